@@ -0,0 +1,111 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#include <AngleCalculator.h>
+#include <BatchAngleCalculator.h>
+
+#include "BenchmarkHarness.h"
+#include "Benchmarks.h"
+#include "SyntheticBodies.h"
+
+namespace
+{
+    Eigen::Vector3d ToVector(const k4abt_body_t& body, k4abt_joint_id_t joint)
+    {
+        const k4a_float3_t& position = body.skeleton.joints[joint].position;
+        return Eigen::Vector3d(position.xyz.x, position.xyz.y, position.xyz.z);
+    }
+
+    // Reference implementation: one call of the scalar AngleCalculator functions per angle and body
+    float ScalarAngle(const k4abt_body_t& body, const JointAngleDefinition& definition)
+    {
+        const Eigen::Vector3d p1 = ToVector(body, definition.Joints[0]);
+        const Eigen::Vector3d p2 = ToVector(body, definition.Joints[1]);
+        const Eigen::Vector3d p3 = ToVector(body, definition.Joints[2]);
+        try
+        {
+            switch (definition.Kind)
+            {
+            case JointAngleKind::Unsigned:
+                return static_cast<float>(CalculateAngle(p1, p2, p3, (p1 - p2).cross(p3 - p2)));
+            case JointAngleKind::Signed:
+                return static_cast<float>(CalculateAngle(p1, p2, p3, CalculateNormalVector(
+                    ToVector(body, definition.Plane[0]), ToVector(body, definition.Plane[1]), ToVector(body, definition.Plane[2]))));
+            case JointAngleKind::Projected:
+                return static_cast<float>(CalculateProjectedAngle(
+                    ToVector(body, definition.Plane[0]), ToVector(body, definition.Plane[1]), ToVector(body, definition.Plane[2]), p1, p2, p3));
+            }
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+        return std::nanf("");
+    }
+
+    void RunForBodyCount(size_t bodyCount, const std::string& filter)
+    {
+        const std::vector<k4abt_body_t> bodies = Benchmark::CreateSyntheticBodies(bodyCount);
+        const std::vector<JointAngleDefinition>& definitions = GetClinicalJointAngleDefinitions();
+
+        std::vector<float> scalarDegrees(definitions.size() * bodyCount);
+        auto scalar = [&]() {
+            for (size_t angle = 0; angle < definitions.size(); angle++)
+            {
+                for (size_t body = 0; body < bodyCount; body++)
+                {
+                    scalarDegrees[angle * bodyCount + body] = ScalarAngle(bodies[body], definitions[angle]);
+                }
+            }
+            Benchmark::DoNotOptimize(scalarDegrees[0]);
+        };
+
+        BatchAngleCalculator calculator(definitions);
+        JointPositionsSoA positions;
+        JointAngleBatch batch;
+        auto batched = [&]() {
+            positions.Assign(bodies);
+            calculator.Compute(positions, batch);
+            Benchmark::DoNotOptimize(batch.Degrees[0]);
+        };
+
+        const std::string suffix = "/" + std::to_string(definitions.size()) + "angles/" + std::to_string(bodyCount) + "bodies";
+        if (Benchmark::Matches("angles/scalar" + suffix, filter))
+        {
+            Benchmark::Print(Benchmark::Run("angles/scalar" + suffix, scalar));
+        }
+        if (Benchmark::Matches("angles/batch" + suffix, filter))
+        {
+            Benchmark::Print(Benchmark::Run("angles/batch" + suffix, batched));
+        }
+
+        // Both paths must agree before the timings mean anything
+        if (!Benchmark::Matches("angles/check" + suffix, filter))
+        {
+            return;
+        }
+        scalar();
+        batched();
+        float maxDifference = 0.f;
+        for (size_t lane = 0; lane < scalarDegrees.size(); lane++)
+        {
+            if (batch.ValidMask[lane] != 0 && !std::isnan(scalarDegrees[lane]))
+            {
+                maxDifference = std::max(maxDifference, std::abs(scalarDegrees[lane] - batch.Degrees[lane]));
+            }
+        }
+        printf("%-48s %14.5f deg max difference\n", ("angles/check" + suffix).c_str(), maxDifference);
+    }
+}
+
+void RunAngleCalculatorBenchmarks(const std::string& filter)
+{
+    for (size_t bodyCount : { 1, 6 })
+    {
+        RunForBodyCount(bodyCount, filter);
+    }
+}
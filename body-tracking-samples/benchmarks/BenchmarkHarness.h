@@ -0,0 +1,80 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <AllocationCounter.h>
+
+namespace Benchmark
+{
+    struct Result
+    {
+        std::string Name;
+        uint64_t Iterations = 0;
+        double NanosecondsPerIteration = 0;
+        double AllocationsPerIteration = 0;   // Heap allocations, counted when main.cpp replaces operator new
+    };
+
+    inline volatile char g_doNotOptimizeSink;
+
+    // Keeps the compiler from optimizing away the computation of a value
+    template <typename T>
+    inline void DoNotOptimize(const T& value)
+    {
+        g_doNotOptimizeSink = *reinterpret_cast<const volatile char*>(&value);
+    }
+
+    // Run an iteration (one frame worth of work) repeatedly for at least minimumDuration
+    template <typename Function>
+    Result Run(const std::string& name, Function&& iteration, std::chrono::milliseconds minimumDuration = std::chrono::milliseconds(300))
+    {
+        using namespace std::chrono;
+
+        // Warm up caches and lazily sized buffers
+        iteration();
+
+        Result result;
+        result.Name = name;
+
+        uint64_t batchSize = 1;
+        nanoseconds elapsed = nanoseconds::zero();
+        const size_t allocationsBefore = GetAllocationCount();
+        const auto start = steady_clock::now();
+        while (elapsed < minimumDuration)
+        {
+            for (uint64_t i = 0; i < batchSize; i++)
+            {
+                iteration();
+            }
+            result.Iterations += batchSize;
+            batchSize = std::min<uint64_t>(batchSize * 2, 1 << 16);
+            elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+        }
+        const size_t allocations = GetAllocationCount() - allocationsBefore;
+
+        result.NanosecondsPerIteration = static_cast<double>(elapsed.count()) / static_cast<double>(result.Iterations);
+        result.AllocationsPerIteration = static_cast<double>(allocations) / static_cast<double>(result.Iterations);
+        return result;
+    }
+
+    inline void Print(const Result& result)
+    {
+        printf("%-48s %14.1f ns/frame %10.1f allocs/frame %12llu frames\n",
+            result.Name.c_str(),
+            result.NanosecondsPerIteration,
+            result.AllocationsPerIteration,
+            static_cast<unsigned long long>(result.Iterations));
+    }
+
+    // Returns true if the benchmark should run given the optional name filter from the command line
+    inline bool Matches(const std::string& name, const std::string& filter)
+    {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+}
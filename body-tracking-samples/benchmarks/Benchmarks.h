@@ -0,0 +1,18 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <string>
+
+// Each function runs the benchmarks of one area whose name contains filter (all if empty)
+void RunAngleCalculatorBenchmarks(const std::string& filter);
+void RunSkeletonSmootherBenchmarks(const std::string& filter);
+void RunPointCloudBenchmarks(const std::string& filter);
+void RunFloorDetectorBenchmarks(const std::string& filter);
+void RunExportBenchmarks(const std::string& filter);
+void RunJumpAnalysisBenchmarks(const std::string& filter);
+void RunFusionBenchmarks(const std::string& filter);
+void RunLatencyRecorderBenchmarks(const std::string& filter);
+void RunSkeletonCodecBenchmarks(const std::string& filter);
+void RunSessionStoreBenchmarks(const std::string& filter);
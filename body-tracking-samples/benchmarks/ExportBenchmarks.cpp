@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <Addition.h>
+#include <BodyFrameJson.h>
+#include <MetricsPipeline.h>
+
+#include "BenchmarkHarness.h"
+#include "Benchmarks.h"
+#include "SyntheticBodies.h"
+
+namespace
+{
+    template <typename Joints>
+    void RunCsvExport(const std::string& name, const std::vector<k4abt_body_t>& bodies, const FrameMetrics& metrics)
+    {
+        // Written to a temporary file, so the timings include the stream but not a slow disk
+        const std::filesystem::path fileName = std::filesystem::temp_directory_path() / "body_tracking_benchmarks.csv";
+        {
+            std::ofstream csvFile(fileName, std::ios::trunc);
+            uint64_t timestamp = 0;
+            Benchmark::Print(Benchmark::Run(name, [&]() {
+                timestamp += 33333;
+                SaveMultipleBodiesToCSV<Joints>(bodies, metrics, csvFile, timestamp, timestamp * 1000);
+            }));
+        }
+        std::filesystem::remove(fileName);
+    }
+}
+
+void RunExportBenchmarks(const std::string& filter)
+{
+    const std::vector<k4abt_body_t> bodies = Benchmark::CreateSyntheticBodies(6);
+    MetricsPipeline metricsPipeline(GetDefaultMetricsConfig());
+    const FrameMetrics& metrics = metricsPipeline.Compute(bodies, 0);
+
+    if (Benchmark::Matches("export/csv/6bodies", filter))
+    {
+        RunCsvExport<JointProfiles::Full>("export/csv/6bodies", bodies, metrics);
+    }
+    if (Benchmark::Matches("export/csv/6bodies/legs", filter))
+    {
+        RunCsvExport<JointProfiles::Legs>("export/csv/6bodies/legs", bodies, metrics);
+    }
+
+    // JSON object of one frame as built by offline_processor, which keeps all frames in memory
+    if (Benchmark::Matches("export/offline_json/6bodies", filter))
+    {
+        int frameId = 0;
+        Benchmark::Print(Benchmark::Run("export/offline_json/6bodies", [&]() {
+            nlohmann::json frame = body_frame_to_json(static_cast<uint64_t>(frameId) * 33333, frameId, bodies);
+            frameId++;
+            Benchmark::DoNotOptimize(frame);
+        }));
+    }
+}
@@ -0,0 +1,71 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <cmath>
+#include <cstdio>
+#include <optional>
+#include <vector>
+
+#include <FloorDetector.h>
+#include <FrameArena.h>
+#include <PointCloudGenerator.h>
+#include <WorkerPool.h>
+
+#include "BenchmarkHarness.h"
+#include "Benchmarks.h"
+#include "SyntheticScene.h"
+
+void RunFloorDetectorBenchmarks(const std::string& filter)
+{
+    // Settings of the floor detector sample
+    const int downsampleStep = 2;
+    const size_t minimumFloorPointCount = 1024 / (downsampleStep * downsampleStep);
+
+    const k4a_calibration_t calibration = Benchmark::CreateSyntheticCalibration();
+    const k4a_imu_sample_t imuSample = Benchmark::CreateSyntheticImuSample();
+    Samples::PointCloudGenerator generator(calibration);
+    k4a_image_t depthImage = Benchmark::CreateSyntheticDepthImage(calibration);
+    generator.Update(depthImage);
+    k4a_image_release(depthImage);
+    const std::vector<k4a_float3_t> cloudPoints = generator.GetCloudPoints(downsampleStep);
+
+    // Stateless full search of every frame
+    if (Benchmark::Matches("floor/detect", filter))
+    {
+        Benchmark::Print(Benchmark::Run("floor/detect", [&]() {
+            std::optional<Samples::Plane> floor = Samples::FloorDetector::TryDetectFloorPlane(
+                cloudPoints, imuSample, calibration, minimumFloorPointCount);
+            Benchmark::DoNotOptimize(floor);
+        }));
+    }
+
+    // Tracker of the sample: after the first frame it only searches a band around the locked floor
+    if (Benchmark::Matches("floor/tracker", filter))
+    {
+        Samples::FrameArena arena;
+        Samples::WorkerPool workers;
+        Samples::FloorTracker tracker{ minimumFloorPointCount, arena, workers };
+        Benchmark::Print(Benchmark::Run("floor/tracker", [&]() {
+            arena.Reset();
+            std::optional<Samples::Plane> floor = tracker.Update(cloudPoints, imuSample, calibration);
+            Benchmark::DoNotOptimize(floor);
+        }));
+
+        // The timing above only means something if the frames took the band path, and the same floor every frame
+        // has to make the tracker stable
+        arena.Reset();
+        const std::optional<Samples::Plane> tracked = tracker.Update(cloudPoints, imuSample, calibration);
+        const std::optional<Samples::Plane> detected = Samples::FloorDetector::TryDetectFloorPlane(
+            cloudPoints, imuSample, calibration, minimumFloorPointCount);
+        if (tracked.has_value() && detected.has_value())
+        {
+            const float elevationDifference = std::abs(detected->Normal.Dot(tracked->Origin) - detected->Normal.Dot(detected->Origin));
+            printf("%-48s %14.2f mm from floor/detect, stability %.2f, %s\n", "floor/tracker/check", elevationDifference * 1000.0f,
+                tracker.GetStability(), tracker.IsFoundInBand() ? "band search" : "FELL BACK TO FULL SEARCH");
+        }
+        else
+        {
+            printf("%-48s %s\n", "floor/tracker/check", "NO FLOOR");
+        }
+    }
+}
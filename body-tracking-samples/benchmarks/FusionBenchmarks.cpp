@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <array>
+#include <cmath>
+#include <random>
+
+#include <SkeletonFusion.h>
+
+#include "BenchmarkHarness.h"
+#include "Benchmarks.h"
+#include "SyntheticBodies.h"
+
+namespace
+{
+    // World point seen from a camera: the inverse of CameraExtrinsics::TransformPoint
+    k4a_float3_t ToCamera(const Samples::CameraExtrinsics& extrinsics, const k4a_float3_t& world)
+    {
+        const std::array<float, 9>& r = extrinsics.Rotation;
+        const float dx = world.xyz.x - extrinsics.Translation[0];
+        const float dy = world.xyz.y - extrinsics.Translation[1];
+        const float dz = world.xyz.z - extrinsics.Translation[2];
+        k4a_float3_t camera;
+        camera.xyz.x = r[0] * dx + r[3] * dy + r[6] * dz;
+        camera.xyz.y = r[1] * dx + r[4] * dy + r[7] * dz;
+        camera.xyz.z = r[2] * dx + r[5] * dy + r[8] * dz;
+        return camera;
+    }
+}
+
+void RunFusionBenchmarks(const std::string& filter)
+{
+    // Four cameras 1.5 m above the floor around the room, each seeing the same six bodies with its own noise
+    constexpr uint32_t CameraCount = 4;
+    k4a_float3_t up;
+    up.xyz = { 0.f, -std::cos(0.3f), std::sin(0.3f) };
+    k4a_float3_t floorPoint;
+    floorPoint.xyz = { -1.5f * up.xyz.x, -1.5f * up.xyz.y, -1.5f * up.xyz.z };
+    const Samples::CameraExtrinsics floor = Samples::CameraExtrinsics::FromFloor(up, floorPoint);
+
+    std::vector<Samples::CameraExtrinsics> extrinsics;
+    for (uint32_t c = 0; c < CameraCount; c++)
+    {
+        const float yaw = static_cast<float>(c) * 1.5708f;
+        extrinsics.push_back(floor.PlacedOnFloor(yaw, 3000.f * std::sin(yaw), -3000.f * std::cos(yaw)));
+    }
+
+    const std::vector<k4abt_body_t> bodies = Benchmark::CreateSyntheticBodies(6);
+    std::mt19937 generator(11);
+    std::normal_distribution<float> noise(0.f, 20.f);
+    Samples::MultiViewFrame frame;
+    frame.DeviceCount = CameraCount;
+    for (uint32_t c = 0; c < CameraCount; c++)
+    {
+        Samples::DeviceView view;
+        view.DeviceIndex = c;
+        view.Bodies = bodies;
+        for (k4abt_body_t& body : view.Bodies)
+        {
+            body.id += 100 * c;
+            for (k4abt_joint_t& joint : body.skeleton.joints)
+            {
+                joint.position = ToCamera(extrinsics[c], joint.position);
+                joint.position.xyz.x += noise(generator);
+                joint.position.xyz.z += noise(generator);
+            }
+        }
+        frame.Views.push_back(std::move(view));
+    }
+
+    if (Benchmark::Matches("fusion/4cameras/6bodies", filter))
+    {
+        Samples::SkeletonFusion fusion(extrinsics);
+        Benchmark::Print(Benchmark::Run("fusion/4cameras/6bodies", [&]() {
+            const std::vector<k4abt_body_t>& fused = fusion.Fuse(frame);
+            Benchmark::DoNotOptimize(fused[0]);
+        }));
+    }
+}
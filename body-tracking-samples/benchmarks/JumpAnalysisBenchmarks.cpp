@@ -0,0 +1,49 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <vector>
+
+#include <DigitalSignalProcessing.h>
+#include <JumpEvaluator.h>
+
+#include "BenchmarkHarness.h"
+#include "Benchmarks.h"
+#include "SyntheticScene.h"
+
+void RunJumpAnalysisBenchmarks(const std::string& filter)
+{
+    const Benchmark::SyntheticJump jump = Benchmark::CreateSyntheticJump();
+    std::vector<float> pelvisHeight(jump.Bodies.size());
+    for (size_t i = 0; i < jump.Bodies.size(); i++)
+    {
+        pelvisHeight[i] = -jump.Bodies[i].skeleton.joints[K4ABT_JOINT_PELVIS].position.xyz.y;
+    }
+    const std::string suffix = "/" + std::to_string(jump.Bodies.size()) + "frames";
+
+    // Signal processing of one jump session, with the filter width of JumpEvaluator
+    if (Benchmark::Matches("jump/moving_average" + suffix, filter))
+    {
+        Benchmark::Print(Benchmark::Run("jump/moving_average" + suffix, [&]() {
+            std::vector<float> filtered = DSP::MovingAverage(pelvisHeight, 6);
+            Benchmark::DoNotOptimize(filtered[0]);
+        }));
+    }
+    if (Benchmark::Matches("jump/first_derivative" + suffix, filter))
+    {
+        Benchmark::Print(Benchmark::Run("jump/first_derivative" + suffix, [&]() {
+            std::vector<float> derivative = DSP::FirstDerivate(pelvisHeight);
+            Benchmark::DoNotOptimize(derivative[0]);
+        }));
+    }
+
+    // Whole analysis that runs when a jump session ends
+    if (Benchmark::Matches("jump/analysis" + suffix, filter))
+    {
+        JumpEvaluator evaluator;
+        evaluator.LoadJumpData(jump.Bodies, jump.TimestampsInUsec);
+        Benchmark::Print(Benchmark::Run("jump/analysis" + suffix, [&]() {
+            JumpResultsData results = evaluator.CalculateJumpResults();
+            Benchmark::DoNotOptimize(results);
+        }));
+    }
+}
@@ -0,0 +1,31 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <thread>
+
+#include <LatencyRecorder.h>
+
+#include "BenchmarkHarness.h"
+#include "Benchmarks.h"
+
+void RunLatencyRecorderBenchmarks(const std::string& filter)
+{
+    // Cost of timing one stage, paid several times per frame by the viewer
+    if (Benchmark::Matches("latency/scope", filter))
+    {
+        Benchmark::Print(Benchmark::Run("latency/scope", []() {
+            LatencyScope latency(PipelineStage::Metrics);
+        }));
+    }
+
+    // Threads keep spans only if tracing was enabled before their first span, so trace on a new thread
+    if (Benchmark::Matches("latency/scope/trace", filter))
+    {
+        g_latencyRecorder.EnableTrace();
+        std::thread([]() {
+            Benchmark::Print(Benchmark::Run("latency/scope/trace", []() {
+                LatencyScope latency(PipelineStage::Metrics);
+            }));
+        }).join();
+    }
+}
@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <vector>
+
+#include <BodyTrackingHelpers.h>
+#include <PointCloudGenerator.h>
+#include <Window3dWrapper.h>
+
+#include "BenchmarkHarness.h"
+#include "Benchmarks.h"
+#include "SyntheticScene.h"
+
+void RunPointCloudBenchmarks(const std::string& filter)
+{
+    const k4a_calibration_t calibration = Benchmark::CreateSyntheticCalibration();
+    k4a_image_t pointCloudImage = Benchmark::CreateSyntheticPointCloudImage(calibration);
+    const size_t pixelCount = static_cast<size_t>(calibration.depth_camera_calibration.resolution_width) *
+        calibration.depth_camera_calibration.resolution_height;
+
+    // Window3dWrapper::UpdatePointClouds after the SDK transformation, the vertices are cleared by Render
+    std::vector<Visualization::PointCloudVertex> vertices;
+    const std::vector<Color> noColors;
+    if (Benchmark::Matches("window3d/point_cloud", filter))
+    {
+        Benchmark::Print(Benchmark::Run("window3d/point_cloud", [&]() {
+            vertices.clear();
+            Window3dWrapper::ConvertPointCloud(pointCloudImage, noColors, vertices);
+            Benchmark::DoNotOptimize(vertices[0]);
+        }));
+    }
+
+    // Same with the body index map colors of simple_3d_viewer
+    const std::vector<Color> bodyColors(pixelCount, g_bodyColors[0]);
+    if (Benchmark::Matches("window3d/point_cloud/colored", filter))
+    {
+        Benchmark::Print(Benchmark::Run("window3d/point_cloud/colored", [&]() {
+            vertices.clear();
+            Window3dWrapper::ConvertPointCloud(pointCloudImage, bodyColors, vertices);
+            Benchmark::DoNotOptimize(vertices[0]);
+        }));
+    }
+    k4a_image_release(pointCloudImage);
+
+    // Float conversion of the floor detector sample, for all pixels and with its down-sampling step
+    Samples::PointCloudGenerator generator(calibration);
+    k4a_image_t depthImage = Benchmark::CreateSyntheticDepthImage(calibration);
+    generator.Update(depthImage);
+    k4a_image_release(depthImage);
+    for (int step : { 1, 2 })
+    {
+        const std::string name = "floor/point_cloud/step" + std::to_string(step);
+        if (Benchmark::Matches(name, filter))
+        {
+            Benchmark::Print(Benchmark::Run(name, [&]() {
+                Benchmark::DoNotOptimize(generator.GetCloudPoints(step)[0]);
+            }));
+        }
+    }
+}
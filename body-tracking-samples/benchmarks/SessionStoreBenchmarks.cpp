@@ -0,0 +1,212 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <Addition.h>
+#include <SessionStore.h>
+
+#include "BenchmarkHarness.h"
+#include "Benchmarks.h"
+#include "SyntheticBodies.h"
+
+namespace
+{
+    constexpr uint64_t FramePeriodUsec = 33333;
+    constexpr size_t SessionCount = 3;
+    constexpr size_t FramesPerSession = 1800;
+
+    struct StoredFrame
+    {
+        size_t Segment = 0;
+        uint64_t TimestampUsec = 0;
+        std::vector<k4abt_body_t> Bodies;
+    };
+
+    // Three one minute sessions appended to one file like the viewer does. Bodies 1 and 2 are always there, body 3
+    // from 20 to 40 seconds and body 4 in every other block of 100 frames. The device timestamps of every session
+    // start again.
+    void WriteSessions(const std::filesystem::path& fileName)
+    {
+        std::filesystem::remove(fileName);
+        const std::vector<k4abt_body_t> pose = Benchmark::CreateSyntheticBodies(4);
+        for (size_t session = 0; session < SessionCount; session++)
+        {
+            std::ofstream csvFile(fileName, std::ios::app);
+            for (size_t frame = 0; frame < FramesPerSession; frame++)
+            {
+                std::vector<k4abt_body_t> bodies;
+                for (size_t b = 0; b < pose.size(); b++)
+                {
+                    const bool present = b < 2 || (b == 2 && frame >= 600 && frame < 1200) || (b == 3 && (frame / 100) % 2 == 1);
+                    if (present)
+                    {
+                        bodies.push_back(pose[b]);
+                        for (k4abt_joint_t& joint : bodies.back().skeleton.joints)
+                        {
+                            joint.position.xyz.x += 300.f * std::sin(0.05f * static_cast<float>(frame + b));
+                        }
+                    }
+                }
+
+                FrameMetrics metrics;
+                metrics.DeviceTimestampUsec = 200000 + frame * FramePeriodUsec;
+                SaveMultipleBodiesToCSV<JointProfiles::Full>(bodies, metrics, csvFile, metrics.DeviceTimestampUsec, 0);
+            }
+        }
+    }
+
+    // What an analysis did before: parse every row of the file
+    std::vector<StoredFrame> ParseAll(const SessionStore& store)
+    {
+        std::vector<StoredFrame> frames;
+        for (size_t segment = 0; segment < store.GetSegments().size(); segment++)
+        {
+            for (const SessionSpan& span : store.FindFrames(segment))
+            {
+                store.ReadFrames(span, [&](uint64_t timestampUsec, const std::vector<k4abt_body_t>& bodies) {
+                    frames.push_back({ segment, timestampUsec, bodies });
+                });
+            }
+        }
+        return frames;
+    }
+
+    bool SameBody(const k4abt_body_t& a, const k4abt_body_t& b)
+    {
+        bool same = a.id == b.id;
+        for (int j = 0; same && j < static_cast<int>(K4ABT_JOINT_COUNT); j++)
+        {
+            same = a.skeleton.joints[j].position.xyz.x == b.skeleton.joints[j].position.xyz.x &&
+                   a.skeleton.joints[j].position.xyz.y == b.skeleton.joints[j].position.xyz.y &&
+                   a.skeleton.joints[j].position.xyz.z == b.skeleton.joints[j].position.xyz.z &&
+                   a.skeleton.joints[j].confidence_level == b.skeleton.joints[j].confidence_level;
+        }
+        return same;
+    }
+
+    // Compares the queries with filtering the full parse
+    void Check(const SessionStore& store, uint64_t startUsec, uint64_t endUsec, const std::string& name)
+    {
+        const std::vector<StoredFrame> all = ParseAll(store);
+        const size_t lastSegment = store.GetSegments().size() - 1;
+
+        std::vector<StoredFrame> expected;
+        size_t expectedCrowded = 0;
+        for (const StoredFrame& frame : all)
+        {
+            expectedCrowded += frame.Bodies.size() >= 3 ? 1 : 0;
+            for (const k4abt_body_t& body : frame.Bodies)
+            {
+                if (frame.Segment == lastSegment && body.id == 3 && frame.TimestampUsec >= startUsec && frame.TimestampUsec <= endUsec)
+                {
+                    expected.push_back({ frame.Segment, frame.TimestampUsec, { body } });
+                }
+            }
+        }
+
+        std::vector<StoredFrame> found;
+        for (const SessionSpan& span : store.FindBody(lastSegment, 3, startUsec, endUsec))
+        {
+            store.ReadFrames(span, [&](uint64_t timestampUsec, const std::vector<k4abt_body_t>& bodies) {
+                found.push_back({ span.Segment, timestampUsec, bodies });
+            });
+        }
+        bool same = found.size() == expected.size() && !found.empty();
+        for (size_t i = 0; same && i < found.size(); i++)
+        {
+            same = found[i].TimestampUsec == expected[i].TimestampUsec && found[i].Bodies.size() == 1 &&
+                   SameBody(found[i].Bodies[0], expected[i].Bodies[0]);
+        }
+
+        size_t crowded = 0;
+        for (size_t segment = 0; segment < store.GetSegments().size(); segment++)
+        {
+            for (const SessionSpan& span : store.FindFramesWithBodies(segment, 3))
+            {
+                store.ReadFrames(span, [&](uint64_t, const std::vector<k4abt_body_t>& bodies) {
+                    same = same && bodies.size() >= 3;
+                    crowded++;
+                });
+            }
+        }
+        same = same && crowded == expectedCrowded && store.GetSegments().size() == SessionCount;
+
+        printf("%-48s %14zu segments, queries %s the full parse\n", name.c_str(), store.GetSegments().size(), same ? "match" : "DIFFER from");
+    }
+}
+
+void RunSessionStoreBenchmarks(const std::string& filter)
+{
+    const std::string names[] = { "store/open/scan", "store/open/index_file", "store/query/body_2s", "store/full_parse", "store/check" };
+    bool any = false;
+    for (const std::string& name : names)
+    {
+        any = any || Benchmark::Matches(name, filter);
+    }
+    if (!any)
+    {
+        return;
+    }
+
+    const std::filesystem::path fileName = std::filesystem::temp_directory_path() / "body_tracking_benchmarks_sessions.csv";
+    WriteSessions(fileName);
+
+    SessionStore store;
+    store.Open(fileName.string());
+
+    // One iteration indexes the whole file
+    if (Benchmark::Matches("store/open/scan", filter))
+    {
+        Benchmark::Print(Benchmark::Run("store/open/scan", [&]() {
+            SessionStore scanned;
+            scanned.Open(fileName.string(), false);
+            Benchmark::DoNotOptimize(scanned.GetSegments()[0].FrameCount);
+        }));
+    }
+
+    if (Benchmark::Matches("store/open/index_file", filter))
+    {
+        Benchmark::Print(Benchmark::Run("store/open/index_file", [&]() {
+            SessionStore loaded;
+            loaded.Open(fileName.string());
+            Benchmark::DoNotOptimize(loaded.GetSegments()[0].FrameCount);
+        }));
+    }
+
+    // Two seconds of body 3 in the last session, as loaded by a jump replay
+    const size_t lastSegment = store.GetSegments().size() - 1;
+    const uint64_t startUsec = store.GetSegments()[lastSegment].StartUsec + 25000000;
+    const uint64_t endUsec = startUsec + 2000000;
+    if (Benchmark::Matches("store/query/body_2s", filter))
+    {
+        Benchmark::Print(Benchmark::Run("store/query/body_2s", [&]() {
+            size_t frameCount = 0;
+            for (const SessionSpan& span : store.FindBody(lastSegment, 3, startUsec, endUsec))
+            {
+                store.ReadFrames(span, [&](uint64_t, const std::vector<k4abt_body_t>&) { frameCount++; });
+            }
+            Benchmark::DoNotOptimize(frameCount);
+        }));
+    }
+
+    if (Benchmark::Matches("store/full_parse", filter))
+    {
+        Benchmark::Print(Benchmark::Run("store/full_parse", [&]() {
+            const std::vector<StoredFrame> frames = ParseAll(store);
+            Benchmark::DoNotOptimize(frames[0].TimestampUsec);
+        }));
+    }
+
+    if (Benchmark::Matches("store/check", filter))
+    {
+        Check(store, startUsec, endUsec, "store/check");
+    }
+
+    std::filesystem::remove(fileName);
+    std::filesystem::remove(fileName.string() + ".index");
+}
@@ -0,0 +1,182 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include <Addition.h>
+#include <SkeletonCodec.h>
+
+#include "BenchmarkHarness.h"
+#include "Benchmarks.h"
+#include "SyntheticBodies.h"
+
+namespace
+{
+    constexpr uint64_t FramePeriodUsec = 33333;
+
+    // Ten seconds of six bodies swaying around their place, with the jitter of tracked joints and the hands
+    // dropping to low confidence now and then
+    std::vector<std::vector<k4abt_body_t>> CreateMovingBodies(size_t frameCount)
+    {
+        const std::vector<k4abt_body_t> pose = Benchmark::CreateSyntheticBodies(6);
+        std::mt19937 generator(11);
+        std::normal_distribution<float> jitter(0.f, 2.f);
+
+        std::vector<std::vector<k4abt_body_t>> frames(frameCount, pose);
+        for (size_t frame = 0; frame < frameCount; frame++)
+        {
+            const float t = static_cast<float>(frame) / 30.f;
+            for (size_t b = 0; b < pose.size(); b++)
+            {
+                const float phase = 2.f * 3.14159265f * 0.3f * t + static_cast<float>(b);
+                for (int j = 0; j < static_cast<int>(K4ABT_JOINT_COUNT); j++)
+                {
+                    k4abt_joint_t& joint = frames[frame][b].skeleton.joints[j];
+                    joint.position.xyz.x += 300.f * std::sin(phase) + jitter(generator);
+                    joint.position.xyz.y += 20.f * std::sin(3.f * phase) + jitter(generator);
+                    joint.position.xyz.z += 200.f * std::cos(phase) + jitter(generator);
+                    const bool hand = j == K4ABT_JOINT_HANDTIP_LEFT || j == K4ABT_JOINT_THUMB_LEFT ||
+                                      j == K4ABT_JOINT_HANDTIP_RIGHT || j == K4ABT_JOINT_THUMB_RIGHT;
+                    if (hand && std::sin(phase) > 0.8f)
+                    {
+                        joint.confidence_level = K4ABT_JOINT_CONFIDENCE_LOW;
+                    }
+                }
+            }
+        }
+        return frames;
+    }
+
+    std::vector<std::vector<uint8_t>> EncodeAll(const std::vector<std::vector<k4abt_body_t>>& frames, SkeletonCodecConfig config)
+    {
+        SkeletonEncoder encoder(config);
+        std::vector<std::vector<uint8_t>> packets(frames.size());
+        for (size_t frame = 0; frame < frames.size(); frame++)
+        {
+            encoder.Encode(frame * FramePeriodUsec, frames[frame], packets[frame]);
+        }
+        return packets;
+    }
+
+    // Bytes of the CSV rows of the frames, without the header and the metric columns
+    double GetCsvBytesPerBody(const std::vector<std::vector<k4abt_body_t>>& frames)
+    {
+        const std::filesystem::path fileName = std::filesystem::temp_directory_path() / "body_tracking_benchmarks_codec.csv";
+        const FrameMetrics noMetrics;
+        uint64_t headerSize = 0;
+        uint64_t fileSize = 0;
+        size_t bodyCount = 0;
+        {
+            std::ofstream csvFile(fileName, std::ios::trunc);
+            for (size_t frame = 0; frame < frames.size(); frame++)
+            {
+                SaveMultipleBodiesToCSV<JointProfiles::Full>(frames[frame], noMetrics, csvFile, frame * FramePeriodUsec, frame * FramePeriodUsec * 1000);
+                if (frame == 0)
+                {
+                    headerSize = static_cast<uint64_t>(csvFile.tellp());
+                }
+                bodyCount += frames[frame].size();
+            }
+            fileSize = static_cast<uint64_t>(csvFile.tellp());
+        }
+        std::filesystem::remove(fileName);
+
+        // The rows of the first frame are written with the header
+        return static_cast<double>(fileSize - headerSize) / static_cast<double>(bodyCount - frames[0].size());
+    }
+
+    void RunCodec(const char* suffix, const std::vector<std::vector<k4abt_body_t>>& frames, SkeletonCodecConfig config,
+                  const std::string& filter)
+    {
+        const std::string encodeName = std::string("codec/encode/6bodies") + suffix;
+        if (Benchmark::Matches(encodeName, filter))
+        {
+            SkeletonEncoder encoder(config);
+            std::vector<uint8_t> packet;
+            uint64_t timestampUsec = 0;
+            size_t frameIndex = 0;
+            Benchmark::Print(Benchmark::Run(encodeName, [&]() {
+                packet.clear();
+                timestampUsec += FramePeriodUsec;
+                encoder.Encode(timestampUsec, frames[frameIndex++ % frames.size()], packet);
+                Benchmark::DoNotOptimize(packet[0]);
+            }));
+        }
+
+        // The frame count is a multiple of the keyframe interval, so the packets can be decoded in a loop
+        const std::vector<std::vector<uint8_t>> packets = EncodeAll(frames, config);
+        const std::string decodeName = std::string("codec/decode/6bodies") + suffix;
+        if (Benchmark::Matches(decodeName, filter))
+        {
+            SkeletonDecoder decoder;
+            std::vector<k4abt_body_t> bodies;
+            uint64_t timestampUsec = 0;
+            size_t frameIndex = 0;
+            Benchmark::Print(Benchmark::Run(decodeName, [&]() {
+                decoder.Decode(packets[frameIndex++ % packets.size()], timestampUsec, bodies);
+                Benchmark::DoNotOptimize(bodies[0]);
+            }));
+        }
+
+        const std::string checkName = std::string("codec/check") + suffix;
+        if (Benchmark::Matches(checkName, filter))
+        {
+            SkeletonDecoder decoder;
+            std::vector<k4abt_body_t> bodies;
+            float maxError = 0.f;
+            bool exact = true;
+            for (size_t frame = 0; frame < frames.size(); frame++)
+            {
+                uint64_t timestampUsec = 0;
+                exact = decoder.Decode(packets[frame], timestampUsec, bodies) && exact && timestampUsec == frame * FramePeriodUsec &&
+                        bodies.size() == frames[frame].size();
+                for (size_t b = 0; exact && b < bodies.size(); b++)
+                {
+                    for (int j = 0; j < static_cast<int>(K4ABT_JOINT_COUNT); j++)
+                    {
+                        const k4abt_joint_t& expected = frames[frame][b].skeleton.joints[j];
+                        const k4abt_joint_t& decoded = bodies[b].skeleton.joints[j];
+                        exact = exact && decoded.confidence_level == expected.confidence_level && bodies[b].id == frames[frame][b].id;
+                        for (int axis = 0; axis < 3; axis++)
+                        {
+                            maxError = std::max(maxError, std::abs(decoded.position.v[axis] - expected.position.v[axis]));
+                        }
+                    }
+                }
+            }
+            printf("%-48s %14.3f mm max position error, ids and confidences %s\n", checkName.c_str(), maxError, exact ? "exact" : "DIFFER");
+        }
+
+        const std::string sizeName = std::string("codec/size") + suffix;
+        if (Benchmark::Matches(sizeName, filter))
+        {
+            size_t bytes = 0;
+            size_t bodyCount = 0;
+            for (size_t frame = 0; frame < frames.size(); frame++)
+            {
+                bytes += packets[frame].size() + (packets[frame].size() < 128 ? 1 : 2);   // With the size of the packet in a file
+                bodyCount += frames[frame].size();
+            }
+            const double bytesPerBody = static_cast<double>(bytes) / static_cast<double>(bodyCount);
+            const double csvBytesPerBody = GetCsvBytesPerBody(frames);
+            printf("%-48s %14.1f bytes/body %9.1fx smaller than CSV\n", sizeName.c_str(), bytesPerBody, csvBytesPerBody / bytesPerBody);
+        }
+    }
+}
+
+void RunSkeletonCodecBenchmarks(const std::string& filter)
+{
+    const std::vector<std::vector<k4abt_body_t>> frames = CreateMovingBodies(300);
+
+    SkeletonCodecConfig config;
+    RunCodec("", frames, config, filter);
+
+    config.QuantizationUm = 100;
+    RunCodec("/0.1mm", frames, config, filter);
+}
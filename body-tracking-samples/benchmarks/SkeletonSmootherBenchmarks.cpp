@@ -0,0 +1,81 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <random>
+
+#include <SkeletonSmoother.h>
+
+#include "BenchmarkHarness.h"
+#include "Benchmarks.h"
+#include "SyntheticBodies.h"
+
+namespace
+{
+    template <typename Joints>
+    void RunSmoother(const char* name, SmoothingFilter filter, const std::vector<k4abt_body_t>& bodies,
+        const std::vector<std::vector<k4abt_body_t>>& frames)
+    {
+        SkeletonSmootherConfig config;
+        config.Filter = filter;
+        BasicSkeletonSmoother<Joints> smoother(config);
+        std::vector<k4abt_body_t> current = bodies;
+        uint64_t timestampUsec = 0;
+        size_t frameIndex = 0;
+        Benchmark::Print(Benchmark::Run(name, [&]() {
+            const std::vector<k4abt_body_t>& frame = frames[frameIndex++ % frames.size()];
+            std::copy(frame.begin(), frame.end(), current.begin());
+            timestampUsec += 33333;
+            smoother.Apply(current, timestampUsec);
+            Benchmark::DoNotOptimize(current[0]);
+        }));
+    }
+}
+
+void RunSkeletonSmootherBenchmarks(const std::string& filter)
+{
+    // Noisy copies of the same bodies, so that the filters see realistic input
+    const std::vector<k4abt_body_t> bodies = Benchmark::CreateSyntheticBodies(6);
+    std::mt19937 generator(7);
+    std::normal_distribution<float> noise(0.f, 10.f);
+    std::vector<std::vector<k4abt_body_t>> frames(64, bodies);
+    for (auto& frame : frames)
+    {
+        for (k4abt_body_t& body : frame)
+        {
+            for (k4abt_joint_t& joint : body.skeleton.joints)
+            {
+                joint.position.xyz.x += noise(generator);
+                joint.position.xyz.y += noise(generator);
+                joint.position.xyz.z += noise(generator);
+            }
+        }
+    }
+
+    const std::pair<const char*, SmoothingFilter> filters[] =
+    {
+        { "smoothing/one_euro/6bodies", SmoothingFilter::OneEuro },
+        { "smoothing/kalman/6bodies", SmoothingFilter::Kalman },
+    };
+    for (const auto& entry : filters)
+    {
+        if (Benchmark::Matches(entry.first, filter))
+        {
+            RunSmoother<JointProfiles::Full>(entry.first, entry.second, bodies, frames);
+        }
+    }
+
+    // Same filters for the joints of the legs only
+    const std::pair<const char*, SmoothingFilter> legFilters[] =
+    {
+        { "smoothing/one_euro/6bodies/legs", SmoothingFilter::OneEuro },
+        { "smoothing/kalman/6bodies/legs", SmoothingFilter::Kalman },
+    };
+    for (const auto& entry : legFilters)
+    {
+        if (Benchmark::Matches(entry.first, filter))
+        {
+            RunSmoother<JointProfiles::Legs>(entry.first, entry.second, bodies, frames);
+        }
+    }
+}
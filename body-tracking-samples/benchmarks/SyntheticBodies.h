@@ -0,0 +1,73 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <random>
+#include <vector>
+#include <k4abttypes.h>
+
+namespace Benchmark
+{
+    // Standing pose in depth camera space, in millimeters (x right, y down, z forward)
+    const std::array<k4a_float3_t, K4ABT_JOINT_COUNT> g_standingPose =
+    { {
+        {    0.f,    0.f, 2500.f },  // PELVIS
+        {    0.f, -200.f, 2510.f },  // SPINE_NAVEL
+        {    0.f, -380.f, 2520.f },  // SPINE_CHEST
+        {    0.f, -560.f, 2520.f },  // NECK
+        {  -40.f, -520.f, 2520.f },  // CLAVICLE_LEFT
+        { -180.f, -500.f, 2520.f },  // SHOULDER_LEFT
+        { -220.f, -230.f, 2500.f },  // ELBOW_LEFT
+        { -240.f,   20.f, 2460.f },  // WRIST_LEFT
+        { -245.f,   90.f, 2450.f },  // HAND_LEFT
+        { -250.f,  160.f, 2440.f },  // HANDTIP_LEFT
+        { -210.f,   80.f, 2420.f },  // THUMB_LEFT
+        {   40.f, -520.f, 2520.f },  // CLAVICLE_RIGHT
+        {  180.f, -500.f, 2520.f },  // SHOULDER_RIGHT
+        {  220.f, -230.f, 2500.f },  // ELBOW_RIGHT
+        {  240.f,   20.f, 2460.f },  // WRIST_RIGHT
+        {  245.f,   90.f, 2450.f },  // HAND_RIGHT
+        {  250.f,  160.f, 2440.f },  // HANDTIP_RIGHT
+        {  210.f,   80.f, 2420.f },  // THUMB_RIGHT
+        { -100.f,   20.f, 2500.f },  // HIP_LEFT
+        { -110.f,  420.f, 2480.f },  // KNEE_LEFT
+        { -115.f,  820.f, 2520.f },  // ANKLE_LEFT
+        { -120.f,  870.f, 2400.f },  // FOOT_LEFT
+        {  100.f,   20.f, 2500.f },  // HIP_RIGHT
+        {  110.f,  420.f, 2480.f },  // KNEE_RIGHT
+        {  115.f,  820.f, 2520.f },  // ANKLE_RIGHT
+        {  120.f,  870.f, 2400.f },  // FOOT_RIGHT
+        {    0.f, -680.f, 2510.f },  // HEAD
+        {    0.f, -660.f, 2420.f },  // NOSE
+        {  -35.f, -700.f, 2440.f },  // EYE_LEFT
+        {  -75.f, -690.f, 2500.f },  // EAR_LEFT
+        {   35.f, -700.f, 2440.f },  // EYE_RIGHT
+        {   75.f, -690.f, 2500.f },  // EAR_RIGHT
+    } };
+
+    // Deterministic bodies: the standing pose shifted sideways per body plus a little noise
+    inline std::vector<k4abt_body_t> CreateSyntheticBodies(size_t bodyCount, uint32_t seed = 42)
+    {
+        std::mt19937 generator(seed);
+        std::normal_distribution<float> noise(0.f, 15.f);
+
+        std::vector<k4abt_body_t> bodies(bodyCount);
+        for (size_t b = 0; b < bodyCount; b++)
+        {
+            bodies[b].id = static_cast<uint32_t>(b + 1);
+            const float offsetX = (static_cast<float>(b) - bodyCount / 2.f) * 700.f;
+            for (int j = 0; j < static_cast<int>(K4ABT_JOINT_COUNT); j++)
+            {
+                k4abt_joint_t& joint = bodies[b].skeleton.joints[j];
+                joint.position.xyz.x = g_standingPose[j].xyz.x + offsetX + noise(generator);
+                joint.position.xyz.y = g_standingPose[j].xyz.y + noise(generator);
+                joint.position.xyz.z = g_standingPose[j].xyz.z + noise(generator);
+                joint.orientation = { 1.f, 0.f, 0.f, 0.f };
+                joint.confidence_level = K4ABT_JOINT_CONFIDENCE_MEDIUM;
+            }
+        }
+        return bodies;
+    }
+}
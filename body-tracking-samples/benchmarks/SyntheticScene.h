@@ -0,0 +1,174 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <k4a/k4a.h>
+#include <k4abttypes.h>
+
+#include "SyntheticBodies.h"
+
+namespace Benchmark
+{
+    // NFOV unbinned depth camera without lens distortion, with all cameras and sensors at the same place
+    inline k4a_calibration_t CreateSyntheticCalibration()
+    {
+        k4a_calibration_t calibration;
+        std::memset(&calibration, 0, sizeof(calibration));
+        calibration.depth_mode = K4A_DEPTH_MODE_NFOV_UNBINNED;
+        calibration.color_resolution = K4A_COLOR_RESOLUTION_OFF;
+
+        k4a_calibration_camera_t& depth = calibration.depth_camera_calibration;
+        depth.resolution_width = 640;
+        depth.resolution_height = 576;
+        depth.metric_radius = 1.74f;
+        depth.intrinsics.type = K4A_CALIBRATION_LENS_DISTORTION_MODEL_BROWN_CONRADY;
+        depth.intrinsics.parameter_count = 14;
+        depth.intrinsics.parameters.param.cx = 320.f;
+        depth.intrinsics.parameters.param.cy = 288.f;
+        depth.intrinsics.parameters.param.fx = 504.f;
+        depth.intrinsics.parameters.param.fy = 504.f;
+        depth.intrinsics.parameters.param.metric_radius = 1.74f;
+        depth.extrinsics.rotation[0] = depth.extrinsics.rotation[4] = depth.extrinsics.rotation[8] = 1.f;
+        calibration.color_camera_calibration = depth;
+
+        for (auto& row : calibration.extrinsics)
+        {
+            for (k4a_calibration_extrinsics_t& extrinsics : row)
+            {
+                extrinsics.rotation[0] = extrinsics.rotation[4] = extrinsics.rotation[8] = 1.f;
+            }
+        }
+        return calibration;
+    }
+
+    // Device at rest and level: the accelerometer measures 1 g upwards, which is -y in depth camera space
+    inline k4a_imu_sample_t CreateSyntheticImuSample()
+    {
+        k4a_imu_sample_t sample;
+        std::memset(&sample, 0, sizeof(sample));
+        sample.temperature = 30.f;
+        sample.acc_sample = { 0.f, -9.81f, 0.f };
+        return sample;
+    }
+
+    // Depth image of a room seen by the synthetic camera: a floor 1 m below the camera and a wall 4 m in front of it.
+    // The caller releases the image.
+    inline k4a_image_t CreateSyntheticDepthImage(const k4a_calibration_t& calibration)
+    {
+        const k4a_calibration_camera_t& camera = calibration.depth_camera_calibration;
+        const int width = camera.resolution_width;
+        const int height = camera.resolution_height;
+
+        k4a_image_t depthImage = nullptr;
+        if (k4a_image_create(K4A_IMAGE_FORMAT_DEPTH16, width, height, width * static_cast<int>(sizeof(uint16_t)), &depthImage) != K4A_RESULT_SUCCEEDED)
+        {
+            throw std::runtime_error("Create synthetic depth image failed!");
+        }
+
+        const float FloorDistanceInMM = 1000.f;
+        const float WallDistanceInMM = 4000.f;
+        const auto& intrinsics = camera.intrinsics.parameters.param;
+        uint16_t* depth = reinterpret_cast<uint16_t*>(k4a_image_get_buffer(depthImage));
+        for (int v = 0; v < height; v++)
+        {
+            // A ray through row v hits the floor (y = FloorDistanceInMM) at z = FloorDistanceInMM / ray.y
+            const float rayY = (static_cast<float>(v) - intrinsics.cy) / intrinsics.fy;
+            const float z = rayY > 0.f ? std::min(FloorDistanceInMM / rayY, WallDistanceInMM) : WallDistanceInMM;
+            std::fill(depth + v * width, depth + (v + 1) * width, static_cast<uint16_t>(z));
+        }
+        return depthImage;
+    }
+
+    // Point cloud image (int16 x, y, z per pixel in millimeters) of the synthetic room, as produced by
+    // k4a_transformation_depth_image_to_point_cloud. The caller releases the image.
+    inline k4a_image_t CreateSyntheticPointCloudImage(const k4a_calibration_t& calibration)
+    {
+        const int width = calibration.depth_camera_calibration.resolution_width;
+        const int height = calibration.depth_camera_calibration.resolution_height;
+
+        k4a_image_t depthImage = CreateSyntheticDepthImage(calibration);
+        k4a_image_t pointCloudImage = nullptr;
+        k4a_transformation_t transformation = k4a_transformation_create(&calibration);
+        const bool created = transformation != nullptr &&
+            k4a_image_create(K4A_IMAGE_FORMAT_CUSTOM, width, height, width * 3 * static_cast<int>(sizeof(int16_t)), &pointCloudImage) == K4A_RESULT_SUCCEEDED &&
+            k4a_transformation_depth_image_to_point_cloud(transformation, depthImage, K4A_CALIBRATION_TYPE_DEPTH, pointCloudImage) == K4A_RESULT_SUCCEEDED;
+
+        if (transformation != nullptr)
+        {
+            k4a_transformation_destroy(transformation);
+        }
+        k4a_image_release(depthImage);
+        if (!created)
+        {
+            if (pointCloudImage != nullptr)
+            {
+                k4a_image_release(pointCloudImage);
+            }
+            throw std::runtime_error("Create synthetic point cloud image failed!");
+        }
+        return pointCloudImage;
+    }
+
+    // Countermovement jump of one body, sampled at 30 fps: standing, squat, push off, flight, landing squat, standing.
+    // Heights follow the pelvis in millimeters, the y axis of the camera points down.
+    struct SyntheticJump
+    {
+        std::vector<k4abt_body_t> Bodies;
+        std::vector<float> TimestampsInUsec;
+    };
+
+    inline SyntheticJump CreateSyntheticJump(size_t frameCount = 120)
+    {
+        SyntheticJump jump;
+        std::vector<k4abt_body_t> pose = CreateSyntheticBodies(1);
+        const float Pi = 3.14159265f;
+
+        for (size_t frame = 0; frame < frameCount; frame++)
+        {
+            const float t = static_cast<float>(frame) / static_cast<float>(frameCount);
+
+            // Downwards displacement of the body, negative in the air
+            float lift = 0.f;
+            float kneeBend = 0.f;
+            if (t > 0.25f && t < 0.4f)
+            {
+                kneeBend = std::sin((t - 0.25f) / 0.15f * Pi);       // Squat and push off
+                lift = 250.f * kneeBend;
+            }
+            else if (t >= 0.4f && t < 0.6f)
+            {
+                lift = -400.f * std::sin((t - 0.4f) / 0.2f * Pi);     // Flight
+            }
+            else if (t >= 0.6f && t < 0.75f)
+            {
+                kneeBend = std::sin((t - 0.6f) / 0.15f * Pi);        // Landing squat
+                lift = 200.f * kneeBend;
+            }
+
+            k4abt_body_t body = pose[0];
+            for (int j = 0; j < static_cast<int>(K4ABT_JOINT_COUNT); j++)
+            {
+                k4a_float3_t& position = body.skeleton.joints[j].position;
+                position.xyz.y += lift;
+                if (j == K4ABT_JOINT_KNEE_LEFT || j == K4ABT_JOINT_KNEE_RIGHT)
+                {
+                    position.xyz.z -= 300.f * kneeBend;   // Knees move forward in a squat
+                }
+                if (j == K4ABT_JOINT_ANKLE_LEFT || j == K4ABT_JOINT_ANKLE_RIGHT || j == K4ABT_JOINT_FOOT_LEFT || j == K4ABT_JOINT_FOOT_RIGHT)
+                {
+                    position.xyz.y -= lift > 0.f ? lift : 0.f;   // Feet stay on the floor unless in flight
+                }
+            }
+            jump.Bodies.push_back(body);
+            jump.TimestampsInUsec.push_back(static_cast<float>(frame) * 33333.f);
+        }
+        return jump;
+    }
+}
@@ -0,0 +1,38 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <iostream>
+#include <string>
+
+// The benchmarks report allocations per frame, this translation unit provides the counting operator new
+#define K4A_SAMPLES_COUNT_ALLOCATIONS
+#include <AllocationCounter.h>
+
+#include "Benchmarks.h"
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    if (argc > 1)
+    {
+        filter = argv[1];
+    }
+    if (argc > 2 || filter == "-h" || filter == "--help")
+    {
+        std::cout << "Usage: body_tracking_benchmarks [name filter]" << std::endl;
+        return 0;
+    }
+
+    RunAngleCalculatorBenchmarks(filter);
+    RunSkeletonSmootherBenchmarks(filter);
+    RunPointCloudBenchmarks(filter);
+    RunFloorDetectorBenchmarks(filter);
+    RunExportBenchmarks(filter);
+    RunJumpAnalysisBenchmarks(filter);
+    RunFusionBenchmarks(filter);
+    RunLatencyRecorderBenchmarks(filter);
+    RunSkeletonCodecBenchmarks(filter);
+    RunSessionStoreBenchmarks(filter);
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "BodyIndexMapTransformer.h"
+#include "JointProjector.h"
+
+#include <k4a/k4a.h>
+#include <k4abttypes.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    // Depth buckets, spaced uniformly in inverse depth between the closest and the farthest body distance.
+    // Depths outside the range are extrapolated from the first or last two buckets.
+    constexpr int BucketCount = 6;
+    constexpr float MinimumDepthInMillimeters = 250.f;
+    constexpr float MaximumDepthInMillimeters = 6000.f;
+
+    // Color positions are stored in 1/8 pixels, which covers the width of the 4K color image in 16 bits
+    constexpr float FixedPointScale = 8.f;
+
+    // Color position of depth pixels without a valid projection, outside of any color image
+    constexpr int16_t InvalidPosition = INT16_MIN;
+
+    constexpr uint16_t EmptyDepth = 0xFFFF;
+
+    // Positions far outside of the image are clamped, they still end up outside
+    int16_t ToFixedPoint(float position)
+    {
+        const float scaled = std::min(std::max(position * FixedPointScale, -32767.f), 32767.f);
+        return static_cast<int16_t>(std::lround(scaled));
+    }
+}
+
+Samples::BodyIndexMapTransformer::BodyIndexMapTransformer(const k4a_calibration_t& sensorCalibration)
+    : m_depthWidth(sensorCalibration.depth_camera_calibration.resolution_width)
+    , m_depthHeight(sensorCalibration.depth_camera_calibration.resolution_height)
+    , m_colorWidth(sensorCalibration.color_camera_calibration.resolution_width)
+    , m_colorHeight(sensorCalibration.color_camera_calibration.resolution_height)
+{
+    const size_t depthPixelCount = static_cast<size_t>(m_depthWidth) * m_depthHeight;
+
+    // Ray of every depth pixel at 1 mm depth
+    std::vector<float> rayX(depthPixelCount), rayY(depthPixelCount);
+    std::vector<uint8_t> rayValid(depthPixelCount);
+    for (int y = 0; y < m_depthHeight; y++)
+    {
+        for (int x = 0; x < m_depthWidth; x++)
+        {
+            const size_t p = static_cast<size_t>(y) * m_depthWidth + x;
+            k4a_float2_t pixel;
+            pixel.xy.x = static_cast<float>(x);
+            pixel.xy.y = static_cast<float>(y);
+            k4a_float3_t point = {};
+            int valid = 0;
+            if (k4a_calibration_2d_to_3d(&sensorCalibration, &pixel, 1000.f, K4A_CALIBRATION_TYPE_DEPTH, K4A_CALIBRATION_TYPE_DEPTH,
+                &point, &valid) != K4A_RESULT_SUCCEEDED)
+            {
+                valid = 0;
+            }
+            rayX[p] = point.xyz.x / 1000.f;
+            rayY[p] = point.xyz.y / 1000.f;
+            rayValid[p] = static_cast<uint8_t>(valid != 0);
+        }
+    }
+
+    // Project the rays at the depth of every bucket to the color image
+    const float firstInverseDepth = 1.f / MaximumDepthInMillimeters;
+    const float bucketSpacing = (1.f / MinimumDepthInMillimeters - firstInverseDepth) / (BucketCount - 1);
+    m_firstBucketInverseDepth = firstInverseDepth;
+    m_inverseBucketSpacing = 1.f / bucketSpacing;
+
+    JointProjector projector(sensorCalibration);
+    std::vector<float> x(depthPixelCount), y(depthPixelCount), z(depthPixelCount);
+    std::vector<float> u(depthPixelCount), v(depthPixelCount);
+    std::vector<uint8_t> valid(depthPixelCount);
+    m_splatTable.resize(depthPixelCount * BucketCount);
+    for (int k = 0; k < BucketCount; k++)
+    {
+        const float depth = 1.f / (firstInverseDepth + k * bucketSpacing);
+        for (size_t p = 0; p < depthPixelCount; p++)
+        {
+            x[p] = rayX[p] * depth;
+            y[p] = rayY[p] * depth;
+            z[p] = depth;
+        }
+        projector.Project(x.data(), y.data(), z.data(), depthPixelCount, u.data(), v.data(), valid.data());
+        for (size_t p = 0; p < depthPixelCount; p++)
+        {
+            const bool isValid = rayValid[p] != 0 && valid[p] != 0;
+            m_splatTable[p * BucketCount + k].U = isValid ? ToFixedPoint(u[p]) : InvalidPosition;
+            m_splatTable[p * BucketCount + k].V = isValid ? ToFixedPoint(v[p]) : InvalidPosition;
+        }
+    }
+
+    // A depth pixel covers the color pixels up to half the distance to its neighbors. The largest spacing
+    // over the image is used so that neighboring body pixels always leave no holes.
+    float maxSpacingU = 0.f;
+    float maxSpacingV = 0.f;
+    const int middleBucket = BucketCount / 2;
+    for (int y = 0; y + 1 < m_depthHeight; y++)
+    {
+        for (int x = 0; x + 1 < m_depthWidth; x++)
+        {
+            const size_t p = static_cast<size_t>(y) * m_depthWidth + x;
+            const ColorPosition& center = m_splatTable[p * BucketCount + middleBucket];
+            const ColorPosition& right = m_splatTable[(p + 1) * BucketCount + middleBucket];
+            const ColorPosition& below = m_splatTable[(p + m_depthWidth) * BucketCount + middleBucket];
+            if (center.U == InvalidPosition || right.U == InvalidPosition || below.U == InvalidPosition)
+            {
+                continue;
+            }
+            maxSpacingU = std::max(maxSpacingU, std::abs(right.U - center.U) / FixedPointScale);
+            maxSpacingV = std::max(maxSpacingV, std::abs(below.V - center.V) / FixedPointScale);
+        }
+    }
+    m_footprintRadiusU = 0.5f * maxSpacingU;
+    m_footprintRadiusV = 0.5f * maxSpacingV;
+
+    m_depthBuffer.assign(static_cast<size_t>(m_colorWidth) * m_colorHeight, EmptyDepth);
+}
+
+void Samples::BodyIndexMapTransformer::Transform(const k4a_image_t depthImage, const k4a_image_t bodyIndexMap,
+    k4a_image_t bodyIndexMapInColorSpace)
+{
+    Transform(reinterpret_cast<const uint16_t*>(k4a_image_get_buffer(depthImage)),
+        k4a_image_get_buffer(bodyIndexMap),
+        k4a_image_get_buffer(bodyIndexMapInColorSpace));
+}
+
+void Samples::BodyIndexMapTransformer::Transform(const uint16_t* depth, const uint8_t* bodyIndexMap, uint8_t* bodyIndexMapInColorSpace)
+{
+    std::memset(bodyIndexMapInColorSpace, K4ABT_BODY_INDEX_MAP_BACKGROUND, static_cast<size_t>(m_colorWidth) * m_colorHeight);
+
+    // Reset the depth buffer where the previous frame drew
+    for (int y = m_dirtyTop; y <= m_dirtyBottom; y++)
+    {
+        uint16_t* row = m_depthBuffer.data() + static_cast<size_t>(y) * m_colorWidth;
+        std::fill(row + m_dirtyLeft, row + m_dirtyRight + 1, EmptyDepth);
+    }
+    m_dirtyLeft = m_colorWidth;
+    m_dirtyTop = m_colorHeight;
+    m_dirtyRight = -1;
+    m_dirtyBottom = -1;
+
+    // Everything the splat loop touches is kept in locals: the output is a byte array, which the compiler
+    // would otherwise have to assume aliases the members.
+    const ColorPosition* splatTable = m_splatTable.data();
+    uint16_t* depthBuffer = m_depthBuffer.data();
+    const int colorWidth = m_colorWidth;
+    const int colorHeight = m_colorHeight;
+    const float firstBucketInverseDepth = m_firstBucketInverseDepth;
+    const float inverseBucketSpacing = m_inverseBucketSpacing;
+    const float radiusU = m_footprintRadiusU;
+    const float radiusV = m_footprintRadiusV;
+    int dirtyLeft = colorWidth;
+    int dirtyTop = colorHeight;
+    int dirtyRight = -1;
+    int dirtyBottom = -1;
+
+    auto splat = [&](int depthPixel)
+    {
+        const uint16_t pixelDepth = depth[depthPixel];
+        if (pixelDepth == 0)
+        {
+            return;
+        }
+
+        // Interpolate the color position between the two buckets around the depth of the pixel
+        const float bucket = (1.f / pixelDepth - firstBucketInverseDepth) * inverseBucketSpacing;
+        const int k = std::min(std::max(static_cast<int>(bucket), 0), BucketCount - 2);
+        const float f = bucket - k;
+        const ColorPosition& nearBucket = splatTable[static_cast<size_t>(depthPixel) * BucketCount + k];
+        const ColorPosition& farBucket = splatTable[static_cast<size_t>(depthPixel) * BucketCount + k + 1];
+        if (nearBucket.U == InvalidPosition || farBucket.U == InvalidPosition)
+        {
+            return;
+        }
+        const float u = (nearBucket.U + f * (farBucket.U - nearBucket.U)) * (1.f / FixedPointScale);
+        const float v = (nearBucket.V + f * (farBucket.V - nearBucket.V)) * (1.f / FixedPointScale);
+
+        // Color pixels whose center lies inside the footprint, clipped to the image
+        const int left = std::max(static_cast<int>(std::ceil(u - radiusU)), 0);
+        const int right = std::min(static_cast<int>(std::floor(u + radiusU)), colorWidth - 1);
+        const int top = std::max(static_cast<int>(std::ceil(v - radiusV)), 0);
+        const int bottom = std::min(static_cast<int>(std::floor(v + radiusV)), colorHeight - 1);
+        if (left > right || top > bottom)
+        {
+            return;
+        }
+
+        const uint8_t bodyIndex = bodyIndexMap[depthPixel];
+        for (int y = top; y <= bottom; y++)
+        {
+            const size_t row = static_cast<size_t>(y) * colorWidth;
+            for (int x = left; x <= right; x++)
+            {
+                if (pixelDepth < depthBuffer[row + x])
+                {
+                    depthBuffer[row + x] = pixelDepth;
+                    bodyIndexMapInColorSpace[row + x] = bodyIndex;
+                }
+            }
+        }
+
+        dirtyLeft = std::min(dirtyLeft, left);
+        dirtyTop = std::min(dirtyTop, top);
+        dirtyRight = std::max(dirtyRight, right);
+        dirtyBottom = std::max(dirtyBottom, bottom);
+    };
+
+    // Skip the background eight pixels at a time
+    const uint64_t backgroundWord = 0x0101010101010101ull * K4ABT_BODY_INDEX_MAP_BACKGROUND;
+    const int depthPixelCount = m_depthWidth * m_depthHeight;
+    size_t foregroundPixelCount = 0;
+    int p = 0;
+    for (; p + 8 <= depthPixelCount; p += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bodyIndexMap + p, sizeof(word));
+        if (word == backgroundWord)
+        {
+            continue;
+        }
+        for (int i = p; i < p + 8; i++)
+        {
+            if (bodyIndexMap[i] != K4ABT_BODY_INDEX_MAP_BACKGROUND)
+            {
+                splat(i);
+                foregroundPixelCount++;
+            }
+        }
+    }
+    for (; p < depthPixelCount; p++)
+    {
+        if (bodyIndexMap[p] != K4ABT_BODY_INDEX_MAP_BACKGROUND)
+        {
+            splat(p);
+            foregroundPixelCount++;
+        }
+    }
+
+    m_dirtyLeft = dirtyLeft;
+    m_dirtyTop = dirtyTop;
+    m_dirtyRight = dirtyRight;
+    m_dirtyBottom = dirtyBottom;
+    m_foregroundPixelCount = foregroundPixelCount;
+}
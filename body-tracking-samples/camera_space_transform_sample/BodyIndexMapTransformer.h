@@ -0,0 +1,66 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <k4a/k4atypes.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace Samples
+{
+    // Transforms a body index map from depth space to color space by splatting only the body pixels.
+    //
+    // The color pixel of a depth pixel depends on its depth only through the parallax between the two cameras.
+    // At construction the color position of every depth pixel is computed for a few depth buckets spaced
+    // uniformly in inverse depth, where the parallax is almost linear. Per frame, each body pixel looks up its
+    // two enclosing buckets, interpolates its color position, and fills its footprint in the color image with
+    // a z-test against a depth buffer that is kept between frames. Background pixels cost a byte compare.
+    //
+    // Unlike k4a_transformation_depth_image_to_color_camera_custom, scene pixels that are not part of a body do
+    // not occlude the bodies behind them, which only makes a difference at the silhouette edges.
+    class BodyIndexMapTransformer
+    {
+    public:
+        BodyIndexMapTransformer(const k4a_calibration_t& sensorCalibration);
+
+        // Transform the body index map, the output image has the resolution of the color camera
+        void Transform(const k4a_image_t depthImage, const k4a_image_t bodyIndexMap, k4a_image_t bodyIndexMapInColorSpace);
+
+        void Transform(const uint16_t* depth, const uint8_t* bodyIndexMap, uint8_t* bodyIndexMapInColorSpace);
+
+        // Number of body pixels of the last transformed frame
+        size_t GetForegroundPixelCount() const { return m_foregroundPixelCount; }
+
+    private:
+        int m_depthWidth;
+        int m_depthHeight;
+        int m_colorWidth;
+        int m_colorHeight;
+
+        // Color position of depth pixel p at bucket k is m_splatTable[p * BucketCount + k], in fixed point
+        struct ColorPosition
+        {
+            int16_t U;
+            int16_t V;
+        };
+        std::vector<ColorPosition> m_splatTable;
+        float m_firstBucketInverseDepth;
+        float m_inverseBucketSpacing;
+
+        // Half size of the color footprint of a depth pixel, in color pixels
+        float m_footprintRadiusU;
+        float m_footprintRadiusV;
+
+        // Depth of the body pixel drawn at each color pixel, 0xFFFF where nothing was drawn.
+        // Only the bounding box of the previous frame is reset.
+        std::vector<uint16_t> m_depthBuffer;
+        int m_dirtyLeft = 0;
+        int m_dirtyTop = 0;
+        int m_dirtyRight = -1;
+        int m_dirtyBottom = -1;
+
+        size_t m_foregroundPixelCount = 0;
+    };
+}
@@ -0,0 +1,182 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "JointProjector.h"
+
+#include <k4a/k4a.h>
+
+#include <algorithm>
+#include <cmath>
+
+void Samples::JointBatch::Resize(size_t bodyCount)
+{
+    BodyCount = bodyCount;
+    const size_t count = GetJointCount();
+    X.resize(count);
+    Y.resize(count);
+    Z.resize(count);
+    U.resize(count);
+    V.resize(count);
+    Valid.resize(count);
+}
+
+void Samples::JointBatch::SetSkeleton(size_t body, const k4abt_skeleton_t& skeleton)
+{
+    const size_t first = GetIndex(body, 0);
+    for (int jointId = 0; jointId < (int)K4ABT_JOINT_COUNT; jointId++)
+    {
+        X[first + jointId] = skeleton.joints[jointId].position.xyz.x;
+        Y[first + jointId] = skeleton.joints[jointId].position.xyz.y;
+        Z[first + jointId] = skeleton.joints[jointId].position.xyz.z;
+    }
+}
+
+Samples::JointProjector::JointProjector(const k4a_calibration_t& sensorCalibration)
+    : m_calibration(sensorCalibration)
+{
+    const k4a_calibration_extrinsics_t& extrinsics = sensorCalibration.extrinsics[K4A_CALIBRATION_TYPE_DEPTH][K4A_CALIBRATION_TYPE_COLOR];
+    std::copy(extrinsics.rotation, extrinsics.rotation + 9, m_rotation);
+    std::copy(extrinsics.translation, extrinsics.translation + 3, m_translation);
+
+    const k4a_calibration_camera_t& color = sensorCalibration.color_camera_calibration;
+    const auto& param = color.intrinsics.parameters.param;
+    m_cx = param.cx;
+    m_cy = param.cy;
+    m_fx = param.fx;
+    m_fy = param.fy;
+    m_k1 = param.k1;
+    m_k2 = param.k2;
+    m_k3 = param.k3;
+    m_k4 = param.k4;
+    m_k5 = param.k5;
+    m_k6 = param.k6;
+    m_codx = param.codx;
+    m_cody = param.cody;
+    m_p1 = param.p1;
+    m_p2 = param.p2;
+    m_maxRadiusSquared = color.metric_radius * color.metric_radius;
+
+    m_supported = color.intrinsics.type == K4A_CALIBRATION_LENS_DISTORTION_MODEL_BROWN_CONRADY ||
+        color.intrinsics.type == K4A_CALIBRATION_LENS_DISTORTION_MODEL_RATIONAL_6KT;
+    m_tangentialScale = color.intrinsics.type == K4A_CALIBRATION_LENS_DISTORTION_MODEL_RATIONAL_6KT ? 1.f : 2.f;
+}
+
+void Samples::JointProjector::Project(const float* x, const float* y, const float* z, size_t count,
+    float* u, float* v, uint8_t* valid) const
+{
+    const float r0 = m_rotation[0], r1 = m_rotation[1], r2 = m_rotation[2];
+    const float r3 = m_rotation[3], r4 = m_rotation[4], r5 = m_rotation[5];
+    const float r6 = m_rotation[6], r7 = m_rotation[7], r8 = m_rotation[8];
+    const float t0 = m_translation[0], t1 = m_translation[1], t2 = m_translation[2];
+    const float cx = m_cx, cy = m_cy, fx = m_fx, fy = m_fy;
+    const float k1 = m_k1, k2 = m_k2, k3 = m_k3, k4 = m_k4, k5 = m_k5, k6 = m_k6;
+    const float codx = m_codx, cody = m_cody, p1 = m_p1, p2 = m_p2;
+    const float tangentialScale = m_tangentialScale;
+    const float maxRadiusSquared = m_maxRadiusSquared;
+    const float supported = m_supported ? 1.f : 0.f;
+
+    // The points are projected block by block into local arrays, which the compiler knows not to alias the
+    // input, so the loop vectorizes without runtime alias checks. Conditions are evaluated as 0/1 factors
+    // instead of branches for the same reason; GCC only turns the comparisons into vector selects when they
+    // may not trap, hence -fno-trapping-math for this file. The arithmetic follows the operation order of the SDK, so
+    // that both agree to a small fraction of a pixel.
+    constexpr size_t BlockSize = 64;
+    float blockU[BlockSize];
+    float blockV[BlockSize];
+    float blockValid[BlockSize];
+
+    for (size_t first = 0; first < count; first += BlockSize)
+    {
+        const size_t blockCount = std::min(BlockSize, count - first);
+        const float* bx = x + first;
+        const float* by = y + first;
+        const float* bz = z + first;
+
+        for (size_t i = 0; i < blockCount; i++)
+        {
+            // Depth camera space to color camera space
+            const float px = r0 * bx[i] + r1 * by[i] + r2 * bz[i] + t0;
+            const float py = r3 * bx[i] + r4 * by[i] + r5 * bz[i] + t1;
+            const float pz = r6 * bx[i] + r7 * by[i] + r8 * bz[i] + t2;
+
+            // Points behind the camera are projected from a dummy depth of 1 and masked out
+            const float inFront = static_cast<float>(pz > 0.f);
+            const float depth = pz * inFront + (1.f - inFront);
+
+            const float xp = px / depth - codx;
+            const float yp = py / depth - cody;
+
+            const float xp2 = xp * xp;
+            const float yp2 = yp * yp;
+            const float xyp = xp * yp;
+            const float rs = xp2 + yp2;
+            const float rss = rs * rs;
+            const float rsc = rss * rs;
+
+            const float a = 1.f + k1 * rs + k2 * rss + k3 * rsc;
+            const float b = 1.f + k4 * rs + k5 * rss + k6 * rsc;
+            const float bi = 1.f / (b + static_cast<float>(b == 0.f));
+            const float d = a * bi;
+
+            float xpd = xp * d;
+            float ypd = yp * d;
+            xpd += (rs + 2.f * xp2) * p2 + tangentialScale * xyp * p1;
+            ypd += (rs + 2.f * yp2) * p1 + tangentialScale * xyp * p2;
+
+            blockU[i] = (xpd + codx) * fx + cx;
+            blockV[i] = (ypd + cody) * fy + cy;
+
+            // The distortion model is only calibrated up to the metric radius
+            blockValid[i] = inFront * static_cast<float>(rs <= maxRadiusSquared) * supported;
+        }
+
+        for (size_t i = 0; i < blockCount; i++)
+        {
+            u[first + i] = blockU[i];
+            v[first + i] = blockV[i];
+            valid[first + i] = static_cast<uint8_t>(blockValid[i]);
+        }
+    }
+}
+
+void Samples::JointProjector::Project(JointBatch& joints) const
+{
+    Project(joints.X.data(), joints.Y.data(), joints.Z.data(), joints.GetJointCount(),
+        joints.U.data(), joints.V.data(), joints.Valid.data());
+}
+
+Samples::ProjectionCheck Samples::JointProjector::CompareWithSdk(const float* x, const float* y, const float* z, size_t count) const
+{
+    ProjectionCheck check;
+    check.PointCount = count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float u, v;
+        uint8_t valid;
+        Project(x + i, y + i, z + i, 1, &u, &v, &valid);
+
+        k4a_float3_t point;
+        point.xyz.x = x[i];
+        point.xyz.y = y[i];
+        point.xyz.z = z[i];
+        k4a_float2_t sdkPixel;
+        int sdkValid = 0;
+        if (k4a_calibration_3d_to_2d(&m_calibration, &point, K4A_CALIBRATION_TYPE_DEPTH, K4A_CALIBRATION_TYPE_COLOR,
+            &sdkPixel, &sdkValid) != K4A_RESULT_SUCCEEDED)
+        {
+            sdkValid = 0;
+        }
+
+        if ((valid != 0) != (sdkValid != 0))
+        {
+            check.ValidityMismatchCount++;
+        }
+        else if (valid != 0)
+        {
+            const float error = std::hypot(u - sdkPixel.xy.x, v - sdkPixel.xy.y);
+            check.MaxPixelError = std::max(check.MaxPixelError, error);
+        }
+    }
+    return check;
+}
@@ -0,0 +1,86 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <k4a/k4atypes.h>
+#include <k4abttypes.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace Samples
+{
+    // Joints of all bodies of a frame in struct-of-arrays layout.
+    // Joint j of body b is stored at index b * K4ABT_JOINT_COUNT + j.
+    struct JointBatch
+    {
+        size_t BodyCount = 0;
+
+        // Input: joint positions in depth camera space, in millimeters
+        std::vector<float> X;
+        std::vector<float> Y;
+        std::vector<float> Z;
+
+        // Output: joint positions in the color image, in pixels
+        std::vector<float> U;
+        std::vector<float> V;
+        std::vector<uint8_t> Valid;
+
+        // Resize for the given number of bodies. The storage only grows, so a steady frame loop does not allocate.
+        void Resize(size_t bodyCount);
+        void SetSkeleton(size_t body, const k4abt_skeleton_t& skeleton);
+
+        size_t GetJointCount() const { return BodyCount * static_cast<size_t>(K4ABT_JOINT_COUNT); }
+        size_t GetIndex(size_t body, int jointId) const { return body * static_cast<size_t>(K4ABT_JOINT_COUNT) + static_cast<size_t>(jointId); }
+    };
+
+    // Result of comparing the projector with k4a_calibration_3d_to_2d
+    struct ProjectionCheck
+    {
+        size_t PointCount = 0;
+        size_t ValidityMismatchCount = 0;   // Points that only one of the two considers valid
+        float MaxPixelError = 0.f;          // Largest distance between the two projections of a valid point
+    };
+
+    // Projects 3d points from depth camera space to 2d color image space, like
+    // k4a_calibration_3d_to_2d(K4A_CALIBRATION_TYPE_DEPTH, K4A_CALIBRATION_TYPE_COLOR).
+    //
+    // The depth to color extrinsics and the color camera intrinsics are unpacked once at construction,
+    // and Project runs the rigid transform and the Brown-Conrady distortion model over flat float arrays
+    // in a single branch-free loop, which GCC vectorizes at -O3 when the file is built with -fno-trapping-math
+    // (see CMakeLists.txt). Points that cannot be projected are reported through the validity mask instead of
+    // failing the call.
+    class JointProjector
+    {
+    public:
+        JointProjector(const k4a_calibration_t& sensorCalibration);
+
+        // False if the color camera uses a lens model other than Brown-Conrady or Rational 6KT
+        bool IsSupported() const { return m_supported; }
+
+        void Project(const float* x, const float* y, const float* z, size_t count,
+            float* u, float* v, uint8_t* valid) const;
+
+        void Project(JointBatch& joints) const;
+
+        // Project the points with both this projector and the SDK and report the differences
+        ProjectionCheck CompareWithSdk(const float* x, const float* y, const float* z, size_t count) const;
+
+    private:
+        k4a_calibration_t m_calibration;
+        bool m_supported = false;
+
+        // Depth to color extrinsics, row major rotation and translation in millimeters
+        float m_rotation[9];
+        float m_translation[3];
+
+        // Color camera intrinsics
+        float m_cx, m_cy, m_fx, m_fy;
+        float m_k1, m_k2, m_k3, m_k4, m_k5, m_k6;
+        float m_codx, m_cody;
+        float m_p1, m_p2;
+        float m_tangentialScale;       // Brown-Conrady doubles the mixed tangential term, Rational 6KT does not
+        float m_maxRadiusSquared;
+    };
+}
@@ -3,10 +3,14 @@
 
 #include <assert.h>
 #include <iostream>
+#include <vector>
 
 #include <k4a/k4a.h>
 #include <k4abt.h>
 
+#include "BodyIndexMapTransformer.h"
+#include "JointProjector.h"
+
 #define VERIFY(result, error)                                                                            \
     if(result != K4A_RESULT_SUCCEEDED)                                                                   \
     {                                                                                                    \
@@ -36,22 +40,29 @@ void print_body_index_map_middle_line(k4a_image_t body_index_map)
     printf("\n");
 }
 
-// Transform skeleton results from 3d depth space to 2d color image space
-inline bool transform_joint_from_depth_3d_to_color_2d(
-    const k4a_calibration_t* calibration, 
-    k4a_float3_t joint_in_depth_space, 
-    k4a_float2_t& joint_in_color_2d)
+void print_projection_check(const char* name, const Samples::ProjectionCheck& check)
+{
+    printf("%s: %zu points, max error to k4a_calibration_3d_to_2d %f pixels, %zu validity mismatches\n",
+        name, check.PointCount, check.MaxPixelError, check.ValidityMismatchCount);
+}
+
+// Compare the batch projector with the SDK on a grid of points covering the field of view of the depth camera
+void verify_joint_projector(const Samples::JointProjector& projector)
 {
-    int valid;
-    VERIFY(k4a_calibration_3d_to_2d(
-        calibration, 
-        &joint_in_depth_space, 
-        K4A_CALIBRATION_TYPE_DEPTH, 
-        K4A_CALIBRATION_TYPE_COLOR, 
-        &joint_in_color_2d, 
-        &valid), "Failed to project 3d joint from depth space to 2d color image space!");
-
-    return valid != 0;
+    std::vector<float> x, y, z;
+    for (float depth = 500.f; depth <= 5000.f; depth += 500.f)
+    {
+        for (float row = -0.8f; row <= 0.8f; row += 0.05f)
+        {
+            for (float column = -0.8f; column <= 0.8f; column += 0.05f)
+            {
+                x.push_back(column * depth);
+                y.push_back(row * depth);
+                z.push_back(depth);
+            }
+        }
+    }
+    print_projection_check("Joint projector self check", projector.CompareWithSdk(x.data(), y.data(), z.data(), x.size()));
 }
 
 // Transform body index map results from depth space to color space
@@ -80,12 +91,33 @@ void transform_body_index_map_from_depth_to_color(
         K4ABT_BODY_INDEX_MAP_BACKGROUND), "Failed to transform body index map to color space!");
 }
 
-bool ProcessArguments(k4abt_tracker_configuration_t& tracker_config, int argc, char** argv)
+// Print the fraction of body pixels on which the two body index maps in color space agree
+void print_body_index_map_agreement(const k4a_image_t body_index_map, const k4a_image_t reference_body_index_map)
+{
+    const uint8_t* buffer = k4a_image_get_buffer(body_index_map);
+    const uint8_t* reference_buffer = k4a_image_get_buffer(reference_body_index_map);
+    size_t pixel_count = (size_t)k4a_image_get_width_pixels(body_index_map) * k4a_image_get_height_pixels(body_index_map);
+
+    size_t body_pixel_count = 0;
+    size_t agreeing_pixel_count = 0;
+    for (size_t i = 0; i < pixel_count; i++)
+    {
+        if (buffer[i] != K4ABT_BODY_INDEX_MAP_BACKGROUND || reference_buffer[i] != K4ABT_BODY_INDEX_MAP_BACKGROUND)
+        {
+            body_pixel_count++;
+            agreeing_pixel_count += buffer[i] == reference_buffer[i] ? 1 : 0;
+        }
+    }
+    printf("Body index map agrees with k4a_transformation_depth_image_to_color_camera_custom on %zu of %zu body pixels\n",
+        agreeing_pixel_count, body_pixel_count);
+}
+
+bool ProcessArguments(k4abt_tracker_configuration_t& tracker_config, bool& verify_projection, int argc, char** argv)
 {
 #ifdef _WIN32
-    printf("Usage: k4abt_camera_space_transform_sample PROCESSING_MODE[CUDA, CPU, DirectML ( default ), or TensorRT](optional) -model MODEL_FILEPATH(optional).\n");
+    printf("Usage: k4abt_camera_space_transform_sample PROCESSING_MODE[CUDA, CPU, DirectML ( default ), or TensorRT](optional) -model MODEL_FILEPATH(optional) -verify(optional).\n");
 #else
-    printf("Usage: k4abt_camera_space_transform_sample PROCESSING_MODE[CUDA ( default ), CPU, or TensorRT](optional) -model MODEL_FILEPATH(optional).\n");
+    printf("Usage: k4abt_camera_space_transform_sample PROCESSING_MODE[CUDA ( default ), CPU, or TensorRT](optional) -model MODEL_FILEPATH(optional) -verify(optional).\n");
 #endif
 
     for (int i = 1; i < argc; i++)
@@ -118,6 +150,10 @@ bool ProcessArguments(k4abt_tracker_configuration_t& tracker_config, int argc, c
                 return false;
             }
         }
+        else if (0 == strcmp(argv[i], "-verify"))
+        {
+            verify_projection = true;
+        }
         else
         {
 #ifdef _WIN32
@@ -155,10 +191,24 @@ int main(int argc, char** argv)
         exit(1);
     }
 
+    // Unpack the depth to color extrinsics and the color intrinsics once to project the joints of every frame in one pass
+    Samples::JointProjector joint_projector(sensor_calibration);
+    if (!joint_projector.IsSupported())
+    {
+        printf("Unsupported color camera lens distortion model!");
+        exit(1);
+    }
+
     k4abt_tracker_t tracker = NULL;
     k4abt_tracker_configuration_t tracker_config = K4ABT_TRACKER_CONFIG_DEFAULT;
-    if (!ProcessArguments(tracker_config, argc, argv))
+    bool verify_projection = false;
+    if (!ProcessArguments(tracker_config, verify_projection, argc, argv))
         exit(1);
+
+    if (verify_projection)
+    {
+        verify_joint_projector(joint_projector);
+    }
     VERIFY(k4abt_tracker_create(&sensor_calibration, tracker_config, &tracker), "Body tracker initialization failed!");
 
     // Preallocated the buffers to hold the depth image in color space and the body index map in color space
@@ -179,6 +229,19 @@ int main(int argc, char** argv)
         color_image_width_pixels * (int)sizeof(uint8_t),
         &body_index_map_in_color_space), "Failed to create empty image for the body index map in color space");
 
+    // Reference result of the SDK transform, only used with -verify
+    k4a_image_t reference_body_index_map_in_color_space = NULL;
+    VERIFY(k4a_image_create(K4A_IMAGE_FORMAT_CUSTOM8,
+        color_image_width_pixels,
+        color_image_height_pixels,
+        color_image_width_pixels * (int)sizeof(uint8_t),
+        &reference_body_index_map_in_color_space), "Failed to create empty image for the reference body index map in color space");
+
+    // Precompute the color position of every depth pixel once, then only the body pixels are transformed per frame
+    Samples::BodyIndexMapTransformer body_index_map_transformer(sensor_calibration);
+
+    Samples::JointBatch joints;
+
     int frame_count = 0;
     do
     {
@@ -212,23 +275,32 @@ int main(int argc, char** argv)
                 uint32_t num_bodies = k4abt_frame_get_num_bodies(body_frame);
                 printf("%u bodies are detected!\n", num_bodies);
 
-                // Transform each 3d joints from 3d depth space to 2d color image space
+                // Transform the 3d joints of all bodies from 3d depth space to 2d color image space at once
+                joints.Resize(num_bodies);
                 for (uint32_t i = 0; i < num_bodies; i++)
                 {
-                    printf("Person[%u]:\n", i);
                     k4abt_skeleton_t skeleton;
                     VERIFY(k4abt_frame_get_body_skeleton(body_frame, i, &skeleton), "Get body from body frame failed!");
+                    joints.SetSkeleton(i, skeleton);
+                }
+                joint_projector.Project(joints);
+
+                if (verify_projection)
+                {
+                    print_projection_check("Joint projection",
+                        joint_projector.CompareWithSdk(joints.X.data(), joints.Y.data(), joints.Z.data(), joints.GetJointCount()));
+                }
+
+                for (uint32_t i = 0; i < num_bodies; i++)
+                {
+                    printf("Person[%u]:\n", i);
                     for (int joint_id = 0; joint_id < (int)K4ABT_JOINT_COUNT; joint_id++)
                     {
-                        k4a_float2_t joint_in_color_2d;
-                        bool valid = transform_joint_from_depth_3d_to_color_2d(
-                            &sensor_calibration, 
-                            skeleton.joints[joint_id].position,
-                            joint_in_color_2d);
-                        if (valid)
+                        size_t index = joints.GetIndex(i, joint_id);
+                        if (joints.Valid[index])
                         {
                             printf("Joint[%d]: Pixel Location at Color Image ( %f, %f) \n",
-                                joint_id, joint_in_color_2d.v[0], joint_in_color_2d.v[1]);
+                                joint_id, joints.U[index], joints.V[index]);
                         }
                         else
                         {
@@ -241,16 +313,29 @@ int main(int argc, char** argv)
                 k4a_image_t body_index_map_in_depth_space = k4abt_frame_get_body_index_map(body_frame);
                 if (body_index_map_in_depth_space != NULL)
                 {
-                    // Depth image is needed in order to perform the body index map space transform
-                    k4a_image_t depth_image = k4a_capture_get_depth_image(sensor_capture);
+                    // Depth image is needed in order to perform the body index map space transform. The sensor capture
+                    // was released after enqueueing, the body frame holds its own reference to it.
+                    k4a_capture_t original_capture = k4abt_frame_get_capture(body_frame);
+                    k4a_image_t depth_image = k4a_capture_get_depth_image(original_capture);
+                    k4a_capture_release(original_capture);
 
-                    transform_body_index_map_from_depth_to_color(
-                        transformation,
+                    body_index_map_transformer.Transform(
                         depth_image,
                         body_index_map_in_depth_space,
-                        depth_image_in_color_space,
                         body_index_map_in_color_space);
 
+                    if (verify_projection)
+                    {
+                        transform_body_index_map_from_depth_to_color(
+                            transformation,
+                            depth_image,
+                            body_index_map_in_depth_space,
+                            depth_image_in_color_space,
+                            reference_body_index_map_in_color_space);
+
+                        print_body_index_map_agreement(body_index_map_in_color_space, reference_body_index_map_in_color_space);
+                    }
+
                     print_body_index_map_middle_line(body_index_map_in_color_space);
                     k4a_image_release(body_index_map_in_depth_space);
                     k4a_image_release(depth_image);
@@ -292,6 +377,7 @@ int main(int argc, char** argv)
 
     k4a_image_release(depth_image_in_color_space);
     k4a_image_release(body_index_map_in_color_space);
+    k4a_image_release(reference_body_index_map_in_color_space);
 
     k4a_transformation_destroy(transformation);
     k4abt_tracker_shutdown(tracker);
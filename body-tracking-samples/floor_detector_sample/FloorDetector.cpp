@@ -3,9 +3,9 @@
 
 #include "FloorDetector.h"
 
-#include <algorithm>    // std::sort
+#include <algorithm>    // std::max, std::min, std::fill
 #include <cassert>      // assert
-#include <numeric>      // std::iota
+#include <cmath>        // std::floor
 
 std::optional<Samples::Vector> Samples::TryEstimateGravityVectorForDepthCamera(
     const k4a_imu_sample_t& imuSample,
@@ -37,92 +37,287 @@ std::optional<Samples::Vector> Samples::TryEstimateGravityVectorForDepthCamera(
     return {};
 }
 
-struct HistogramBin
+namespace
 {
-    size_t count;
-    float leftEdge;
-};
+    // There could be several horizontal planes in the scene (floor, tables, ceiling).
+    // For the floor, look for lowest N points whose elevations are within a small range from each other.
+    const float PlaneDisplacementRangeInMeters = 0.050f; // 5 cm in meters.
+    const float PlaneMaxTiltInDeg = 5.0f;
+    const size_t BinAggregation = 6;
+    const float BinSize = PlaneDisplacementRangeInMeters / BinAggregation;
 
-std::vector<HistogramBin> Histogram(const std::vector<float>& values, float binSize)
-{
-    // Bounds
-    const auto [minEl, maxEl] = std::minmax_element(values.begin(), values.end());
-    const float minVal = *minEl;
-    const float maxVal = *maxEl;
+    // Range of elevations covered by a full search, beyond the depth range of the sensor.
+    const float MaximumElevationInMeters = 8.0f;
 
-    size_t binCount = 1 + static_cast<size_t>((maxVal - minVal) / binSize);
+    // Clouds are only split across threads when every thread gets at least this many points.
+    const size_t MinimumPointsPerThread = 32768;
 
-    // Bins
-    std::vector<HistogramBin> histBins{ binCount };
-    for (size_t i = 0; i < binCount; ++i)
+    using Moments = Samples::ElevationHistogram::Moments;
+
+    void AddMoments(Moments& sum, const Moments& m)
     {
-        histBins[i] = { /*binCount*/ 0, /*binLeftEdge*/ i * binSize + minVal };
+        sum.Count += m.Count;
+        sum.X += m.X;
+        sum.Y += m.Y;
+        sum.Z += m.Z;
+        sum.XX += m.XX;
+        sum.XY += m.XY;
+        sum.XZ += m.XZ;
+        sum.YY += m.YY;
+        sum.YZ += m.YZ;
+        sum.ZZ += m.ZZ;
     }
 
-    // Counts
-    for (float v : values)
+    // Computes the elevation and bin of every point and adds the point to the moments of its bin, in one pass.
+    void AccumulateBins(
+        const k4a_float3_t* cloudPoints,
+        size_t sampleBegin,
+        size_t sampleEnd,
+        size_t pointStride,
+        const Samples::Vector& up,
+        float minimumElevation,
+        float binSize,
+        size_t binCount,
+        Moments* bins)
     {
-        int binIndex = static_cast<int>((v - minVal) / binSize);
-        histBins[binIndex].count++;
-    }
-    return histBins;
-}
+        const float inverseBinSize = 1.0f / binSize;
+        const float binLimit = static_cast<float>(binCount);
 
-std::optional<Samples::Plane> FitPlaneToInlierPoints(const std::vector<k4a_float3_t>& cloudPoints, const std::vector<size_t>& inlierIndices)
-{
-    // https://www.ilikebigbits.com/2015_03_04_plane_from_points.html
+        for (size_t i = sampleBegin; i < sampleEnd; ++i)
+        {
+            const k4a_float3_t& p = cloudPoints[i * pointStride];
+            const float elevation = up.X * p.xyz.x + up.Y * p.xyz.y + up.Z * p.xyz.z;
+            const float binPosition = (elevation - minimumElevation) * inverseBinSize;
+
+            // Also rejects NaN elevations.
+            if (!(binPosition >= 0 && binPosition < binLimit))
+            {
+                continue;
+            }
+
+            const double x = p.xyz.x;
+            const double y = p.xyz.y;
+            const double z = p.xyz.z;
+            Moments& bin = bins[static_cast<int>(binPosition)];
+            bin.Count += 1;
+            bin.X += x;
+            bin.Y += y;
+            bin.Z += z;
+            bin.XX += x * x;
+            bin.XY += x * y;
+            bin.XZ += x * z;
+            bin.YY += y * y;
+            bin.YZ += y * z;
+            bin.ZZ += z * z;
+        }
+    }
 
-    if (inlierIndices.size() < 3)
+    struct FloorWindow
     {
+        Samples::Plane Plane;
+        size_t InlierCount;
+    };
+
+    // Looks for the lowest window of BinAggregation bins, starting at firstBin, that holds more than
+    // minimumFloorPointCount points, and accepts it as the floor if its plane is close to horizontal.
+    std::optional<FloorWindow> TryFindFloorWindow(
+        const Samples::ElevationHistogram& histogram,
+        size_t firstBin,
+        const Samples::Vector& up,
+        size_t minimumFloorPointCount)
+    {
+        for (size_t i = firstBin; i + BinAggregation <= histogram.GetBinCount(); ++i)
+        {
+            size_t aggBinStart = i;                 // inclusive bin
+            size_t aggBinEnd = i + BinAggregation;  // exclusive bin
+            size_t inlierCount = histogram.GetCount(aggBinStart, aggBinEnd);
+            if (inlierCount > minimumFloorPointCount)
+            {
+                // Fit plane to inlier points.
+                auto refinedPlane = Samples::FitPlaneToMoments(histogram.GetMoments(aggBinStart, aggBinEnd));
+
+                if (refinedPlane.has_value())
+                {
+                    // Ensure normal is upward.
+                    if (refinedPlane->Normal.Dot(up) < 0)
+                    {
+                        refinedPlane->Normal = refinedPlane->Normal * -1;
+                    }
+
+                    // Ensure normal is mostly vertical.
+                    auto floorTiltInDeg = acos(std::min(refinedPlane->Normal.Dot(up), 1.0f)) * 180.0f / 3.14159265f;
+                    if (floorTiltInDeg < PlaneMaxTiltInDeg)
+                    {
+                        // For reduced jitter, use gravity for floor normal.
+                        refinedPlane->Normal = up;
+                        return FloorWindow{ *refinedPlane, inlierCount };
+                    }
+                }
+
+                return {};
+            }
+        }
         return {};
     }
 
-    // Compute centroid.
-    Samples::Vector centroid(0, 0, 0);
-    for (const auto& index : inlierIndices)
+    // Full search over all elevations.
+    std::optional<FloorWindow> TryFindFloorWindow(
+        Samples::ElevationHistogram& histogram,
+        const std::vector<k4a_float3_t>& cloudPoints,
+        const Samples::Vector& up,
+        size_t minimumFloorPointCount)
     {
-        centroid = centroid + cloudPoints[index];
+        const size_t binCount = static_cast<size_t>(2 * MaximumElevationInMeters / BinSize);
+        histogram.Build(cloudPoints, up, -MaximumElevationInMeters, BinSize, binCount);
+
+        // Skip the lowest bin, it only holds the tail of the lowest structure.
+        return TryFindFloorWindow(histogram, histogram.GetFirstNonEmptyBin() + 1, up, minimumFloorPointCount);
     }
-    centroid = centroid / static_cast<float>(inlierIndices.size());
+}
+
+std::optional<Samples::Plane> Samples::FitPlaneToMoments(const ElevationHistogram::Moments& m)
+{
+    // https://www.ilikebigbits.com/2015_03_04_plane_from_points.html
 
-    // Compute the zero-mean 3x3 symmetric covariance matrix relative.
-    float xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
-    for (const auto& index : inlierIndices)
+    if (m.Count < 3)
     {
-        Samples::Vector r = cloudPoints[index] - centroid;
-        xx += r.X * r.X;
-        xy += r.X * r.Y;
-        xz += r.X * r.Z;
-        yy += r.Y * r.Y;
-        yz += r.Y * r.Z;
-        zz += r.Z * r.Z;
+        return {};
     }
 
-    float detX = yy * zz - yz * yz;
-    float detY = xx * zz - xz * xz;
-    float detZ = xx * yy - xy * xy;
-
-    float detMax = std::max({ detX, detY, detZ });
+    // Compute centroid.
+    const double cx = m.X / m.Count;
+    const double cy = m.Y / m.Count;
+    const double cz = m.Z / m.Count;
+
+    // Zero-mean 3x3 symmetric covariance matrix from the raw moments.
+    const double xx = m.XX - m.X * cx;
+    const double xy = m.XY - m.X * cy;
+    const double xz = m.XZ - m.X * cz;
+    const double yy = m.YY - m.Y * cy;
+    const double yz = m.YZ - m.Y * cz;
+    const double zz = m.ZZ - m.Z * cz;
+
+    const double detX = yy * zz - yz * yz;
+    const double detY = xx * zz - xz * xz;
+    const double detZ = xx * yy - xy * xy;
+
+    const double detMax = std::max({ detX, detY, detZ });
     if (detMax <= 0)
     {
         return {};
     }
 
-    Samples::Vector normal(0, 0, 0);
+    double nx, ny, nz;
     if (detMax == detX)
     {
-        normal = { detX, xz * yz - xy * zz, xy * yz - xz * yy };
+        nx = detX; ny = xz * yz - xy * zz; nz = xy * yz - xz * yy;
     }
     else if (detMax == detY)
     {
-        normal = { xz * yz - xy * zz, detY, xy * xz - yz * xx };
+        nx = xz * yz - xy * zz; ny = detY; nz = xy * xz - yz * xx;
     }
     else
     {
-        normal = { xy * yz - xz * yy, xy * xz - yz * xx, detZ };
+        nx = xy * yz - xz * yy; ny = xy * xz - yz * xx; nz = detZ;
+    }
+
+    const double length = std::sqrt(nx * nx + ny * ny + nz * nz);
+    Samples::Vector normal(static_cast<float>(nx / length), static_cast<float>(ny / length), static_cast<float>(nz / length));
+    Samples::Vector centroid(static_cast<float>(cx), static_cast<float>(cy), static_cast<float>(cz));
+    return Samples::Plane::Create(normal, centroid);
+}
+
+Samples::ElevationHistogram::ElevationHistogram(FrameArena& arena, WorkerPool* workers)
+    : m_arena(arena)
+    , m_workers(workers)
+{
+}
+
+void Samples::ElevationHistogram::Build(
+    const std::vector<k4a_float3_t>& cloudPoints,
+    const Samples::Vector& up,
+    float minimumElevation,
+    float binSize,
+    size_t binCount,
+    size_t pointStride)
+{
+    assert(pointStride >= 1);
+    m_minimumElevation = minimumElevation;
+    m_binSize = binSize;
+    m_binCount = binCount;
+
+    const size_t sampleCount = (cloudPoints.size() + pointStride - 1) / pointStride;
+    const size_t maximumThreadCount = m_workers != nullptr ? m_workers->GetThreadCount() : 1;
+    const size_t threadCount = std::max<size_t>(1, std::min(maximumThreadCount, sampleCount / MinimumPointsPerThread));
+
+    // Per-thread bins.
+    ArenaSpan<Moments> threadBins = m_arena.Allocate<Moments>(threadCount * binCount);
+    std::fill(threadBins.begin(), threadBins.end(), Moments{});
+
+    auto accumulate = [&](size_t t)
+    {
+        AccumulateBins(cloudPoints.data(),
+            sampleCount * t / threadCount,
+            sampleCount * (t + 1) / threadCount,
+            pointStride, up, minimumElevation, binSize, binCount, threadBins.Data + t * binCount);
+    };
+
+    if (threadCount == 1)
+    {
+        accumulate(0);
+    }
+    else
+    {
+        m_workers->Run(threadCount, accumulate);
+    }
+
+    // Merge the per-thread bins into prefix sums.
+    m_prefix = m_arena.Allocate<Moments>(binCount + 1);
+    m_prefix[0] = Moments{};
+    for (size_t i = 0; i < binCount; ++i)
+    {
+        Moments sum = m_prefix[i];
+        for (size_t t = 0; t < threadCount; ++t)
+        {
+            AddMoments(sum, threadBins[t * binCount + i]);
+        }
+        m_prefix[i + 1] = sum;
+    }
+}
+
+size_t Samples::ElevationHistogram::GetFirstNonEmptyBin() const
+{
+    for (size_t i = 0; i < m_binCount; ++i)
+    {
+        if (m_prefix[i + 1].Count > 0)
+        {
+            return i;
+        }
     }
+    return m_binCount;
+}
 
-    return Samples::Plane::Create(normal.Normalized(), centroid);
+size_t Samples::ElevationHistogram::GetCount(size_t binStart, size_t binEnd) const
+{
+    return static_cast<size_t>(m_prefix[binEnd].Count - m_prefix[binStart].Count);
+}
+
+Samples::ElevationHistogram::Moments Samples::ElevationHistogram::GetMoments(size_t binStart, size_t binEnd) const
+{
+    const Moments& end = m_prefix[binEnd];
+    const Moments& start = m_prefix[binStart];
+    Moments m;
+    m.Count = end.Count - start.Count;
+    m.X = end.X - start.X;
+    m.Y = end.Y - start.Y;
+    m.Z = end.Z - start.Z;
+    m.XX = end.XX - start.XX;
+    m.XY = end.XY - start.XY;
+    m.XZ = end.XZ - start.XZ;
+    m.YY = end.YY - start.YY;
+    m.YZ = end.YZ - start.YZ;
+    m.ZZ = end.ZZ - start.ZZ;
+    return m;
 }
 
 std::optional<Samples::Plane> Samples::FloorDetector::TryDetectFloorPlane(
@@ -137,79 +332,109 @@ std::optional<Samples::Plane> Samples::FloorDetector::TryDetectFloorPlane(
         // Up normal is opposite to gravity down vector.
         Samples::Vector up = (gravity.value() * -1).Normalized();
 
-        // Compute elevation of cloud points (projections on the floor normal).
-        std::vector<float> offsets(cloudPoints.size());
-        for (size_t i = 0; i < cloudPoints.size(); ++i)
+        // Stateless entry point: scratch memory for this call only, worker threads shared by all calls.
+        static WorkerPool workers;
+        FrameArena arena;
+        ElevationHistogram histogram{ arena, &workers };
+        auto floor = TryFindFloorWindow(histogram, cloudPoints, up, minimumFloorPointCount);
+        if (floor.has_value())
         {
-            offsets[i] = up.Dot(Samples::Vector(cloudPoints[i]));
+            return floor->Plane;
         }
+    }
 
-        // There could be several horizontal planes in the scene (floor, tables, ceiling).
-        // For the floor, look for lowest N points whose elevations are within a small range from each other.
-
-        const float planeDisplacementRangeInMeters = 0.050f; // 5 cm in meters.
-        const float planeMaxTiltInDeg = 5.0f;
-
-        const int binAggregation = 6;
-        assert(binAggregation >= 1);
-        const float binSize = planeDisplacementRangeInMeters / binAggregation;
-        const auto histBins = Histogram(offsets, binSize);
-        
-        // Cumulative histogram counts.
-        std::vector<size_t> cumulativeHistCounts(histBins.size());
-        cumulativeHistCounts[0] = histBins[0].count;
-        for (size_t i = 1; i < histBins.size(); ++i)
-        {
-            cumulativeHistCounts[i] = cumulativeHistCounts[i - 1] + histBins[i].count;
-        }
+    return {};
+}
 
-        assert(cumulativeHistCounts.back() == offsets.size());
+Samples::FloorTracker::FloorTracker(size_t minimumFloorPointCount, FrameArena& arena, WorkerPool& workers)
+    : m_minimumFloorPointCount(minimumFloorPointCount)
+    , m_histogram(arena, &workers)
+{
+}
 
-        for (size_t i = 1; i + binAggregation < cumulativeHistCounts.size(); ++i)
-        {
-            size_t aggBinStart = i;                 // inclusive bin
-            size_t aggBinEnd = i + binAggregation;  // exclusive bin
-            size_t inlierCount = cumulativeHistCounts[aggBinEnd - 1] - cumulativeHistCounts[aggBinStart - 1];
-            if (inlierCount > minimumFloorPointCount)
-            {
-                float offsetStart = histBins[aggBinStart].leftEdge; // inclusive
-                float offsetEnd = histBins[aggBinEnd].leftEdge;     // exclusive
+void Samples::FloorTracker::Reset()
+{
+    Lose();
+}
 
-                // Inlier indices.
-                std::vector<size_t> inlierIndices;
-                for (size_t j = 0; j < offsets.size(); ++j)
-                {
-                    if (offsetStart <= offsets[j] && offsets[j] < offsetEnd)
-                    {
-                        inlierIndices.push_back(j);
-                    }
-                }
+std::optional<Samples::Plane> Samples::FloorTracker::Lose()
+{
+    m_locked = false;
+    m_foundInBand = false;
+    m_confidence = 0;
+    m_stability = 0;
+    return {};
+}
 
-                // Fit plane to inlier points.
-                auto refinedPlane = FitPlaneToInlierPoints(cloudPoints, inlierIndices);
+std::optional<Samples::Plane> Samples::FloorTracker::Update(
+    const std::vector<k4a_float3_t>& cloudPoints,
+    const k4a_imu_sample_t& imuSample,
+    const k4a_calibration_t& sensorCalibration)
+{
+    return Update(cloudPoints, TryEstimateGravityVectorForDepthCamera(imuSample, sensorCalibration));
+}
 
-                if (refinedPlane.has_value())
-                {
-                    // Ensure normal is upward.
-                    if (refinedPlane->Normal.Dot(up) < 0)
-                    {
-                        refinedPlane->Normal = refinedPlane->Normal * -1;
-                    }
+std::optional<Samples::Plane> Samples::FloorTracker::Update(
+    const std::vector<k4a_float3_t>& cloudPoints,
+    const std::optional<Samples::Vector>& gravity)
+{
+    if (!gravity.has_value() || cloudPoints.empty())
+    {
+        // The device is moving, the previous floor cannot be trusted.
+        return Lose();
+    }
 
-                    // Ensure normal is mostly vertical.
-                    auto floorTiltInDeg = acos(refinedPlane->Normal.Dot(up)) * 180.0f / 3.14159265f;
-                    if (floorTiltInDeg < planeMaxTiltInDeg)
-                    {
-                        // For reduced jitter, use gravity for floor normal.
-                        refinedPlane->Normal = up;
-                        return refinedPlane;
-                    }
-                }
+    // Up normal is opposite to gravity down vector.
+    Samples::Vector up = (gravity.value() * -1).Normalized();
 
-                return {};
-            }
+    const float gravityChangeInDeg = std::acos(std::min(up.Dot(m_lockedUp), 1.0f)) * 180.0f / 3.14159265f;
+    bool searchBand = m_locked && gravityChangeInDeg < GravityChangeThresholdInDeg;
+
+    std::optional<FloorWindow> floor;
+    size_t pointStride = 1;
+    if (searchBand)
+    {
+        // Search a subsample of the points in a narrow band around the previous floor.
+        const size_t binCount = static_cast<size_t>(2 * LockedSearchBandInMeters / BinSize);
+        pointStride = LockedPointStride;
+        // The band starts at a bin boundary of the full search, so the bins do not shift with the locked elevation
+        // from frame to frame.
+        const float bandStart = std::floor((m_lockedElevation - LockedSearchBandInMeters) / BinSize) * BinSize;
+        m_histogram.Build(cloudPoints, up, bandStart, BinSize, binCount, pointStride);
+
+        // Unlike the full search, no bin is skipped: the band is so narrow that the floor often fills a single bin,
+        // which is also the first non-empty one.
+        floor = TryFindFloorWindow(m_histogram, 0, up, m_minimumFloorPointCount / pointStride);
+    }
+
+    if (!floor.has_value())
+    {
+        searchBand = false;
+        pointStride = 1;
+        floor = TryFindFloorWindow(m_histogram, cloudPoints, up, m_minimumFloorPointCount);
+        if (!floor.has_value())
+        {
+            return Lose();
         }
+        m_lockedUp = up;
     }
 
-    return {};
+    const float elevation = up.Dot(floor->Plane.Origin);
+    if (searchBand)
+    {
+        m_averageElevationChange += 0.1f * (std::abs(elevation - m_lockedElevation) - m_averageElevationChange);
+    }
+    else if (!m_locked)
+    {
+        // A new lock starts with a change of one plane displacement range, stability builds up from there.
+        m_averageElevationChange = PlaneDisplacementRangeInMeters;
+    }
+
+    m_locked = true;
+    m_foundInBand = searchBand;
+    m_lockedElevation = elevation;
+    m_confidence = std::min(1.0f, static_cast<float>(floor->InlierCount * pointStride) / (2.0f * m_minimumFloorPointCount));
+    m_stability = 1.0f / (1.0f + m_averageElevationChange * 100.0f);
+
+    return floor->Plane;
 }
@@ -3,7 +3,9 @@
 
 #pragma once
 
+#include "FrameArena.h"
 #include "SampleMathTypes.h"
+#include "WorkerPool.h"
 
 #include <optional>
 #include <vector>
@@ -14,6 +16,59 @@ namespace Samples
         const k4a_imu_sample_t& imuSample,
         const k4a_calibration_t& sensorCalibration);
 
+    // Histogram of point elevations along an up vector, built in a single pass over the cloud.
+    // Besides the point count, every bin keeps the sums of x, y, z and of their pairwise products,
+    // stored as prefix sums over the bins. The centroid and covariance of the points in any range of
+    // bins are therefore available without another pass over the points.
+    class ElevationHistogram
+    {
+    public:
+        struct Moments
+        {
+            double Count = 0;
+            double X = 0, Y = 0, Z = 0;
+            double XX = 0, XY = 0, XZ = 0, YY = 0, YZ = 0, ZZ = 0;
+        };
+
+        // Bins and prefix sums are allocated from the arena and stay valid until it is reset.
+        // Large clouds are split across the workers, if any.
+        ElevationHistogram(FrameArena& arena, WorkerPool* workers);
+
+        // Bins points whose elevation is in [minimumElevation, minimumElevation + binCount * binSize).
+        // Only every pointStride-th point is used.
+        void Build(
+            const std::vector<k4a_float3_t>& cloudPoints,
+            const Samples::Vector& up,
+            float minimumElevation,
+            float binSize,
+            size_t binCount,
+            size_t pointStride = 1);
+
+        size_t GetBinCount() const { return m_binCount; }
+        float GetBinLeftEdge(size_t bin) const { return m_minimumElevation + bin * m_binSize; }
+
+        // Index of the lowest non-empty bin, GetBinCount() if all bins are empty.
+        size_t GetFirstNonEmptyBin() const;
+
+        // Number of points and moments of the bins [binStart, binEnd).
+        size_t GetCount(size_t binStart, size_t binEnd) const;
+        Moments GetMoments(size_t binStart, size_t binEnd) const;
+
+    private:
+        FrameArena& m_arena;
+        WorkerPool* m_workers;
+
+        float m_minimumElevation = 0;
+        float m_binSize = 1;
+        size_t m_binCount = 0;
+
+        // m_prefix[i] holds the sums over the bins [0, i), it has m_binCount + 1 entries.
+        ArenaSpan<Moments> m_prefix;
+    };
+
+    // Least squares plane through the points summarized by the moments, {} if they are degenerate.
+    std::optional<Samples::Plane> FitPlaneToMoments(const ElevationHistogram::Moments& moments);
+
     class FloorDetector
     {
     public:
@@ -23,4 +78,60 @@ namespace Samples
             const k4a_calibration_t& sensorCalibration,
             size_t minimumFloorPointCount);
     };
+
+    // Tracks the floor plane over a sequence of frames.
+    //
+    // The first detection searches the whole elevation range like FloorDetector. Once the floor is found,
+    // the tracker is locked: following frames only search a narrow band around the previous floor elevation
+    // using a subsample of the points. A full search is done again when the gravity direction changes by
+    // more than GravityChangeThresholdInDeg or when the floor is no longer found in the band.
+    class FloorTracker
+    {
+    public:
+        // The tracker takes its per-frame memory from the arena, which the caller resets between frames.
+        FloorTracker(size_t minimumFloorPointCount, FrameArena& arena, WorkerPool& workers);
+
+        std::optional<Samples::Plane> Update(
+            const std::vector<k4a_float3_t>& cloudPoints,
+            const k4a_imu_sample_t& imuSample,
+            const k4a_calibration_t& sensorCalibration);
+
+        // Same with a gravity vector in the depth camera frame, {} if the device is moving.
+        std::optional<Samples::Plane> Update(
+            const std::vector<k4a_float3_t>& cloudPoints,
+            const std::optional<Samples::Vector>& gravity);
+
+        void Reset();
+
+        bool IsLocked() const { return m_locked; }
+
+        // True if the last Update found the floor in the band around the locked floor, without the full search.
+        bool IsFoundInBand() const { return m_foundInBand; }
+
+        // Support of the last detection in [0, 1]: 1 when the floor window holds at least
+        // twice the minimum number of points.
+        float GetConfidence() const { return m_confidence; }
+
+        // Temporal stability in (0, 1]: 1 / (1 + average frame to frame change of the floor elevation in cm).
+        float GetStability() const { return m_stability; }
+
+        static constexpr float GravityChangeThresholdInDeg = 1.0f;
+        static constexpr float LockedSearchBandInMeters = 0.10f;    // Searched above and below the previous floor.
+        static constexpr size_t LockedPointStride = 8;
+
+    private:
+        std::optional<Samples::Plane> Lose();
+
+        size_t m_minimumFloorPointCount;
+        ElevationHistogram m_histogram;
+
+        bool m_locked = false;
+        bool m_foundInBand = false;
+        Samples::Vector m_lockedUp = { 0, 0, 0 };
+        float m_lockedElevation = 0;
+
+        float m_confidence = 0;
+        float m_stability = 0;
+        float m_averageElevationChange = 0;
+    };
 }
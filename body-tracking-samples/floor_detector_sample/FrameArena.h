@@ -0,0 +1,95 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace Samples
+{
+    // Contiguous range of arena memory, valid until the arena is reset.
+    template<typename T>
+    struct ArenaSpan
+    {
+        T* Data = nullptr;
+        size_t Size = 0;
+
+        T& operator[](size_t i) const { return Data[i]; }
+        T* begin() const { return Data; }
+        T* end() const { return Data + Size; }
+        bool empty() const { return Size == 0; }
+    };
+
+    // Scratch memory for the work of one frame.
+    //
+    // Allocate hands out uninitialized spans from a single block by bumping an offset, and Reset releases
+    // all of them at once at the start of the next frame. When a frame needs more than the block holds,
+    // the extra spans come from overflow blocks; Reset then replaces the block by one large enough for
+    // the whole frame. After the first frames the arena stops allocating.
+    class FrameArena
+    {
+    public:
+        explicit FrameArena(size_t initialCapacity = 0)
+        {
+            Grow(initialCapacity);
+        }
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        template<typename T>
+        ArenaSpan<T> Allocate(size_t count)
+        {
+            static_assert(std::is_trivially_destructible<T>::value, "Arena memory is released without running destructors");
+            return { static_cast<T*>(AllocateBytes(count * sizeof(T), alignof(T))), count };
+        }
+
+        void Reset()
+        {
+            if (!m_overflowBlocks.empty())
+            {
+                m_overflowBlocks.clear();
+                Grow(m_capacity + m_overflowBytes);
+                m_overflowBytes = 0;
+            }
+            m_used = 0;
+        }
+
+        size_t GetCapacity() const { return m_capacity; }
+        size_t GetUsed() const { return m_used + m_overflowBytes; }
+
+    private:
+        void Grow(size_t capacity)
+        {
+            m_block.reset(capacity > 0 ? new std::byte[capacity] : nullptr);
+            m_capacity = capacity;
+        }
+
+        void* AllocateBytes(size_t size, size_t alignment)
+        {
+            const size_t offset = (m_used + alignment - 1) / alignment * alignment;
+            if (offset + size <= m_capacity)
+            {
+                m_used = offset + size;
+                return m_block.get() + offset;
+            }
+
+            // Does not fit, serve it from an overflow block until the next Reset.
+            const size_t blockSize = size + alignment;
+            m_overflowBlocks.emplace_back(new std::byte[blockSize]);
+            m_overflowBytes += blockSize;
+            const size_t address = reinterpret_cast<size_t>(m_overflowBlocks.back().get());
+            return m_overflowBlocks.back().get() + ((address + alignment - 1) / alignment * alignment - address);
+        }
+
+        std::unique_ptr<std::byte[]> m_block;
+        size_t m_capacity = 0;
+        size_t m_used = 0;
+
+        std::vector<std::unique_ptr<std::byte[]>> m_overflowBlocks;
+        size_t m_overflowBytes = 0;
+    };
+}
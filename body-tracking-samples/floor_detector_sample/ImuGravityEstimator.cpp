@@ -0,0 +1,195 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "ImuGravityEstimator.h"
+
+#include <cmath>
+#include <iostream>
+
+Samples::ImuGravityEstimator::ImuGravityEstimator(const k4a_calibration_t& sensorCalibration, float cutoffFrequencyHz)
+    : m_cutoffFrequencyHz(cutoffFrequencyHz)
+{
+    // Extrinsic Rotation from ACCEL to DEPTH.
+    const auto& R = sensorCalibration.extrinsics[K4A_CALIBRATION_TYPE_ACCEL][K4A_CALIBRATION_TYPE_DEPTH].rotation;
+    for (size_t i = 0; i < m_rotation.size(); ++i)
+    {
+        m_rotation[i] = R[i];
+    }
+}
+
+Samples::ImuGravityEstimator::~ImuGravityEstimator()
+{
+    Stop();
+}
+
+void Samples::ImuGravityEstimator::Start(k4a_device_t device)
+{
+    Stop();
+    m_running = true;
+    m_thread = std::thread(&ImuGravityEstimator::Run, this, device);
+}
+
+void Samples::ImuGravityEstimator::Stop()
+{
+    m_running = false;
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void Samples::ImuGravityEstimator::Run(k4a_device_t device)
+{
+    const int32_t timeoutInMs = 10;
+    while (m_running)
+    {
+        // Returns the queued samples one by one, waits only when the queue is empty.
+        k4a_imu_sample_t imuSample;
+        k4a_wait_result_t result = k4a_device_get_imu_sample(device, &imuSample, timeoutInMs);
+        if (result == K4A_WAIT_RESULT_SUCCEEDED)
+        {
+            AddSample(imuSample);
+        }
+        else if (result == K4A_WAIT_RESULT_FAILED)
+        {
+            std::cout << "Get IMU sample failed!" << std::endl;
+            break;
+        }
+    }
+}
+
+void Samples::ImuGravityEstimator::AddRecordedSamples(k4a_playback_t playback, uint64_t untilTimestampUsec)
+{
+    while (true)
+    {
+        if (!m_pendingRecordedSample.has_value())
+        {
+            k4a_imu_sample_t imuSample;
+            if (k4a_playback_get_next_imu_sample(playback, &imuSample) != K4A_STREAM_RESULT_SUCCEEDED)
+            {
+                return;
+            }
+            m_pendingRecordedSample = imuSample;
+        }
+
+        if (m_pendingRecordedSample->acc_timestamp_usec > untilTimestampUsec)
+        {
+            return;
+        }
+        AddSample(*m_pendingRecordedSample);
+        m_pendingRecordedSample.reset();
+    }
+}
+
+void Samples::ImuGravityEstimator::AddSample(const k4a_imu_sample_t& imuSample)
+{
+    const Samples::Vector acceleration = imuSample.acc_sample; // in meters per second squared.
+    const uint64_t timestampUsec = imuSample.acc_timestamp_usec;
+
+    // Skip samples with motion on top of gravity, the estimate is kept.
+    if (std::abs(acceleration.Length() - 9.81f) < MaximumGravityDeviation)
+    {
+        if (m_acceptedSampleCount == 0 || timestampUsec <= m_lastAcceptedTimestampUsec)
+        {
+            m_filteredAcceleration = acceleration;
+        }
+        else
+        {
+            // Exponential low pass filter with the configured cutoff frequency. The time step spans the rejected
+            // samples, so the first sample after motion gets the weight of all the time the estimate was held.
+            const float dt = static_cast<float>(timestampUsec - m_lastAcceptedTimestampUsec) * 1e-6f;
+            const float alpha = 1.0f / (1.0f + 1.0f / (6.28318531f * m_cutoffFrequencyHz * dt));
+            m_filteredAcceleration = m_filteredAcceleration + (acceleration - m_filteredAcceleration) * alpha;
+        }
+        m_lastAcceptedTimestampUsec = timestampUsec;
+        m_acceptedSampleCount++;
+    }
+
+    const Samples::Vector& a = m_filteredAcceleration;
+    const auto& R = m_rotation;
+    Samples::Vector depthAcc = {
+        R[0] * a.X + R[1] * a.Y + R[2] * a.Z,
+        R[3] * a.X + R[4] * a.Y + R[5] * a.Z,
+        R[6] * a.X + R[7] * a.Y + R[8] * a.Z };
+
+    // An accelerometer at rest reports upward acceleration, gravity points the other way.
+    GravityEstimate estimate = {
+        timestampUsec,
+        depthAcc * -1,
+        m_acceptedSampleCount >= MinimumSampleCount && timestampUsec - m_lastAcceptedTimestampUsec <= MaximumEstimateAgeUsec };
+    Publish(estimate);
+}
+
+void Samples::ImuGravityEstimator::Publish(const GravityEstimate& estimate)
+{
+    const uint64_t index = m_publishedCount.load(std::memory_order_relaxed);
+    GravitySlot& slot = m_history[index % HistorySize];
+
+    const uint32_t sequence = slot.Sequence.load(std::memory_order_relaxed);
+    slot.Sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.TimestampUsec.store(estimate.TimestampUsec, std::memory_order_relaxed);
+    slot.X.store(estimate.Gravity.X, std::memory_order_relaxed);
+    slot.Y.store(estimate.Gravity.Y, std::memory_order_relaxed);
+    slot.Z.store(estimate.Gravity.Z, std::memory_order_relaxed);
+    slot.Valid.store(estimate.Valid, std::memory_order_relaxed);
+
+    slot.Sequence.store(sequence + 2, std::memory_order_release);
+    m_publishedCount.store(index + 1, std::memory_order_release);
+}
+
+bool Samples::ImuGravityEstimator::TryRead(uint64_t index, GravityEstimate& estimate) const
+{
+    const GravitySlot& slot = m_history[index % HistorySize];
+    for (int attempt = 0; attempt < 4; ++attempt)
+    {
+        const uint32_t sequence = slot.Sequence.load(std::memory_order_acquire);
+        if (sequence & 1)
+        {
+            continue;
+        }
+
+        estimate.TimestampUsec = slot.TimestampUsec.load(std::memory_order_relaxed);
+        estimate.Gravity = { slot.X.load(std::memory_order_relaxed), slot.Y.load(std::memory_order_relaxed), slot.Z.load(std::memory_order_relaxed) };
+        estimate.Valid = slot.Valid.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.Sequence.load(std::memory_order_relaxed) == sequence)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<Samples::Vector> Samples::ImuGravityEstimator::TryGetGravity(uint64_t deviceTimestampUsec) const
+{
+    const uint64_t publishedCount = m_publishedCount.load(std::memory_order_acquire);
+
+    // Walk back from the newest estimate to the first one not newer than the timestamp. Only half of the ring
+    // is searched to leave the writer room to advance meanwhile; the sequence keeps every read consistent.
+    const uint64_t searchCount = publishedCount < HistorySize / 2 ? publishedCount : HistorySize / 2;
+    GravityEstimate estimate = { 0, { 0, 0, 0 }, false };
+    bool found = false;
+    for (uint64_t i = 0; i < searchCount; ++i)
+    {
+        GravityEstimate candidate = { 0, { 0, 0, 0 }, false };
+        if (!TryRead(publishedCount - 1 - i, candidate))
+        {
+            continue;
+        }
+        estimate = candidate;
+        found = true;
+        if (candidate.TimestampUsec <= deviceTimestampUsec)
+        {
+            break;
+        }
+    }
+
+    if (found && estimate.Valid)
+    {
+        return estimate.Gravity;
+    }
+    return {};
+}
@@ -0,0 +1,103 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "SampleMathTypes.h"
+
+#include <k4a/k4a.h>
+#include <k4arecord/playback.h>
+
+#include <array>
+#include <atomic>
+#include <optional>
+#include <thread>
+
+namespace Samples
+{
+    // Estimates the gravity vector in the depth camera frame from all IMU samples.
+    //
+    // Accelerometer samples (about 1.6 kHz) are low pass filtered; samples that do not look like
+    // gravity alone (the device is moving) are skipped instead of invalidating the estimate. Every
+    // filtered value is published with its timestamp into a lock-free history ring, so the capture
+    // thread reads the estimate aligned to a depth frame without locking and without waiting.
+    //
+    // Samples come from a background thread draining the device queue (Start), or are fed from a
+    // recording (AddRecordedSamples) or directly (AddSample).
+    class ImuGravityEstimator
+    {
+    public:
+        explicit ImuGravityEstimator(const k4a_calibration_t& sensorCalibration, float cutoffFrequencyHz = 2.0f);
+        ~ImuGravityEstimator();
+
+        ImuGravityEstimator(const ImuGravityEstimator&) = delete;
+        ImuGravityEstimator& operator=(const ImuGravityEstimator&) = delete;
+
+        // Starts draining the IMU queue of the device on a background thread. The IMU must be started.
+        void Start(k4a_device_t device);
+        void Stop();
+
+        // Feeds the samples of the recording up to the given device timestamp.
+        void AddRecordedSamples(k4a_playback_t playback, uint64_t untilTimestampUsec);
+
+        // Feeds one sample. Must not be called concurrently with itself or while the background thread runs.
+        void AddSample(const k4a_imu_sample_t& imuSample);
+
+        // Gravity in the depth camera frame at the given device timestamp, from the latest estimate
+        // not newer than the timestamp (or the oldest one kept). {} if there is no stable estimate.
+        std::optional<Samples::Vector> TryGetGravity(uint64_t deviceTimestampUsec) const;
+
+        // Samples that looked like gravity alone are filtered; samples further than this from g are skipped.
+        static constexpr float MaximumGravityDeviation = 0.2f;
+
+        // The estimate becomes invalid when no sample was accepted for this long.
+        static constexpr uint64_t MaximumEstimateAgeUsec = 500000;
+
+        // Number of accepted samples before the estimate is valid.
+        static constexpr size_t MinimumSampleCount = 16;
+
+        // About 160 ms of history at 1.6 kHz.
+        static constexpr size_t HistorySize = 256;
+
+    private:
+        // Single writer, multiple readers; readers retry while the sequence is odd or changed (seqlock).
+        struct GravitySlot
+        {
+            std::atomic<uint32_t> Sequence{ 0 };
+            std::atomic<uint64_t> TimestampUsec{ 0 };
+            std::atomic<float> X{ 0 };
+            std::atomic<float> Y{ 0 };
+            std::atomic<float> Z{ 0 };
+            std::atomic<bool> Valid{ false };
+        };
+
+        struct GravityEstimate
+        {
+            uint64_t TimestampUsec;
+            Samples::Vector Gravity;
+            bool Valid;
+        };
+
+        void Publish(const GravityEstimate& estimate);
+        bool TryRead(uint64_t index, GravityEstimate& estimate) const;
+        void Run(k4a_device_t device);
+
+        // Rotation from the accelerometer to the depth camera.
+        std::array<float, 9> m_rotation;
+        float m_cutoffFrequencyHz;
+
+        // Filter state, only touched by the writer.
+        Samples::Vector m_filteredAcceleration = { 0, 0, 0 };
+        uint64_t m_lastAcceptedTimestampUsec = 0;
+        size_t m_acceptedSampleCount = 0;
+
+        std::array<GravitySlot, HistorySize> m_history;
+        std::atomic<uint64_t> m_publishedCount{ 0 };
+
+        std::thread m_thread;
+        std::atomic<bool> m_running{ false };
+
+        // Recorded sample read ahead of the requested timestamp.
+        std::optional<k4a_imu_sample_t> m_pendingRecordedSample;
+    };
+}
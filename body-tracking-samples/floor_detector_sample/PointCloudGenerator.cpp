@@ -35,6 +35,9 @@ Samples::PointCloudGenerator::PointCloudGenerator(const k4a_calibration_t& senso
         depthHeight,
         depthWidth * (int)sizeof(PointCloudPixel_int16x3_t),
         &m_pointCloudImage_int16x3), "Create Point Cloud Image failed!");
+
+    // Enough for any down-sampling step, so that GetCloudPoints never reallocates.
+    m_cloudPoints.reserve(static_cast<size_t>(depthWidth) * depthHeight);
 }
 
 Samples::PointCloudGenerator::~PointCloudGenerator()
@@ -72,7 +75,8 @@ const std::vector<k4a_float3_t>& Samples::PointCloudGenerator::GetCloudPoints(in
 
     const auto pointCloudImageBufferInMM = (PointCloudPixel_int16x3_t*)k4a_image_get_buffer(m_pointCloudImage_int16x3);
 
-    m_cloudPoints.resize(width * height / (step * step));
+    // Rows and columns 0, step, 2 * step, ... are sampled, also when the size is not a multiple of step.
+    m_cloudPoints.resize(static_cast<size_t>((width + step - 1) / step) * ((height + step - 1) / step));
     size_t cloudPointsIndex = 0;
     for (int h = 0; h < height; h+= step)
     {
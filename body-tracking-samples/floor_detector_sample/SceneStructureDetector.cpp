@@ -0,0 +1,492 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "SceneStructureDetector.h"
+
+#include <algorithm>    // std::min, std::max, std::fill
+#include <array>        // std::array
+#include <cmath>        // std::abs, std::atan2
+#include <limits>       // std::numeric_limits
+#include <random>       // std::minstd_rand
+
+namespace
+{
+    const size_t BinAggregation = 6;
+    const float MaximumElevationInMeters = 8.0f;
+    const float PlaneMaxTiltInDeg = 5.0f;
+
+    // A horizontal plane must hold this many times more points than the windows right below and above it,
+    // otherwise it is a slice of vertical structures.
+    const size_t HorizontalPeakProminence = 2;
+
+    // Both points of a wall hypothesis must be at least this far apart horizontally.
+    const float MinimumWallHypothesisSpanInMeters = 0.2f;
+
+    const size_t MaximumRansacThreadCount = 4;
+    const size_t MaximumCellsPerAxis = 256;
+
+    Samples::Vector HorizontalAxis(const Samples::Vector& up, Samples::Vector reference)
+    {
+        Samples::Vector axis = reference - up * reference.Dot(up);
+        if (axis.Length() < 0.1f)
+        {
+            reference = { 0, 0, 1 };
+            axis = reference - up * reference.Dot(up);
+        }
+        return axis.Normalized();
+    }
+}
+
+const char* Samples::GetScenePlaneTypeName(ScenePlaneType type)
+{
+    switch (type)
+    {
+    case ScenePlaneType::Floor:
+        return "Floor";
+    case ScenePlaneType::Table:
+        return "Table";
+    case ScenePlaneType::Ceiling:
+        return "Ceiling";
+    case ScenePlaneType::Wall:
+        return "Wall";
+    }
+    return "Unknown";
+}
+
+Samples::SceneStructureDetector::SceneStructureDetector(FrameArena& arena, WorkerPool& workers, SceneStructureSettings settings)
+    : m_settings(settings)
+    , m_arena(arena)
+    , m_workers(workers)
+    , m_histogram(arena, &workers)
+{
+}
+
+const std::vector<Samples::ScenePlane>& Samples::SceneStructureDetector::Detect(
+    const std::vector<k4a_float3_t>& cloudPoints,
+    const k4a_imu_sample_t& imuSample,
+    const k4a_calibration_t& sensorCalibration)
+{
+    return Detect(cloudPoints, TryEstimateGravityVectorForDepthCamera(imuSample, sensorCalibration));
+}
+
+const std::vector<Samples::ScenePlane>& Samples::SceneStructureDetector::Detect(
+    const std::vector<k4a_float3_t>& cloudPoints,
+    const std::optional<Samples::Vector>& gravity)
+{
+    m_planes.clear();
+
+    if (!gravity.has_value() || cloudPoints.empty())
+    {
+        return m_planes;
+    }
+
+    // Up normal is opposite to gravity down vector.
+    Samples::Vector up = (gravity.value() * -1).Normalized();
+
+    FindHorizontalCandidates(cloudPoints, up);
+
+    // Assign every point to the horizontal plane whose elevation window contains it, or keep it for the walls.
+    if (m_horizontalInliers.size() < m_horizontalCandidates.size())
+    {
+        m_horizontalInliers.resize(m_horizontalCandidates.size());
+    }
+    for (auto& inliers : m_horizontalInliers)
+    {
+        inliers.clear();
+    }
+    m_remainingIndices.clear();
+
+    for (size_t i = 0; i < cloudPoints.size(); ++i)
+    {
+        const float elevation = up.Dot(cloudPoints[i]);
+        size_t candidate = 0;
+        while (candidate < m_horizontalCandidates.size() &&
+            !(m_horizontalCandidates[candidate].ElevationStart <= elevation && elevation < m_horizontalCandidates[candidate].ElevationEnd))
+        {
+            ++candidate;
+        }
+
+        if (candidate < m_horizontalCandidates.size())
+        {
+            m_horizontalInliers[candidate].push_back(static_cast<uint32_t>(i));
+        }
+        else
+        {
+            m_remainingIndices.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    FindWalls(cloudPoints, up);
+
+    // Slices of the walls that fall into the elevation window of a horizontal plane belong to the wall.
+    const float halfWallThickness = m_settings.WallThicknessInMeters / 2;
+    for (size_t candidate = 0; candidate < m_horizontalCandidates.size(); ++candidate)
+    {
+        std::vector<uint32_t>& inliers = m_horizontalInliers[candidate];
+        size_t keptCount = 0;
+        for (uint32_t index : inliers)
+        {
+            size_t wall = 0;
+            while (wall < m_walls.size() && m_walls[wall].AbsDistance(cloudPoints[index]) >= halfWallThickness)
+            {
+                ++wall;
+            }
+
+            if (wall < m_walls.size())
+            {
+                m_wallInliers[wall].push_back(index);
+            }
+            else
+            {
+                inliers[keptCount++] = index;
+            }
+        }
+        inliers.resize(keptCount);
+    }
+
+    // Candidates are sorted by elevation: the lowest one below the camera is the floor,
+    // the highest one above the camera is the ceiling.
+    const Samples::Vector axisU = HorizontalAxis(up, { 1, 0, 0 });
+    const Samples::Vector axisV = up * axisU;
+    for (size_t i = 0; i < m_horizontalCandidates.size(); ++i)
+    {
+        const Samples::Plane& plane = m_horizontalCandidates[i].Plane;
+        const float elevation = up.Dot(plane.Origin);
+
+        ScenePlaneType type = ScenePlaneType::Table;
+        if (i == 0 && elevation < 0)
+        {
+            type = ScenePlaneType::Floor;
+        }
+        else if (i + 1 == m_horizontalCandidates.size() && elevation > 0)
+        {
+            type = ScenePlaneType::Ceiling;
+        }
+
+        AddRegions(cloudPoints, m_horizontalInliers[i], type, plane, axisU, axisV);
+    }
+
+    for (size_t wall = 0; wall < m_walls.size(); ++wall)
+    {
+        const Samples::Plane& plane = m_walls[wall];
+        AddRegions(cloudPoints, m_wallInliers[wall], ScenePlaneType::Wall, plane, (up * plane.Normal).Normalized(), up);
+    }
+
+    return m_planes;
+}
+
+void Samples::SceneStructureDetector::FindHorizontalCandidates(const std::vector<k4a_float3_t>& cloudPoints, const Samples::Vector& up)
+{
+    m_horizontalCandidates.clear();
+
+    const float binSize = m_settings.HorizontalPlaneThicknessInMeters / BinAggregation;
+    const size_t binCount = static_cast<size_t>(2 * MaximumElevationInMeters / binSize);
+    m_histogram.Build(cloudPoints, up, -MaximumElevationInMeters, binSize, binCount);
+
+    // Every window of BinAggregation bins that holds more points than the windows overlapping it is a candidate.
+    const size_t windowCount = binCount - BinAggregation + 1;
+    auto windowPointCount = [&](size_t window) { return m_histogram.GetCount(window, window + BinAggregation); };
+
+    size_t nextFreeWindow = 0;
+    for (size_t i = 0; i < windowCount; ++i)
+    {
+        const size_t count = windowPointCount(i);
+        if (count <= m_settings.MinimumPlanePointCount || i < nextFreeWindow)
+        {
+            continue;
+        }
+
+        bool isPeak = true;
+        const size_t firstNeighbor = i >= BinAggregation ? i - BinAggregation + 1 : 0;
+        const size_t lastNeighbor = std::min(windowCount - 1, i + BinAggregation - 1);
+        for (size_t j = firstNeighbor; j <= lastNeighbor && isPeak; ++j)
+        {
+            // On a plateau the lowest window wins.
+            const size_t neighborCount = windowPointCount(j);
+            isPeak = j < i ? neighborCount < count : (j == i || neighborCount <= count);
+        }
+        const size_t below = i >= BinAggregation ? windowPointCount(i - BinAggregation) : 0;
+        const size_t above = i + BinAggregation < windowCount ? windowPointCount(i + BinAggregation) : 0;
+        if (!isPeak || count < HorizontalPeakProminence * std::max(below, above))
+        {
+            continue;
+        }
+
+        auto plane = FitPlaneToMoments(m_histogram.GetMoments(i, i + BinAggregation));
+        if (plane.has_value())
+        {
+            // Ensure normal is mostly vertical.
+            auto tiltInDeg = std::acos(std::min(std::abs(plane->Normal.Dot(up)), 1.0f)) * 180.0f / 3.14159265f;
+            if (tiltInDeg < PlaneMaxTiltInDeg)
+            {
+                // For reduced jitter, use gravity for the normal.
+                m_horizontalCandidates.push_back({
+                    Samples::Plane::Create(up, plane->Origin),
+                    m_histogram.GetBinLeftEdge(i),
+                    m_histogram.GetBinLeftEdge(i + BinAggregation) });
+                nextFreeWindow = i + BinAggregation;
+            }
+        }
+    }
+}
+
+void Samples::SceneStructureDetector::FindWalls(const std::vector<k4a_float3_t>& cloudPoints, const Samples::Vector& up)
+{
+    // Orthonormal basis of the horizontal plane, for the wall fit.
+    const Samples::Vector e1 = HorizontalAxis(up, { 1, 0, 0 });
+    const Samples::Vector e2 = up * e1;
+    const float halfThickness = m_settings.WallThicknessInMeters / 2;
+
+    m_walls.clear();
+    for (size_t wall = 0; wall < m_settings.MaximumWallCount; ++wall)
+    {
+        const size_t remainingCount = m_remainingIndices.size();
+        if (remainingCount <= m_settings.MinimumPlanePointCount)
+        {
+            break;
+        }
+
+        // Score hypotheses on an evenly spaced subsample of the remaining points.
+        const size_t sampleCount = std::min(remainingCount, m_settings.RansacSampleCount);
+        m_ransacSample = m_arena.Allocate<k4a_float3_t>(sampleCount);
+        for (size_t i = 0; i < sampleCount; ++i)
+        {
+            m_ransacSample[i] = cloudPoints[m_remainingIndices[i * remainingCount / sampleCount]];
+        }
+
+        const size_t threadCount = std::min(MaximumRansacThreadCount, m_workers.GetThreadCount());
+        const size_t iterationCount = (m_settings.RansacIterationCount + threadCount - 1) / threadCount;
+        std::array<WallHypothesis, MaximumRansacThreadCount> hypotheses;
+        m_workers.Run(threadCount, [&](size_t t)
+        {
+            const uint32_t seed = static_cast<uint32_t>(wall * MaximumRansacThreadCount + t + 1);
+            hypotheses[t] = FindBestWallHypothesis(up, iterationCount, seed);
+        });
+
+        WallHypothesis best = hypotheses[0];
+        for (size_t t = 1; t < threadCount; ++t)
+        {
+            if (hypotheses[t].InlierCount > best.InlierCount)
+            {
+                best = hypotheses[t];
+            }
+        }
+
+        if (best.InlierCount * remainingCount / sampleCount <= m_settings.MinimumPlanePointCount)
+        {
+            break;
+        }
+
+        // Refine with a least squares fit of a vertical plane to all inliers of the hypothesis:
+        // the normal is perpendicular to the major axis of the inliers projected on the horizontal plane.
+        double n = 0, sx = 0, sy = 0, sz = 0, sa = 0, sb = 0, saa = 0, sab = 0, sbb = 0;
+        for (uint32_t index : m_remainingIndices)
+        {
+            const Samples::Vector p = cloudPoints[index];
+            if (std::abs(best.Normal.Dot(p) + best.C) < halfThickness)
+            {
+                const double a = e1.Dot(p);
+                const double b = e2.Dot(p);
+                n += 1;
+                sx += p.X;
+                sy += p.Y;
+                sz += p.Z;
+                sa += a;
+                sb += b;
+                saa += a * a;
+                sab += a * b;
+                sbb += b * b;
+            }
+        }
+
+        const double caa = saa - sa * sa / n;
+        const double cab = sab - sa * sb / n;
+        const double cbb = sbb - sb * sb / n;
+        const double majorAngle = 0.5 * std::atan2(2 * cab, caa - cbb);
+        Samples::Vector normal = e1 * static_cast<float>(-std::sin(majorAngle)) + e2 * static_cast<float>(std::cos(majorAngle));
+        const Samples::Vector centroid(static_cast<float>(sx / n), static_cast<float>(sy / n), static_cast<float>(sz / n));
+
+        // Orient the normal towards the camera at the origin.
+        if (normal.Dot(centroid) > 0)
+        {
+            normal = normal * -1;
+        }
+        const Samples::Plane plane = Samples::Plane::Create(normal, centroid);
+
+        // Move the inliers of the refined plane out of the remaining points.
+        if (m_wallInliers.size() <= wall)
+        {
+            m_wallInliers.resize(wall + 1);
+        }
+        std::vector<uint32_t>& inliers = m_wallInliers[wall];
+        inliers.clear();
+        size_t keptCount = 0;
+        for (uint32_t index : m_remainingIndices)
+        {
+            if (std::abs(normal.Dot(cloudPoints[index]) + plane.C) < halfThickness)
+            {
+                inliers.push_back(index);
+            }
+            else
+            {
+                m_remainingIndices[keptCount++] = index;
+            }
+        }
+        m_remainingIndices.resize(keptCount);
+
+        if (inliers.size() <= m_settings.MinimumPlanePointCount)
+        {
+            break;
+        }
+
+        m_walls.push_back(plane);
+    }
+}
+
+Samples::SceneStructureDetector::WallHypothesis Samples::SceneStructureDetector::FindBestWallHypothesis(
+    const Samples::Vector& up,
+    size_t iterationCount,
+    uint32_t seed) const
+{
+    const float halfThickness = m_settings.WallThicknessInMeters / 2;
+    const k4a_float3_t* sample = m_ransacSample.Data;
+    const size_t sampleCount = m_ransacSample.Size;
+
+    std::minstd_rand random(seed);
+    std::uniform_int_distribution<size_t> pick(0, sampleCount - 1);
+
+    WallHypothesis best;
+    for (size_t iteration = 0; iteration < iterationCount; ++iteration)
+    {
+        // A vertical plane through two points contains their difference and the up vector.
+        const Samples::Vector p1 = sample[pick(random)];
+        const Samples::Vector p2 = sample[pick(random)];
+        Samples::Vector normal = (p2 - p1) * up;
+        const float span = normal.Length();
+        if (span < MinimumWallHypothesisSpanInMeters)
+        {
+            continue;
+        }
+        normal = normal / span;
+        const float c = -normal.Dot(p1);
+
+        size_t inlierCount = 0;
+        for (size_t i = 0; i < sampleCount; ++i)
+        {
+            const float distance = normal.X * sample[i].xyz.x + normal.Y * sample[i].xyz.y + normal.Z * sample[i].xyz.z + c;
+            inlierCount += std::abs(distance) < halfThickness ? 1 : 0;
+        }
+
+        if (inlierCount > best.InlierCount)
+        {
+            best = { normal, c, inlierCount };
+        }
+    }
+    return best;
+}
+
+void Samples::SceneStructureDetector::AddRegions(
+    const std::vector<k4a_float3_t>& cloudPoints,
+    const std::vector<uint32_t>& inlierIndices,
+    ScenePlaneType type,
+    const Samples::Plane& plane,
+    const Samples::Vector& axisU,
+    const Samples::Vector& axisV)
+{
+    if (inlierIndices.empty())
+    {
+        return;
+    }
+
+    // Bounds of the inliers in plane coordinates.
+    const Samples::Vector& origin = plane.Origin;
+    float minU = std::numeric_limits<float>::max();
+    float minV = std::numeric_limits<float>::max();
+    float maxU = std::numeric_limits<float>::lowest();
+    float maxV = std::numeric_limits<float>::lowest();
+    for (uint32_t index : inlierIndices)
+    {
+        const Samples::Vector q = Samples::Vector(cloudPoints[index]) - origin;
+        const float u = q.Dot(axisU);
+        const float v = q.Dot(axisV);
+        minU = std::min(minU, u);
+        maxU = std::max(maxU, u);
+        minV = std::min(minV, v);
+        maxV = std::max(maxV, v);
+    }
+
+    // Count the inliers per cell.
+    const float cellSize = m_settings.CellSizeInMeters;
+    const size_t cellsU = std::min(MaximumCellsPerAxis, static_cast<size_t>((maxU - minU) / cellSize) + 1);
+    const size_t cellsV = std::min(MaximumCellsPerAxis, static_cast<size_t>((maxV - minV) / cellSize) + 1);
+    ArenaSpan<uint32_t> cellCounts = m_arena.Allocate<uint32_t>(cellsU * cellsV);
+    std::fill(cellCounts.begin(), cellCounts.end(), 0u);
+    for (uint32_t index : inlierIndices)
+    {
+        const Samples::Vector q = Samples::Vector(cloudPoints[index]) - origin;
+        const size_t cellU = std::min(cellsU - 1, static_cast<size_t>((q.Dot(axisU) - minU) / cellSize));
+        const size_t cellV = std::min(cellsV - 1, static_cast<size_t>((q.Dot(axisV) - minV) / cellSize));
+        cellCounts[cellV * cellsU + cellU]++;
+    }
+
+    // Grow regions of 4-connected dense cells. Every cell is pushed at most once.
+    ArenaSpan<uint8_t> cellVisited = m_arena.Allocate<uint8_t>(cellCounts.Size);
+    std::fill(cellVisited.begin(), cellVisited.end(), uint8_t(0));
+    ArenaSpan<size_t> regionStack = m_arena.Allocate<size_t>(cellCounts.Size);
+    for (size_t seed = 0; seed < cellCounts.Size; ++seed)
+    {
+        if (cellVisited[seed] || cellCounts[seed] < m_settings.MinimumCellPointCount)
+        {
+            continue;
+        }
+
+        size_t regionCount = 0;
+        size_t regionMinU = cellsU, regionMaxU = 0, regionMinV = cellsV, regionMaxV = 0;
+
+        cellVisited[seed] = 1;
+        size_t stackSize = 0;
+        regionStack[stackSize++] = seed;
+        while (stackSize > 0)
+        {
+            const size_t cell = regionStack[--stackSize];
+
+            const size_t cellU = cell % cellsU;
+            const size_t cellV = cell / cellsU;
+            regionCount += cellCounts[cell];
+            regionMinU = std::min(regionMinU, cellU);
+            regionMaxU = std::max(regionMaxU, cellU);
+            regionMinV = std::min(regionMinV, cellV);
+            regionMaxV = std::max(regionMaxV, cellV);
+
+            auto visit = [&](size_t neighbor)
+            {
+                if (!cellVisited[neighbor] && cellCounts[neighbor] >= m_settings.MinimumCellPointCount)
+                {
+                    cellVisited[neighbor] = 1;
+                    regionStack[stackSize++] = neighbor;
+                }
+            };
+            if (cellU > 0) visit(cell - 1);
+            if (cellU + 1 < cellsU) visit(cell + 1);
+            if (cellV > 0) visit(cell - cellsU);
+            if (cellV + 1 < cellsV) visit(cell + cellsU);
+        }
+
+        if (regionCount > m_settings.MinimumPlanePointCount)
+        {
+            const float centerU = minU + (regionMinU + regionMaxU + 1) * 0.5f * cellSize;
+            const float centerV = minV + (regionMinV + regionMaxV + 1) * 0.5f * cellSize;
+
+            ScenePlane scenePlane = {
+                type,
+                plane,
+                regionCount,
+                origin + axisU * centerU + axisV * centerV,
+                axisU,
+                axisV,
+                (regionMaxU - regionMinU + 1) * cellSize,
+                (regionMaxV - regionMinV + 1) * cellSize };
+            m_planes.push_back(scenePlane);
+        }
+    }
+}
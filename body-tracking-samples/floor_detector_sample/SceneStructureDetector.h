@@ -0,0 +1,120 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "FloorDetector.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace Samples
+{
+    enum class ScenePlaneType
+    {
+        Floor,
+        Table,      // Any horizontal surface between floor and ceiling
+        Ceiling,
+        Wall
+    };
+
+    const char* GetScenePlaneTypeName(ScenePlaneType type);
+
+    struct ScenePlane
+    {
+        ScenePlaneType Type;
+        Samples::Plane Plane;       // Normal points up for horizontal planes and towards the camera for walls.
+        size_t InlierCount;
+
+        // Extent of the inliers: a rectangle on the plane centered at Center, spanned by the unit axes AxisU and AxisV.
+        // For walls AxisU is horizontal and AxisV points up.
+        Samples::Vector Center;
+        Samples::Vector AxisU;
+        Samples::Vector AxisV;
+        float ExtentU;              // in meters
+        float ExtentV;              // in meters
+    };
+
+    struct SceneStructureSettings
+    {
+        size_t MinimumPlanePointCount = 256;
+        float HorizontalPlaneThicknessInMeters = 0.05f;
+        float WallThicknessInMeters = 0.04f;
+        size_t MaximumWallCount = 4;
+
+        // RANSAC for walls: hypotheses per wall and number of points they are scored on.
+        size_t RansacIterationCount = 256;
+        size_t RansacSampleCount = 2048;
+
+        // Region growing: inliers are binned into cells on the plane, and connected cells with at least
+        // MinimumCellPointCount points form one region. Separate regions become separate planes.
+        float CellSizeInMeters = 0.10f;
+        size_t MinimumCellPointCount = 2;
+    };
+
+    // Extracts the dominant planes of the scene: floor, tables, ceiling and walls.
+    //
+    // Horizontal planes are the peaks of the gravity aligned elevation histogram of FloorDetector. Walls are
+    // found with RANSAC on the remaining points, with hypotheses constrained to contain the gravity direction,
+    // scored in parallel and refined by a least squares fit. Inliers of every plane are then split into
+    // connected regions, so that for example two tables of the same height are reported separately.
+    class SceneStructureDetector
+    {
+    public:
+        // The detector takes its per-frame memory from the arena, which the caller resets between frames.
+        SceneStructureDetector(FrameArena& arena, WorkerPool& workers, SceneStructureSettings settings = SceneStructureSettings());
+
+        // Returns the planes of the scene, valid until the next call. Empty if the device is moving.
+        const std::vector<ScenePlane>& Detect(
+            const std::vector<k4a_float3_t>& cloudPoints,
+            const k4a_imu_sample_t& imuSample,
+            const k4a_calibration_t& sensorCalibration);
+
+        // Same with a gravity vector in the depth camera frame, {} if the device is moving.
+        const std::vector<ScenePlane>& Detect(
+            const std::vector<k4a_float3_t>& cloudPoints,
+            const std::optional<Samples::Vector>& gravity);
+
+    private:
+        struct HorizontalCandidate
+        {
+            Samples::Plane Plane;
+            float ElevationStart;   // inclusive
+            float ElevationEnd;     // exclusive
+        };
+
+        struct WallHypothesis
+        {
+            Samples::Vector Normal = { 0, 0, 0 };
+            float C = 0;
+            size_t InlierCount = 0;
+        };
+
+        void FindHorizontalCandidates(const std::vector<k4a_float3_t>& cloudPoints, const Samples::Vector& up);
+        void FindWalls(const std::vector<k4a_float3_t>& cloudPoints, const Samples::Vector& up);
+        WallHypothesis FindBestWallHypothesis(const Samples::Vector& up, size_t iterationCount, uint32_t seed) const;
+        void AddRegions(
+            const std::vector<k4a_float3_t>& cloudPoints,
+            const std::vector<uint32_t>& inlierIndices,
+            ScenePlaneType type,
+            const Samples::Plane& plane,
+            const Samples::Vector& axisU,
+            const Samples::Vector& axisV);
+
+        SceneStructureSettings m_settings;
+        FrameArena& m_arena;
+        WorkerPool& m_workers;
+        ElevationHistogram m_histogram;
+
+        std::vector<ScenePlane> m_planes;
+        std::vector<HorizontalCandidate> m_horizontalCandidates;
+        std::vector<Samples::Plane> m_walls;
+
+        // Index lists reused across frames, they only grow. Fixed size scratch comes from the arena.
+        std::vector<std::vector<uint32_t>> m_horizontalInliers;
+        std::vector<uint32_t> m_remainingIndices;
+        std::vector<std::vector<uint32_t>> m_wallInliers;
+        ArenaSpan<k4a_float3_t> m_ransacSample;
+    };
+}
@@ -0,0 +1,94 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "WorkerPool.h"
+
+Samples::WorkerPool::WorkerPool(size_t threadCount)
+{
+    for (size_t i = 1; i < threadCount; ++i)
+    {
+        m_workers.emplace_back(&WorkerPool::WorkerLoop, this);
+    }
+}
+
+Samples::WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void Samples::WorkerPool::RunTasks(size_t taskCount, TaskFunction function, const void* context)
+{
+    if (taskCount == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = function;
+        m_context = context;
+        m_taskCount = taskCount;
+        m_nextTask = 0;
+        m_pendingTaskCount = taskCount;
+        generation = ++m_generation;
+    }
+    if (!m_workers.empty())
+    {
+        m_workAvailable.notify_all();
+    }
+
+    ProcessTasks(generation);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_workDone.wait(lock, [this] { return m_pendingTaskCount == 0; });
+}
+
+void Samples::WorkerPool::ProcessTasks(uint64_t generation)
+{
+    // Tasks are few and coarse, so they are claimed under the lock. A worker that wakes up after the
+    // tasks of its generation are gone finds a newer generation and returns.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_generation == generation && m_nextTask < m_taskCount)
+    {
+        const size_t index = m_nextTask++;
+        const TaskFunction function = m_function;
+        const void* context = m_context;
+
+        lock.unlock();
+        function(context, index);
+        lock.lock();
+
+        if (--m_pendingTaskCount == 0)
+        {
+            m_workDone.notify_all();
+        }
+    }
+}
+
+void Samples::WorkerPool::WorkerLoop()
+{
+    uint64_t seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workAvailable.wait(lock, [&] { return m_stopping || m_generation != seenGeneration; });
+            if (m_stopping)
+            {
+                return;
+            }
+            seenGeneration = m_generation;
+        }
+        ProcessTasks(seenGeneration);
+    }
+}
@@ -0,0 +1,59 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Samples
+{
+    // Persistent worker threads for the data parallel steps of the detectors.
+    //
+    // Unlike std::async, running tasks does not create threads or allocate, so it can be used
+    // in every frame of a pipeline that must not allocate.
+    class WorkerPool
+    {
+    public:
+        // threadCount includes the calling thread, which takes part in every Run.
+        explicit WorkerPool(size_t threadCount = std::thread::hardware_concurrency());
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        size_t GetThreadCount() const { return m_workers.size() + 1; }
+
+        // Calls task(i) for every i in [0, taskCount) and returns when all calls are done.
+        template<typename Task>
+        void Run(size_t taskCount, const Task& task)
+        {
+            RunTasks(taskCount, [](const void* context, size_t index) { (*static_cast<const Task*>(context))(index); }, &task);
+        }
+
+    private:
+        using TaskFunction = void (*)(const void* context, size_t index);
+
+        void RunTasks(size_t taskCount, TaskFunction function, const void* context);
+        void ProcessTasks(uint64_t generation);
+        void WorkerLoop();
+
+        std::vector<std::thread> m_workers;
+
+        std::mutex m_runMutex;      // Serializes Run calls from different threads.
+        std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_workDone;
+        uint64_t m_generation = 0;
+        bool m_stopping = false;
+
+        TaskFunction m_function = nullptr;
+        const void* m_context = nullptr;
+        size_t m_taskCount = 0;
+        size_t m_nextTask = 0;
+        size_t m_pendingTaskCount = 0;
+    };
+}
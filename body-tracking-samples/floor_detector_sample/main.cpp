@@ -1,17 +1,29 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <chrono>
 #include <iostream>
 
 #include <k4a/k4a.h>
+#include <k4arecord/playback.h>
 
+// Count heap allocations to report when the steady-state detection allocates.
+#define K4A_SAMPLES_COUNT_ALLOCATIONS
+#include "AllocationCounter.h"
 #include "FloorDetector.h"
+#include "FrameArena.h"
+#include "ImuGravityEstimator.h"
 #include "PointCloudGenerator.h"
+#include "SceneStructureDetector.h"
 #include "Utilities.h"
 #include "Window3dWrapper.h"
+#include "WorkerPool.h"
 
 void PrintAppUsage()
 {
+    printf("\n");
+    printf(" Usage: floor_detector_sample.exe [recording.mkv]\n");
+    printf(" Streams from the first device, or plays back a recording made with the IMU track enabled.\n");
     printf("\n");
     printf(" Basic Navigation:\n\n");
     printf(" Rotate: Rotate the camera by moving the mouse while holding mouse left button\n");
@@ -21,11 +33,13 @@ void PrintAppUsage()
     printf(" Key Shortcuts\n\n");
     printf(" ESC: quit\n");
     printf(" h: help\n");
+    printf(" s: toggle scene structure detection (floor, tables, ceiling, walls)\n");
     printf("\n");
 }
 
 // Global State and Key Process Function
 bool s_isRunning = true;
+bool s_detectSceneStructure = false;
 
 int64_t ProcessKey(void* /*context*/, int key)
 {
@@ -39,6 +53,9 @@ int64_t ProcessKey(void* /*context*/, int key)
     case GLFW_KEY_H:
         PrintAppUsage();
         break;
+    case GLFW_KEY_S:
+        s_detectSceneStructure = !s_detectSceneStructure;
+        break;
     }
     return 1;
 }
@@ -49,26 +66,48 @@ int64_t CloseCallback(void* /*context*/)
     return 1;
 }
 
-int main()
+int main(int argc, char** argv)
 {
     PrintAppUsage();
 
     k4a_device_t device = nullptr;
-    VERIFY(k4a_device_open(0, &device), "Open K4A Device failed!");
+    k4a_playback_t playback = nullptr;
+    k4a_calibration_t sensorCalibration;
 
-    // Start camera. Make sure depth camera is enabled.
-    k4a_device_configuration_t deviceConfig = K4A_DEVICE_CONFIG_INIT_DISABLE_ALL;
-    deviceConfig.depth_mode = K4A_DEPTH_MODE_NFOV_UNBINNED;
-    deviceConfig.color_resolution = K4A_COLOR_RESOLUTION_OFF;
-    VERIFY(k4a_device_start_cameras(device, &deviceConfig), "Start K4A cameras failed!");
+    if (argc > 1)
+    {
+        VERIFY(k4a_playback_open(argv[1], &playback), "Open recording failed!");
+        VERIFY(k4a_playback_get_calibration(playback, &sensorCalibration), "Get depth camera calibration failed!");
 
-    // Get calibration information.
-    k4a_calibration_t sensorCalibration;
-    VERIFY(k4a_device_get_calibration(device, deviceConfig.depth_mode, deviceConfig.color_resolution, &sensorCalibration),
-        "Get depth camera calibration failed!");
+        k4a_record_configuration_t recordConfig;
+        VERIFY(k4a_playback_get_record_configuration(playback, &recordConfig), "Get record configuration failed!");
+        EXIT_IF(!recordConfig.imu_track_enabled, "The recording has no IMU track!");
+    }
+    else
+    {
+        VERIFY(k4a_device_open(0, &device), "Open K4A Device failed!");
+
+        // Start camera. Make sure depth camera is enabled.
+        k4a_device_configuration_t deviceConfig = K4A_DEVICE_CONFIG_INIT_DISABLE_ALL;
+        deviceConfig.depth_mode = K4A_DEPTH_MODE_NFOV_UNBINNED;
+        deviceConfig.color_resolution = K4A_COLOR_RESOLUTION_OFF;
+        VERIFY(k4a_device_start_cameras(device, &deviceConfig), "Start K4A cameras failed!");
+
+        // Get calibration information.
+        VERIFY(k4a_device_get_calibration(device, deviceConfig.depth_mode, deviceConfig.color_resolution, &sensorCalibration),
+            "Get depth camera calibration failed!");
 
-    // Start imu for gravity vector.
-    VERIFY(k4a_device_start_imu(device), "Start IMU failed!");
+        // Start imu for gravity vector.
+        VERIFY(k4a_device_start_imu(device), "Start IMU failed!");
+    }
+
+    // Gravity estimate from all IMU samples. For a device they are drained on a background thread,
+    // for a recording they are fed along with the captures.
+    Samples::ImuGravityEstimator gravityEstimator{ sensorCalibration };
+    if (device != nullptr)
+    {
+        gravityEstimator.Start(device);
+    }
 
     // Initialize the 3d window controller.
     Window3dWrapper window3d;
@@ -78,31 +117,120 @@ int main()
 
     // PointCloudGenerator for floor estimation.
     Samples::PointCloudGenerator pointCloudGenerator{ sensorCalibration };
-    Samples::FloorDetector floorDetector;
+
+    // Get down-sampled cloud points.
+    const int downsampleStep = 2;
+
+    // Scratch memory and threads shared by the detectors. The arena is reset at every frame.
+    Samples::FrameArena frameArena;
+    Samples::WorkerPool workers;
+
+    // Floor tracker, keeps the floor plane locked between frames.
+    const size_t minimumFloorPointCount = 1024 / (downsampleStep * downsampleStep);
+    Samples::FloorTracker floorTracker{ minimumFloorPointCount, frameArena, workers };
+    bool floorLocked = false;
+
+    // Scene structure detector, its result is printed about once per second.
+    Samples::SceneStructureSettings sceneStructureSettings;
+    sceneStructureSettings.MinimumPlanePointCount = minimumFloorPointCount;
+    Samples::SceneStructureDetector sceneStructureDetector{ frameArena, workers, sceneStructureSettings };
+    int frameCount = 0;
+
+    // Buffers reach their steady-state size during the first frames after a change of the detectors;
+    // after that, detection should not allocate.
+    const int warmUpFrameCount = 30;
+    int steadyFrameCount = 0;
+    bool sceneStructureEnabled = false;
 
     while (s_isRunning)
     {
         k4a_capture_t sensorCapture = nullptr;
-        k4a_wait_result_t getCaptureResult = k4a_device_get_capture(device, &sensorCapture, 0); // timeout_in_ms is set to 0
+        k4a_wait_result_t getCaptureResult = K4A_WAIT_RESULT_FAILED;
+        if (playback != nullptr)
+        {
+            k4a_stream_result_t streamResult = k4a_playback_get_next_capture(playback, &sensorCapture);
+            if (streamResult == K4A_STREAM_RESULT_EOF)
+            {
+                std::cout << "End of recording" << std::endl;
+                break;
+            }
+            getCaptureResult = streamResult == K4A_STREAM_RESULT_SUCCEEDED ? K4A_WAIT_RESULT_SUCCEEDED : K4A_WAIT_RESULT_FAILED;
+        }
+        else
+        {
+            getCaptureResult = k4a_device_get_capture(device, &sensorCapture, 0); // timeout_in_ms is set to 0
+        }
 
         if (getCaptureResult == K4A_WAIT_RESULT_SUCCEEDED)
         {
             k4a_image_t depthImage = k4a_capture_get_depth_image(sensorCapture);
 
-            // Capture an IMU sample for sensor orientation.
-            k4a_imu_sample_t imu_sample;
-            if (k4a_device_get_imu_sample(device, &imu_sample, 0) == K4A_WAIT_RESULT_SUCCEEDED)
+            if (depthImage != nullptr)
             {
+                // Gravity for sensor orientation, aligned to the depth frame.
+                const uint64_t depthTimestampUsec = k4a_image_get_device_timestamp_usec(depthImage);
+                if (playback != nullptr)
+                {
+                    gravityEstimator.AddRecordedSamples(playback, depthTimestampUsec);
+                }
+                const auto gravity = gravityEstimator.TryGetGravity(depthTimestampUsec);
+
+                // Release the scratch memory of the previous frame.
+                frameArena.Reset();
+                if (sceneStructureEnabled != s_detectSceneStructure)
+                {
+                    sceneStructureEnabled = s_detectSceneStructure;
+                    steadyFrameCount = 0;
+                }
+                const size_t allocationCountBefore = GetAllocationCount();
+
                 // Update point cloud.
                 pointCloudGenerator.Update(depthImage);
 
-                // Get down-sampled cloud points.
-                const int downsampleStep = 2;
                 const auto& cloudPoints = pointCloudGenerator.GetCloudPoints(downsampleStep);
 
-                // Detect floor plane based on latest visual and inertial observations.
-                const size_t minimumFloorPointCount = 1024 / (downsampleStep * downsampleStep);
-                const auto& maybeFloorPlane = floorDetector.TryDetectFloorPlane(cloudPoints, imu_sample, sensorCalibration, minimumFloorPointCount);
+                // Track floor plane based on latest visual and inertial observations.
+                const auto maybeFloorPlane = floorTracker.Update(cloudPoints, gravity);
+
+                const std::vector<Samples::ScenePlane>* planes = nullptr;
+                double sceneStructureDurationInMs = 0;
+                if (sceneStructureEnabled)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    planes = &sceneStructureDetector.Detect(cloudPoints, gravity);
+                    sceneStructureDurationInMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                }
+
+                const size_t allocationCount = GetAllocationCount() - allocationCountBefore;
+                if (allocationCount > 0 && steadyFrameCount >= warmUpFrameCount)
+                {
+                    printf("Detection made %zu heap allocations in a steady-state frame\n", allocationCount);
+                }
+                steadyFrameCount++;
+
+                if (floorTracker.IsLocked() != floorLocked)
+                {
+                    floorLocked = floorTracker.IsLocked();
+                    std::cout << (floorLocked ? "Floor locked" : "Floor lost") << std::endl;
+                    if (floorLocked && maybeFloorPlane.has_value())
+                    {
+                        // Extrinsics line of this camera for the skeleton fusion of multi_device_sample
+                        const Samples::Vector n = maybeFloorPlane->Normal.Normalized();
+                        const Samples::Vector& p = maybeFloorPlane->Origin;
+                        printf("  FLOOR %.4f %.4f %.4f %.4f %.4f %.4f\n", n.X, n.Y, n.Z, p.X, p.Y, p.Z);
+                    }
+                }
+
+                if (planes != nullptr && frameCount++ % 30 == 0)
+                {
+                    printf("%zu planes in %.1f ms\n", planes->size(), sceneStructureDurationInMs);
+                    for (const auto& plane : *planes)
+                    {
+                        printf("  %-8s inliers %6zu  center (%5.2f, %5.2f, %5.2f) m  extent %.2f x %.2f m\n",
+                            Samples::GetScenePlaneTypeName(plane.Type), plane.InlierCount,
+                            plane.Center.X, plane.Center.Y, plane.Center.Z, plane.ExtentU, plane.ExtentV);
+                    }
+                }
 
                 // Visualize point cloud.
                 window3d.UpdatePointClouds(depthImage);
@@ -126,7 +254,10 @@ int main()
 
             // Release the sensor capture and depth image once they are no longer needed.
             k4a_capture_release(sensorCapture);
-            k4a_image_release(depthImage);
+            if (depthImage != nullptr)
+            {
+                k4a_image_release(depthImage);
+            }
 
         }
         else if (getCaptureResult != K4A_WAIT_RESULT_TIMEOUT)
@@ -140,9 +271,17 @@ int main()
 
     window3d.Delete();
 
-    k4a_device_stop_cameras(device);
-    k4a_device_stop_imu(device);
-    k4a_device_close(device);
+    gravityEstimator.Stop();
+    if (playback != nullptr)
+    {
+        k4a_playback_close(playback);
+    }
+    else
+    {
+        k4a_device_stop_cameras(device);
+        k4a_device_stop_imu(device);
+        k4a_device_close(device);
+    }
 
     return 0;
 }
@@ -12,22 +12,6 @@
 using namespace Visualization;
 using namespace std::chrono;
 
-struct JumpResultsData
-{
-    // Jump analysis results
-    float Height = 0;
-    float PreparationSquatDepth = 0;
-    float LandingSquatDepth = 0;
-    float PushOffVelocity = 0;
-    float KneeAngle = 0;
-
-    // Fields that help to visualize the results
-    k4a_float3_t StandingPosition;
-    int PeakIndex = 0;
-    int SquatPointIndex = 0;
-    bool JumpSuccess = false;
-};
-
 /******************************************************************************************************/
 /******************************************* Demo functions *******************************************/
 /******************************************************************************************************/
@@ -57,17 +41,22 @@ void JumpEvaluator::UpdateData(k4abt_body_t selectedBody, uint64_t currentTimest
     // Calculate jump results
     if (m_jumpStatus == JumpStatus::EvaluateAndReview)
     {
-        JumpResultsData jumpResults = CalculateJumpResults();
-        PrintJumpResults(jumpResults);
-
-        if (jumpResults.JumpSuccess)
-        {
-            ReviewJumpResults(jumpResults);
-        }
+        EvaluateJumpData();
         m_jumpStatus = JumpStatus::Idle;
     }
 }
 
+void JumpEvaluator::EvaluateJumpData()
+{
+    JumpResultsData jumpResults = CalculateJumpResults();
+    PrintJumpResults(jumpResults);
+
+    if (jumpResults.JumpSuccess)
+    {
+        ReviewJumpResults(jumpResults);
+    }
+}
+
 /******************************************************************************************************/
 /****************************************** Helper functions ******************************************/
 /******************************************************************************************************/
@@ -97,6 +86,12 @@ void JumpEvaluator::InitiateJump()
     m_framesTimestampInUsec.clear();
 }
 
+void JumpEvaluator::LoadJumpData(const std::vector<k4abt_body_t>& bodies, const std::vector<float>& timestampsInUsec)
+{
+    m_listOfBodyPositions.assign(bodies.begin(), bodies.end());
+    m_framesTimestampInUsec.assign(timestampsInUsec.begin(), timestampsInUsec.end());
+}
+
 JumpResultsData JumpEvaluator::CalculateJumpResults()
 {
     JumpResultsData jumpResults;
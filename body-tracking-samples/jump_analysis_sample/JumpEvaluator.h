@@ -17,7 +17,22 @@ enum JumpStatus
 };
 
 struct IndexValueTuple;
-struct JumpResultsData;
+
+struct JumpResultsData
+{
+    // Jump analysis results
+    float Height = 0;
+    float PreparationSquatDepth = 0;
+    float LandingSquatDepth = 0;
+    float PushOffVelocity = 0;
+    float KneeAngle = 0;
+
+    // Fields that help to visualize the results
+    k4a_float3_t StandingPosition;
+    int PeakIndex = 0;
+    int SquatPointIndex = 0;
+    bool JumpSuccess = false;
+};
 
 class JumpEvaluator
 {
@@ -25,11 +40,19 @@ public:
     void UpdateStatus(bool changeStatus);
     void UpdateData(k4abt_body_t selectedBody, uint64_t currentTimestampUsec);
 
-private:
-    void InitiateJump();
+    // Replace the collected jump session, e.g. to analyze a recorded session without the hand raise gesture
+    void LoadJumpData(const std::vector<k4abt_body_t>& bodies, const std::vector<float>& timestampsInUsec);
 
+    // Analyze the collected jump session
     JumpResultsData CalculateJumpResults();
 
+    // Analyze the collected jump session, print the results and review a successful jump in the 3d windows until
+    // one of them is closed
+    void EvaluateJumpData();
+
+private:
+    void InitiateJump();
+
     void PrintJumpResults(const JumpResultsData& jumpResults);
 
     void ReviewJumpResults(const JumpResultsData& jumpResults);
@@ -2,14 +2,18 @@
 // Licensed under the MIT License.
 
 #include <array>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <map>
+#include <string>
 #include <vector>
 
 #include <k4a/k4a.h>
 #include <k4abt.h>
 
 #include <BodyTrackingHelpers.h>
+#include <SessionStore.h>
 #include <Utilities.h>
 #include <Window3dWrapper.h>
 
@@ -58,6 +62,16 @@ int64_t CloseCallback(void* /*context*/)
     return 1;
 }
 
+// Jump session recorded by simple_3d_viewer to analyze instead of the device
+struct ReplaySettings
+{
+    std::string FileName;                           // joint positions CSV file, no replay if empty
+    size_t Segment = SIZE_MAX;                      // Session of the file, the last one by default
+    uint32_t BodyId = K4ABT_INVALID_BODY_ID;        // Body to analyze, by default the one in the most frames
+    double StartSeconds = 0;                        // Time range from the start of the session
+    double EndSeconds = -1;                         // End of the session if negative
+};
+
 void PrintUsage()
 {
 #ifdef _WIN32
@@ -65,14 +79,49 @@ void PrintUsage()
 #else
     printf("Usage: k4abt_jump_analysis_sample PROCESSING_MODE[CUDA ( default ) or TensorRT](optional) -model MODEL_FILEPATH(optional).\n");
 #endif
+    printf("       k4abt_jump_analysis_sample -replay CSV_FILEPATH [-segment N] [-body ID] [-start SECONDS] [-end SECONDS]\n");
 }
 
-bool ProcessArguments(k4abt_tracker_configuration_t& tracker_config, int argc, char** argv)
+bool ProcessArguments(k4abt_tracker_configuration_t& tracker_config, ReplaySettings& replay, int argc, char** argv)
 {
     PrintUsage();
 
     for (int i = 1; i < argc; i++ )
     {
+        const bool hasValue = i < argc - 1;
+        if (0 == strcmp(argv[i], "-replay") || 0 == strcmp(argv[i], "-segment") || 0 == strcmp(argv[i], "-body") ||
+            0 == strcmp(argv[i], "-start") || 0 == strcmp(argv[i], "-end"))
+        {
+            if (!hasValue)
+            {
+                printf("Error: %s value missing\n", argv[i]);
+                return false;
+            }
+            const std::string option = argv[i];
+            const char* value = argv[++i];
+            if (option == "-replay")
+            {
+                replay.FileName = value;
+            }
+            else if (option == "-segment")
+            {
+                replay.Segment = std::strtoul(value, nullptr, 10);
+            }
+            else if (option == "-body")
+            {
+                replay.BodyId = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            }
+            else if (option == "-start")
+            {
+                replay.StartSeconds = std::atof(value);
+            }
+            else
+            {
+                replay.EndSeconds = std::atof(value);
+            }
+            continue;
+        }
+
         if (0 == strcmp(argv[i], "TensorRT"))
         {
             tracker_config.processing_mode = K4ABT_TRACKER_PROCESSING_MODE_GPU_TENSORRT;
@@ -110,8 +159,90 @@ bool ProcessArguments(k4abt_tracker_configuration_t& tracker_config, int argc, c
     return true;
 }
 
+// Analyzes one body of a session of the joint positions file. Only the rows of that body in the time range are read,
+// the rest of the file is skipped with the session index.
+bool ReplaySession(const ReplaySettings& settings)
+{
+    SessionStore store;
+    if (!store.Open(settings.FileName))
+    {
+        printf("Error: cannot read %s\n", settings.FileName.c_str());
+        return false;
+    }
+
+    const std::vector<SessionSegment>& segments = store.GetSegments();
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        printf("Session %zu: %.1f s, %llu frames, bodies", i, static_cast<double>(segments[i].EndUsec - segments[i].StartUsec) / 1e6,
+            static_cast<unsigned long long>(segments[i].FrameCount));
+        for (const auto& body : segments[i].Bodies)
+        {
+            printf(" %u", body.first);
+        }
+        printf("\n");
+    }
+
+    const size_t segmentIndex = settings.Segment == SIZE_MAX && !segments.empty() ? segments.size() - 1 : settings.Segment;
+    if (segmentIndex >= segments.size())
+    {
+        printf("Error: there is no session %zu in %s\n", settings.Segment, settings.FileName.c_str());
+        return false;
+    }
+    const SessionSegment& segment = segments[segmentIndex];
+
+    uint32_t bodyId = settings.BodyId;
+    if (bodyId == K4ABT_INVALID_BODY_ID)
+    {
+        uint64_t mostFrames = 0;
+        for (const auto& body : segment.Bodies)
+        {
+            uint64_t frameCount = 0;
+            for (const SessionFrameRun& run : body.second)
+            {
+                frameCount += run.FrameCount;
+            }
+            if (frameCount > mostFrames)
+            {
+                mostFrames = frameCount;
+                bodyId = body.first;
+            }
+        }
+    }
+
+    const uint64_t startUsec = segment.StartUsec + static_cast<uint64_t>(settings.StartSeconds * 1e6);
+    const uint64_t endUsec = settings.EndSeconds < 0 ? segment.EndUsec : segment.StartUsec + static_cast<uint64_t>(settings.EndSeconds * 1e6);
+
+    // Timestamps from the start of the session keep the precision of float
+    std::vector<k4abt_body_t> bodies;
+    std::vector<float> timestampsInUsec;
+    for (const SessionSpan& span : store.FindBody(segmentIndex, bodyId, startUsec, endUsec))
+    {
+        store.ReadFrames(span, [&](uint64_t timestampUsec, const std::vector<k4abt_body_t>& frameBodies) {
+            bodies.push_back(frameBodies[0]);
+            timestampsInUsec.push_back(static_cast<float>(timestampUsec - segment.StartUsec));
+        });
+    }
+    printf("Analyzing body %u of session %zu: %zu frames\n", bodyId, segmentIndex, bodies.size());
+
+    JumpEvaluator jumpEvaluator;
+    jumpEvaluator.LoadJumpData(bodies, timestampsInUsec);
+    jumpEvaluator.EvaluateJumpData();
+    return true;
+}
+
 int main(int argc, char** argv)
 {
+    k4abt_tracker_configuration_t tracker_config = K4ABT_TRACKER_CONFIG_DEFAULT;
+    ReplaySettings replay;
+    if( !ProcessArguments( tracker_config, replay, argc, argv))
+    {
+        exit(1);
+    }
+    if (!replay.FileName.empty())
+    {
+        return ReplaySession(replay) ? 0 : 1;
+    }
+
     PrintAppUsage();
 
     k4a_device_t device = nullptr;
@@ -130,11 +261,6 @@ int main(int argc, char** argv)
 
     // Create Body Tracker
     k4abt_tracker_t tracker = nullptr;
-    k4abt_tracker_configuration_t tracker_config = K4ABT_TRACKER_CONFIG_DEFAULT;
-    if( !ProcessArguments( tracker_config, argc, argv))
-    {
-        exit(1);
-    }
     VERIFY(k4abt_tracker_create(&sensorCalibration, tracker_config, &tracker), "Body tracker initialization failed!");
 
     // Initialize the 3d window controller
@@ -0,0 +1,209 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "CaptureSource.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    // Delay between the depth exposures of consecutive devices in a sync chain, recommended for the depth lasers
+    const uint32_t SubordinateDelayStepUsec = 160;
+
+    std::string GetSerialNumber(k4a_device_t device)
+    {
+        size_t size = 0;
+        if (k4a_device_get_serialnum(device, nullptr, &size) != K4A_BUFFER_RESULT_TOO_SMALL)
+        {
+            return {};
+        }
+        std::string serialNumber(size, '\0');
+        if (k4a_device_get_serialnum(device, &serialNumber[0], &size) != K4A_BUFFER_RESULT_SUCCEEDED)
+        {
+            return {};
+        }
+        serialNumber.resize(size > 0 ? size - 1 : 0);
+        return serialNumber;
+    }
+}
+
+std::vector<std::unique_ptr<Samples::CaptureSource>> Samples::CaptureSource::OpenDevices(uint32_t count, const k4a_device_configuration_t& configuration)
+{
+    if (count > k4a_device_get_installed_count())
+    {
+        throw std::runtime_error("Only " + std::to_string(k4a_device_get_installed_count()) + " devices are connected");
+    }
+
+    std::vector<std::unique_ptr<CaptureSource>> sources;
+    uint32_t subordinateCount = 0;
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        std::unique_ptr<CaptureSource> source(new CaptureSource());
+        if (k4a_device_open(index, &source->m_device) != K4A_RESULT_SUCCEEDED)
+        {
+            throw std::runtime_error("Open K4A device " + std::to_string(index) + " failed");
+        }
+        source->m_name = GetSerialNumber(source->m_device);
+        if (source->m_name.empty())
+        {
+            source->m_name = "device " + std::to_string(index);
+        }
+
+        bool syncInConnected = false;
+        bool syncOutConnected = false;
+        if (k4a_device_get_sync_jack(source->m_device, &syncInConnected, &syncOutConnected) != K4A_RESULT_SUCCEEDED)
+        {
+            throw std::runtime_error("Get sync jack state of " + source->m_name + " failed");
+        }
+
+        source->m_configuration = configuration;
+        source->m_cameraFps = configuration.camera_fps;
+        if (syncInConnected)
+        {
+            source->m_syncMode = K4A_WIRED_SYNC_MODE_SUBORDINATE;
+            source->m_configuration.subordinate_delay_off_master_usec = SubordinateDelayStepUsec * ++subordinateCount;
+        }
+        else if (syncOutConnected)
+        {
+            source->m_syncMode = K4A_WIRED_SYNC_MODE_MASTER;
+            source->m_configuration.subordinate_delay_off_master_usec = 0;
+
+            // The Sensor SDK only starts a master with the color camera on. The color images are not used and are
+            // dropped before the captures are enqueued; MJPG at 720p costs the least USB bandwidth.
+            if (source->m_configuration.color_resolution == K4A_COLOR_RESOLUTION_OFF)
+            {
+                source->m_configuration.color_format = K4A_IMAGE_FORMAT_COLOR_MJPG;
+                source->m_configuration.color_resolution = K4A_COLOR_RESOLUTION_720P;
+            }
+        }
+        else
+        {
+            source->m_syncMode = K4A_WIRED_SYNC_MODE_STANDALONE;
+            source->m_configuration.subordinate_delay_off_master_usec = 0;
+        }
+        source->m_configuration.wired_sync_mode = source->m_syncMode;
+        source->m_timestampOffsetUsec = source->m_configuration.subordinate_delay_off_master_usec;
+
+        if (k4a_device_get_calibration(source->m_device, source->m_configuration.depth_mode, source->m_configuration.color_resolution, &source->m_calibration) != K4A_RESULT_SUCCEEDED)
+        {
+            throw std::runtime_error("Get depth camera calibration of " + source->m_name + " failed");
+        }
+        sources.push_back(std::move(source));
+    }
+
+    const size_t masterCount = static_cast<size_t>(std::count_if(sources.begin(), sources.end(),
+        [](const std::unique_ptr<CaptureSource>& source) { return source->m_syncMode == K4A_WIRED_SYNC_MODE_MASTER; }));
+    if (masterCount > 1 || (subordinateCount > 0 && masterCount == 0))
+    {
+        throw std::runtime_error("The sync cables must connect one master to all subordinates");
+    }
+    return sources;
+}
+
+std::unique_ptr<Samples::CaptureSource> Samples::CaptureSource::OpenRecording(const std::string& path)
+{
+    std::unique_ptr<CaptureSource> source(new CaptureSource());
+    source->m_name = path;
+    if (k4a_playback_open(path.c_str(), &source->m_playback) != K4A_RESULT_SUCCEEDED)
+    {
+        throw std::runtime_error("Failed to open recording: " + path);
+    }
+    if (k4a_playback_get_calibration(source->m_playback, &source->m_calibration) != K4A_RESULT_SUCCEEDED)
+    {
+        throw std::runtime_error("Failed to get calibration of recording: " + path);
+    }
+
+    k4a_record_configuration_t recordConfiguration;
+    if (k4a_playback_get_record_configuration(source->m_playback, &recordConfiguration) != K4A_RESULT_SUCCEEDED)
+    {
+        throw std::runtime_error("Failed to get configuration of recording: " + path);
+    }
+    source->m_syncMode = recordConfiguration.wired_sync_mode;
+    source->m_cameraFps = recordConfiguration.camera_fps;
+    source->m_timestampOffsetUsec = source->m_syncMode == K4A_WIRED_SYNC_MODE_STANDALONE ?
+        recordConfiguration.start_timestamp_offset_usec : recordConfiguration.subordinate_delay_off_master_usec;
+    return source;
+}
+
+Samples::CaptureSource::~CaptureSource()
+{
+    Stop();
+    if (m_device != nullptr)
+    {
+        k4a_device_close(m_device);
+    }
+    if (m_playback != nullptr)
+    {
+        k4a_playback_close(m_playback);
+    }
+}
+
+uint32_t Samples::CaptureSource::GetFramesPerSecond() const
+{
+    switch (m_cameraFps)
+    {
+    case K4A_FRAMES_PER_SECOND_5:
+        return 5;
+    case K4A_FRAMES_PER_SECOND_15:
+        return 15;
+    default:
+        return 30;
+    }
+}
+
+bool Samples::CaptureSource::Start()
+{
+    if (m_device != nullptr && !m_started)
+    {
+        m_started = k4a_device_start_cameras(m_device, &m_configuration) == K4A_RESULT_SUCCEEDED;
+        return m_started;
+    }
+    return true;
+}
+
+void Samples::CaptureSource::Stop()
+{
+    if (m_started)
+    {
+        k4a_device_stop_cameras(m_device);
+        m_started = false;
+    }
+}
+
+Samples::CaptureStatus Samples::CaptureSource::GetNextCapture(k4a_capture_t* capture, int32_t timeoutMs)
+{
+    if (m_playback != nullptr)
+    {
+        switch (k4a_playback_get_next_capture(m_playback, capture))
+        {
+        case K4A_STREAM_RESULT_SUCCEEDED:
+            return CaptureStatus::Succeeded;
+        case K4A_STREAM_RESULT_EOF:
+            return CaptureStatus::EndOfStream;
+        default:
+            return CaptureStatus::Failed;
+        }
+    }
+
+    switch (k4a_device_get_capture(m_device, capture, timeoutMs))
+    {
+    case K4A_WAIT_RESULT_SUCCEEDED:
+        return CaptureStatus::Succeeded;
+    case K4A_WAIT_RESULT_TIMEOUT:
+        return CaptureStatus::Timeout;
+    default:
+        return CaptureStatus::Failed;
+    }
+}
+
+uint64_t Samples::CaptureSource::GetAlignedTimestampUsec(k4a_image_t depthImage)
+{
+    const uint64_t deviceTimestampUsec = k4a_image_get_device_timestamp_usec(depthImage);
+    if (m_device != nullptr && m_syncMode == K4A_WIRED_SYNC_MODE_STANDALONE)
+    {
+        m_hostClock.AddSample(deviceTimestampUsec, k4a_image_get_system_timestamp_nsec(depthImage));
+        return m_hostClock.ToHostNsec(deviceTimestampUsec) / 1000;
+    }
+    return deviceTimestampUsec >= m_timestampOffsetUsec ? deviceTimestampUsec - m_timestampOffsetUsec : 0;
+}
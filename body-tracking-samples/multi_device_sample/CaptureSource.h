@@ -0,0 +1,78 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <k4a/k4a.h>
+#include <k4arecord/playback.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <DeviceClockCorrelator.h>
+
+namespace Samples
+{
+    enum class CaptureStatus
+    {
+        Succeeded,
+        Timeout,
+        EndOfStream,
+        Failed
+    };
+
+    // Captures of one Azure Kinect device or of one recording standing in for a device.
+    //
+    // Every capture gets an aligned timestamp that is comparable between the sources of one session:
+    //  - Devices and recordings in a wired sync chain use the device timestamp minus the subordinate delay, their
+    //    device clocks are started together by the master.
+    //  - Standalone recordings use the time since their first capture.
+    //  - Standalone devices use the exposure time on the host clock, from their system timestamps.
+    class CaptureSource
+    {
+    public:
+        // Opens count devices. The device with only the sync out jack connected becomes the master and devices with
+        // sync in connected become its subordinates, each 160 us later than the previous one so their depth lasers
+        // do not interfere. Devices without connected jacks run standalone. Throws std::runtime_error.
+        static std::vector<std::unique_ptr<CaptureSource>> OpenDevices(uint32_t count, const k4a_device_configuration_t& configuration);
+
+        // Throws std::runtime_error.
+        static std::unique_ptr<CaptureSource> OpenRecording(const std::string& path);
+
+        ~CaptureSource();
+
+        CaptureSource(const CaptureSource&) = delete;
+        CaptureSource& operator=(const CaptureSource&) = delete;
+
+        const std::string& GetName() const { return m_name; }
+        const k4a_calibration_t& GetCalibration() const { return m_calibration; }
+        k4a_wired_sync_mode_t GetSyncMode() const { return m_syncMode; }
+        bool IsRecording() const { return m_playback != nullptr; }
+        uint32_t GetFramesPerSecond() const;
+
+        // Starts the cameras of a device, recordings need no start. Start subordinates before their master.
+        bool Start();
+        void Stop();
+
+        // Recordings return their captures as fast as they are read, timeoutMs only applies to devices.
+        CaptureStatus GetNextCapture(k4a_capture_t* capture, int32_t timeoutMs);
+
+        // Aligned timestamp of a depth image of this source. Call from the thread that gets the captures.
+        uint64_t GetAlignedTimestampUsec(k4a_image_t depthImage);
+
+    private:
+        CaptureSource() = default;
+
+        std::string m_name;
+        k4a_device_t m_device = nullptr;
+        k4a_device_configuration_t m_configuration = K4A_DEVICE_CONFIG_INIT_DISABLE_ALL;
+        bool m_started = false;
+        k4a_playback_t m_playback = nullptr;
+        k4a_calibration_t m_calibration = {};
+        k4a_wired_sync_mode_t m_syncMode = K4A_WIRED_SYNC_MODE_STANDALONE;
+        k4a_fps_t m_cameraFps = K4A_FRAMES_PER_SECOND_30;
+        uint64_t m_timestampOffsetUsec = 0;     // Subtracted from device timestamps
+        DeviceClockCorrelator m_hostClock;
+    };
+}
@@ -0,0 +1,100 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "FrameAligner.h"
+
+#include <algorithm>
+#include <limits>
+
+Samples::FrameAligner::FrameAligner(size_t deviceCount, uint64_t toleranceUsec, Output output, size_t maxPendingViews)
+    : m_toleranceUsec(toleranceUsec)
+    , m_maxPendingViews(std::max<size_t>(maxPendingViews, 1))
+    , m_output(std::move(output))
+    , m_pending(deviceCount)
+    , m_finished(deviceCount, false)
+{
+    m_statistics.MissingViews.resize(deviceCount, 0);
+}
+
+void Samples::FrameAligner::Add(DeviceView&& view)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (view.DeviceIndex >= m_pending.size())
+    {
+        return;
+    }
+    if (m_emitted && view.AlignedTimestampUsec <= m_lastTimestampUsec + m_toleranceUsec)
+    {
+        // Its frame was emitted without it
+        m_statistics.LateViews++;
+        return;
+    }
+    m_pending[view.DeviceIndex].push_back(std::move(view));
+    EmitReadyFrames();
+}
+
+void Samples::FrameAligner::Finish(uint32_t deviceIndex)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (deviceIndex < m_finished.size())
+    {
+        m_finished[deviceIndex] = true;
+        EmitReadyFrames();
+    }
+}
+
+Samples::AlignmentStatistics Samples::FrameAligner::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+void Samples::FrameAligner::EmitReadyFrames()
+{
+    while (true)
+    {
+        bool waiting = false;
+        size_t mostPending = 0;
+        uint64_t earliestUsec = std::numeric_limits<uint64_t>::max();
+        for (size_t device = 0; device < m_pending.size(); ++device)
+        {
+            const std::deque<DeviceView>& pending = m_pending[device];
+            if (pending.empty())
+            {
+                // A device that is still running may deliver an earlier view
+                waiting = waiting || !m_finished[device];
+                continue;
+            }
+            mostPending = std::max(mostPending, pending.size());
+            earliestUsec = std::min(earliestUsec, pending.front().AlignedTimestampUsec);
+        }
+        if (mostPending == 0 || (waiting && mostPending < m_maxPendingViews))
+        {
+            return;
+        }
+
+        MultiViewFrame frame;
+        frame.FrameIndex = m_statistics.Frames;
+        frame.TimestampUsec = earliestUsec;
+        frame.DeviceCount = m_pending.size();
+        for (size_t device = 0; device < m_pending.size(); ++device)
+        {
+            std::deque<DeviceView>& pending = m_pending[device];
+            if (!pending.empty() && pending.front().AlignedTimestampUsec <= earliestUsec + m_toleranceUsec)
+            {
+                frame.Views.push_back(std::move(pending.front()));
+                pending.pop_front();
+            }
+            else
+            {
+                m_statistics.MissingViews[device]++;
+            }
+        }
+
+        m_statistics.Frames++;
+        m_statistics.CompleteFrames += frame.IsComplete() ? 1 : 0;
+        m_emitted = true;
+        m_lastTimestampUsec = earliestUsec;
+        m_output(std::move(frame));
+    }
+}
@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "MultiViewFrame.h"
+
+namespace Samples
+{
+    struct AlignmentStatistics
+    {
+        uint64_t Frames = 0;
+        uint64_t CompleteFrames = 0;
+        uint64_t LateViews = 0;                 // Arrived after their frame was emitted
+        std::vector<uint64_t> MissingViews;     // Frames without a view, per device
+    };
+
+    // Combines the views of the devices, which arrive in order per device but at any time relative to each
+    // other, into multi-view frames by aligned timestamp.
+    //
+    // A frame is emitted once every device has delivered a later view or has finished, so nothing is held back
+    // longer than the slowest tracker takes. The frame takes the earliest pending view and the pending views of
+    // the other devices within the tolerance of it. If a device stalls, frames are emitted without it as soon as
+    // another device has maxPendingViews views waiting.
+    class FrameAligner
+    {
+    public:
+        using Output = std::function<void(MultiViewFrame&&)>;
+
+        // output is called in frame order while the aligner is locked
+        FrameAligner(size_t deviceCount, uint64_t toleranceUsec, Output output, size_t maxPendingViews = 30);
+
+        // Thread safe, views of one device must be added in order
+        void Add(DeviceView&& view);
+
+        // No more views will come from the device
+        void Finish(uint32_t deviceIndex);
+
+        AlignmentStatistics GetStatistics() const;
+
+    private:
+        void EmitReadyFrames();
+
+        const uint64_t m_toleranceUsec;
+        const size_t m_maxPendingViews;
+        Output m_output;
+
+        mutable std::mutex m_mutex;
+        std::vector<std::deque<DeviceView>> m_pending;
+        std::vector<bool> m_finished;
+        bool m_emitted = false;
+        uint64_t m_lastTimestampUsec = 0;
+        AlignmentStatistics m_statistics;
+    };
+}
@@ -0,0 +1,268 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "MultiDeviceRuntime.h"
+
+#include <cstdio>
+
+#include "ThreadPlacement.h"
+
+using namespace std::chrono;
+
+namespace
+{
+    // Live devices check for Stop this often
+    const int32_t CaptureTimeoutMs = 100;
+}
+
+Samples::MultiDeviceRuntime::MultiDeviceRuntime(std::vector<std::unique_ptr<CaptureSource>> sources, k4abt_tracker_configuration_t trackerConfiguration,
+    uint64_t alignmentToleranceUsec, FrameAligner::Output output, bool pinThreads)
+    : m_trackerConfiguration(trackerConfiguration)
+    , m_aligner(sources.size(), alignmentToleranceUsec, std::move(output))
+{
+    std::vector<std::vector<uint32_t>> plan;
+    if (pinThreads)
+    {
+        plan = PlanDeviceProcessors(GetNumaNodes(), sources.size());
+    }
+    for (size_t index = 0; index < sources.size(); ++index)
+    {
+        std::unique_ptr<Worker> worker = std::make_unique<Worker>();
+        worker->Source = std::move(sources[index]);
+        worker->Index = static_cast<uint32_t>(index);
+        if (pinThreads)
+        {
+            worker->Processors = plan[index];
+        }
+        m_workers.push_back(std::move(worker));
+    }
+}
+
+Samples::MultiDeviceRuntime::~MultiDeviceRuntime()
+{
+    Stop();
+    Wait();
+}
+
+bool Samples::MultiDeviceRuntime::Start()
+{
+    for (std::unique_ptr<Worker>& worker : m_workers)
+    {
+        worker->CaptureThread = std::thread(&MultiDeviceRuntime::CaptureLoop, this, std::ref(*worker));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_startMutex);
+        m_startChanged.wait(lock, [this] { return m_trackersCreated == m_workers.size(); });
+    }
+
+    bool started = true;
+    for (const std::unique_ptr<Worker>& worker : m_workers)
+    {
+        started = started && !worker->Failed;
+    }
+
+    // The master starts the capture of all subordinates, so they must be ready before it
+    for (int pass = 0; pass < 2 && started; ++pass)
+    {
+        for (std::unique_ptr<Worker>& worker : m_workers)
+        {
+            const bool subordinate = worker->Source->GetSyncMode() == K4A_WIRED_SYNC_MODE_SUBORDINATE;
+            if (subordinate == (pass == 0) && !worker->Source->Start())
+            {
+                printf("Start K4A cameras of %s failed!\n", worker->Source->GetName().c_str());
+                started = false;
+                break;
+            }
+        }
+    }
+
+    if (!started)
+    {
+        m_stopping = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_startMutex);
+        m_capturing = true;
+    }
+    m_startChanged.notify_all();
+    return started;
+}
+
+void Samples::MultiDeviceRuntime::Stop()
+{
+    m_stopping = true;
+}
+
+void Samples::MultiDeviceRuntime::Wait()
+{
+    if (m_waited)
+    {
+        return;
+    }
+    for (std::unique_ptr<Worker>& worker : m_workers)
+    {
+        if (worker->CaptureThread.joinable())
+        {
+            worker->CaptureThread.join();
+        }
+    }
+    for (std::unique_ptr<Worker>& worker : m_workers)
+    {
+        worker->Source->Stop();
+    }
+    m_waited = true;
+}
+
+std::vector<Samples::DeviceStatistics> Samples::MultiDeviceRuntime::GetDeviceStatistics() const
+{
+    std::vector<DeviceStatistics> statistics;
+    for (const std::unique_ptr<Worker>& worker : m_workers)
+    {
+        DeviceStatistics device;
+        device.Name = worker->Source->GetName();
+        device.Processors = worker->Processors;
+        device.Captures = worker->Captures;
+        device.BodyFrames = worker->BodyFrames;
+        device.Failed = worker->Failed;
+        const double seconds = static_cast<double>(worker->LastBodyFrameNsec) / 1e9;
+        device.FramesPerSecond = seconds > 0.0 ? static_cast<double>(device.BodyFrames) / seconds : 0.0;
+        statistics.push_back(std::move(device));
+    }
+    return statistics;
+}
+
+void Samples::MultiDeviceRuntime::WaitForStart()
+{
+    std::unique_lock<std::mutex> lock(m_startMutex);
+    m_trackersCreated++;
+    m_startChanged.notify_all();
+    m_startChanged.wait(lock, [this] { return m_capturing; });
+}
+
+void Samples::MultiDeviceRuntime::CaptureLoop(Worker& worker)
+{
+    if (!worker.Processors.empty() && !PinCurrentThread(worker.Processors))
+    {
+        printf("Pinning the threads of %s failed, they run on any processor\n", worker.Source->GetName().c_str());
+    }
+
+    // Created on the pinned thread, so the tracker allocates on the NUMA node of this device
+    if (k4abt_tracker_create(&worker.Source->GetCalibration(), m_trackerConfiguration, &worker.Tracker) != K4A_RESULT_SUCCEEDED)
+    {
+        printf("Body tracker initialization for %s failed!\n", worker.Source->GetName().c_str());
+        worker.Failed = true;
+        worker.Tracker = nullptr;
+    }
+    WaitForStart();
+    if (worker.Tracker == nullptr)
+    {
+        m_aligner.Finish(worker.Index);
+        return;
+    }
+    worker.FirstCapture = steady_clock::now();
+    worker.PopThread = std::thread(&MultiDeviceRuntime::PopLoop, this, std::ref(worker));
+
+    while (!m_stopping)
+    {
+        k4a_capture_t capture = nullptr;
+        const CaptureStatus status = worker.Source->GetNextCapture(&capture, CaptureTimeoutMs);
+        if (status == CaptureStatus::Timeout)
+        {
+            continue;
+        }
+        if (status != CaptureStatus::Succeeded)
+        {
+            if (status == CaptureStatus::Failed)
+            {
+                printf("Get capture from %s failed!\n", worker.Source->GetName().c_str());
+                worker.Failed = true;
+            }
+            break;
+        }
+
+        // Recordings can contain captures without a depth image
+        k4a_image_t depthImage = k4a_capture_get_depth_image(capture);
+        if (depthImage == nullptr)
+        {
+            k4a_capture_release(capture);
+            continue;
+        }
+        const uint64_t deviceTimestampUsec = k4a_image_get_device_timestamp_usec(depthImage);
+        const uint64_t alignedTimestampUsec = worker.Source->GetAlignedTimestampUsec(depthImage);
+        k4a_image_release(depthImage);
+        {
+            std::lock_guard<std::mutex> lock(worker.TimestampMutex);
+            worker.AlignedTimestamps.emplace_back(deviceTimestampUsec, alignedTimestampUsec);
+        }
+        worker.Captures++;
+
+        // The tracker only uses the depth and IR images; the color image of a master is released here
+        k4a_capture_set_color_image(capture, nullptr);
+
+        // Waits while the tracker queue is full, the pop thread keeps draining it
+        const k4a_wait_result_t queueCaptureResult = k4abt_tracker_enqueue_capture(worker.Tracker, capture, K4A_WAIT_INFINITE);
+        k4a_capture_release(capture);
+        if (queueCaptureResult != K4A_WAIT_RESULT_SUCCEEDED)
+        {
+            printf("Add capture of %s to tracker process queue failed!\n", worker.Source->GetName().c_str());
+            worker.Failed = true;
+            break;
+        }
+    }
+
+    // The pop thread returns once the remaining results are popped
+    k4abt_tracker_shutdown(worker.Tracker);
+    worker.PopThread.join();
+    k4abt_tracker_destroy(worker.Tracker);
+    worker.Tracker = nullptr;
+    m_aligner.Finish(worker.Index);
+}
+
+void Samples::MultiDeviceRuntime::PopLoop(Worker& worker)
+{
+    if (!worker.Processors.empty())
+    {
+        PinCurrentThread(worker.Processors);
+    }
+
+    while (true)
+    {
+        k4abt_frame_t bodyFrame = nullptr;
+        if (k4abt_tracker_pop_result(worker.Tracker, &bodyFrame, K4A_WAIT_INFINITE) != K4A_WAIT_RESULT_SUCCEEDED)
+        {
+            // Failed after shutdown, when the tracker is empty
+            break;
+        }
+
+        DeviceView view;
+        view.DeviceIndex = worker.Index;
+        view.DeviceTimestampUsec = k4abt_frame_get_device_timestamp_usec(bodyFrame);
+        view.AlignedTimestampUsec = view.DeviceTimestampUsec;
+        {
+            std::lock_guard<std::mutex> lock(worker.TimestampMutex);
+            while (!worker.AlignedTimestamps.empty() && worker.AlignedTimestamps.front().first != view.DeviceTimestampUsec)
+            {
+                worker.AlignedTimestamps.pop_front();
+            }
+            if (!worker.AlignedTimestamps.empty())
+            {
+                view.AlignedTimestampUsec = worker.AlignedTimestamps.front().second;
+                worker.AlignedTimestamps.pop_front();
+            }
+        }
+
+        const uint32_t bodyCount = k4abt_frame_get_num_bodies(bodyFrame);
+        view.Bodies.resize(bodyCount);
+        for (uint32_t i = 0; i < bodyCount; i++)
+        {
+            k4abt_frame_get_body_skeleton(bodyFrame, i, &view.Bodies[i].skeleton);
+            view.Bodies[i].id = k4abt_frame_get_body_id(bodyFrame, i);
+        }
+        k4abt_frame_release(bodyFrame);
+
+        worker.BodyFrames++;
+        worker.LastBodyFrameNsec = duration_cast<nanoseconds>(steady_clock::now() - worker.FirstCapture).count();
+        m_aligner.Add(std::move(view));
+    }
+}
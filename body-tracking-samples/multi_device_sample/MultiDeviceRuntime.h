@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <k4abt.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CaptureSource.h"
+#include "FrameAligner.h"
+
+namespace Samples
+{
+    struct DeviceStatistics
+    {
+        std::string Name;
+        std::vector<uint32_t> Processors;   // Empty if the threads were not pinned
+        uint64_t Captures = 0;
+        uint64_t BodyFrames = 0;
+        double FramesPerSecond = 0.0;       // Body frames from the first capture until the last body frame
+        bool Failed = false;
+    };
+
+    // Runs one body tracker per capture source and combines their results into multi-view frames.
+    //
+    // Every source has a capture thread, which creates the tracker and enqueues the captures, and a pop thread,
+    // which extracts the bodies and hands them to the FrameAligner. The two threads of a device are pinned to a
+    // processor set of their own on one NUMA node (see PlanDeviceProcessors), and the tracker is created on the
+    // pinned thread, so its memory and the threads it starts stay on that node. Devices share nothing but the
+    // aligner, so throughput grows with the number of devices until the inference hardware is saturated.
+    class MultiDeviceRuntime
+    {
+    public:
+        MultiDeviceRuntime(std::vector<std::unique_ptr<CaptureSource>> sources, k4abt_tracker_configuration_t trackerConfiguration,
+            uint64_t alignmentToleranceUsec, FrameAligner::Output output, bool pinThreads = true);
+        ~MultiDeviceRuntime();
+
+        MultiDeviceRuntime(const MultiDeviceRuntime&) = delete;
+        MultiDeviceRuntime& operator=(const MultiDeviceRuntime&) = delete;
+
+        // Creates the trackers, then starts the devices: subordinates first, the master last. Returns false if a
+        // tracker or a device failed to start; the runtime is stopped then.
+        bool Start();
+
+        // Devices stop capturing, the captures in the trackers are still processed. Recordings stop at their end.
+        void Stop();
+
+        // Waits until every source ended or was stopped and its tracker is drained.
+        void Wait();
+
+        std::vector<DeviceStatistics> GetDeviceStatistics() const;
+        AlignmentStatistics GetAlignmentStatistics() const { return m_aligner.GetStatistics(); }
+
+    private:
+        struct Worker
+        {
+            std::unique_ptr<CaptureSource> Source;
+            uint32_t Index = 0;
+            std::vector<uint32_t> Processors;
+            k4abt_tracker_t Tracker = nullptr;
+            std::thread CaptureThread;
+            std::thread PopThread;
+
+            // Aligned timestamps of the captures in the tracker, by device timestamp
+            std::mutex TimestampMutex;
+            std::deque<std::pair<uint64_t, uint64_t>> AlignedTimestamps;
+
+            std::atomic<uint64_t> Captures{ 0 };
+            std::atomic<uint64_t> BodyFrames{ 0 };
+            std::chrono::steady_clock::time_point FirstCapture;
+            std::atomic<int64_t> LastBodyFrameNsec{ 0 };   // Since FirstCapture
+            std::atomic<bool> Failed{ false };
+        };
+
+        void CaptureLoop(Worker& worker);
+        void PopLoop(Worker& worker);
+        void WaitForStart();
+
+        k4abt_tracker_configuration_t m_trackerConfiguration;
+        FrameAligner m_aligner;
+        std::vector<std::unique_ptr<Worker>> m_workers;
+
+        std::mutex m_startMutex;
+        std::condition_variable m_startChanged;
+        size_t m_trackersCreated = 0;
+        bool m_capturing = false;
+
+        std::atomic<bool> m_stopping{ false };
+        bool m_waited = false;
+    };
+}
@@ -0,0 +1,34 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <k4abt.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace Samples
+{
+    // Bodies one device tracked in one capture.
+    struct DeviceView
+    {
+        uint32_t DeviceIndex = 0;
+        uint64_t DeviceTimestampUsec = 0;
+        uint64_t AlignedTimestampUsec = 0;      // Comparable between the devices, see CaptureSource
+        std::vector<k4abt_body_t> Bodies;
+    };
+
+    // The views of all devices that captured the same moment, ordered by device index. A device whose capture was
+    // dropped or is missing has no view in the frame.
+    struct MultiViewFrame
+    {
+        uint64_t FrameIndex = 0;
+        uint64_t TimestampUsec = 0;             // Aligned timestamp of the earliest view
+        size_t DeviceCount = 0;
+        std::vector<DeviceView> Views;
+        std::vector<k4abt_body_t> WorldBodies;  // Bodies of all views fused in the world frame, see SkeletonFusion
+
+        bool IsComplete() const { return Views.size() == DeviceCount; }
+    };
+}
@@ -0,0 +1,449 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "SkeletonFusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    const size_t MaxDevices = 32;       // Devices of a group are a 32 bit mask
+    const size_t MaxRegistrationPairs = 3000;
+
+    k4a_quaternion_t Multiply(const k4a_quaternion_t& a, const k4a_quaternion_t& b)
+    {
+        k4a_quaternion_t q;
+        q.wxyz.w = a.wxyz.w * b.wxyz.w - a.wxyz.x * b.wxyz.x - a.wxyz.y * b.wxyz.y - a.wxyz.z * b.wxyz.z;
+        q.wxyz.x = a.wxyz.w * b.wxyz.x + a.wxyz.x * b.wxyz.w + a.wxyz.y * b.wxyz.z - a.wxyz.z * b.wxyz.y;
+        q.wxyz.y = a.wxyz.w * b.wxyz.y - a.wxyz.x * b.wxyz.z + a.wxyz.y * b.wxyz.w + a.wxyz.z * b.wxyz.x;
+        q.wxyz.z = a.wxyz.w * b.wxyz.z + a.wxyz.x * b.wxyz.y - a.wxyz.y * b.wxyz.x + a.wxyz.z * b.wxyz.w;
+        return q;
+    }
+
+    float Dot(const std::array<float, 3>& a, const std::array<float, 3>& b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    std::array<float, 3> Normalized(const std::array<float, 3>& v)
+    {
+        const float length = std::sqrt(Dot(v, v));
+        return { v[0] / length, v[1] / length, v[2] / length };
+    }
+
+    std::array<float, 3> Cross(const std::array<float, 3>& a, const std::array<float, 3>& b)
+    {
+        return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+    }
+}
+
+k4a_float3_t Samples::CameraExtrinsics::TransformPoint(const k4a_float3_t& point) const
+{
+    const float x = point.xyz.x;
+    const float y = point.xyz.y;
+    const float z = point.xyz.z;
+    k4a_float3_t result;
+    result.xyz.x = Rotation[0] * x + Rotation[1] * y + Rotation[2] * z + Translation[0];
+    result.xyz.y = Rotation[3] * x + Rotation[4] * y + Rotation[5] * z + Translation[1];
+    result.xyz.z = Rotation[6] * x + Rotation[7] * y + Rotation[8] * z + Translation[2];
+    return result;
+}
+
+k4a_quaternion_t Samples::CameraExtrinsics::GetRotationQuaternion() const
+{
+    const std::array<float, 9>& r = Rotation;
+    const float trace = r[0] + r[4] + r[8];
+    k4a_quaternion_t q;
+    if (trace > 0)
+    {
+        const float s = std::sqrt(trace + 1.f) * 2.f;
+        q.wxyz = { 0.25f * s, (r[7] - r[5]) / s, (r[2] - r[6]) / s, (r[3] - r[1]) / s };
+    }
+    else if (r[0] > r[4] && r[0] > r[8])
+    {
+        const float s = std::sqrt(1.f + r[0] - r[4] - r[8]) * 2.f;
+        q.wxyz = { (r[7] - r[5]) / s, 0.25f * s, (r[1] + r[3]) / s, (r[2] + r[6]) / s };
+    }
+    else if (r[4] > r[8])
+    {
+        const float s = std::sqrt(1.f + r[4] - r[0] - r[8]) * 2.f;
+        q.wxyz = { (r[2] - r[6]) / s, (r[1] + r[3]) / s, 0.25f * s, (r[5] + r[7]) / s };
+    }
+    else
+    {
+        const float s = std::sqrt(1.f + r[8] - r[0] - r[4]) * 2.f;
+        q.wxyz = { (r[3] - r[1]) / s, (r[2] + r[6]) / s, (r[5] + r[7]) / s, 0.25f * s };
+    }
+    return q;
+}
+
+Samples::CameraExtrinsics Samples::CameraExtrinsics::FromFloor(const k4a_float3_t& floorNormal, const k4a_float3_t& floorPointInMeters)
+{
+    std::array<float, 3> normal = Normalized({ floorNormal.xyz.x, floorNormal.xyz.y, floorNormal.xyz.z });
+    const std::array<float, 3> point = { floorPointInMeters.xyz.x * 1000.f, floorPointInMeters.xyz.y * 1000.f, floorPointInMeters.xyz.z * 1000.f };
+    if (Dot(normal, point) > 0)
+    {
+        // The normal points from the floor towards the camera
+        normal = { -normal[0], -normal[1], -normal[2] };
+    }
+    const float heightMm = -Dot(normal, point);
+
+    // Down is against the normal, forward is the view direction of the camera along the floor. A camera that looks
+    // straight down takes the bottom of its image as forward.
+    const std::array<float, 3> down = { -normal[0], -normal[1], -normal[2] };
+    std::array<float, 3> forward = { 0, 0, 1 };
+    if (std::abs(Dot(forward, down)) > 0.999f)
+    {
+        forward = { 0, 1, 0 };
+    }
+    const float along = Dot(forward, down);
+    forward = Normalized({ forward[0] - along * down[0], forward[1] - along * down[1], forward[2] - along * down[2] });
+    const std::array<float, 3> right = Cross(down, forward);
+
+    CameraExtrinsics extrinsics;
+    extrinsics.Rotation = { right[0], right[1], right[2], down[0], down[1], down[2], forward[0], forward[1], forward[2] };
+    extrinsics.Translation = { 0, -heightMm, 0 };
+    return extrinsics;
+}
+
+Samples::CameraExtrinsics Samples::CameraExtrinsics::PlacedOnFloor(float yawInRadians, float xInMm, float zInMm) const
+{
+    const float c = std::cos(yawInRadians);
+    const float s = std::sin(yawInRadians);
+    CameraExtrinsics placed;
+    for (int column = 0; column < 3; ++column)
+    {
+        placed.Rotation[column] = c * Rotation[column] + s * Rotation[6 + column];
+        placed.Rotation[3 + column] = Rotation[3 + column];
+        placed.Rotation[6 + column] = -s * Rotation[column] + c * Rotation[6 + column];
+    }
+    placed.Translation = { c * Translation[0] + s * Translation[2] + xInMm, Translation[1], -s * Translation[0] + c * Translation[2] + zInMm };
+    return placed;
+}
+
+std::vector<Samples::DeviceExtrinsics> Samples::LoadExtrinsics(const std::string& fileName, size_t deviceCount)
+{
+    std::ifstream file(fileName);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to open extrinsics file: " + fileName);
+    }
+
+    std::vector<DeviceExtrinsics> devices(deviceCount);
+    std::vector<bool> found(deviceCount, false);
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        std::istringstream stream(line);
+        size_t device = 0;
+        std::string type;
+        if (line.empty() || line[0] == '#' || !(stream >> device))
+        {
+            continue;
+        }
+        stream >> type;
+        if (device >= deviceCount)
+        {
+            continue;
+        }
+
+        std::vector<float> values;
+        for (float value; stream >> value;)
+        {
+            values.push_back(value);
+        }
+        if (type == "MATRIX" && values.size() == 12)
+        {
+            std::copy(values.begin(), values.begin() + 9, devices[device].Extrinsics.Rotation.begin());
+            std::copy(values.begin() + 9, values.end(), devices[device].Extrinsics.Translation.begin());
+            devices[device].PlacementKnown = true;
+        }
+        else if (type == "FLOOR" && (values.size() == 6 || values.size() == 9))
+        {
+            k4a_float3_t normal, point;
+            normal.xyz = { values[0], values[1], values[2] };
+            point.xyz = { values[3], values[4], values[5] };
+            devices[device].Extrinsics = CameraExtrinsics::FromFloor(normal, point);
+            devices[device].PlacementKnown = values.size() == 9;
+            if (devices[device].PlacementKnown)
+            {
+                const float yawInRadians = values[6] * 3.14159265f / 180.f;
+                devices[device].Extrinsics = devices[device].Extrinsics.PlacedOnFloor(yawInRadians, values[7], values[8]);
+            }
+        }
+        else
+        {
+            throw std::runtime_error(fileName + ":" + std::to_string(lineNumber) + ": expected MATRIX with 12 or FLOOR with 6 or 9 values");
+        }
+        found[device] = true;
+    }
+
+    for (size_t device = 0; device < deviceCount; ++device)
+    {
+        if (!found[device])
+        {
+            throw std::runtime_error(fileName + ": no extrinsics for device " + std::to_string(device));
+        }
+    }
+    return devices;
+}
+
+Samples::FloorRegistration::FloorRegistration(std::vector<DeviceExtrinsics> devices, size_t requiredPairs, float requiredSpreadMm)
+    : m_devices(std::move(devices))
+    , m_requiredPairs(std::max<size_t>(requiredPairs, 3))
+    , m_requiredSpreadMm(requiredSpreadMm)
+    , m_pairs(m_devices.size())
+{
+    auto reference = std::find_if(m_devices.begin(), m_devices.end(), [](const DeviceExtrinsics& device) { return device.PlacementKnown; });
+    if (reference == m_devices.end() && !m_devices.empty())
+    {
+        reference = m_devices.begin();
+        reference->PlacementKnown = true;
+    }
+    m_reference = static_cast<size_t>(reference - m_devices.begin());
+}
+
+bool Samples::FloorRegistration::IsComplete() const
+{
+    return std::all_of(m_devices.begin(), m_devices.end(), [](const DeviceExtrinsics& device) { return device.PlacementKnown; });
+}
+
+void Samples::FloorRegistration::Add(const MultiViewFrame& frame)
+{
+    // Only frames where the reference sees exactly one confidently tracked person
+    auto singlePelvis = [](const DeviceView& view, k4a_float3_t& pelvis) {
+        if (view.Bodies.size() != 1 || view.Bodies[0].skeleton.joints[K4ABT_JOINT_PELVIS].confidence_level < K4ABT_JOINT_CONFIDENCE_MEDIUM)
+        {
+            return false;
+        }
+        pelvis = view.Bodies[0].skeleton.joints[K4ABT_JOINT_PELVIS].position;
+        return true;
+    };
+
+    k4a_float3_t referencePelvis;
+    auto reference = std::find_if(frame.Views.begin(), frame.Views.end(), [this](const DeviceView& view) { return view.DeviceIndex == m_reference; });
+    if (reference == frame.Views.end() || !singlePelvis(*reference, referencePelvis))
+    {
+        return;
+    }
+    referencePelvis = m_devices[m_reference].Extrinsics.TransformPoint(referencePelvis);
+
+    for (const DeviceView& view : frame.Views)
+    {
+        k4a_float3_t pelvis;
+        if (view.DeviceIndex >= m_devices.size() || m_devices[view.DeviceIndex].PlacementKnown || !singlePelvis(view, pelvis))
+        {
+            continue;
+        }
+        pelvis = m_devices[view.DeviceIndex].Extrinsics.TransformPoint(pelvis);
+
+        std::vector<Pair>& pairs = m_pairs[view.DeviceIndex];
+        if (pairs.size() < MaxRegistrationPairs)
+        {
+            pairs.push_back({ referencePelvis.xyz.x, referencePelvis.xyz.z, pelvis.xyz.x, pelvis.xyz.z });
+        }
+        if (pairs.size() >= m_requiredPairs)
+        {
+            TrySolve(view.DeviceIndex);
+        }
+    }
+}
+
+void Samples::FloorRegistration::TrySolve(size_t device)
+{
+    std::vector<Pair>& pairs = m_pairs[device];
+    const double count = static_cast<double>(pairs.size());
+    double referenceX = 0, referenceZ = 0, deviceX = 0, deviceZ = 0;
+    for (const Pair& pair : pairs)
+    {
+        referenceX += pair.ReferenceX;
+        referenceZ += pair.ReferenceZ;
+        deviceX += pair.DeviceX;
+        deviceZ += pair.DeviceZ;
+    }
+    referenceX /= count;
+    referenceZ /= count;
+    deviceX /= count;
+    deviceZ /= count;
+
+    // Maximizes the sum of reference . (R device) over the centered pairs, R rotates about the vertical
+    double spread = 0, dot = 0, cross = 0;
+    for (const Pair& pair : pairs)
+    {
+        const double ax = pair.DeviceX - deviceX, az = pair.DeviceZ - deviceZ;
+        const double bx = pair.ReferenceX - referenceX, bz = pair.ReferenceZ - referenceZ;
+        spread += bx * bx + bz * bz;
+        dot += bx * ax + bz * az;
+        cross += bx * az - bz * ax;
+    }
+    if (std::sqrt(spread / count) < m_requiredSpreadMm)
+    {
+        // The person has not walked through enough of the room yet
+        return;
+    }
+
+    const double yaw = std::atan2(cross, dot);
+    const double c = std::cos(yaw), s = std::sin(yaw);
+    const double x = referenceX - (c * deviceX + s * deviceZ);
+    const double z = referenceZ - (-s * deviceX + c * deviceZ);
+    m_devices[device].Extrinsics = m_devices[device].Extrinsics.PlacedOnFloor(static_cast<float>(yaw), static_cast<float>(x), static_cast<float>(z));
+    m_devices[device].PlacementKnown = true;
+    pairs.clear();
+}
+
+Samples::SkeletonFusion::SkeletonFusion(std::vector<CameraExtrinsics> extrinsics, float maxPelvisDistanceMm)
+    : m_extrinsics(std::move(extrinsics))
+    , m_maxDistanceSquared(maxPelvisDistanceMm * maxPelvisDistanceMm)
+{
+    for (const CameraExtrinsics& camera : m_extrinsics)
+    {
+        m_rotations.push_back(camera.GetRotationQuaternion());
+    }
+}
+
+uint32_t Samples::SkeletonFusion::FindGroup(uint32_t body)
+{
+    while (m_groups[body] != body)
+    {
+        m_groups[body] = m_groups[m_groups[body]];
+        body = m_groups[body];
+    }
+    return body;
+}
+
+const std::vector<k4abt_body_t>& Samples::SkeletonFusion::Fuse(const MultiViewFrame& frame)
+{
+    // All bodies in the world frame, in the order of the devices
+    m_worldBodies.clear();
+    m_devices.clear();
+    for (const DeviceView& view : frame.Views)
+    {
+        if (view.DeviceIndex >= m_extrinsics.size() || view.DeviceIndex >= MaxDevices)
+        {
+            continue;
+        }
+        const CameraExtrinsics& camera = m_extrinsics[view.DeviceIndex];
+        const k4a_quaternion_t& rotation = m_rotations[view.DeviceIndex];
+        for (const k4abt_body_t& body : view.Bodies)
+        {
+            m_worldBodies.push_back(body);
+            k4abt_body_t& world = m_worldBodies.back();
+            for (k4abt_joint_t& joint : world.skeleton.joints)
+            {
+                joint.position = camera.TransformPoint(joint.position);
+                joint.orientation = Multiply(rotation, joint.orientation);
+            }
+            m_devices.push_back(view.DeviceIndex);
+        }
+    }
+
+    const uint32_t bodyCount = static_cast<uint32_t>(m_worldBodies.size());
+    m_groups.resize(bodyCount);
+    m_groupDevices.resize(bodyCount);
+    std::iota(m_groups.begin(), m_groups.end(), 0u);
+    for (uint32_t i = 0; i < bodyCount; ++i)
+    {
+        m_groupDevices[i] = 1u << m_devices[i];
+    }
+
+    // Candidate pairs of bodies from different devices, closest first
+    m_pairs.clear();
+    for (uint32_t i = 0; i < bodyCount; ++i)
+    {
+        const k4a_float3_t& a = m_worldBodies[i].skeleton.joints[K4ABT_JOINT_PELVIS].position;
+        for (uint32_t j = i + 1; j < bodyCount; ++j)
+        {
+            if (m_devices[i] == m_devices[j])
+            {
+                continue;
+            }
+            const k4a_float3_t& b = m_worldBodies[j].skeleton.joints[K4ABT_JOINT_PELVIS].position;
+            const float dx = a.xyz.x - b.xyz.x, dy = a.xyz.y - b.xyz.y, dz = a.xyz.z - b.xyz.z;
+            const float distanceSquared = dx * dx + dy * dy + dz * dz;
+            if (distanceSquared <= m_maxDistanceSquared)
+            {
+                m_pairs.push_back({ distanceSquared, i, j });
+            }
+        }
+    }
+    std::sort(m_pairs.begin(), m_pairs.end(), [](const CandidatePair& a, const CandidatePair& b) { return a.DistanceSquared < b.DistanceSquared; });
+
+    // The root of a group is its body with the lowest index, which is from the lowest device
+    for (const CandidatePair& pair : m_pairs)
+    {
+        uint32_t first = FindGroup(pair.First);
+        uint32_t second = FindGroup(pair.Second);
+        if (first == second || (m_groupDevices[first] & m_groupDevices[second]) != 0)
+        {
+            continue;
+        }
+        if (second < first)
+        {
+            std::swap(first, second);
+        }
+        m_groups[second] = first;
+        m_groupDevices[first] |= m_groupDevices[second];
+    }
+
+    m_fused.clear();
+    m_sums.clear();
+    m_fusedIndex.resize(bodyCount);
+    for (uint32_t i = 0; i < bodyCount; ++i)
+    {
+        if (FindGroup(i) == i)
+        {
+            m_fusedIndex[i] = static_cast<uint32_t>(m_fused.size());
+            m_fused.push_back(m_worldBodies[i]);
+            m_fused.back().id = (m_devices[i] << 24) | (m_worldBodies[i].id & 0xFFFFFF);
+            m_sums.emplace_back();
+        }
+    }
+
+    for (uint32_t i = 0; i < bodyCount; ++i)
+    {
+        std::array<JointSum, K4ABT_JOINT_COUNT>& sums = m_sums[m_fusedIndex[FindGroup(i)]];
+        for (int j = 0; j < static_cast<int>(K4ABT_JOINT_COUNT); ++j)
+        {
+            const k4abt_joint_t& joint = m_worldBodies[i].skeleton.joints[j];
+            JointSum& sum = sums[j];
+
+            // Joints without confidence only count when no body of the group has a better one
+            const float weight = joint.confidence_level > K4ABT_JOINT_CONFIDENCE_NONE ? static_cast<float>(joint.confidence_level) : 1e-3f;
+            sum.Weight += weight;
+            sum.X += weight * joint.position.xyz.x;
+            sum.Y += weight * joint.position.xyz.y;
+            sum.Z += weight * joint.position.xyz.z;
+
+            // q and -q are the same rotation, add the one in the hemisphere of the sum so far
+            const k4a_quaternion_t& q = joint.orientation;
+            const float sign = sum.W * q.wxyz.w + sum.QX * q.wxyz.x + sum.QY * q.wxyz.y + sum.QZ * q.wxyz.z < 0 ? -weight : weight;
+            sum.W += sign * q.wxyz.w;
+            sum.QX += sign * q.wxyz.x;
+            sum.QY += sign * q.wxyz.y;
+            sum.QZ += sign * q.wxyz.z;
+            sum.Confidence = std::max(sum.Confidence, static_cast<int>(joint.confidence_level));
+        }
+    }
+
+    for (size_t f = 0; f < m_fused.size(); ++f)
+    {
+        for (int j = 0; j < static_cast<int>(K4ABT_JOINT_COUNT); ++j)
+        {
+            const JointSum& sum = m_sums[f][j];
+            k4abt_joint_t& joint = m_fused[f].skeleton.joints[j];
+            joint.position.xyz = { sum.X / sum.Weight, sum.Y / sum.Weight, sum.Z / sum.Weight };
+            const float length = std::sqrt(sum.W * sum.W + sum.QX * sum.QX + sum.QY * sum.QY + sum.QZ * sum.QZ);
+            if (length > 0)
+            {
+                joint.orientation.wxyz = { sum.W / length, sum.QX / length, sum.QY / length, sum.QZ / length };
+            }
+            joint.confidence_level = static_cast<k4abt_joint_confidence_level_t>(sum.Confidence);
+        }
+    }
+    return m_fused;
+}
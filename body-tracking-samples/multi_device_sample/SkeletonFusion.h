@@ -0,0 +1,133 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <k4abt.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MultiViewFrame.h"
+
+namespace Samples
+{
+    // Rigid transform from the depth camera of a device into the world frame shared by all devices, in millimeters.
+    // The world frame follows the camera convention: x right, y down, z forward.
+    struct CameraExtrinsics
+    {
+        std::array<float, 9> Rotation = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };     // Row major
+        std::array<float, 3> Translation = { 0, 0, 0 };
+
+        k4a_float3_t TransformPoint(const k4a_float3_t& point) const;
+        k4a_quaternion_t GetRotationQuaternion() const;
+
+        // Frame of a camera from the floor plane found by FloorDetector, a unit normal and a point on the floor in
+        // meters as printed by floor_detector_sample. The origin is on the floor below the camera, y points down and
+        // z along the view direction of the camera. The floor fixes height, tilt and roll of the camera, its
+        // heading and position on the floor are given by PlacedOnFloor.
+        static CameraExtrinsics FromFloor(const k4a_float3_t& floorNormal, const k4a_float3_t& floorPointInMeters);
+
+        // This transform followed by a rotation about the vertical axis and an offset along the floor
+        CameraExtrinsics PlacedOnFloor(float yawInRadians, float xInMm, float zInMm) const;
+    };
+
+    struct DeviceExtrinsics
+    {
+        CameraExtrinsics Extrinsics;
+        bool PlacementKnown = true;     // False for a floor frame whose heading and position are not known yet
+    };
+
+    // Reads the extrinsics of deviceCount devices, one line per device:
+    //     <device> MATRIX r00 r01 r02 r10 r11 r12 r20 r21 r22 tx ty tz    calibrated, translation in mm
+    //     <device> FLOOR nx ny nz px py pz [yaw_degrees x_mm z_mm]         floor plane, see FromFloor
+    // A FLOOR line without placement leaves heading and position to FloorRegistration. Lines starting with # are
+    // comments. Throws std::runtime_error.
+    std::vector<DeviceExtrinsics> LoadExtrinsics(const std::string& fileName, size_t deviceCount);
+
+    // Finds heading and position on the floor of the devices whose placement is not known, from one person walking
+    // through the room. In frames where a placed reference device and another device both see exactly one body, the
+    // pelvis positions are paired. Once a device has requiredPairs pairs spread over the room, the rotation about
+    // the vertical and the floor offset that map its pelvis positions onto those of the reference are solved in
+    // closed form (2d Kabsch).
+    class FloorRegistration
+    {
+    public:
+        // The first device with a known placement is the reference, device 0 if there is none
+        explicit FloorRegistration(std::vector<DeviceExtrinsics> devices, size_t requiredPairs = 150, float requiredSpreadMm = 500.f);
+
+        void Add(const MultiViewFrame& frame);
+
+        bool IsComplete() const;
+        const std::vector<DeviceExtrinsics>& GetDevices() const { return m_devices; }
+
+    private:
+        struct Pair
+        {
+            float ReferenceX, ReferenceZ;
+            float DeviceX, DeviceZ;
+        };
+
+        void TrySolve(size_t device);
+
+        std::vector<DeviceExtrinsics> m_devices;
+        size_t m_reference = 0;
+        size_t m_requiredPairs;
+        float m_requiredSpreadMm;
+        std::vector<std::vector<Pair>> m_pairs;
+    };
+
+    // Fuses the views of a multi-view frame into one set of bodies in the world frame.
+    //
+    // The bodies of all views are transformed into the world frame and associated greedily by pelvis distance:
+    // pairs of bodies seen by different devices are joined in order of increasing distance, up to
+    // maxPelvisDistanceMm, as long as the group keeps at most one body per device. The joints of a group are
+    // averaged with their confidence levels as weights, orientations as the normalized weighted quaternion sum,
+    // and keep the highest confidence of the group. A fused body takes the id of its body from the lowest device
+    // index, with that index in the upper 8 bits, so ids stay stable while that device sees the person.
+    //
+    // Fuse does not allocate once the buffers have grown to the largest frame.
+    class SkeletonFusion
+    {
+    public:
+        explicit SkeletonFusion(std::vector<CameraExtrinsics> extrinsics, float maxPelvisDistanceMm = 400.f);
+
+        // The bodies stay valid until the next call
+        const std::vector<k4abt_body_t>& Fuse(const MultiViewFrame& frame);
+
+    private:
+        struct CandidatePair
+        {
+            float DistanceSquared;
+            uint32_t First;
+            uint32_t Second;
+        };
+
+        struct JointSum
+        {
+            float Weight, X, Y, Z;
+            float W, QX, QY, QZ;
+            int Confidence;
+        };
+
+        uint32_t FindGroup(uint32_t body);
+
+        std::vector<CameraExtrinsics> m_extrinsics;
+        std::vector<k4a_quaternion_t> m_rotations;
+        float m_maxDistanceSquared;
+
+        // Per body of the frame
+        std::vector<k4abt_body_t> m_worldBodies;
+        std::vector<uint32_t> m_devices;
+        std::vector<uint32_t> m_groups;         // Union-find parents
+        std::vector<uint32_t> m_groupDevices;   // Bit mask of the devices in the group of a root
+        std::vector<uint32_t> m_fusedIndex;
+
+        std::vector<CandidatePair> m_pairs;
+        std::vector<std::array<JointSum, K4ABT_JOINT_COUNT>> m_sums;
+        std::vector<k4abt_body_t> m_fused;
+    };
+}
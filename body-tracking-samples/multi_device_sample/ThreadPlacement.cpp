@@ -0,0 +1,190 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "ThreadPlacement.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+#ifndef _WIN32
+    // Parses a Linux cpu list such as "0-3,8-11"
+    std::vector<uint32_t> ParseCpuList(const std::string& cpuList)
+    {
+        std::vector<uint32_t> processors;
+        std::stringstream stream(cpuList);
+        std::string range;
+        while (std::getline(stream, range, ','))
+        {
+            const size_t dash = range.find('-');
+            try
+            {
+                const uint32_t first = static_cast<uint32_t>(std::stoul(range.substr(0, dash)));
+                const uint32_t last = dash == std::string::npos ? first : static_cast<uint32_t>(std::stoul(range.substr(dash + 1)));
+                for (uint32_t processor = first; processor <= last; ++processor)
+                {
+                    processors.push_back(processor);
+                }
+            }
+            catch (const std::exception&)
+            {
+                // Empty or malformed entry
+            }
+        }
+        return processors;
+    }
+#endif
+
+    std::vector<Samples::NumaNode> GetSystemNumaNodes()
+    {
+        std::vector<Samples::NumaNode> nodes;
+#ifdef _WIN32
+        ULONG highestNode = 0;
+        if (GetNumaHighestNodeNumber(&highestNode))
+        {
+            for (USHORT node = 0; node <= highestNode; ++node)
+            {
+                GROUP_AFFINITY affinity = {};
+                if (!GetNumaNodeProcessorMaskEx(node, &affinity) || affinity.Group != 0)
+                {
+                    // Only processor group 0 is used, like SetThreadAffinityMask
+                    continue;
+                }
+                Samples::NumaNode numaNode;
+                numaNode.Index = node;
+                for (uint32_t processor = 0; processor < sizeof(KAFFINITY) * 8; ++processor)
+                {
+                    if (affinity.Mask & (static_cast<KAFFINITY>(1) << processor))
+                    {
+                        numaNode.Processors.push_back(processor);
+                    }
+                }
+                if (!numaNode.Processors.empty())
+                {
+                    nodes.push_back(std::move(numaNode));
+                }
+            }
+        }
+#else
+        for (uint32_t node = 0;; ++node)
+        {
+            std::ifstream cpuListFile("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!cpuListFile)
+            {
+                break;
+            }
+            std::string cpuList;
+            std::getline(cpuListFile, cpuList);
+
+            Samples::NumaNode numaNode;
+            numaNode.Index = node;
+            numaNode.Processors = ParseCpuList(cpuList);
+            if (!numaNode.Processors.empty())
+            {
+                nodes.push_back(std::move(numaNode));
+            }
+        }
+#endif
+        return nodes;
+    }
+}
+
+std::vector<Samples::NumaNode> Samples::GetNumaNodes()
+{
+    std::vector<NumaNode> nodes = GetSystemNumaNodes();
+    if (nodes.empty())
+    {
+        NumaNode node;
+        const uint32_t processorCount = std::max(std::thread::hardware_concurrency(), 1u);
+        for (uint32_t processor = 0; processor < processorCount; ++processor)
+        {
+            node.Processors.push_back(processor);
+        }
+        nodes.push_back(std::move(node));
+    }
+    return nodes;
+}
+
+std::vector<std::vector<uint32_t>> Samples::PlanDeviceProcessors(const std::vector<NumaNode>& nodes, size_t deviceCount)
+{
+    std::vector<std::vector<uint32_t>> plan(deviceCount);
+    if (nodes.empty())
+    {
+        return plan;
+    }
+
+    for (size_t node = 0; node < nodes.size(); ++node)
+    {
+        // Devices node, node + nodes.size(), ... run on this node
+        std::vector<size_t> devices;
+        for (size_t device = node; device < deviceCount; device += nodes.size())
+        {
+            devices.push_back(device);
+        }
+        const std::vector<uint32_t>& processors = nodes[node].Processors;
+        if (devices.empty())
+        {
+            continue;
+        }
+        if (devices.size() > processors.size())
+        {
+            for (size_t device : devices)
+            {
+                plan[device] = processors;
+            }
+            continue;
+        }
+
+        // Contiguous slices, the first ones get one more processor when the count does not divide
+        size_t begin = 0;
+        for (size_t i = 0; i < devices.size(); ++i)
+        {
+            const size_t count = processors.size() / devices.size() + (i < processors.size() % devices.size() ? 1 : 0);
+            plan[devices[i]].assign(processors.begin() + begin, processors.begin() + begin + count);
+            begin += count;
+        }
+    }
+    return plan;
+}
+
+bool Samples::PinCurrentThread(const std::vector<uint32_t>& processors)
+{
+    if (processors.empty())
+    {
+        return false;
+    }
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (uint32_t processor : processors)
+    {
+        if (processor < sizeof(DWORD_PTR) * 8)
+        {
+            mask |= static_cast<DWORD_PTR>(1) << processor;
+        }
+    }
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (uint32_t processor : processors)
+    {
+        if (processor < CPU_SETSIZE)
+        {
+            CPU_SET(processor, &cpuSet);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#endif
+}
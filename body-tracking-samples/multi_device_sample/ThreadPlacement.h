@@ -0,0 +1,30 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Samples
+{
+    // Logical processors of one NUMA node.
+    struct NumaNode
+    {
+        uint32_t Index = 0;
+        std::vector<uint32_t> Processors;
+    };
+
+    // NUMA nodes of the machine. Machines without NUMA information report a single node with all processors.
+    std::vector<NumaNode> GetNumaNodes();
+
+    // Splits the machine into deviceCount processor sets: devices are spread round-robin over the NUMA nodes and
+    // the processors of a node are divided evenly between its devices. When there are more devices than processors
+    // on a node, its devices share the processors of the node.
+    std::vector<std::vector<uint32_t>> PlanDeviceProcessors(const std::vector<NumaNode>& nodes, size_t deviceCount);
+
+    // Restricts the calling thread to the given processors. Threads it creates afterwards inherit the restriction,
+    // and memory it touches first is allocated on the node of these processors. Returns false if not supported.
+    bool PinCurrentThread(const std::vector<uint32_t>& processors);
+}
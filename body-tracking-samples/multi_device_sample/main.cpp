@@ -0,0 +1,413 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <k4a/k4a.h>
+#include <k4abt.h>
+
+#include <BodyTrackingHelpers.h>
+#include <ResultBus.h>
+
+#include "CaptureSource.h"
+#include "MultiDeviceRuntime.h"
+#include "SkeletonFusion.h"
+
+using namespace Samples;
+
+void PrintUsage()
+{
+    printf("\nUSAGE: (k4abt_)multi_device_sample.exe -devices N | -mkv file.mkv [-mkv file2.mkv ...] [options]\n");
+    printf("  - Sources (one of):\n");
+    printf("      -devices N - Open the first N connected devices. Their sync cables decide master and subordinates\n");
+    printf("      -mkv file.mkv - Play a recording as one device, repeat for every device of the session\n");
+    printf("  - SensorMode: \n");
+    printf("      NFOV_UNBINNED (default) - Narrow Field of View Unbinned Mode [Resolution: 640x576; FOI: 75 degree x 65 degree]\n");
+    printf("      WFOV_BINNED             - Wide Field of View Binned Mode [Resolution: 512x512; FOI: 120 degree x 120 degree]\n");
+    printf("  - RuntimeMode: \n");
+    printf("      CPU - Use the CPU only mode. It runs on machines without a GPU but it will be much slower\n");
+    printf("      CUDA - Use CUDA for processing.\n");
+#ifdef _WIN32
+    printf("      DIRECTML - Use the DirectML processing mode.\n");
+#endif
+    printf("      TENSORRT - Use the TensorRT processing mode.\n");
+    printf("  - Additional options:\n");
+    printf("      FPS_5, FPS_15, FPS_30 - Camera frame rate of the devices (optional, default: FPS_30)\n");
+    printf("      -csv filename.csv - Joint positions of the multi-view frames (optional, default: multi_view_frames.csv)\n");
+    printf("      -extrinsics extrinsics.txt - Fuse the bodies of all devices in a world frame (optional)\n");
+    printf("      -seconds S - Run time with devices (optional, default: 30)\n");
+    printf("      -nopin - Do not pin the threads of each device to its own processors (optional)\n");
+    printf("e.g.   (k4abt_)multi_device_sample.exe -devices 3\n");
+    printf("e.g.   (k4abt_)multi_device_sample.exe -mkv master.mkv -mkv sub1.mkv -mkv sub2.mkv CPU\n");
+}
+
+struct InputSettings
+{
+    uint32_t DeviceCount = 0;
+    std::vector<std::string> Recordings;
+    k4a_depth_mode_t DepthCameraMode = K4A_DEPTH_MODE_NFOV_UNBINNED;
+#ifdef _WIN32
+    k4abt_tracker_processing_mode_t processingMode = K4ABT_TRACKER_PROCESSING_MODE_GPU_DIRECTML;
+#else
+    k4abt_tracker_processing_mode_t processingMode = K4ABT_TRACKER_PROCESSING_MODE_GPU_CUDA;
+#endif
+    k4a_fps_t CameraFPS = K4A_FRAMES_PER_SECOND_30;
+    std::string CSVFileName = "multi_view_frames.csv";
+    std::string ExtrinsicsFileName;
+    int Seconds = 30;
+    bool PinThreads = true;
+};
+
+bool ParseInputSettingsFromArg(int argc, char** argv, InputSettings& inputSettings)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string inputArg(argv[i]);
+        if (inputArg == std::string("-devices"))
+        {
+            inputSettings.DeviceCount = i < argc - 1 ? static_cast<uint32_t>(std::max(atoi(argv[++i]), 0)) : 0;
+            if (inputSettings.DeviceCount == 0)
+            {
+                printf("Error: device count must be a positive number\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("-mkv"))
+        {
+            if (i < argc - 1)
+                inputSettings.Recordings.push_back(argv[++i]);
+            else
+            {
+                printf("Error: recording file name missing\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("NFOV_UNBINNED"))
+        {
+            inputSettings.DepthCameraMode = K4A_DEPTH_MODE_NFOV_UNBINNED;
+        }
+        else if (inputArg == std::string("WFOV_BINNED"))
+        {
+            inputSettings.DepthCameraMode = K4A_DEPTH_MODE_WFOV_2X2BINNED;
+        }
+        else if (inputArg == std::string("CPU"))
+        {
+            inputSettings.processingMode = K4ABT_TRACKER_PROCESSING_MODE_CPU;
+        }
+        else if (inputArg == std::string("TENSORRT"))
+        {
+            inputSettings.processingMode = K4ABT_TRACKER_PROCESSING_MODE_GPU_TENSORRT;
+        }
+        else if (inputArg == std::string("CUDA"))
+        {
+            inputSettings.processingMode = K4ABT_TRACKER_PROCESSING_MODE_GPU_CUDA;
+        }
+#ifdef _WIN32
+        else if (inputArg == std::string("DIRECTML"))
+        {
+            inputSettings.processingMode = K4ABT_TRACKER_PROCESSING_MODE_GPU_DIRECTML;
+        }
+#endif
+        else if (inputArg == std::string("FPS_5"))
+        {
+            inputSettings.CameraFPS = K4A_FRAMES_PER_SECOND_5;
+        }
+        else if (inputArg == std::string("FPS_15"))
+        {
+            inputSettings.CameraFPS = K4A_FRAMES_PER_SECOND_15;
+        }
+        else if (inputArg == std::string("FPS_30"))
+        {
+            inputSettings.CameraFPS = K4A_FRAMES_PER_SECOND_30;
+        }
+        else if (inputArg == std::string("-csv"))
+        {
+            if (i < argc - 1)
+                inputSettings.CSVFileName = argv[++i];
+            else
+            {
+                printf("Error: CSV file name missing\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("-extrinsics"))
+        {
+            if (i < argc - 1)
+                inputSettings.ExtrinsicsFileName = argv[++i];
+            else
+            {
+                printf("Error: extrinsics file name missing\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("-seconds"))
+        {
+            inputSettings.Seconds = i < argc - 1 ? atoi(argv[++i]) : 0;
+            if (inputSettings.Seconds <= 0)
+            {
+                printf("Error: run time must be a positive number of seconds\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("-nopin"))
+        {
+            inputSettings.PinThreads = false;
+        }
+        else
+        {
+            printf("Error: command not understood: %s\n", inputArg.c_str());
+            return false;
+        }
+    }
+
+    if ((inputSettings.DeviceCount == 0) == inputSettings.Recordings.empty())
+    {
+        printf("Error: use either -devices or -mkv\n");
+        return false;
+    }
+    return true;
+}
+
+// Processors as ranges, e.g. "0-3,8"
+std::string FormatProcessors(const std::vector<uint32_t>& processors)
+{
+    std::string text;
+    for (size_t i = 0; i < processors.size();)
+    {
+        size_t last = i;
+        while (last + 1 < processors.size() && processors[last + 1] == processors[last] + 1)
+        {
+            last++;
+        }
+        text += (text.empty() ? "" : ",") + std::to_string(processors[i]);
+        if (last > i)
+        {
+            text += "-" + std::to_string(processors[last]);
+        }
+        i = last + 1;
+    }
+    return text.empty() ? "any" : text;
+}
+
+void WriteBody(std::ofstream& file, const k4abt_body_t& body)
+{
+    file << body.id;
+    for (const k4abt_joint_t& joint : body.skeleton.joints)
+    {
+        file << "," << joint.position.xyz.x << "," << joint.position.xyz.y << "," << joint.position.xyz.z << "," << joint.confidence_level;
+    }
+    file << "\n";
+}
+
+// One row per body and view with the skeletons in the depth camera coordinates of the device, followed by the fused
+// bodies in world coordinates with "fused" as device
+void WriteMultiViewFrame(std::ofstream& file, const MultiViewFrame& frame)
+{
+    for (const DeviceView& view : frame.Views)
+    {
+        for (const k4abt_body_t& body : view.Bodies)
+        {
+            file << frame.FrameIndex << "," << frame.TimestampUsec << "," << view.DeviceIndex << "," << view.DeviceTimestampUsec << ",";
+            WriteBody(file, body);
+        }
+    }
+    for (const k4abt_body_t& body : frame.WorldBodies)
+    {
+        file << frame.FrameIndex << "," << frame.TimestampUsec << ",fused," << frame.TimestampUsec << ",";
+        WriteBody(file, body);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    InputSettings inputSettings;
+    if (!ParseInputSettingsFromArg(argc, argv, inputSettings))
+    {
+        PrintUsage();
+        return -1;
+    }
+
+    std::vector<std::unique_ptr<CaptureSource>> sources;
+    try
+    {
+        if (inputSettings.DeviceCount > 0)
+        {
+            k4a_device_configuration_t deviceConfig = K4A_DEVICE_CONFIG_INIT_DISABLE_ALL;
+            deviceConfig.depth_mode = inputSettings.DepthCameraMode;
+            deviceConfig.camera_fps = inputSettings.CameraFPS;
+            sources = CaptureSource::OpenDevices(inputSettings.DeviceCount, deviceConfig);
+        }
+        for (const std::string& recording : inputSettings.Recordings)
+        {
+            sources.push_back(CaptureSource::OpenRecording(recording));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    const char* syncModeNames[] = { "standalone", "master", "subordinate" };
+    uint32_t framesPerSecond = 0;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        printf("Device %zu: %s (%s)\n", i, sources[i]->GetName().c_str(), syncModeNames[sources[i]->GetSyncMode()]);
+        framesPerSecond = std::max(framesPerSecond, sources[i]->GetFramesPerSecond());
+    }
+
+    // Devices whose heading and position on the floor are not in the extrinsics file are registered from the bodies
+    // first, the frames are fused once all devices are placed
+    std::optional<FloorRegistration> registration;
+    std::optional<SkeletonFusion> fusion;
+    if (!inputSettings.ExtrinsicsFileName.empty())
+    {
+        try
+        {
+            registration.emplace(LoadExtrinsics(inputSettings.ExtrinsicsFileName, sources.size()));
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return -1;
+        }
+        if (!registration->IsComplete())
+        {
+            printf("Registering the devices on the floor: one person please walk through the room\n");
+        }
+    }
+    uint64_t fusedFrames = 0;
+    double fusionSeconds = 0.0;
+    double maxFusionSeconds = 0.0;
+
+    std::ofstream csvFile(inputSettings.CSVFileName);
+    if (!csvFile.is_open())
+    {
+        std::cerr << "Failed to open CSV file: " << inputSettings.CSVFileName << std::endl;
+        return -1;
+    }
+    csvFile << "Frame,TimeUsec,Device,DeviceTimeUsec,BodyID";
+    for (std::string_view jointName : g_jointNames)
+    {
+        const std::string name(jointName);
+        csvFile << "," << name << "_X," << name << "_Y," << name << "_Z," << name << "_Confidence";
+    }
+    csvFile << "\n";
+
+    // Downstream sinks subscribe to the multi-view frames, each on its own thread
+    ResultBus<MultiViewFrame> bus;
+    Subscription<MultiViewFrame>& csvSubscription = bus.Subscribe<MultiViewFrame>(64, BackpressurePolicy::Block);
+    Subscription<MultiViewFrame>& consoleSubscription = bus.Subscribe<MultiViewFrame>(8, BackpressurePolicy::DropOldest);
+    std::thread csvSink = StartSink(csvSubscription, [&](const MultiViewFrame& frame) { WriteMultiViewFrame(csvFile, frame); });
+    std::thread consoleSink = StartSink(consoleSubscription, [](const MultiViewFrame& frame) {
+        if (frame.FrameIndex % 30 == 0)
+        {
+            printf("Frame %llu at %llu us:", static_cast<unsigned long long>(frame.FrameIndex), static_cast<unsigned long long>(frame.TimestampUsec));
+            for (const DeviceView& view : frame.Views)
+            {
+                printf(" device %u %zu bodies,", view.DeviceIndex, view.Bodies.size());
+            }
+            printf(" %zu of %zu views\n", frame.Views.size(), frame.DeviceCount);
+        }
+    });
+
+    k4abt_tracker_configuration_t trackerConfig = K4ABT_TRACKER_CONFIG_DEFAULT;
+    trackerConfig.processing_mode = inputSettings.processingMode;
+
+    // Views within half a frame period belong to the same frame
+    const uint64_t toleranceUsec = 500000 / std::max(framesPerSecond, 1u);
+    const auto start = std::chrono::steady_clock::now();
+    {
+        // Fusion runs on the live path, in the thread that completes the frame. The aligner emits one frame at a time,
+        // so the world bodies can be built in one buffer that every frame borrows: publishing copies the frame into
+        // the subscriptions, and the buffer is taken back afterwards with its capacity.
+        std::vector<k4abt_body_t> worldBodies;
+        auto fuseAndPublish = [&](MultiViewFrame&& frame) {
+            if (registration && !fusion)
+            {
+                registration->Add(frame);
+                if (registration->IsComplete())
+                {
+                    std::vector<CameraExtrinsics> extrinsics;
+                    for (const DeviceExtrinsics& device : registration->GetDevices())
+                    {
+                        extrinsics.push_back(device.Extrinsics);
+                    }
+                    fusion.emplace(std::move(extrinsics));
+                    printf("All devices are placed, fusing from frame %llu on\n", static_cast<unsigned long long>(frame.FrameIndex));
+                }
+            }
+            if (fusion)
+            {
+                const auto fusionStart = std::chrono::steady_clock::now();
+                const std::vector<k4abt_body_t>& fused = fusion->Fuse(frame);
+                worldBodies.assign(fused.begin(), fused.end());
+                frame.WorldBodies.swap(worldBodies);
+                const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - fusionStart).count();
+                fusionSeconds += elapsed;
+                maxFusionSeconds = std::max(maxFusionSeconds, elapsed);
+                fusedFrames++;
+            }
+            bus.Publish(frame);
+            frame.WorldBodies.swap(worldBodies);
+        };
+
+        MultiDeviceRuntime runtime(std::move(sources), trackerConfig, toleranceUsec, fuseAndPublish, inputSettings.PinThreads);
+        if (runtime.Start())
+        {
+            if (inputSettings.DeviceCount > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::seconds(inputSettings.Seconds));
+                runtime.Stop();
+            }
+            runtime.Wait();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double totalFramesPerSecond = 0.0;
+        std::vector<DeviceStatistics> deviceStatistics = runtime.GetDeviceStatistics();
+        for (size_t i = 0; i < deviceStatistics.size(); i++)
+        {
+            const DeviceStatistics& device = deviceStatistics[i];
+            printf("Device %zu: %llu captures, %llu body frames, %.1f fps on processors %s%s\n", i,
+                static_cast<unsigned long long>(device.Captures), static_cast<unsigned long long>(device.BodyFrames),
+                device.FramesPerSecond, FormatProcessors(device.Processors).c_str(), device.Failed ? " (failed)" : "");
+            totalFramesPerSecond += device.FramesPerSecond;
+        }
+
+        const AlignmentStatistics alignment = runtime.GetAlignmentStatistics();
+        printf("Total: %.1f body frames per second, %llu multi-view frames (%llu complete, %llu late views) in %.1f s\n",
+            totalFramesPerSecond, static_cast<unsigned long long>(alignment.Frames), static_cast<unsigned long long>(alignment.CompleteFrames),
+            static_cast<unsigned long long>(alignment.LateViews), seconds);
+        if (fusedFrames > 0)
+        {
+            printf("Fusion: %llu frames, %.3f ms average, %.3f ms maximum\n", static_cast<unsigned long long>(fusedFrames),
+                fusionSeconds * 1000.0 / fusedFrames, maxFusionSeconds * 1000.0);
+        }
+        else if (registration)
+        {
+            printf("Fusion did not start, not all devices were registered on the floor\n");
+        }
+        for (size_t i = 0; i < alignment.MissingViews.size(); i++)
+        {
+            if (alignment.MissingViews[i] > 0)
+            {
+                printf("Device %zu missed %llu frames\n", i, static_cast<unsigned long long>(alignment.MissingViews[i]));
+            }
+        }
+    }
+
+    bus.Close();
+    csvSink.join();
+    consoleSink.join();
+    std::cout << "Finished multi-device body tracking!" << std::endl;
+    return 0;
+}
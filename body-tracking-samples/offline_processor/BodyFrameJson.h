@@ -0,0 +1,64 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <k4abttypes.h>
+#include <nlohmann/json.hpp>
+
+// JSON object of one body tracking frame as written to the "frames" array of the output file
+inline nlohmann::json body_frame_to_json(uint64_t timestamp_usec, int frame_id, const std::vector<k4abt_body_t>& bodies)
+{
+    using nlohmann::json;
+
+    json frame_result_json;
+    frame_result_json["timestamp_usec"] = timestamp_usec;
+    frame_result_json["frame_id"] = frame_id;
+    frame_result_json["num_bodies"] = static_cast<uint32_t>(bodies.size());
+    frame_result_json["bodies"] = json::array();
+    for (const k4abt_body_t& body : bodies)
+    {
+        const k4abt_skeleton_t& skeleton = body.skeleton;
+        json body_result_json;
+        body_result_json["body_id"] = static_cast<int>(body.id);
+
+        for (int j = 0; j < (int)K4ABT_JOINT_COUNT; j++)
+        {
+            body_result_json["joint_positions"].push_back( {    skeleton.joints[j].position.xyz.x,
+                                                                skeleton.joints[j].position.xyz.y,
+                                                                skeleton.joints[j].position.xyz.z });
+
+            body_result_json["joint_orientations"].push_back({  skeleton.joints[j].orientation.wxyz.w,
+                                                                skeleton.joints[j].orientation.wxyz.x,
+                                                                skeleton.joints[j].orientation.wxyz.y,
+                                                                skeleton.joints[j].orientation.wxyz.z });
+        }
+        frame_result_json["bodies"].push_back(body_result_json);
+    }
+    return frame_result_json;
+}
+
+// Bodies of a JSON object written by body_frame_to_json, with the positions and orientations of all joints
+inline std::vector<k4abt_body_t> body_frame_bodies_from_json(const nlohmann::json& frame_result_json)
+{
+    std::vector<k4abt_body_t> bodies;
+    for (const nlohmann::json& body_result_json : frame_result_json.at("bodies"))
+    {
+        k4abt_body_t body = {};
+        body.id = body_result_json.at("body_id").get<uint32_t>();
+        const nlohmann::json& positions = body_result_json.at("joint_positions");
+        const nlohmann::json& orientations = body_result_json.at("joint_orientations");
+        for (int j = 0; j < (int)K4ABT_JOINT_COUNT; j++)
+        {
+            k4abt_joint_t& joint = body.skeleton.joints[j];
+            joint.position.xyz = { positions[j][0].get<float>(), positions[j][1].get<float>(), positions[j][2].get<float>() };
+            joint.orientation.wxyz = { orientations[j][0].get<float>(), orientations[j][1].get<float>(),
+                                       orientations[j][2].get<float>(), orientations[j][3].get<float>() };
+        }
+        bodies.push_back(body);
+    }
+    return bodies;
+}
@@ -0,0 +1,466 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "ChunkedTracking.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <tuple>
+
+#include <k4a/k4a.h>
+#include <k4arecord/playback.h>
+
+#include <Utilities.h>
+
+#include "TrackingCheckpoint.h"
+
+using namespace std;
+
+namespace
+{
+    mutex g_console_mutex;
+
+    using FrameCallback = function<void(const TrackedFrame&)>;
+
+    // Device timestamp of the capture: the depth image, or the color or IR image of a capture without depth
+    uint64_t get_capture_timestamp_usec(k4a_capture_t capture, bool& has_depth)
+    {
+        k4a_image_t image = k4a_capture_get_depth_image(capture);
+        has_depth = image != nullptr;
+        if (image == nullptr)
+        {
+            image = k4a_capture_get_color_image(capture);
+        }
+        if (image == nullptr)
+        {
+            image = k4a_capture_get_ir_image(capture);
+        }
+        if (image == nullptr)
+        {
+            return 0;
+        }
+        const uint64_t timestamp = k4a_image_get_device_timestamp_usec(image);
+        k4a_image_release(image);
+        return timestamp;
+    }
+
+    // Pops the oldest body frame in the tracker into the warm-up or the frames of the chunk
+    bool pop_body_frame(k4abt_tracker_t tracker, deque<int>& in_flight, TrackedChunk& chunk, const FrameCallback& on_frame)
+    {
+        k4abt_frame_t body_frame = nullptr;
+        if (k4abt_tracker_pop_result(tracker, &body_frame, K4A_WAIT_INFINITE) != K4A_WAIT_RESULT_SUCCEEDED)
+        {
+            return false;
+        }
+
+        TrackedFrame frame;
+        frame.TimestampUsec = k4abt_frame_get_device_timestamp_usec(body_frame);
+        frame.CaptureIndex = in_flight.front();
+        in_flight.pop_front();
+
+        const uint32_t num_bodies = k4abt_frame_get_num_bodies(body_frame);
+        frame.Bodies.resize(num_bodies);
+        for (uint32_t i = 0; i < num_bodies; i++)
+        {
+            VERIFY(k4abt_frame_get_body_skeleton(body_frame, i, &frame.Bodies[i].skeleton), "Get body from body frame failed!");
+            frame.Bodies[i].id = k4abt_frame_get_body_id(body_frame, i);
+        }
+        k4abt_frame_release(body_frame);
+
+        vector<TrackedFrame>& frames = frame.CaptureIndex < 0 ? chunk.WarmUpFrames : chunk.Frames;
+        frames.push_back(move(frame));
+        on_frame(frames.back());
+        return true;
+    }
+
+    // Tracks the captures of one chunk. Captures are enqueued as long as the tracker takes them and results are only
+    // popped when its queue is full, so the tracker always has work.
+    bool track_chunk(const char* input_path, k4abt_tracker_configuration_t tracker_config, TrackedChunk& chunk,
+                     const PlaybackSelection& selection, const FrameCallback& on_frame, atomic<int>& captures_done)
+    {
+        k4a_playback_t playback_handle = nullptr;
+        if (k4a_playback_open(input_path, &playback_handle) != K4A_RESULT_SUCCEEDED)
+        {
+            lock_guard<mutex> lock(g_console_mutex);
+            cerr << "Cannot open recording at " << input_path << endl;
+            return false;
+        }
+
+        k4a_calibration_t calibration;
+        k4a_record_configuration_t record_config;
+        if (k4a_playback_get_calibration(playback_handle, &calibration) != K4A_RESULT_SUCCEEDED ||
+            k4a_playback_get_record_configuration(playback_handle, &record_config) != K4A_RESULT_SUCCEEDED)
+        {
+            lock_guard<mutex> lock(g_console_mutex);
+            cerr << "Failed to get calibration" << endl;
+            k4a_playback_close(playback_handle);
+            return false;
+        }
+
+        k4abt_tracker_t tracker = nullptr;
+        if (K4A_RESULT_SUCCEEDED != k4abt_tracker_create(&calibration, tracker_config, &tracker))
+        {
+            lock_guard<mutex> lock(g_console_mutex);
+            cerr << "Body tracker initialization failed!" << endl;
+            k4a_playback_close(playback_handle);
+            return false;
+        }
+
+        const uint64_t seek_usec = chunk.StartUsec - chunk.WarmUpUsec;
+        bool success = seek_usec == 0 ||
+            k4a_playback_seek_timestamp(playback_handle, static_cast<int64_t>(seek_usec), K4A_PLAYBACK_SEEK_BEGIN) == K4A_RESULT_SUCCEEDED;
+
+        deque<int> in_flight;   // Capture index of every capture in the tracker, -1 during the warm-up
+        uint64_t time_usec = seek_usec;
+        const uint64_t frame_period_usec = GetFramePeriodUsec(record_config.camera_fps);
+        while (success)
+        {
+            k4a_capture_t capture_handle = nullptr;
+            k4a_stream_result_t stream_result = k4a_playback_get_next_capture(playback_handle, &capture_handle);
+            if (stream_result == K4A_STREAM_RESULT_EOF)
+            {
+                break;
+            }
+            if (stream_result != K4A_STREAM_RESULT_SUCCEEDED)
+            {
+                lock_guard<mutex> lock(g_console_mutex);
+                cerr << "Stream error for clip at " << time_usec << " usec" << endl;
+                success = false;
+                break;
+            }
+
+            bool has_depth = false;
+            const uint64_t timestamp_usec = get_capture_timestamp_usec(capture_handle, has_depth);
+            if (timestamp_usec != 0)
+            {
+                time_usec = timestamp_usec > record_config.start_timestamp_offset_usec ?
+                    timestamp_usec - record_config.start_timestamp_offset_usec : 0;
+            }
+            if (time_usec >= chunk.EndUsec)
+            {
+                k4a_capture_release(capture_handle);
+                break;
+            }
+
+            const bool warm_up = time_usec < chunk.StartUsec;
+            const int capture_index = warm_up ? -1 : chunk.CaptureCount++;
+            if (selection.SkipColor)
+            {
+                k4a_capture_set_color_image(capture_handle, nullptr);
+            }
+
+            // Only try to predict joints when capture contains depth image
+            const bool selected = selection.IsSelected(time_usec, frame_period_usec);
+            while (has_depth && selected)
+            {
+                const k4a_wait_result_t queue_capture_result =
+                    k4abt_tracker_enqueue_capture(tracker, capture_handle, in_flight.empty() ? K4A_WAIT_INFINITE : 0);
+                if (queue_capture_result == K4A_WAIT_RESULT_SUCCEEDED)
+                {
+                    in_flight.push_back(capture_index);
+                    break;
+                }
+                if (queue_capture_result != K4A_WAIT_RESULT_TIMEOUT || !pop_body_frame(tracker, in_flight, chunk, on_frame))
+                {
+                    lock_guard<mutex> lock(g_console_mutex);
+                    cerr << "Predict joints failed for clip at " << time_usec << " usec" << endl;
+                    success = false;
+                    break;
+                }
+            }
+            k4a_capture_release(capture_handle);
+            captures_done++;
+        }
+
+        while (success && !in_flight.empty())
+        {
+            success = pop_body_frame(tracker, in_flight, chunk, on_frame);
+        }
+
+        k4abt_tracker_shutdown(tracker);
+        k4abt_tracker_destroy(tracker);
+        k4a_playback_close(playback_handle);
+        return success;
+    }
+
+    // Tracks a chunk into segments. With a checkpoint, the segments of earlier runs are read back from the part file of
+    // the chunk and tracking resumes after its last checkpointed frame; every frame is appended to the part file.
+    bool track_chunk_segments(const char* input_path, k4abt_tracker_configuration_t tracker_config, const TrackedChunk& range,
+                              size_t chunk_index, uint64_t start_timestamp_offset_usec, uint64_t warm_up_usec,
+                              const PlaybackSelection& selection, TrackingCheckpoint* checkpoint,
+                              vector<TrackedChunk>& segments, atomic<int>& captures_done)
+    {
+        TrackedChunk segment;
+        segment.StartUsec = range.StartUsec;
+        segment.EndUsec = range.EndUsec;
+        segment.WarmUpUsec = range.WarmUpUsec;
+        if (checkpoint == nullptr)
+        {
+            segment.Success = track_chunk(input_path, tracker_config, segment, selection, [](const TrackedFrame&) {}, captures_done);
+            segments.push_back(move(segment));
+            return segments.back().Success;
+        }
+
+        const ChunkProgress progress = checkpoint->GetProgress(chunk_index);
+        try
+        {
+            segments = checkpoint->LoadSegments(chunk_index, range);
+        }
+        catch (const exception& e)
+        {
+            lock_guard<mutex> lock(g_console_mutex);
+            cerr << "Cannot read " << checkpoint->GetPartFileName(chunk_index) << ", delete the checkpoint to start over: " << e.what() << endl;
+            return false;
+        }
+        if (progress.Done)
+        {
+            return true;
+        }
+
+        ofstream part_file(checkpoint->GetPartFileName(chunk_index), ios::binary | ios::app);
+        if (progress.CaptureCount > 0)
+        {
+            // The frames up to the checkpoint are the warm-up of the resumed tracker
+            const uint64_t last_usec = progress.LastTimestampUsec > start_timestamp_offset_usec ?
+                progress.LastTimestampUsec - start_timestamp_offset_usec : 0;
+            segment.StartUsec = last_usec + 1;
+            segment.WarmUpUsec = min(warm_up_usec, segment.StartUsec - selection.StartUsec);
+            TrackingCheckpoint::WriteResume(part_file, segment, progress.CaptureCount);
+            lock_guard<mutex> lock(g_console_mutex);
+            cout << "Chunk " << chunk_index << " resumes after capture " << progress.CaptureCount << endl;
+        }
+
+        ChunkProgress current = progress;
+        const int capture_base = progress.CaptureCount;
+        auto on_frame = [&](const TrackedFrame& frame) {
+            TrackingCheckpoint::WriteFrame(part_file, frame);
+            if (frame.CaptureIndex >= 0 && checkpoint->IsDue(chunk_index))
+            {
+                part_file.flush();
+                current.PartFileOffset = static_cast<uint64_t>(part_file.tellp());
+                current.LastTimestampUsec = frame.TimestampUsec;
+                current.CaptureCount = capture_base + frame.CaptureIndex + 1;
+                checkpoint->Update(chunk_index, current);
+            }
+        };
+        segment.Success = track_chunk(input_path, tracker_config, segment, selection, on_frame, captures_done) && part_file.flush();
+        if (segment.Success)
+        {
+            current.PartFileOffset = static_cast<uint64_t>(part_file.tellp());
+            current.CaptureCount = capture_base + segment.CaptureCount;
+            current.Done = true;
+            checkpoint->Update(chunk_index, current);
+        }
+        segments.push_back(move(segment));
+        return segments.back().Success;
+    }
+
+    // Frame with the timestamp in the frames of the chunks before chunk_index, whose ranges follow each other
+    const TrackedFrame* find_frame(const vector<TrackedChunk>& chunks, size_t chunk_index, uint64_t timestamp_usec)
+    {
+        for (size_t c = chunk_index; c-- > 0;)
+        {
+            const vector<TrackedFrame>& frames = chunks[c].Frames;
+            if (frames.empty() || frames.front().TimestampUsec > timestamp_usec)
+            {
+                continue;
+            }
+            auto frame = lower_bound(frames.begin(), frames.end(), timestamp_usec,
+                [](const TrackedFrame& f, uint64_t timestamp) { return f.TimestampUsec < timestamp; });
+            return frame != frames.end() && frame->TimestampUsec == timestamp_usec ? &*frame : nullptr;
+        }
+        return nullptr;
+    }
+
+    // Pairs the bodies of two frames with the same timestamp, closest pelvises first, and counts every pair
+    void vote_for_pairs(const TrackedFrame& previous, const TrackedFrame& frame, float max_distance_mm,
+                        map<pair<uint32_t, uint32_t>, int>& votes)
+    {
+        vector<tuple<float, size_t, size_t>> candidates;
+        for (size_t i = 0; i < frame.Bodies.size(); i++)
+        {
+            const k4a_float3_t& pelvis = frame.Bodies[i].skeleton.joints[K4ABT_JOINT_PELVIS].position;
+            for (size_t j = 0; j < previous.Bodies.size(); j++)
+            {
+                const k4a_float3_t& previous_pelvis = previous.Bodies[j].skeleton.joints[K4ABT_JOINT_PELVIS].position;
+                const float dx = pelvis.xyz.x - previous_pelvis.xyz.x;
+                const float dy = pelvis.xyz.y - previous_pelvis.xyz.y;
+                const float dz = pelvis.xyz.z - previous_pelvis.xyz.z;
+                const float distance = sqrt(dx * dx + dy * dy + dz * dz);
+                if (distance <= max_distance_mm)
+                {
+                    candidates.emplace_back(distance, i, j);
+                }
+            }
+        }
+        sort(candidates.begin(), candidates.end());
+
+        vector<bool> paired(frame.Bodies.size(), false);
+        vector<bool> previous_paired(previous.Bodies.size(), false);
+        for (const auto& [distance, i, j] : candidates)
+        {
+            if (!paired[i] && !previous_paired[j])
+            {
+                paired[i] = true;
+                previous_paired[j] = true;
+                votes[{ frame.Bodies[i].id, previous.Bodies[j].id }]++;
+            }
+        }
+    }
+}
+
+vector<TrackedChunk> track_mkv_in_chunks(const char* input_path,
+                                         k4abt_tracker_configuration_t tracker_config,
+                                         int chunk_count,
+                                         uint64_t warm_up_usec,
+                                         const PlaybackSelection& selection,
+                                         TrackingCheckpoint* checkpoint)
+{
+    k4a_playback_t playback_handle = nullptr;
+    if (k4a_playback_open(input_path, &playback_handle) != K4A_RESULT_SUCCEEDED)
+    {
+        cerr << "Cannot open recording at " << input_path << endl;
+        return {};
+    }
+    const uint64_t length_usec = k4a_playback_get_recording_length_usec(playback_handle);
+    k4a_record_configuration_t record_config;
+    const bool has_record_config = k4a_playback_get_record_configuration(playback_handle, &record_config) == K4A_RESULT_SUCCEEDED;
+    k4a_playback_close(playback_handle);
+    if (!has_record_config)
+    {
+        cerr << "Failed to get record configuration" << endl;
+        return {};
+    }
+
+    // The warm-ups stay in the selection, so that they only track selected captures
+    const uint64_t start_usec = min(selection.StartUsec, length_usec);
+    const uint64_t selected_usec = min(selection.EndUsec, length_usec) - start_usec;
+    chunk_count = max(chunk_count, 1);
+    vector<TrackedChunk> chunks(static_cast<size_t>(chunk_count));
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        chunks[i].StartUsec = start_usec + selected_usec * i / chunks.size();
+        chunks[i].EndUsec = i + 1 < chunks.size() ? start_usec + selected_usec * (i + 1) / chunks.size() : selection.EndUsec;
+        chunks[i].WarmUpUsec = min(warm_up_usec, chunks[i].StartUsec - start_usec);
+    }
+
+    cout << "Tracking " << input_path;
+    if (selection.IsRestricted())
+    {
+        cout << " from " << start_usec / 1000000.0 << " s to " << (start_usec + selected_usec) / 1000000.0 << " s";
+        if (selection.Stride > 1)
+        {
+            cout << ", every " << selection.Stride << ". frame";
+        }
+    }
+    if (chunks.size() > 1)
+    {
+        cout << " in " << chunks.size() << " chunks of " << selected_usec / chunks.size() / 1000000.0 << " s";
+    }
+    cout << endl;
+
+    atomic<int> captures_done(0);
+    atomic<size_t> chunks_done(0);
+    vector<vector<TrackedChunk>> segments(chunks.size());
+    vector<thread> workers;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        workers.emplace_back([&, i, input_path, tracker_config]() {
+            chunks[i].Success = track_chunk_segments(input_path, tracker_config, chunks[i], i, record_config.start_timestamp_offset_usec,
+                                                     warm_up_usec, selection, checkpoint, segments[i], captures_done);
+            chunks_done++;
+        });
+    }
+    while (chunks_done < chunks.size())
+    {
+        this_thread::sleep_for(chrono::milliseconds(200));
+        lock_guard<mutex> lock(g_console_mutex);
+        cout << "frame " << captures_done << '\r' << flush;
+    }
+    for (thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    if (!all_of(chunks.begin(), chunks.end(), [](const TrackedChunk& chunk) { return chunk.Success; }))
+    {
+        return {};
+    }
+
+    vector<TrackedChunk> stitched;
+    for (vector<TrackedChunk>& chunk_segments : segments)
+    {
+        move(chunk_segments.begin(), chunk_segments.end(), back_inserter(stitched));
+    }
+    relink_body_ids(stitched);
+    return stitched;
+}
+
+void relink_body_ids(vector<TrackedChunk>& chunks, float max_distance_mm)
+{
+    uint32_t next_id = 1;
+    for (size_t c = 0; c < chunks.size(); c++)
+    {
+        map<uint32_t, uint32_t> linked_ids;     // Id in this chunk to the id in the output
+        if (c > 0)
+        {
+            // Count the pairs of bodies in the overlap of the warm-up with the frames before it, which are usually the
+            // end of the previous chunk but can reach into earlier segments when the previous chunk was resumed
+            map<pair<uint32_t, uint32_t>, int> votes;
+            for (const TrackedFrame& frame : chunks[c].WarmUpFrames)
+            {
+                const TrackedFrame* previous_frame = find_frame(chunks, c, frame.TimestampUsec);
+                if (previous_frame != nullptr)
+                {
+                    vote_for_pairs(*previous_frame, frame, max_distance_mm, votes);
+                }
+            }
+
+            // Most frequent pairs first, every id of both chunks is linked once
+            vector<tuple<int, uint32_t, uint32_t>> ranked;
+            for (const auto& [ids, count] : votes)
+            {
+                ranked.emplace_back(count, ids.first, ids.second);
+            }
+            sort(ranked.begin(), ranked.end(), greater<>());
+            set<uint32_t> used_ids;
+            for (const auto& [count, id, previous_id] : ranked)
+            {
+                if (linked_ids.count(id) == 0 && used_ids.insert(previous_id).second)
+                {
+                    linked_ids[id] = previous_id;
+                }
+            }
+        }
+
+        // The first chunk keeps the ids of its tracker, persons that were not linked get new ids
+        for (vector<TrackedFrame>* frames : { &chunks[c].Frames, &chunks[c].WarmUpFrames })
+        {
+            for (TrackedFrame& frame : *frames)
+            {
+                for (k4abt_body_t& body : frame.Bodies)
+                {
+                    auto linked = linked_ids.find(body.id);
+                    if (linked == linked_ids.end())
+                    {
+                        linked = linked_ids.emplace(body.id, c == 0 ? body.id : next_id++).first;
+                    }
+                    body.id = linked->second;
+                    next_id = max(next_id, body.id + 1);
+                }
+            }
+        }
+    }
+}
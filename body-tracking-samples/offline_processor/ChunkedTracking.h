@@ -0,0 +1,52 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <k4abt.h>
+#include <PlaybackSelection.h>
+
+class TrackingCheckpoint;
+
+// Body tracking result of one capture
+struct TrackedFrame
+{
+    uint64_t TimestampUsec = 0;     // Device timestamp of the depth image
+    int CaptureIndex = 0;           // Index of the capture in its chunk, captures without depth image included
+    std::vector<k4abt_body_t> Bodies;
+};
+
+// One time range of a recording, tracked by its own tracker. Tracking starts WarmUpUsec before the range, so that
+// the tracker has found the bodies when the range starts; the frames of the warm-up are only kept to re-link the
+// body ids with the previous chunk.
+struct TrackedChunk
+{
+    uint64_t StartUsec = 0;         // Time since the start of the recording, end exclusive
+    uint64_t EndUsec = 0;
+    uint64_t WarmUpUsec = 0;
+    std::vector<TrackedFrame> WarmUpFrames;
+    std::vector<TrackedFrame> Frames;
+    int CaptureCount = 0;           // Captures in the range, with or without depth image
+    bool Success = false;
+};
+
+// Splits the selected time range of the recording into chunk_count ranges of equal length and tracks them in
+// parallel, every chunk on its own thread with its own playback and tracker. Captures outside of the stride of the
+// selection are read and counted, but not tracked. With a checkpoint, chunks resume where an earlier run stopped and
+// record their progress. The tracked segments are returned in order, one per chunk and one per resume of a chunk,
+// with body ids re-linked across their boundaries. Returns an empty vector if a chunk failed.
+std::vector<TrackedChunk> track_mkv_in_chunks(const char* input_path,
+                                              k4abt_tracker_configuration_t tracker_config,
+                                              int chunk_count,
+                                              uint64_t warm_up_usec,
+                                              const PlaybackSelection& selection,
+                                              TrackingCheckpoint* checkpoint = nullptr);
+
+// Gives every body the id of the same person in the previous chunk. Bodies of a chunk's warm-up frames are paired
+// with the bodies of the chunks before at the same timestamps by pelvis distance (closest first, at most
+// max_distance_mm), and each id takes the id it was paired with most often. Bodies without a match get new ids,
+// so an id never stands for two persons.
+void relink_body_ids(std::vector<TrackedChunk>& chunks, float max_distance_mm = 300.f);
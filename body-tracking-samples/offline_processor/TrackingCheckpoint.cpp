@@ -0,0 +1,209 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "TrackingCheckpoint.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+
+#include "BodyFrameJson.h"
+
+using namespace std;
+using namespace nlohmann;
+
+TrackingCheckpoint::TrackingCheckpoint(const string& output_path,
+                                       const string& input_path,
+                                       int chunk_count,
+                                       uint64_t warm_up_usec,
+                                       const PlaybackSelection& selection,
+                                       double interval_seconds)
+    : m_fileName(output_path + ".checkpoint")
+    , m_outputPath(output_path)
+    , m_inputPath(input_path)
+    , m_warmUpUsec(warm_up_usec)
+    , m_selection(selection)
+    , m_interval(chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(interval_seconds)))
+    , m_progress(static_cast<size_t>(max(chunk_count, 1)))
+    , m_lastUpdates(m_progress.size(), chrono::steady_clock::now())
+{
+    ifstream checkpoint_file(m_fileName);
+    if (!checkpoint_file.is_open())
+    {
+        return;
+    }
+
+    try
+    {
+        const json checkpoint = json::parse(checkpoint_file);
+        const json& chunks = checkpoint.at("chunks");
+        if (checkpoint.at("source_file").get<string>() != m_inputPath ||
+            checkpoint.at("warm_up_usec").get<uint64_t>() != m_warmUpUsec ||
+            checkpoint.at("start_usec").get<uint64_t>() != m_selection.StartUsec ||
+            checkpoint.at("end_usec").get<uint64_t>() != m_selection.EndUsec ||
+            checkpoint.at("stride").get<uint32_t>() != m_selection.Stride ||
+            chunks.size() != m_progress.size())
+        {
+            cout << "Checkpoint " << m_fileName << " is of another recording or chunking, starting over" << endl;
+            return;
+        }
+
+        for (size_t i = 0; i < m_progress.size(); i++)
+        {
+            m_progress[i].PartFileOffset = chunks[i].at("part_file_offset").get<uint64_t>();
+            m_progress[i].LastTimestampUsec = chunks[i].at("last_timestamp_usec").get<uint64_t>();
+            m_progress[i].CaptureCount = chunks[i].at("capture_count").get<int>();
+            m_progress[i].Done = chunks[i].at("done").get<bool>();
+        }
+        cout << "Resuming from checkpoint " << m_fileName << endl;
+    }
+    catch (const json::exception& e)
+    {
+        cerr << "Cannot read checkpoint " << m_fileName << ", starting over: " << e.what() << endl;
+        m_progress.assign(m_progress.size(), ChunkProgress());
+    }
+}
+
+string TrackingCheckpoint::GetPartFileName(size_t chunk) const
+{
+    return m_outputPath + ".part" + to_string(chunk);
+}
+
+ChunkProgress TrackingCheckpoint::GetProgress(size_t chunk) const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_progress[chunk];
+}
+
+vector<TrackedChunk> TrackingCheckpoint::LoadSegments(size_t chunk, const TrackedChunk& range) const
+{
+    const ChunkProgress progress = GetProgress(chunk);
+    const string part_file_name = GetPartFileName(chunk);
+
+    // Frames written after the last checkpoint are tracked again
+    error_code error;
+    if (filesystem::exists(part_file_name, error))
+    {
+        filesystem::resize_file(part_file_name, progress.PartFileOffset, error);
+    }
+    if (error || progress.CaptureCount == 0)
+    {
+        return {};
+    }
+
+    vector<TrackedChunk> segments(1);
+    segments[0].StartUsec = range.StartUsec;
+    segments[0].EndUsec = range.EndUsec;
+    segments[0].WarmUpUsec = range.WarmUpUsec;
+    vector<int> segment_capture_counts = { 0 };
+
+    ifstream part_file(part_file_name, ios::binary);
+    string line;
+    while (getline(part_file, line))
+    {
+        const json line_json = json::parse(line);
+        if (line_json.contains("resume_start_usec"))
+        {
+            TrackedChunk segment;
+            segment.StartUsec = line_json["resume_start_usec"].get<uint64_t>();
+            segment.EndUsec = range.EndUsec;
+            segment.WarmUpUsec = line_json["warm_up_usec"].get<uint64_t>();
+            segments.push_back(move(segment));
+            segment_capture_counts.push_back(line_json["capture_count"].get<int>());
+            continue;
+        }
+
+        TrackedFrame frame;
+        frame.TimestampUsec = line_json.at("timestamp_usec").get<uint64_t>();
+        frame.CaptureIndex = line_json.at("frame_id").get<int>();
+        frame.Bodies = body_frame_bodies_from_json(line_json);
+        (frame.CaptureIndex < 0 ? segments.back().WarmUpFrames : segments.back().Frames).push_back(move(frame));
+    }
+
+    // Every segment counted the captures after the previous resume
+    segment_capture_counts.push_back(progress.CaptureCount);
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        segments[i].CaptureCount = segment_capture_counts[i + 1] - segment_capture_counts[i];
+        segments[i].Success = true;
+    }
+    return segments;
+}
+
+bool TrackingCheckpoint::IsDue(size_t chunk) const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return chrono::steady_clock::now() - m_lastUpdates[chunk] >= m_interval;
+}
+
+void TrackingCheckpoint::Update(size_t chunk, const ChunkProgress& progress)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_progress[chunk] = progress;
+    m_lastUpdates[chunk] = chrono::steady_clock::now();
+    Save();
+}
+
+void TrackingCheckpoint::Remove()
+{
+    lock_guard<mutex> lock(m_mutex);
+    error_code error;
+    filesystem::remove(m_fileName, error);
+    for (size_t i = 0; i < m_progress.size(); i++)
+    {
+        filesystem::remove(GetPartFileName(i), error);
+    }
+}
+
+void TrackingCheckpoint::WriteFrame(ostream& part_file, const TrackedFrame& frame)
+{
+    part_file << body_frame_to_json(frame.TimestampUsec, frame.CaptureIndex, frame.Bodies).dump() << '\n';
+}
+
+void TrackingCheckpoint::WriteResume(ostream& part_file, const TrackedChunk& segment, int capture_count)
+{
+    json resume_json;
+    resume_json["resume_start_usec"] = segment.StartUsec;
+    resume_json["warm_up_usec"] = segment.WarmUpUsec;
+    resume_json["capture_count"] = capture_count;
+    part_file << resume_json.dump() << '\n';
+}
+
+void TrackingCheckpoint::Save() const
+{
+    json checkpoint;
+    checkpoint["source_file"] = m_inputPath;
+    checkpoint["warm_up_usec"] = m_warmUpUsec;
+    checkpoint["start_usec"] = m_selection.StartUsec;
+    checkpoint["end_usec"] = m_selection.EndUsec;
+    checkpoint["stride"] = m_selection.Stride;
+    checkpoint["chunks"] = json::array();
+    for (const ChunkProgress& progress : m_progress)
+    {
+        checkpoint["chunks"].push_back({ { "part_file_offset", progress.PartFileOffset },
+                                         { "last_timestamp_usec", progress.LastTimestampUsec },
+                                         { "capture_count", progress.CaptureCount },
+                                         { "done", progress.Done } });
+    }
+
+    // A crash while writing leaves the previous checkpoint intact
+    const string temporary_name = m_fileName + ".tmp";
+    {
+        ofstream checkpoint_file(temporary_name, ios::trunc);
+        checkpoint_file << checkpoint.dump(4) << endl;
+        if (!checkpoint_file)
+        {
+            cerr << "Failed to write checkpoint " << temporary_name << endl;
+            return;
+        }
+    }
+    error_code error;
+    filesystem::rename(temporary_name, m_fileName, error);
+    if (error)
+    {
+        cerr << "Failed to write checkpoint " << m_fileName << ": " << error.message() << endl;
+    }
+}
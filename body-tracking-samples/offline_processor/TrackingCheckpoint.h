@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ChunkedTracking.h"
+
+// Progress of one chunk as persisted in the checkpoint file
+struct ChunkProgress
+{
+    uint64_t PartFileOffset = 0;        // Size of the part file up to the last checkpointed frame
+    uint64_t LastTimestampUsec = 0;     // Device timestamp of that frame
+    int CaptureCount = 0;               // Captures of the chunk up to and including that frame, 0 before the first checkpoint
+    bool Done = false;                  // All frames of the chunk are in the part file
+};
+
+// Checkpoints of the chunks of one run of offline_processor, so that an interrupted run resumes where it stopped.
+//
+// Every chunk appends its frames as JSON lines to its own part file, <output>.part<chunk>. Once per interval a chunk
+// flushes its part file and records its size, the device timestamp of its last frame and its capture count; the
+// records of all chunks are written to <output>.checkpoint through a temporary file, so the checkpoint is never
+// partially written. A restarted run of the same recording with the same chunks truncates every part file to its
+// recorded size and tracks the chunk again from shortly before the recorded timestamp. The frames up to that
+// timestamp are a warm-up, which re-links the body ids of the new tracker as at a chunk boundary.
+class TrackingCheckpoint
+{
+public:
+    // Reads the checkpoint of output_path if it was written for the same recording, chunk count, warm-up and
+    // selection, otherwise all chunks start over
+    TrackingCheckpoint(const std::string& output_path,
+                       const std::string& input_path,
+                       int chunk_count,
+                       uint64_t warm_up_usec,
+                       const PlaybackSelection& selection,
+                       double interval_seconds);
+
+    std::string GetPartFileName(size_t chunk) const;
+    ChunkProgress GetProgress(size_t chunk) const;
+
+    // Truncates the part file of a chunk to its checkpointed size and reads back the segments tracked before: the
+    // first has the range of the chunk, every resume starts another one
+    std::vector<TrackedChunk> LoadSegments(size_t chunk, const TrackedChunk& range) const;
+
+    // True when the interval passed since the last checkpoint of the chunk
+    bool IsDue(size_t chunk) const;
+
+    // Records the progress of a chunk and writes the checkpoint file; the part file must be flushed
+    void Update(size_t chunk, const ChunkProgress& progress);
+
+    // Deletes the checkpoint and the part files once the output is written
+    void Remove();
+
+    static void WriteFrame(std::ostream& part_file, const TrackedFrame& frame);
+    static void WriteResume(std::ostream& part_file, const TrackedChunk& segment, int capture_count);
+
+private:
+    void Save() const;
+
+    std::string m_fileName;
+    std::string m_outputPath;
+    std::string m_inputPath;
+    uint64_t m_warmUpUsec;
+    PlaybackSelection m_selection;
+    std::chrono::steady_clock::duration m_interval;
+
+    mutable std::mutex m_mutex;
+    std::vector<ChunkProgress> m_progress;
+    std::vector<std::chrono::steady_clock::time_point> m_lastUpdates;
+};
@@ -5,106 +5,43 @@
 #include <fstream>
 #include <string>
 #include <iomanip>
+#include <memory>
+#include <vector>
 
 #include <k4a/k4a.h>
-#include <k4arecord/playback.h>
 #include <k4abt.h>
 #include <nlohmann/json.hpp>
 
 #include <BodyTrackingHelpers.h>
 #include <Utilities.h>
 
+#include "BodyFrameJson.h"
+#include "ChunkedTracking.h"
+#include "TrackingCheckpoint.h"
+
 using namespace std;
 using namespace nlohmann;
 
-bool predict_joints(json &frames_json, int frame_count, k4abt_tracker_t tracker, k4a_capture_t capture_handle)
-{
-    k4a_wait_result_t queue_capture_result = k4abt_tracker_enqueue_capture(tracker, capture_handle, K4A_WAIT_INFINITE);
-    if (queue_capture_result != K4A_WAIT_RESULT_SUCCEEDED)
-    {
-        cerr << "Error! Adding capture to tracker process queue failed!" << endl;
-        return false;
-    }
-
-    k4abt_frame_t body_frame = nullptr;
-    k4a_wait_result_t pop_frame_result = k4abt_tracker_pop_result(tracker, &body_frame, K4A_WAIT_INFINITE);
-    if (pop_frame_result != K4A_WAIT_RESULT_SUCCEEDED)
-    {
-        cerr << "Error! Popping body tracking result failed!" << endl;
-        return false;
-    }
-
-    uint32_t num_bodies = k4abt_frame_get_num_bodies(body_frame);
-    uint64_t timestamp = k4abt_frame_get_device_timestamp_usec(body_frame);
-
-    json frame_result_json;
-    frame_result_json["timestamp_usec"] = timestamp;
-    frame_result_json["frame_id"] = frame_count;
-    frame_result_json["num_bodies"] = num_bodies;
-    frame_result_json["bodies"] = json::array();
-    for (uint32_t i = 0; i < num_bodies; i++)
-    {
-        k4abt_skeleton_t skeleton;
-        VERIFY(k4abt_frame_get_body_skeleton(body_frame, i, &skeleton), "Get body from body frame failed!");
-        json body_result_json;
-        int body_id = k4abt_frame_get_body_id(body_frame, i);
-        body_result_json["body_id"] = body_id;
-
-        for (int j = 0; j < (int)K4ABT_JOINT_COUNT; j++)
-        {
-            body_result_json["joint_positions"].push_back( {    skeleton.joints[j].position.xyz.x,
-                                                                skeleton.joints[j].position.xyz.y,
-                                                                skeleton.joints[j].position.xyz.z });
-
-            body_result_json["joint_orientations"].push_back({  skeleton.joints[j].orientation.wxyz.w,
-                                                                skeleton.joints[j].orientation.wxyz.x,
-                                                                skeleton.joints[j].orientation.wxyz.y,
-                                                                skeleton.joints[j].orientation.wxyz.z });
-        }
-        frame_result_json["bodies"].push_back(body_result_json);
-    }
-    frames_json.push_back(frame_result_json);
-    k4abt_frame_release(body_frame);
-
-    return true;
-}
-
-bool check_depth_image_exists(k4a_capture_t capture)
+// Settings of the tracking of one recording
+struct ProcessingOptions
 {
-    k4a_image_t depth = k4a_capture_get_depth_image(capture);
-    if (depth != nullptr)
-    {
-        k4a_image_release(depth);
-        return true;
-    }
-    else
-    {
-        return false;
-    }
-}
+    int ChunkCount = 1;                 // Time ranges tracked in parallel, each by its own tracker
+    uint64_t WarmUpUsec = 2000000;      // Tracked before each range but the first, to re-link the body ids
+    double CheckpointSeconds = 30.0;    // Interval of the checkpoints, 0 to disable them
+    PlaybackSelection Selection;        // Part of the recording that is tracked
+};
 
-bool process_mkv_offline(const char* input_path, const char* output_path, k4abt_tracker_configuration_t tracker_config = K4ABT_TRACKER_CONFIG_DEFAULT )
+bool process_mkv_offline(const char* input_path, const char* output_path, k4abt_tracker_configuration_t tracker_config, const ProcessingOptions& options)
 {
-    k4a_playback_t playback_handle = nullptr;
-    k4a_result_t result = k4a_playback_open(input_path, &playback_handle);
-    if (result != K4A_RESULT_SUCCEEDED)
-    {
-        cerr << "Cannot open recording at " << input_path << endl;
-        return false;
-    }
-
-    k4a_calibration_t calibration;
-    result = k4a_playback_get_calibration(playback_handle, &calibration);
-    if (result != K4A_RESULT_SUCCEEDED)
+    unique_ptr<TrackingCheckpoint> checkpoint;
+    if (options.CheckpointSeconds > 0)
     {
-        cerr << "Failed to get calibration" << endl;
-        return false;
+        checkpoint = make_unique<TrackingCheckpoint>(output_path, input_path, options.ChunkCount, options.WarmUpUsec, options.Selection, options.CheckpointSeconds);
     }
 
-    k4abt_tracker_t tracker = NULL;
-    if (K4A_RESULT_SUCCEEDED != k4abt_tracker_create(&calibration, tracker_config, &tracker))
+    vector<TrackedChunk> chunks = track_mkv_in_chunks(input_path, tracker_config, options.ChunkCount, options.WarmUpUsec, options.Selection, checkpoint.get());
+    if (chunks.empty())
     {
-        cerr << "Body tracker initialization failed!" << endl;
         return false;
     }
 
@@ -116,90 +53,67 @@ bool process_mkv_offline(const char* input_path, const char* output_path, k4abt_
     json_output["joint_names"] = json::array();
     for (int i = 0; i < (int)K4ABT_JOINT_COUNT; i++)
     {
-        json_output["joint_names"].push_back(g_jointNames.find((k4abt_joint_id_t)i)->second);
+        json_output["joint_names"].push_back(std::string(g_jointNames[i]));
     }
 
     // Store all bone linkings to the json
     json_output["bone_list"] = json::array();
     for (int i = 0; i < (int)g_boneList.size(); i++)
     {
-        json_output["bone_list"].push_back({ g_jointNames.find(g_boneList[i].first)->second,
-                                             g_jointNames.find(g_boneList[i].second)->second });
+        json_output["bone_list"].push_back({ std::string(g_jointNames[g_boneList[i].first]),
+                                             std::string(g_jointNames[g_boneList[i].second]) });
     }
 
-    cout << "Tracking " << input_path << endl;
-
+    // Stitch the chunks in order, frame ids count the captures since the start of the selected range
     int frame_count = 0;
     json frames_json = json::array();
-    bool success = true;
-    while (true)
+    for (const TrackedChunk& chunk : chunks)
     {
-        k4a_capture_t capture_handle = nullptr;
-        k4a_stream_result_t stream_result = k4a_playback_get_next_capture(playback_handle, &capture_handle);
-        if (stream_result == K4A_STREAM_RESULT_EOF)
+        for (const TrackedFrame& frame : chunk.Frames)
         {
-            break;
+            frames_json.push_back(body_frame_to_json(frame.TimestampUsec, frame_count + frame.CaptureIndex, frame.Bodies));
         }
+        frame_count += chunk.CaptureCount;
+    }
 
-        cout << "frame " << frame_count << '\r';
-        if (stream_result == K4A_STREAM_RESULT_SUCCEEDED)
-        {
-            // Only try to predict joints when capture contains depth image
-            if (check_depth_image_exists(capture_handle))
-            {
-                success = predict_joints(frames_json, frame_count, tracker, capture_handle);
-                k4a_capture_release(capture_handle);
-                if (!success)
-                {
-                    cerr << "Predict joints failed for clip at frame " << frame_count << endl;
-                    break;
-                }
-            }
-        }
-        else
-        {
-            success = false;
-            cerr << "Stream error for clip at frame " << frame_count << endl;
-            break;
-        }
+    json_output["frames"] = frames_json;
+    cout << endl << "DONE " << endl;
 
-        frame_count++;
+    cout << "Total read " << frame_count << " frames" << endl;
+    std::ofstream output_file(output_path);
+    output_file << std::setw(4) << json_output << std::endl;
+    if (!output_file)
+    {
+        cerr << "Failed to write " << output_path << endl;
+        return false;
     }
+    cout << "Results saved in " << output_path;
 
-    if (success)
+    // The checkpoint is kept until the output is complete
+    if (checkpoint)
     {
-        json_output["frames"] = frames_json;
-        cout << endl << "DONE " << endl;
-
-        cout << "Total read " << frame_count << " frames" << endl;
-        std::ofstream output_file(output_path);
-        output_file << std::setw(4) << json_output << std::endl;
-        cout << "Results saved in " << output_path;
+        checkpoint->Remove();
     }
-
-    k4abt_tracker_shutdown(tracker);
-    k4abt_tracker_destroy(tracker);
-    k4a_playback_close(playback_handle);
-
-    return success;
+    return true;
 }
 
 void PrintUsage()
 {
 #ifdef _WIN32
-    cout << "Usage: k4abt_offline_processor.exe <input_mkv_file> <output_json_file> [processing_mode] [-model MODEL_FILE_PATH]\n\t[Optional] processing_mode\n\t\tCPU\n\t\tCUDA\n\t\tTensorRT\n\t\tDirectML ( default )" << endl;
+    cout << "Usage: k4abt_offline_processor.exe <input_mkv_file> <output_json_file> [processing_mode] [-model MODEL_FILE_PATH] [-chunks K] [-warmup SECONDS] [-checkpoint SECONDS] [-start SECONDS] [-end SECONDS] [-stride N] [-skipcolor]\n\t[Optional] processing_mode\n\t\tCPU\n\t\tCUDA\n\t\tTensorRT\n\t\tDirectML ( default )\n\t[Optional] -chunks K: track K time ranges of the recording in parallel ( default 1 )\n\t[Optional] -warmup SECONDS: tracked before each range to re-link body ids ( default 2 )\n\t[Optional] -checkpoint SECONDS: interval of the checkpoints to resume from, 0 to disable ( default 30 )\n\t[Optional] -start SECONDS, -end SECONDS: track only this time range of the recording\n\t[Optional] -stride N: track every Nth frame of the range ( default 1 )\n\t[Optional] -skipcolor: drop the color images as they are read" << endl;
 #else
-    cout << "Usage: k4abt_offline_processor.exe <input_mkv_file> <output_json_file> [processing_mode] [-model MODEL_FILE_PATH]\n\t[Optional] processing_mode\n\t\tCPU\n\t\tCUDA ( default )\n\t\tTensorRT" << endl;
+    cout << "Usage: k4abt_offline_processor.exe <input_mkv_file> <output_json_file> [processing_mode] [-model MODEL_FILE_PATH] [-chunks K] [-warmup SECONDS] [-checkpoint SECONDS] [-start SECONDS] [-end SECONDS] [-stride N] [-skipcolor]\n\t[Optional] processing_mode\n\t\tCPU\n\t\tCUDA ( default )\n\t\tTensorRT\n\t[Optional] -chunks K: track K time ranges of the recording in parallel ( default 1 )\n\t[Optional] -warmup SECONDS: tracked before each range to re-link body ids ( default 2 )\n\t[Optional] -checkpoint SECONDS: interval of the checkpoints to resume from, 0 to disable ( default 30 )\n\t[Optional] -start SECONDS, -end SECONDS: track only this time range of the recording\n\t[Optional] -stride N: track every Nth frame of the range ( default 1 )\n\t[Optional] -skipcolor: drop the color images as they are read" << endl;
 #endif
 }
 
-bool ProcessArguments(k4abt_tracker_configuration_t &tracker_config, int argc, char** argv)
+bool ProcessArguments(k4abt_tracker_configuration_t &tracker_config, ProcessingOptions &options, int argc, char** argv)
 {
     if (argc < 3)
     {
         PrintUsage();
         return false;
     }
+    bool selection_valid = true;
     for( int i = 3; i < argc; i++ )
     {
         if (0 == strcmp(argv[i], "TensorRT"))
@@ -231,6 +145,36 @@ bool ProcessArguments(k4abt_tracker_configuration_t &tracker_config, int argc, c
                 return false;
             }
         }
+        else if (0 == strcmp(argv[i], "-chunks") && i < argc - 1)
+        {
+            options.ChunkCount = atoi(argv[++i]);
+            if (options.ChunkCount < 1)
+            {
+                printf("Error: the number of chunks must be at least 1\n");
+                return false;
+            }
+        }
+        else if (0 == strcmp(argv[i], "-warmup") && i < argc - 1)
+        {
+            const double warm_up_seconds = atof(argv[++i]);
+            if (warm_up_seconds < 0)
+            {
+                printf("Error: the warm-up must not be negative\n");
+                return false;
+            }
+            options.WarmUpUsec = static_cast<uint64_t>(warm_up_seconds * 1000000.0);
+        }
+        else if (0 == strcmp(argv[i], "-checkpoint") && i < argc - 1)
+        {
+            options.CheckpointSeconds = atof(argv[++i]);
+        }
+        else if (ParsePlaybackSelectionArg(argc, argv, i, options.Selection, selection_valid))
+        {
+            if (!selection_valid)
+            {
+                return false;
+            }
+        }
         else
         {
             PrintUsage();
@@ -243,7 +187,8 @@ bool ProcessArguments(k4abt_tracker_configuration_t &tracker_config, int argc, c
 int main(int argc, char **argv)
 {
     k4abt_tracker_configuration_t tracker_config = K4ABT_TRACKER_CONFIG_DEFAULT;
-    if (!ProcessArguments(tracker_config, argc, argv))
+    ProcessingOptions options;
+    if (!ProcessArguments(tracker_config, options, argc, argv))
         return -1;
-    return process_mkv_offline(argv[1], argv[2], tracker_config) ? 0 : -1;
+    return process_mkv_offline(argv[1], argv[2], tracker_config, options) ? 0 : -1;
 }
@@ -0,0 +1,136 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Counts heap allocations made through the global operator new, to check that a steady-state
+// per-frame pipeline does not allocate. This includes the aligned overloads used for over-aligned types,
+// but not memory that libraries take from malloc directly, such as the dynamic size matrices and arrays
+// of Eigen.
+//
+// The counter is always available. It is only incremented when exactly one translation unit of the
+// program defines K4A_SAMPLES_COUNT_ALLOCATIONS before including this header; that translation unit
+// then provides replacements of the global operator new and delete.
+//
+//     const size_t before = GetAllocationCount();
+//     ... per-frame work ...
+//     const size_t allocations = GetAllocationCount() - before;
+
+inline std::atomic<size_t> g_allocationCount{ 0 };
+
+inline size_t GetAllocationCount()
+{
+    return g_allocationCount.load(std::memory_order_relaxed);
+}
+
+#ifdef K4A_SAMPLES_COUNT_ALLOCATIONS
+
+void* operator new(std::size_t size)
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// Over-aligned types. Memory from _aligned_malloc must be released with _aligned_free, so these are only
+// paired with the aligned deletes below.
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    const std::size_t alignedSize = (size + align - 1) / align * align;
+#ifdef _WIN32
+    return _aligned_malloc(alignedSize == 0 ? align : alignedSize, align);
+#else
+    return std::aligned_alloc(align, alignedSize == 0 ? align : alignedSize);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* p = operator new(size, alignment, std::nothrow))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, alignment, tag);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
+
+#endif
@@ -4,14 +4,18 @@
 #pragma once
 
 #include <array>
-#include <unordered_map>
-#include <k4abttypes.h>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <k4abttypes.h>
 
-#include <string>
+// All tables below are indexed by k4abt_joint_id_t and built at compile time, so looking up a joint
+// name or a neighbor is plain array indexing with no hashing and no static initialization.
 
 // Define the bone list based on the documentation
-const std::array<std::pair<k4abt_joint_id_t, k4abt_joint_id_t>, 31> g_boneList =
+constexpr std::array<std::pair<k4abt_joint_id_t, k4abt_joint_id_t>, 31> g_boneList =
 {
     std::make_pair(K4ABT_JOINT_SPINE_CHEST, K4ABT_JOINT_SPINE_NAVEL),
     std::make_pair(K4ABT_JOINT_SPINE_NAVEL, K4ABT_JOINT_PELVIS),
@@ -48,43 +52,123 @@ const std::array<std::pair<k4abt_joint_id_t, k4abt_joint_id_t>, 31> g_boneList =
     std::make_pair(K4ABT_JOINT_EYE_RIGHT, K4ABT_JOINT_EAR_RIGHT)
 };
 
-// Define the joint string names
-const std::unordered_map<k4abt_joint_id_t, std::string> g_jointNames =
+// Define the joint string names, in the order of k4abt_joint_id_t
+constexpr std::array<std::string_view, K4ABT_JOINT_COUNT> g_jointNames =
+{
+    "PELVIS",
+    "SPINE_NAVEL",
+    "SPINE_CHEST",
+    "NECK",
+    "CLAVICLE_LEFT",
+    "SHOULDER_LEFT",
+    "ELBOW_LEFT",
+    "WRIST_LEFT",
+    "HAND_LEFT",
+    "HANDTIP_LEFT",
+    "THUMB_LEFT",
+    "CLAVICLE_RIGHT",
+    "SHOULDER_RIGHT",
+    "ELBOW_RIGHT",
+    "WRIST_RIGHT",
+    "HAND_RIGHT",
+    "HANDTIP_RIGHT",
+    "THUMB_RIGHT",
+    "HIP_LEFT",
+    "KNEE_LEFT",
+    "ANKLE_LEFT",
+    "FOOT_LEFT",
+    "HIP_RIGHT",
+    "KNEE_RIGHT",
+    "ANKLE_RIGHT",
+    "FOOT_RIGHT",
+    "HEAD",
+    "NOSE",
+    "EYE_LEFT",
+    "EAR_LEFT",
+    "EYE_RIGHT",
+    "EAR_RIGHT"
+};
+static_assert(g_jointNames[K4ABT_JOINT_HIP_LEFT] == "HIP_LEFT" && g_jointNames[K4ABT_JOINT_EAR_RIGHT] == "EAR_RIGHT",
+    "g_jointNames must follow the order of k4abt_joint_id_t");
+
+// Parent of every joint in the joint hierarchy of the documentation. The pelvis is the root, its parent is K4ABT_JOINT_COUNT.
+constexpr std::array<k4abt_joint_id_t, K4ABT_JOINT_COUNT> g_jointParents =
 {
-    std::make_pair(K4ABT_JOINT_PELVIS,        "PELVIS"),
-    std::make_pair(K4ABT_JOINT_SPINE_NAVEL,   "SPINE_NAVEL"),
-    std::make_pair(K4ABT_JOINT_SPINE_CHEST,   "SPINE_CHEST"),
-    std::make_pair(K4ABT_JOINT_NECK,          "NECK"),
-    std::make_pair(K4ABT_JOINT_CLAVICLE_LEFT, "CLAVICLE_LEFT"),
-    std::make_pair(K4ABT_JOINT_SHOULDER_LEFT, "SHOULDER_LEFT"),
-    std::make_pair(K4ABT_JOINT_ELBOW_LEFT,    "ELBOW_LEFT"),
-    std::make_pair(K4ABT_JOINT_WRIST_LEFT,    "WRIST_LEFT"),
-    std::make_pair(K4ABT_JOINT_HAND_LEFT,     "HAND_LEFT"),
-    std::make_pair(K4ABT_JOINT_HANDTIP_LEFT,  "HANDTIP_LEFT"),
-    std::make_pair(K4ABT_JOINT_THUMB_LEFT,    "THUMB_LEFT"),
-    std::make_pair(K4ABT_JOINT_CLAVICLE_RIGHT,"CLAVICLE_RIGHT"),
-    std::make_pair(K4ABT_JOINT_SHOULDER_RIGHT,"SHOULDER_RIGHT"),
-    std::make_pair(K4ABT_JOINT_ELBOW_RIGHT,   "ELBOW_RIGHT"),
-    std::make_pair(K4ABT_JOINT_WRIST_RIGHT,   "WRIST_RIGHT"),
-    std::make_pair(K4ABT_JOINT_HAND_RIGHT,    "HAND_RIGHT"),
-    std::make_pair(K4ABT_JOINT_HANDTIP_RIGHT, "HANDTIP_RIGHT"),
-    std::make_pair(K4ABT_JOINT_THUMB_RIGHT,   "THUMB_RIGHT"),
-    std::make_pair(K4ABT_JOINT_HIP_LEFT,      "HIP_LEFT"),
-    std::make_pair(K4ABT_JOINT_KNEE_LEFT,     "KNEE_LEFT"),
-    std::make_pair(K4ABT_JOINT_ANKLE_LEFT,    "ANKLE_LEFT"),
-    std::make_pair(K4ABT_JOINT_FOOT_LEFT,     "FOOT_LEFT"),
-    std::make_pair(K4ABT_JOINT_HIP_RIGHT,     "HIP_RIGHT"),
-    std::make_pair(K4ABT_JOINT_KNEE_RIGHT,    "KNEE_RIGHT"),
-    std::make_pair(K4ABT_JOINT_ANKLE_RIGHT,   "ANKLE_RIGHT"),
-    std::make_pair(K4ABT_JOINT_FOOT_RIGHT,    "FOOT_RIGHT"),
-    std::make_pair(K4ABT_JOINT_HEAD,          "HEAD"),
-    std::make_pair(K4ABT_JOINT_NOSE,          "NOSE"),
-    std::make_pair(K4ABT_JOINT_EYE_LEFT,      "EYE_LEFT"),
-    std::make_pair(K4ABT_JOINT_EAR_LEFT,      "EAR_LEFT"),
-    std::make_pair(K4ABT_JOINT_EYE_RIGHT,     "EYE_RIGHT"),
-    std::make_pair(K4ABT_JOINT_EAR_RIGHT,     "EAR_RIGHT")
+    K4ABT_JOINT_COUNT,              // PELVIS
+    K4ABT_JOINT_PELVIS,             // SPINE_NAVEL
+    K4ABT_JOINT_SPINE_NAVEL,        // SPINE_CHEST
+    K4ABT_JOINT_SPINE_CHEST,        // NECK
+    K4ABT_JOINT_SPINE_CHEST,        // CLAVICLE_LEFT
+    K4ABT_JOINT_CLAVICLE_LEFT,      // SHOULDER_LEFT
+    K4ABT_JOINT_SHOULDER_LEFT,      // ELBOW_LEFT
+    K4ABT_JOINT_ELBOW_LEFT,         // WRIST_LEFT
+    K4ABT_JOINT_WRIST_LEFT,         // HAND_LEFT
+    K4ABT_JOINT_HAND_LEFT,          // HANDTIP_LEFT
+    K4ABT_JOINT_WRIST_LEFT,         // THUMB_LEFT
+    K4ABT_JOINT_SPINE_CHEST,        // CLAVICLE_RIGHT
+    K4ABT_JOINT_CLAVICLE_RIGHT,     // SHOULDER_RIGHT
+    K4ABT_JOINT_SHOULDER_RIGHT,     // ELBOW_RIGHT
+    K4ABT_JOINT_ELBOW_RIGHT,        // WRIST_RIGHT
+    K4ABT_JOINT_WRIST_RIGHT,        // HAND_RIGHT
+    K4ABT_JOINT_HAND_RIGHT,         // HANDTIP_RIGHT
+    K4ABT_JOINT_WRIST_RIGHT,        // THUMB_RIGHT
+    K4ABT_JOINT_PELVIS,             // HIP_LEFT
+    K4ABT_JOINT_HIP_LEFT,           // KNEE_LEFT
+    K4ABT_JOINT_KNEE_LEFT,          // ANKLE_LEFT
+    K4ABT_JOINT_ANKLE_LEFT,         // FOOT_LEFT
+    K4ABT_JOINT_PELVIS,             // HIP_RIGHT
+    K4ABT_JOINT_HIP_RIGHT,          // KNEE_RIGHT
+    K4ABT_JOINT_KNEE_RIGHT,         // ANKLE_RIGHT
+    K4ABT_JOINT_ANKLE_RIGHT,        // FOOT_RIGHT
+    K4ABT_JOINT_NECK,               // HEAD
+    K4ABT_JOINT_HEAD,               // NOSE
+    K4ABT_JOINT_HEAD,               // EYE_LEFT
+    K4ABT_JOINT_HEAD,               // EAR_LEFT
+    K4ABT_JOINT_HEAD,               // EYE_RIGHT
+    K4ABT_JOINT_HEAD                // EAR_RIGHT
 };
 
+// Joints connected by a bone of g_boneList, in compressed form: the neighbors of joint j are
+// Neighbors[Offsets[j]] ... Neighbors[Offsets[j + 1] - 1], and the bone to the i-th of them is Bones[i].
+struct JointAdjacency
+{
+    std::array<uint8_t, K4ABT_JOINT_COUNT + 1> Offsets{};
+    std::array<k4abt_joint_id_t, 2 * g_boneList.size()> Neighbors{};
+    std::array<uint8_t, 2 * g_boneList.size()> Bones{};
+};
+
+constexpr JointAdjacency MakeJointAdjacency()
+{
+    JointAdjacency adjacency;
+    for (const auto& bone : g_boneList)
+    {
+        adjacency.Offsets[bone.first + 1]++;
+        adjacency.Offsets[bone.second + 1]++;
+    }
+    for (size_t joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        adjacency.Offsets[joint + 1] += adjacency.Offsets[joint];
+    }
+
+    std::array<uint8_t, K4ABT_JOINT_COUNT> filled{};
+    for (size_t bone = 0; bone < g_boneList.size(); bone++)
+    {
+        const k4abt_joint_id_t first = g_boneList[bone].first;
+        const k4abt_joint_id_t second = g_boneList[bone].second;
+
+        const size_t firstSlot = adjacency.Offsets[first] + filled[first]++;
+        adjacency.Neighbors[firstSlot] = second;
+        adjacency.Bones[firstSlot] = static_cast<uint8_t>(bone);
+
+        const size_t secondSlot = adjacency.Offsets[second] + filled[second]++;
+        adjacency.Neighbors[secondSlot] = first;
+        adjacency.Bones[secondSlot] = static_cast<uint8_t>(bone);
+    }
+    return adjacency;
+}
+
+constexpr JointAdjacency g_jointAdjacency = MakeJointAdjacency();
+
 struct Color
 {
     float r = 1.f;
@@ -0,0 +1,165 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+
+// Maps device timestamps (k4a_image_get_device_timestamp_usec, the center of the exposure on the clock of the
+// device) to the host clock of the system timestamps (k4a_image_get_system_timestamp_nsec, when the host received
+// the image). The SDK takes system timestamps from the monotonic clock of the host: CLOCK_MONOTONIC on Linux and
+// QueryPerformanceCounter on Windows, the clocks of std::chrono::steady_clock.
+//
+// Every image gives one sample of system - device time, which is the clock offset plus the transfer time of that
+// image. The transfer time only adds jitter on top of its minimum, so the estimate follows the lower envelope:
+// the minimum of every block of samples, fitted with a line over the last blocks for the drift between the two
+// clocks, and shifted to lie below all of them. The mapped exposure time is therefore the latest one that is
+// consistent with all observed images; it is early by the minimum transfer time, which cannot be observed.
+//
+// Not thread safe, feed and query it from the capture thread.
+class DeviceClockCorrelator
+{
+public:
+    // blockSize samples per envelope point (30: one second at 30 fps), fitted over the last blockCount points
+    explicit DeviceClockCorrelator(size_t blockSize = 30, size_t blockCount = 60)
+        : m_blockSize(std::max<size_t>(blockSize, 1))
+        , m_blockCount(std::max<size_t>(blockCount, 2))
+    {
+    }
+
+    void AddSample(uint64_t deviceTimestampUsec, uint64_t systemTimestampNsec)
+    {
+        if (systemTimestampNsec == 0)
+        {
+            // Recordings have no system timestamps
+            return;
+        }
+        if (m_sampleCount != 0 && deviceTimestampUsec < m_lastDeviceUsec)
+        {
+            // The device clock restarts with the cameras
+            Reset();
+        }
+        m_lastDeviceUsec = deviceTimestampUsec;
+        m_sampleCount++;
+
+        const double deviceUsec = static_cast<double>(deviceTimestampUsec);
+        const double offsetUsec = static_cast<double>(systemTimestampNsec) / 1000.0 - deviceUsec;
+        if (m_blockSamples == 0 || offsetUsec < m_blockMinimum.OffsetUsec)
+        {
+            m_blockMinimum = { deviceUsec, offsetUsec };
+        }
+        if (++m_blockSamples == m_blockSize)
+        {
+            m_envelope.push_back(m_blockMinimum);
+            if (m_envelope.size() > m_blockCount)
+            {
+                m_envelope.pop_front();
+            }
+            m_blockSamples = 0;
+            Fit();
+        }
+        else if (m_envelope.empty())
+        {
+            // Until the first block is complete, its running minimum is the estimate
+            m_referenceDeviceUsec = m_blockMinimum.DeviceUsec;
+            m_referenceOffsetUsec = m_blockMinimum.OffsetUsec;
+        }
+        else
+        {
+            // A sample below the line lowers it right away, so no image seems to arrive before its exposure
+            const double predictedUsec = m_referenceOffsetUsec + m_drift * (deviceUsec - m_referenceDeviceUsec);
+            m_referenceOffsetUsec -= std::max(0.0, predictedUsec - offsetUsec);
+        }
+    }
+
+    bool IsValid() const { return m_sampleCount != 0; }
+
+    // Host time in nanoseconds of a device timestamp, 0 while no sample was added
+    uint64_t ToHostNsec(uint64_t deviceTimestampUsec) const
+    {
+        if (!IsValid())
+        {
+            return 0;
+        }
+        const double deviceUsec = static_cast<double>(deviceTimestampUsec);
+        const double hostUsec = deviceUsec + m_referenceOffsetUsec + m_drift * (deviceUsec - m_referenceDeviceUsec);
+        return hostUsec > 0 ? static_cast<uint64_t>(hostUsec * 1000.0) : 0;
+    }
+
+    // Rate difference of the clocks in parts per million, positive if the host clock runs faster
+    double GetDriftPpm() const { return m_drift * 1e6; }
+
+    // System - device time in microseconds at the latest envelope point
+    double GetOffsetUsec() const { return m_referenceOffsetUsec; }
+
+    void Reset()
+    {
+        m_envelope.clear();
+        m_blockSamples = 0;
+        m_sampleCount = 0;
+        m_drift = 0.0;
+        m_referenceDeviceUsec = 0.0;
+        m_referenceOffsetUsec = 0.0;
+    }
+
+private:
+    struct EnvelopePoint
+    {
+        double DeviceUsec;
+        double OffsetUsec;
+    };
+
+    // Least squares line through the envelope, lowered until no envelope point is below it
+    void Fit()
+    {
+        const EnvelopePoint& latest = m_envelope.back();
+        double drift = 0.0;
+        if (m_envelope.size() >= 2)
+        {
+            double meanX = 0.0;
+            double meanY = 0.0;
+            for (const EnvelopePoint& point : m_envelope)
+            {
+                meanX += point.DeviceUsec - latest.DeviceUsec;
+                meanY += point.OffsetUsec;
+            }
+            meanX /= static_cast<double>(m_envelope.size());
+            meanY /= static_cast<double>(m_envelope.size());
+
+            double covariance = 0.0;
+            double variance = 0.0;
+            for (const EnvelopePoint& point : m_envelope)
+            {
+                const double dx = point.DeviceUsec - latest.DeviceUsec - meanX;
+                covariance += dx * (point.OffsetUsec - meanY);
+                variance += dx * dx;
+            }
+            drift = variance > 0.0 ? covariance / variance : 0.0;
+        }
+
+        double lowest = std::numeric_limits<double>::max();
+        for (const EnvelopePoint& point : m_envelope)
+        {
+            lowest = std::min(lowest, point.OffsetUsec - drift * (point.DeviceUsec - latest.DeviceUsec));
+        }
+
+        m_drift = drift;
+        m_referenceDeviceUsec = latest.DeviceUsec;
+        m_referenceOffsetUsec = lowest;
+    }
+
+    size_t m_blockSize;
+    size_t m_blockCount;
+    std::deque<EnvelopePoint> m_envelope;
+    EnvelopePoint m_blockMinimum{ 0.0, 0.0 };
+    size_t m_blockSamples = 0;
+    uint64_t m_sampleCount = 0;
+    uint64_t m_lastDeviceUsec = 0;
+
+    double m_drift = 0.0;
+    double m_referenceDeviceUsec = 0.0;
+    double m_referenceOffsetUsec = 0.0;
+};
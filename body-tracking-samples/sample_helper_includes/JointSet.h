@@ -0,0 +1,136 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+#include <k4abttypes.h>
+
+// Compile-time subset of the skeleton joints, given as a bitmask of k4abt_joint_id_t.
+//
+// Exporters, filters and calculators that take a JointSet as template parameter only touch the joints
+// of the set: Count and Ids are constants, so their loops have a fixed trip count over a dense index
+// array and ForEach is unrolled by the compiler.
+//
+//     using Arms = JointSet<JointMask({ K4ABT_JOINT_SHOULDER_LEFT, K4ABT_JOINT_ELBOW_LEFT, K4ABT_JOINT_WRIST_LEFT })>;
+//     Arms::ForEach([&](k4abt_joint_id_t joint) { ... });
+
+static_assert(K4ABT_JOINT_COUNT <= 32, "A joint set is a 32 bit mask");
+
+constexpr uint32_t JointMask(std::initializer_list<k4abt_joint_id_t> joints)
+{
+    uint32_t mask = 0;
+    for (k4abt_joint_id_t joint : joints)
+    {
+        mask |= 1u << joint;
+    }
+    return mask;
+}
+
+constexpr uint32_t AllJointsMask = K4ABT_JOINT_COUNT == 32 ? 0xFFFFFFFFu : (1u << K4ABT_JOINT_COUNT) - 1;
+
+constexpr size_t CountJoints(uint32_t mask)
+{
+    size_t count = 0;
+    for (; mask != 0; mask &= mask - 1)
+    {
+        count++;
+    }
+    return count;
+}
+
+template <size_t Count>
+constexpr std::array<k4abt_joint_id_t, Count> GetJointIds(uint32_t mask)
+{
+    std::array<k4abt_joint_id_t, Count> ids{};
+    size_t index = 0;
+    for (uint32_t joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        if (((mask >> joint) & 1u) != 0)
+        {
+            ids[index++] = static_cast<k4abt_joint_id_t>(joint);
+        }
+    }
+    return ids;
+}
+
+template <uint32_t Mask>
+struct JointSet
+{
+    static_assert((Mask & ~AllJointsMask) == 0, "Joint set contains an invalid joint id");
+
+    static constexpr uint32_t Bits = Mask;
+    static constexpr size_t Count = CountJoints(Mask);
+
+    // Joint ids of the set in ascending order
+    static constexpr std::array<k4abt_joint_id_t, Count> Ids = GetJointIds<Count>(Mask);
+
+    static constexpr bool Contains(k4abt_joint_id_t joint)
+    {
+        return ((Mask >> joint) & 1u) != 0;
+    }
+
+    static constexpr bool IsFull()
+    {
+        return Mask == AllJointsMask;
+    }
+
+    // Call function(k4abt_joint_id_t) for every joint of the set, unrolled
+    template <typename Function>
+    static void ForEach(Function&& function)
+    {
+        ForEach(function, std::make_index_sequence<Count>());
+    }
+
+private:
+    template <typename Function, size_t... Index>
+    static void ForEach(Function& function, std::index_sequence<Index...>)
+    {
+        (function(Ids[Index]), ...);
+    }
+};
+
+// Ready-made profiles
+namespace JointProfiles
+{
+    using Full = JointSet<AllJointsMask>;
+
+    // Trunk, head and arms down to the hands
+    using UpperBody = JointSet<JointMask({
+        K4ABT_JOINT_PELVIS, K4ABT_JOINT_SPINE_NAVEL, K4ABT_JOINT_SPINE_CHEST, K4ABT_JOINT_NECK, K4ABT_JOINT_HEAD,
+        K4ABT_JOINT_CLAVICLE_LEFT, K4ABT_JOINT_SHOULDER_LEFT, K4ABT_JOINT_ELBOW_LEFT, K4ABT_JOINT_WRIST_LEFT, K4ABT_JOINT_HAND_LEFT,
+        K4ABT_JOINT_CLAVICLE_RIGHT, K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_ELBOW_RIGHT, K4ABT_JOINT_WRIST_RIGHT, K4ABT_JOINT_HAND_RIGHT })>;
+
+    // Pelvis and both legs
+    using Legs = JointSet<JointMask({
+        K4ABT_JOINT_PELVIS,
+        K4ABT_JOINT_HIP_LEFT, K4ABT_JOINT_KNEE_LEFT, K4ABT_JOINT_ANKLE_LEFT, K4ABT_JOINT_FOOT_LEFT,
+        K4ABT_JOINT_HIP_RIGHT, K4ABT_JOINT_KNEE_RIGHT, K4ABT_JOINT_ANKLE_RIGHT, K4ABT_JOINT_FOOT_RIGHT })>;
+}
+
+// Profile selected at run time, see DispatchJointProfile
+enum class JointProfile
+{
+    Full,
+    UpperBody,
+    Legs
+};
+
+// Call function with a default constructed joint set of the profile, e.g. to pick a template instantiation once at startup
+template <typename Function>
+auto DispatchJointProfile(JointProfile profile, Function&& function)
+{
+    switch (profile)
+    {
+    case JointProfile::UpperBody:
+        return function(JointProfiles::UpperBody());
+    case JointProfile::Legs:
+        return function(JointProfiles::Legs());
+    default:
+        return function(JointProfiles::Full());
+    }
+}
@@ -0,0 +1,473 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Always-on latency instrumentation of the per-frame pipeline, to see where the frame budget goes.
+//
+// Every thread records the duration of each stage into its own histograms, so recording is a few relaxed
+// atomic stores without locks or contention. Reports merge the histograms of all threads. If tracing is
+// enabled, every recorded span is also kept in a per-thread ring buffer and the spans of a time window can be
+// written as a Chrome trace (chrome://tracing, https://ui.perfetto.dev).
+//
+//     {
+//         LatencyScope scope(PipelineStage::Metrics);
+//         ... work ...
+//     }
+//     g_latencyRecorder.PrintReport(stdout);
+
+enum class PipelineStage
+{
+    CaptureAcquire,
+    TrackerEnqueueWait,
+    TrackerResidency,
+    BodyExtraction,
+    Metrics,
+    CsvWrite,
+    JsonWrite,
+    SkeletonWrite,
+    PointCloudBuild,
+    PointCloudUpload,
+    RenderSubmit,
+    Swap,
+
+    // Latencies of one frame from the exposure of its capture (DeviceClockCorrelator.h) until it was received by
+    // the host, popped from the tracker and shown by a buffer swap. Frames overlap, so these are not nested spans.
+    GlassToReceive,
+    GlassToPop,
+    GlassToSwap,
+    Count
+};
+
+constexpr size_t PipelineStageCount = static_cast<size_t>(PipelineStage::Count);
+
+inline constexpr std::array<const char*, PipelineStageCount> g_pipelineStageNames =
+{
+    "capture_acquire",
+    "tracker_enqueue_wait",
+    "tracker_residency",
+    "body_extraction",
+    "metrics",
+    "csv_write",
+    "json_write",
+    "skeleton_write",
+    "point_cloud_build",
+    "point_cloud_upload",
+    "render_submit",
+    "swap",
+    "glass_to_receive",
+    "glass_to_pop",
+    "glass_to_swap",
+};
+
+constexpr bool IsFrameLatency(PipelineStage stage)
+{
+    return stage >= PipelineStage::GlassToReceive && stage < PipelineStage::Count;
+}
+
+using LatencyClock = std::chrono::steady_clock;
+
+// Time point of a host time in nanoseconds on the clock of the SDK system timestamps, see DeviceClockCorrelator.h
+inline LatencyClock::time_point FromHostNsec(uint64_t hostNsec)
+{
+    return LatencyClock::time_point(std::chrono::duration_cast<LatencyClock::duration>(std::chrono::nanoseconds(hostNsec)));
+}
+
+// Histogram of durations in nanoseconds with log-linear buckets like HdrHistogram: values below 64 ns are
+// exact, larger values are within 1/32 (about 3%) of their bucket. Values above MaxValueBits are clamped.
+//
+// Record must only be called by one thread at a time, reads are safe from any thread at any time.
+class LatencyHistogram
+{
+public:
+    static constexpr int SubBucketBits = 6;
+    static constexpr int MaxValueBits = 40;
+    static constexpr size_t SubBucketCount = size_t(1) << SubBucketBits;
+    static constexpr size_t HalfSubBucketCount = SubBucketCount / 2;
+    static constexpr size_t BucketCount = SubBucketCount + (MaxValueBits - SubBucketBits) * HalfSubBucketCount;
+
+    void Record(uint64_t valueNs)
+    {
+        valueNs = std::min(valueNs, (uint64_t(1) << MaxValueBits) - 1);
+        Increment(m_buckets[GetBucketIndex(valueNs)], 1);
+        Increment(m_count, 1);
+        if (valueNs > m_max.load(std::memory_order_relaxed))
+        {
+            m_max.store(valueNs, std::memory_order_relaxed);
+        }
+    }
+
+    // Adds the values of another histogram, which may be recorded into concurrently
+    void Merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < BucketCount; i++)
+        {
+            Increment(m_buckets[i], other.m_buckets[i].load(std::memory_order_relaxed));
+        }
+        Increment(m_count, other.m_count.load(std::memory_order_relaxed));
+        m_max.store(std::max(m_max.load(std::memory_order_relaxed), other.m_max.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    }
+
+    uint64_t GetCount() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t GetMax() const { return m_max.load(std::memory_order_relaxed); }
+
+    // Smallest value that at least percentile (0..100) percent of the values are not larger than, reported as
+    // the upper end of its bucket
+    uint64_t GetValueAtPercentile(double percentile) const
+    {
+        uint64_t total = 0;
+        for (const std::atomic<uint64_t>& bucket : m_buckets)
+        {
+            total += bucket.load(std::memory_order_relaxed);
+        }
+        const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5));
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BucketCount; i++)
+        {
+            seen += m_buckets[i].load(std::memory_order_relaxed);
+            if (seen >= target)
+            {
+                return std::min(GetBucketUpperBound(i), GetMax());
+            }
+        }
+        return GetMax();
+    }
+
+    static size_t GetBucketIndex(uint64_t value)
+    {
+        if (value < SubBucketCount)
+        {
+            return static_cast<size_t>(value);
+        }
+
+        // Position of the highest set bit; the SubBucketBits bits below and including it select the sub-bucket
+        int msb = 0;
+        for (int bits = 32; bits > 0; bits /= 2)
+        {
+            if ((value >> (msb + bits)) != 0)
+            {
+                msb += bits;
+            }
+        }
+        const int shift = msb - (SubBucketBits - 1);
+        const size_t mantissa = static_cast<size_t>(value >> shift);
+        return SubBucketCount + static_cast<size_t>(msb - SubBucketBits) * HalfSubBucketCount + (mantissa - HalfSubBucketCount);
+    }
+
+    static uint64_t GetBucketUpperBound(size_t index)
+    {
+        if (index < SubBucketCount)
+        {
+            return index;
+        }
+        const size_t octave = (index - SubBucketCount) / HalfSubBucketCount;
+        const uint64_t mantissa = (index - SubBucketCount) % HalfSubBucketCount + HalfSubBucketCount;
+        const int shift = static_cast<int>(octave) + 1;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+private:
+    // Single writer: a load and a store are enough and cheaper than a locked add
+    static void Increment(std::atomic<uint64_t>& counter, uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, BucketCount> m_buckets{};
+    std::atomic<uint64_t> m_count{ 0 };
+    std::atomic<uint64_t> m_max{ 0 };
+};
+
+class LatencyRecorder
+{
+public:
+    // Keep the last eventsPerThread spans of every thread for WriteChromeTrace. Only threads that record their
+    // first span afterwards are traced, so call it before starting the pipeline threads.
+    void EnableTrace(size_t eventsPerThread = size_t(1) << 16)
+    {
+        // Round up to a power of two for the ring buffer index
+        size_t capacity = 1;
+        while (capacity < eventsPerThread)
+        {
+            capacity *= 2;
+        }
+        m_traceCapacity.store(capacity, std::memory_order_relaxed);
+    }
+
+    bool IsTraceEnabled() const { return m_traceCapacity.load(std::memory_order_relaxed) != 0; }
+
+    // Name of the calling thread in traces, the default is "thread <index>"
+    void SetThreadName(const std::string& name)
+    {
+        ThreadRecord& record = GetThreadRecord();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        record.Name = name;
+    }
+
+    void Record(PipelineStage stage, LatencyClock::time_point start, LatencyClock::time_point end)
+    {
+        ThreadRecord& record = GetThreadRecord();
+        const uint64_t durationNs = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        record.Histograms[static_cast<size_t>(stage)].Record(durationNs);
+
+        if (record.TraceCapacity != 0)
+        {
+            // Seqlock-style ring: the fence orders the overwrite of a slot after the count that retires it,
+            // so a reader can tell which of the slots it copied are still intact
+            const uint64_t index = record.EventCount.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            TraceEvent& event = record.Events[index & (record.TraceCapacity - 1)];
+            event.StartNs.store(ToNanoseconds(start), std::memory_order_relaxed);
+            event.DurationAndStage.store(durationNs << 8 | static_cast<uint64_t>(stage), std::memory_order_relaxed);
+            record.EventCount.store(index + 1, std::memory_order_release);
+        }
+    }
+
+    // Histograms of all threads merged per stage
+    std::unique_ptr<std::array<LatencyHistogram, PipelineStageCount>> GetHistograms() const
+    {
+        auto histograms = std::make_unique<std::array<LatencyHistogram, PipelineStageCount>>();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const std::unique_ptr<ThreadRecord>& record : m_threads)
+        {
+            for (size_t stage = 0; stage < PipelineStageCount; stage++)
+            {
+                (*histograms)[stage].Merge(record->Histograms[stage]);
+            }
+        }
+        return histograms;
+    }
+
+    // p50/p95/p99/max per stage in milliseconds, stages without values are left out
+    void PrintReport(FILE* out) const
+    {
+        const auto histograms = GetHistograms();
+        std::fprintf(out, "\n%-22s %10s %10s %10s %10s %10s\n", "Stage", "Count", "p50 ms", "p95 ms", "p99 ms", "max ms");
+        for (size_t stage = 0; stage < PipelineStageCount; stage++)
+        {
+            const LatencyHistogram& histogram = (*histograms)[stage];
+            if (histogram.GetCount() == 0)
+            {
+                continue;
+            }
+            std::fprintf(out, "%-22s %10llu %10.3f %10.3f %10.3f %10.3f\n", g_pipelineStageNames[stage],
+                static_cast<unsigned long long>(histogram.GetCount()),
+                histogram.GetValueAtPercentile(50) / 1e6, histogram.GetValueAtPercentile(95) / 1e6,
+                histogram.GetValueAtPercentile(99) / 1e6, histogram.GetMax() / 1e6);
+        }
+        std::fprintf(out, "\n");
+    }
+
+    // Writes the spans that ended in the last window as Chrome trace events. Returns false if tracing is not
+    // enabled or the file cannot be written.
+    bool WriteChromeTrace(const std::string& fileName, std::chrono::nanoseconds window) const
+    {
+        if (!IsTraceEnabled())
+        {
+            return false;
+        }
+
+        const uint64_t nowNs = ToNanoseconds(LatencyClock::now());
+        const uint64_t windowNs = static_cast<uint64_t>(window.count());
+        const uint64_t beginNs = nowNs > windowNs ? nowNs - windowNs : 0;
+
+        std::ofstream file(fileName, std::ios::trunc);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        uint64_t asyncId = 0;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const std::unique_ptr<ThreadRecord>& record : m_threads)
+        {
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << record->ThreadIndex
+                 << ",\"args\":{\"name\":\"" << record->Name << "\"}}";
+            first = false;
+
+            for (const std::pair<uint64_t, uint64_t>& event : CopyEvents(*record))
+            {
+                const uint64_t durationNs = event.second >> 8;
+                const PipelineStage stage = static_cast<PipelineStage>(event.second & 0xff);
+                if (event.first + durationNs < beginNs)
+                {
+                    continue;
+                }
+
+                char line[320];
+                const char* name = g_pipelineStageNames[static_cast<size_t>(stage)];
+                if (IsFrameLatency(stage))
+                {
+                    // Overlapping frames are async events, each pair with its own id
+                    asyncId++;
+                    std::snprintf(line, sizeof(line),
+                        ",\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"b\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":%.3f}"
+                        ",\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"e\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+                        name, static_cast<unsigned long long>(asyncId), record->ThreadIndex, event.first / 1e3,
+                        name, static_cast<unsigned long long>(asyncId), record->ThreadIndex, (event.first + durationNs) / 1e3);
+                }
+                else
+                {
+                    std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"pipeline\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        name, record->ThreadIndex, event.first / 1e3, durationNs / 1e3);
+                }
+                file << line;
+            }
+        }
+        file << "\n]}\n";
+        return file.good();
+    }
+
+private:
+    struct TraceEvent
+    {
+        std::atomic<uint64_t> StartNs{ 0 };
+        std::atomic<uint64_t> DurationAndStage{ 0 };
+    };
+
+    struct ThreadRecord
+    {
+        uint32_t ThreadIndex = 0;
+        std::string Name;
+        std::array<LatencyHistogram, PipelineStageCount> Histograms;
+        size_t TraceCapacity = 0;
+        std::unique_ptr<TraceEvent[]> Events;
+        std::atomic<uint64_t> EventCount{ 0 };
+    };
+
+    ThreadRecord& GetThreadRecord()
+    {
+        // Records stay with the recorder after their thread exits, so reports include finished threads
+        thread_local ThreadRecord* t_record = nullptr;
+        if (t_record == nullptr)
+        {
+            auto record = std::make_unique<ThreadRecord>();
+            record->TraceCapacity = m_traceCapacity.load(std::memory_order_relaxed);
+            if (record->TraceCapacity != 0)
+            {
+                record->Events = std::make_unique<TraceEvent[]>(record->TraceCapacity);
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            record->ThreadIndex = static_cast<uint32_t>(m_threads.size() + 1);
+            record->Name = "thread " + std::to_string(record->ThreadIndex);
+            t_record = record.get();
+            m_threads.push_back(std::move(record));
+        }
+        return *t_record;
+    }
+
+    // Start and packed duration/stage of the intact spans in the ring of a thread, oldest first
+    static std::vector<std::pair<uint64_t, uint64_t>> CopyEvents(const ThreadRecord& record)
+    {
+        std::vector<std::pair<uint64_t, uint64_t>> events;
+        if (record.TraceCapacity == 0)
+        {
+            return events;
+        }
+
+        const uint64_t end = record.EventCount.load(std::memory_order_acquire);
+        const uint64_t begin = end > record.TraceCapacity ? end - record.TraceCapacity : 0;
+        for (uint64_t index = begin; index < end; index++)
+        {
+            const TraceEvent& event = record.Events[index & (record.TraceCapacity - 1)];
+            events.emplace_back(event.StartNs.load(std::memory_order_relaxed), event.DurationAndStage.load(std::memory_order_relaxed));
+        }
+
+        // Slots the writer may have started to overwrite while they were copied are dropped
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t written = record.EventCount.load(std::memory_order_relaxed);
+        const uint64_t firstIntact = written >= record.TraceCapacity ? written - record.TraceCapacity + 1 : 0;
+        if (firstIntact > begin)
+        {
+            events.erase(events.begin(), events.begin() + static_cast<ptrdiff_t>(std::min<uint64_t>(firstIntact - begin, events.size())));
+        }
+        return events;
+    }
+
+    uint64_t ToNanoseconds(LatencyClock::time_point time) const
+    {
+        return static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_epoch).count()));
+    }
+
+    const LatencyClock::time_point m_epoch = LatencyClock::now();
+    std::atomic<size_t> m_traceCapacity{ 0 };
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadRecord>> m_threads;
+};
+
+inline LatencyRecorder g_latencyRecorder;
+
+// Records the time from construction to destruction as one span of a stage
+class LatencyScope
+{
+public:
+    explicit LatencyScope(PipelineStage stage)
+        : m_stage(stage)
+        , m_start(LatencyClock::now())
+    {
+    }
+
+    ~LatencyScope()
+    {
+        g_latencyRecorder.Record(m_stage, m_start, LatencyClock::now());
+    }
+
+    LatencyScope(const LatencyScope&) = delete;
+    LatencyScope& operator=(const LatencyScope&) = delete;
+
+private:
+    PipelineStage m_stage;
+    LatencyClock::time_point m_start;
+};
+
+// Times items across an asynchronous boundary, e.g. captures from tracker enqueue to pop, keyed by an id such
+// as the device timestamp. Keeps the latest Capacity items; for use by one thread.
+class LatencyStartTimes
+{
+public:
+    static constexpr size_t Capacity = 32;
+
+    void Start(uint64_t key)
+    {
+        m_items[m_next] = { key, LatencyClock::now() };
+        m_valid[m_next] = true;
+        m_next = (m_next + 1) % Capacity;
+    }
+
+    // Records the span of the started item with this key, if it is still known
+    void Stop(PipelineStage stage, uint64_t key)
+    {
+        for (size_t i = 0; i < Capacity; i++)
+        {
+            if (m_valid[i] && m_items[i].first == key)
+            {
+                g_latencyRecorder.Record(stage, m_items[i].second, LatencyClock::now());
+                m_valid[i] = false;
+                return;
+            }
+        }
+    }
+
+private:
+    std::array<std::pair<uint64_t, LatencyClock::time_point>, Capacity> m_items{};
+    std::array<bool, Capacity> m_valid{};
+    size_t m_next = 0;
+};
@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+#include <k4a/k4atypes.h>
+
+// Part of a recording that is played back, so that quick looks at long recordings only read and track what they need.
+// The time range is reached with k4a_playback_seek_timestamp instead of reading the captures before it. The stride
+// keeps one frame period in Stride, counted from the start of the range, so chunks and resumed runs that start
+// anywhere in the recording keep the same frames. Skipping color releases the color image of every capture as soon as
+// it is read; the SDK only decompresses color when a color conversion is set, which the samples never do, so this
+// keeps the compressed images out of the tracker queue. The tracker itself needs the depth and the IR image.
+struct PlaybackSelection
+{
+    uint64_t StartUsec = 0;                                         // Time since the start of the recording
+    uint64_t EndUsec = std::numeric_limits<uint64_t>::max();        // Exclusive
+    uint32_t Stride = 1;
+    bool SkipColor = false;
+
+    bool IsRestricted() const
+    {
+        return StartUsec != 0 || EndUsec != std::numeric_limits<uint64_t>::max() || Stride > 1;
+    }
+
+    // True if a capture at timeUsec since the start of the recording is in the range and in the stride
+    bool IsSelected(uint64_t timeUsec, uint64_t framePeriodUsec) const
+    {
+        if (timeUsec < StartUsec || timeUsec >= EndUsec)
+        {
+            return false;
+        }
+        if (Stride <= 1 || framePeriodUsec == 0)
+        {
+            return true;
+        }
+        const uint64_t frame = (timeUsec - StartUsec + framePeriodUsec / 2) / framePeriodUsec;
+        return frame % Stride == 0;
+    }
+};
+
+inline uint64_t GetFramePeriodUsec(k4a_fps_t cameraFps)
+{
+    switch (cameraFps)
+    {
+    case K4A_FRAMES_PER_SECOND_5:
+        return 200000;
+    case K4A_FRAMES_PER_SECOND_15:
+        return 66667;
+    default:
+        return 33333;
+    }
+}
+
+// Parses the selection option at argv[i]: -start SECONDS, -end SECONDS, -stride N or -skipcolor. Returns false if
+// argv[i] is not a selection option; otherwise i is the index of its last argument, and valid is false for a missing
+// or bad value.
+inline bool ParsePlaybackSelectionArg(int argc, char** argv, int& i, PlaybackSelection& selection, bool& valid)
+{
+    const std::string arg = argv[i];
+    valid = true;
+    if (arg == "-skipcolor")
+    {
+        selection.SkipColor = true;
+        return true;
+    }
+    if (arg != "-start" && arg != "-end" && arg != "-stride")
+    {
+        return false;
+    }
+    if (i >= argc - 1)
+    {
+        printf("Error: %s needs a value\n", arg.c_str());
+        valid = false;
+        return true;
+    }
+
+    const double value = atof(argv[++i]);
+    if (arg == "-stride")
+    {
+        selection.Stride = static_cast<uint32_t>(value);
+        valid = value >= 1;
+    }
+    else
+    {
+        (arg == "-start" ? selection.StartUsec : selection.EndUsec) = static_cast<uint64_t>(value * 1000000.0);
+        valid = value >= 0;
+    }
+    if (valid && selection.EndUsec <= selection.StartUsec)
+    {
+        printf("Error: -end must be after -start\n");
+        valid = false;
+    }
+    else if (!valid)
+    {
+        printf("Error: bad value for %s: %s\n", arg.c_str(), argv[i]);
+    }
+    return true;
+}
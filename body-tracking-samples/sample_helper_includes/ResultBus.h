@@ -0,0 +1,362 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Typed publish/subscribe bus that hands per-frame results (body frames, images, events, ...) from the
+// capture loop to any number of sinks (CSV, JSON, image archive, console, ...).
+//
+// Every sink subscribes to one message type with its own bounded lock-free queue and backpressure policy,
+// so a slow sink only ever delays itself (or the publisher if it asked for Block), and adding a sink does
+// not add a lock that existing sinks contend on. Publishing copies the message into the queue of every
+// open subscription of its type.
+//
+//     ResultBus<BodyFrame, Event> bus;
+//     Subscription<BodyFrame>& csv = bus.Subscribe<BodyFrame>(64, BackpressurePolicy::Block);
+//     std::thread csvSink = StartSink(csv, [&](const BodyFrame& frame) { ... });
+//     bus.Publish(BodyFrame{ ... });
+//     ...
+//     bus.Close();
+//     csvSink.join();
+
+enum class BackpressurePolicy
+{
+    Block,        // Publisher waits until the sink has room, nothing is lost
+    DropOldest,   // The oldest queued message is discarded to make room, the sink sees the latest results
+    DropNewest    // The new message is discarded, the sink sees a contiguous prefix
+};
+
+// Bounded multi-producer multi-consumer queue after Dmitry Vyukov: every cell carries a sequence number
+// that tells producers and consumers whose turn it is, so push and pop are a single compare-and-swap on
+// the enqueue or dequeue position and never take a lock.
+template <typename T>
+class BoundedMpmcQueue
+{
+public:
+    // The capacity is rounded up to a power of two
+    explicit BoundedMpmcQueue(size_t capacity)
+        : m_cells(RoundUpToPowerOfTwo(capacity))
+        , m_mask(m_cells.size() - 1)
+    {
+        for (size_t i = 0; i < m_cells.size(); i++)
+        {
+            m_cells[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t GetCapacity() const { return m_mask + 1; }
+
+    bool TryPush(T&& value)
+    {
+        size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = m_cells[position & m_mask];
+            const size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0)
+            {
+                if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.Value = std::move(value);
+                    cell.Sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;   // Full
+            }
+            else
+            {
+                position = m_enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T& value)
+    {
+        size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = m_cells[position & m_mask];
+            const size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0)
+            {
+                if (m_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.Value);
+                    cell.Value = T();   // Release what the message holds (image references, buffers) right away
+                    cell.Sequence.store(position + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;   // Empty
+            }
+            else
+            {
+                position = m_dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> Sequence{ 0 };
+        T Value{};
+    };
+
+    static size_t RoundUpToPowerOfTwo(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size *= 2;
+        }
+        return size;
+    }
+
+    // Producers and consumers update different cache lines
+    alignas(64) std::atomic<size_t> m_enqueuePosition{ 0 };
+    alignas(64) std::atomic<size_t> m_dequeuePosition{ 0 };
+    std::vector<Cell> m_cells;
+    size_t m_mask = 0;
+};
+
+// Waits of the blocking operations: spin briefly, then yield, then sleep, so an idle sink costs no CPU
+class Backoff
+{
+public:
+    void Wait()
+    {
+        if (m_count < 16)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        m_count++;
+    }
+
+private:
+    int m_count = 0;
+};
+
+// Queue of one sink. Created by ResultBus::Subscribe and owned by the bus.
+template <typename T>
+class Subscription
+{
+public:
+    Subscription(size_t capacity, BackpressurePolicy policy)
+        : m_queue(capacity)
+        , m_policy(policy)
+    {
+    }
+
+    BackpressurePolicy GetPolicy() const { return m_policy; }
+    uint64_t GetDeliveredCount() const { return m_delivered.load(std::memory_order_relaxed); }
+    uint64_t GetDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+    bool IsClosed() const { return m_closed.load(std::memory_order_seq_cst); }
+
+    // Stop accepting messages. The sink still receives the queued ones and those of Offer calls that were already
+    // running, then Pop returns false.
+    void Close() { m_closed.store(true, std::memory_order_seq_cst); }
+
+    // Called by the publisher. Returns false if a message (this or an older one) was dropped.
+    bool Offer(T value)
+    {
+        // Announce the offer before checking for close: either Pop sees it in progress, or this sees the close
+        OfferScope scope(m_offering);
+        if (IsClosed())
+        {
+            return true;
+        }
+
+        bool dropped = false;
+        Backoff backoff;
+        while (!m_queue.TryPush(std::move(value)))
+        {
+            switch (m_policy)
+            {
+            case BackpressurePolicy::DropNewest:
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+
+            case BackpressurePolicy::DropOldest:
+            {
+                T oldest;
+                if (m_queue.TryPop(oldest))
+                {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    dropped = true;
+                }
+                break;
+            }
+
+            case BackpressurePolicy::Block:
+                // Pop keeps draining while this offer is in progress, so room comes up even after a close
+                backoff.Wait();
+                break;
+            }
+        }
+        m_delivered.fetch_add(1, std::memory_order_relaxed);
+        return !dropped;
+    }
+
+    bool TryPop(T& value)
+    {
+        return m_queue.TryPop(value);
+    }
+
+    // Wait for the next message. Returns false once the subscription is closed and drained.
+    bool Pop(T& value)
+    {
+        Backoff backoff;
+        while (!m_queue.TryPop(value))
+        {
+            // Offers that started before the close may still push, the last one to finish makes its push visible
+            if (IsClosed() && m_offering.load(std::memory_order_seq_cst) == 0)
+            {
+                return m_queue.TryPop(value);
+            }
+            backoff.Wait();
+        }
+        return true;
+    }
+
+private:
+    // Counts an Offer call while it runs
+    class OfferScope
+    {
+    public:
+        explicit OfferScope(std::atomic<uint32_t>& offering) : m_offering(offering) { m_offering.fetch_add(1, std::memory_order_seq_cst); }
+        ~OfferScope() { m_offering.fetch_sub(1, std::memory_order_release); }
+
+        OfferScope(const OfferScope&) = delete;
+        OfferScope& operator=(const OfferScope&) = delete;
+
+    private:
+        std::atomic<uint32_t>& m_offering;
+    };
+
+    BoundedMpmcQueue<T> m_queue;
+    const BackpressurePolicy m_policy;
+    std::atomic<uint64_t> m_delivered{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<bool> m_closed{ false };
+    std::atomic<uint32_t> m_offering{ 0 };
+};
+
+// All subscriptions of one message type. Subscriptions live in fixed slots for the lifetime of the topic,
+// so publishers walk them without a lock while new sinks are added.
+template <typename T>
+class Topic
+{
+public:
+    static constexpr size_t MaxSubscriptions = 16;
+
+    Subscription<T>& Subscribe(size_t capacity, BackpressurePolicy policy)
+    {
+        const size_t slot = m_reserved.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= MaxSubscriptions)
+        {
+            throw std::runtime_error("Too many subscriptions to one result type");
+        }
+        m_storage[slot] = std::make_unique<Subscription<T>>(capacity, policy);
+        m_slots[slot].store(m_storage[slot].get(), std::memory_order_release);
+        return *m_storage[slot];
+    }
+
+    // Returns the number of subscriptions that dropped a message
+    size_t Publish(const T& value)
+    {
+        size_t dropped = 0;
+        const size_t count = std::min(m_reserved.load(std::memory_order_acquire), MaxSubscriptions);
+        for (size_t slot = 0; slot < count; slot++)
+        {
+            Subscription<T>* subscription = m_slots[slot].load(std::memory_order_acquire);
+            if (subscription != nullptr && !subscription->Offer(value))
+            {
+                dropped++;
+            }
+        }
+        return dropped;
+    }
+
+    void Close()
+    {
+        for (auto& slot : m_slots)
+        {
+            Subscription<T>* subscription = slot.load(std::memory_order_acquire);
+            if (subscription != nullptr)
+            {
+                subscription->Close();
+            }
+        }
+    }
+
+private:
+    std::atomic<size_t> m_reserved{ 0 };
+    std::array<std::atomic<Subscription<T>*>, MaxSubscriptions> m_slots{};
+    std::array<std::unique_ptr<Subscription<T>>, MaxSubscriptions> m_storage;
+};
+
+template <typename... Messages>
+class ResultBus
+{
+public:
+    template <typename T>
+    Subscription<T>& Subscribe(size_t capacity, BackpressurePolicy policy)
+    {
+        return std::get<Topic<T>>(m_topics).Subscribe(capacity, policy);
+    }
+
+    // Deliver a message to every subscription of its type. Returns the number of subscriptions that dropped one.
+    template <typename T>
+    size_t Publish(const T& value)
+    {
+        return std::get<Topic<T>>(m_topics).Publish(value);
+    }
+
+    // Close all subscriptions, the sinks finish their queued messages and stop
+    void Close()
+    {
+        std::apply([](auto&... topics) { (topics.Close(), ...); }, m_topics);
+    }
+
+private:
+    std::tuple<Topic<Messages>...> m_topics;
+};
+
+// Run a sink on its own thread until its subscription is closed and drained
+template <typename T, typename Handler>
+std::thread StartSink(Subscription<T>& subscription, Handler handler)
+{
+    return std::thread([&subscription, handler]() mutable
+    {
+        T message;
+        while (subscription.Pop(message))
+        {
+            handler(message);
+        }
+    });
+}
@@ -0,0 +1,695 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <k4abttypes.h>
+#include <BodyTrackingHelpers.h>
+
+// Index over the joint positions CSV file of simple_3d_viewer, so that an analysis reads the rows it needs instead of
+// parsing the whole file.
+//
+// The viewer appends every session to the same file. The store splits the file into segments, one per session: a
+// segment ends at a header line and where the device timestamp goes back, which it does when the device is started
+// again. A frame is a run of rows with the same timestamp. For every segment the store keeps
+//   - a sparse timestamp index, the timestamp and file offset of every SparseIndexInterval-th frame,
+//   - a posting list per body id, the runs of consecutive frames that have the body,
+//   - the runs of consecutive frames with the same number of bodies.
+// Queries return spans, byte ranges of the file with the time range and the body they select, and ReadFrames parses
+// only the rows of a span.
+//
+// The index is built by one pass that only reads the body id and the timestamp of every row. It is saved next to the
+// file as <file>.index and reused while the file is unchanged; when rows were appended since, only the last segment is
+// scanned again. Rows are only indexed once their line is complete, so a file the viewer is still writing can be
+// opened, and Refresh picks up the rows written since.
+
+// Consecutive frames of a segment
+struct SessionFrameRun
+{
+    uint64_t StartUsec = 0;     // Timestamps of the first and the last frame
+    uint64_t EndUsec = 0;
+    uint64_t BeginOffset = 0;   // File offset of the first row, end exclusive
+    uint64_t EndOffset = 0;
+    uint32_t FrameCount = 0;
+    uint32_t BodyCount = 0;     // Bodies in every frame, only for the runs of frames with the same number of bodies
+};
+
+struct SessionIndexEntry
+{
+    uint64_t TimestampUsec = 0;
+    uint64_t Offset = 0;
+};
+
+// One recording session of the file
+struct SessionSegment
+{
+    std::string Header;         // Column names of the rows
+    uint64_t StartUsec = 0;
+    uint64_t EndUsec = 0;
+    uint64_t BeginOffset = 0;
+    uint64_t EndOffset = 0;
+    uint64_t FrameCount = 0;
+    uint64_t RowCount = 0;
+    std::vector<SessionIndexEntry> SparseIndex;
+    std::map<uint32_t, std::vector<SessionFrameRun>> Bodies;
+    std::vector<SessionFrameRun> BodyCounts;
+};
+
+// Rows of one segment selected by a query
+struct SessionSpan
+{
+    size_t Segment = 0;
+    uint64_t StartUsec = 0;                     // Selected timestamps, both inclusive
+    uint64_t EndUsec = 0;
+    uint64_t BeginOffset = 0;                   // File range of the rows, end exclusive
+    uint64_t EndOffset = 0;
+    uint32_t BodyId = K4ABT_INVALID_BODY_ID;    // Only the rows of this body, all bodies if invalid
+};
+
+namespace SessionStoreInternal
+{
+    // Positions of the columns the store reads, from the header of a segment
+    struct Columns
+    {
+        size_t BodyId = 0;
+        size_t Timestamp = 0;
+        std::array<size_t, K4ABT_JOINT_COUNT> Joints;  // Column of <JOINT>_X followed by _Y, _Z and _CONFIDENCE
+        bool Valid = false;
+
+        static constexpr size_t Missing = static_cast<size_t>(-1);
+
+        explicit Columns(const std::string& header = std::string())
+        {
+            Joints.fill(Missing);
+            size_t timeColumn = Missing;
+            size_t bodyIdColumn = Missing;
+            size_t deviceTimeColumn = Missing;
+            size_t column = 0;
+            for (size_t begin = 0; begin <= header.size(); column++)
+            {
+                size_t end = header.find(',', begin);
+                end = end == std::string::npos ? header.size() : end;
+                const std::string name = header.substr(begin, end - begin);
+                begin = end + 1;
+
+                if (name == "BodyID")
+                {
+                    bodyIdColumn = column;
+                }
+                else if (name == "Time")
+                {
+                    timeColumn = column;
+                }
+                else if (name == "DeviceTimeUsec")
+                {
+                    deviceTimeColumn = column;
+                }
+                else if (name.size() > 2 && name.compare(name.size() - 2, 2, "_X") == 0)
+                {
+                    for (size_t joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+                    {
+                        if (name.compare(0, name.size() - 2, g_jointNames[joint]) == 0)
+                        {
+                            Joints[joint] = column;
+                        }
+                    }
+                }
+            }
+
+            // Files of older versions of the viewer have no device timestamps
+            BodyId = bodyIdColumn;
+            Timestamp = deviceTimeColumn != Missing ? deviceTimeColumn : timeColumn;
+            Valid = BodyId != Missing && Timestamp != Missing;
+        }
+
+        // Reads the body id and the timestamp of a row, false for rows that cannot be read
+        bool ParseKey(const std::string& line, uint32_t& bodyId, uint64_t& timestampUsec) const
+        {
+            if (!Valid)
+            {
+                return false;
+            }
+            bool hasBodyId = false;
+            bool hasTimestamp = false;
+            const char* field = line.c_str();
+            for (size_t column = 0; field != nullptr && !(hasBodyId && hasTimestamp); column++)
+            {
+                if (column == BodyId || column == Timestamp)
+                {
+                    char* end = nullptr;
+                    const unsigned long long value = std::strtoull(field, &end, 10);
+                    if (end == field || (*end != ',' && *end != '\r' && *end != '\0'))
+                    {
+                        return false;
+                    }
+                    if (column == BodyId)
+                    {
+                        bodyId = static_cast<uint32_t>(value);
+                        hasBodyId = true;
+                    }
+                    else
+                    {
+                        timestampUsec = value;
+                        hasTimestamp = true;
+                    }
+                }
+                field = std::strchr(field, ',');
+                field = field != nullptr ? field + 1 : nullptr;
+            }
+            return hasBodyId && hasTimestamp;
+        }
+
+        // Reads the joints of a row. Joints that were not exported have no confidence, orientations are not exported
+        // and are the identity.
+        void ParseBody(const std::string& line, uint32_t bodyId, std::vector<const char*>& fields, k4abt_body_t& body) const
+        {
+            fields.clear();
+            for (const char* field = line.c_str(); field != nullptr; )
+            {
+                fields.push_back(field);
+                field = std::strchr(field, ',');
+                field = field != nullptr ? field + 1 : nullptr;
+            }
+
+            body = k4abt_body_t();
+            body.id = bodyId;
+            for (size_t joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+            {
+                k4abt_joint_t& bodyJoint = body.skeleton.joints[joint];
+                bodyJoint.orientation.wxyz.w = 1.f;
+                bodyJoint.confidence_level = K4ABT_JOINT_CONFIDENCE_NONE;
+                if (Joints[joint] == Missing || Joints[joint] + 3 >= fields.size())
+                {
+                    continue;
+                }
+                for (size_t axis = 0; axis < 3; axis++)
+                {
+                    bodyJoint.position.v[axis] = std::strtof(fields[Joints[joint] + axis], nullptr);
+                }
+                bodyJoint.confidence_level = static_cast<k4abt_joint_confidence_level_t>(std::strtol(fields[Joints[joint] + 3], nullptr, 10));
+            }
+        }
+    };
+
+    template <typename T>
+    void Write(std::ostream& stream, const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are written as bytes");
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool Read(std::istream& stream, T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are read as bytes");
+        return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    template <typename T>
+    void WriteVector(std::ostream& stream, const std::vector<T>& values)
+    {
+        Write(stream, static_cast<uint64_t>(values.size()));
+        stream.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+
+    // maxBytes bounds the size, so a damaged index file cannot make it allocate more than the file holds
+    template <typename T>
+    bool ReadVector(std::istream& stream, std::vector<T>& values, uint64_t maxBytes)
+    {
+        uint64_t size = 0;
+        if (!Read(stream, size) || size > maxBytes / sizeof(T))
+        {
+            return false;
+        }
+        values.resize(static_cast<size_t>(size));
+        return static_cast<bool>(stream.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(size * sizeof(T))));
+    }
+
+    // FNV-1a hash of the first and the last bytes of a file, to notice a file that was replaced
+    inline uint64_t Fingerprint(const std::string& fileName, uint64_t size)
+    {
+        constexpr uint64_t SampleSize = 4096;
+        std::ifstream file(fileName, std::ios::binary);
+        uint64_t hash = 14695981039346656037ull;
+        std::vector<char> bytes;
+        for (uint64_t begin : { uint64_t(0), size > SampleSize ? size - SampleSize : uint64_t(0) })
+        {
+            bytes.resize(static_cast<size_t>(std::min(SampleSize, size - begin)));
+            file.seekg(static_cast<std::streamoff>(begin));
+            file.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            for (char byte : bytes)
+            {
+                hash = (hash ^ static_cast<uint8_t>(byte)) * 1099511628211ull;
+            }
+        }
+        return hash;
+    }
+}
+
+class SessionStore
+{
+public:
+    static constexpr uint64_t SparseIndexInterval = 64;
+
+    // Indexes the file, with the index file if useIndexFile and the index file matches. Returns false if the file
+    // cannot be read.
+    bool Open(const std::string& fileName, bool useIndexFile = true)
+    {
+        m_fileName = fileName;
+        m_useIndexFile = useIndexFile;
+        m_segments.clear();
+        m_scannedSize = 0;
+        m_fingerprint = 0;
+        if (useIndexFile)
+        {
+            LoadIndex();
+        }
+        return Refresh();
+    }
+
+    // Indexes the rows appended since the file was opened or refreshed. The file is indexed again if it was replaced.
+    bool Refresh()
+    {
+        std::ifstream file(m_fileName, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+        file.close();
+
+        if (fileSize < m_scannedSize || SessionStoreInternal::Fingerprint(m_fileName, m_scannedSize) != m_fingerprint)
+        {
+            m_segments.clear();
+            m_scannedSize = 0;
+        }
+        else if (fileSize == m_scannedSize)
+        {
+            return true;
+        }
+
+        // The last segment may go on in the appended rows, it is scanned again from its first row
+        uint64_t offset = 0;
+        std::string header;
+        if (!m_segments.empty())
+        {
+            offset = m_segments.back().BeginOffset;
+            header = m_segments.back().Header;
+            m_segments.pop_back();
+        }
+        if (!Scan(offset, header))
+        {
+            return false;
+        }
+        m_fingerprint = SessionStoreInternal::Fingerprint(m_fileName, m_scannedSize);
+        if (m_useIndexFile)
+        {
+            SaveIndex();
+        }
+        return true;
+    }
+
+    const std::vector<SessionSegment>& GetSegments() const
+    {
+        return m_segments;
+    }
+
+    // Frames of a segment between startUsec and endUsec, both inclusive
+    std::vector<SessionSpan> FindFrames(size_t segment, uint64_t startUsec = 0, uint64_t endUsec = UINT64_MAX) const
+    {
+        std::vector<SessionSpan> spans;
+        if (segment < m_segments.size())
+        {
+            const SessionSegment& sessionSegment = m_segments[segment];
+            SessionFrameRun run;
+            run.StartUsec = sessionSegment.StartUsec;
+            run.EndUsec = sessionSegment.EndUsec;
+            run.BeginOffset = sessionSegment.BeginOffset;
+            run.EndOffset = sessionSegment.EndOffset;
+            AddSpan(segment, run, startUsec, endUsec, K4ABT_INVALID_BODY_ID, spans);
+        }
+        return spans;
+    }
+
+    // Frames of one body between startUsec and endUsec, ReadFrames of the spans returns only this body
+    std::vector<SessionSpan> FindBody(size_t segment, uint32_t bodyId, uint64_t startUsec = 0, uint64_t endUsec = UINT64_MAX) const
+    {
+        std::vector<SessionSpan> spans;
+        if (segment < m_segments.size())
+        {
+            const auto runs = m_segments[segment].Bodies.find(bodyId);
+            if (runs != m_segments[segment].Bodies.end())
+            {
+                for (const SessionFrameRun& run : runs->second)
+                {
+                    AddSpan(segment, run, startUsec, endUsec, bodyId, spans);
+                }
+            }
+        }
+        return spans;
+    }
+
+    // Frames with at least minimumBodies bodies between startUsec and endUsec
+    std::vector<SessionSpan> FindFramesWithBodies(size_t segment, uint32_t minimumBodies, uint64_t startUsec = 0, uint64_t endUsec = UINT64_MAX) const
+    {
+        std::vector<SessionSpan> spans;
+        if (segment < m_segments.size())
+        {
+            // Adjacent runs with different body counts that all qualify make one span
+            SessionFrameRun merged;
+            bool hasMerged = false;
+            for (const SessionFrameRun& run : m_segments[segment].BodyCounts)
+            {
+                if (run.BodyCount < minimumBodies)
+                {
+                    continue;
+                }
+                if (hasMerged && merged.EndOffset == run.BeginOffset)
+                {
+                    merged.EndUsec = run.EndUsec;
+                    merged.EndOffset = run.EndOffset;
+                    continue;
+                }
+                if (hasMerged)
+                {
+                    AddSpan(segment, merged, startUsec, endUsec, K4ABT_INVALID_BODY_ID, spans);
+                }
+                merged = run;
+                hasMerged = true;
+            }
+            if (hasMerged)
+            {
+                AddSpan(segment, merged, startUsec, endUsec, K4ABT_INVALID_BODY_ID, spans);
+            }
+        }
+        return spans;
+    }
+
+    // Parses the rows of a span and calls onFrame for every frame with the bodies the span selects. Returns false if
+    // the file cannot be read.
+    bool ReadFrames(const SessionSpan& span, const std::function<void(uint64_t timestampUsec, const std::vector<k4abt_body_t>& bodies)>& onFrame) const
+    {
+        if (span.Segment >= m_segments.size())
+        {
+            return false;
+        }
+        std::ifstream file(m_fileName, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.seekg(static_cast<std::streamoff>(span.BeginOffset));
+
+        const SessionStoreInternal::Columns columns(m_segments[span.Segment].Header);
+        std::vector<const char*> fields;
+        std::vector<k4abt_body_t> bodies;
+        uint64_t frameUsec = 0;
+        std::string line;
+        for (uint64_t offset = span.BeginOffset; offset < span.EndOffset && std::getline(file, line); )
+        {
+            offset += line.size() + 1;
+            uint32_t bodyId = 0;
+            uint64_t timestampUsec = 0;
+            if (!columns.ParseKey(line, bodyId, timestampUsec) || timestampUsec < span.StartUsec || timestampUsec > span.EndUsec ||
+                (span.BodyId != K4ABT_INVALID_BODY_ID && bodyId != span.BodyId))
+            {
+                continue;
+            }
+            if (!bodies.empty() && timestampUsec != frameUsec)
+            {
+                onFrame(frameUsec, bodies);
+                bodies.clear();
+            }
+            frameUsec = timestampUsec;
+            bodies.emplace_back();
+            columns.ParseBody(line, bodyId, fields, bodies.back());
+        }
+        if (!bodies.empty())
+        {
+            onFrame(frameUsec, bodies);
+        }
+        return !file.bad();
+    }
+
+private:
+    static constexpr uint32_t IndexVersion = 1;
+
+    // Frame whose rows the scan is reading
+    struct ScanFrame
+    {
+        uint64_t TimestampUsec = 0;
+        uint64_t BeginOffset = 0;
+        uint64_t EndOffset = 0;
+        std::vector<uint32_t> BodyIds;
+    };
+
+    // Indexes the rows from offset to the last complete line, header is the header of the rows before offset
+    bool Scan(uint64_t offset, std::string header)
+    {
+        std::ifstream file(m_fileName, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.seekg(static_cast<std::streamoff>(offset));
+
+        SessionStoreInternal::Columns columns(header);
+        SessionSegment segment;
+        ScanFrame frame;
+        bool inSegment = false;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (file.eof())
+            {
+                break;  // The last line is not complete, the viewer may be writing it
+            }
+            const uint64_t lineOffset = offset;
+            offset += line.size() + 1;
+
+            if (line.compare(0, 6, "BodyID") == 0)
+            {
+                if (inSegment)
+                {
+                    FinishSegment(segment, frame);
+                    inSegment = false;
+                }
+                header = line.substr(0, line.find_last_not_of('\r') + 1);
+                columns = SessionStoreInternal::Columns(header);
+                continue;
+            }
+
+            // Rows before the first header and damaged rows are not indexed
+            uint32_t bodyId = 0;
+            uint64_t timestampUsec = 0;
+            if (!columns.ParseKey(line, bodyId, timestampUsec))
+            {
+                continue;
+            }
+            if (inSegment && timestampUsec == frame.TimestampUsec)
+            {
+                frame.BodyIds.push_back(bodyId);
+                frame.EndOffset = offset;
+                continue;
+            }
+
+            if (inSegment)
+            {
+                FinishFrame(segment, frame);
+                if (timestampUsec < segment.EndUsec)
+                {
+                    FinishSegment(segment, frame);
+                    inSegment = false;
+                }
+            }
+            if (!inSegment)
+            {
+                segment = SessionSegment();
+                segment.Header = header;
+                segment.BeginOffset = lineOffset;
+                inSegment = true;
+            }
+            frame.TimestampUsec = timestampUsec;
+            frame.BeginOffset = lineOffset;
+            frame.EndOffset = offset;
+            frame.BodyIds.assign(1, bodyId);
+        }
+
+        if (inSegment)
+        {
+            FinishFrame(segment, frame);
+            FinishSegment(segment, frame);
+        }
+        m_scannedSize = offset;
+        return !file.bad();
+    }
+
+    static void AddToRun(std::vector<SessionFrameRun>& runs, const ScanFrame& frame, uint32_t bodyCount)
+    {
+        if (!runs.empty() && runs.back().EndOffset == frame.EndOffset)
+        {
+            return;  // A body id that is twice in the frame
+        }
+        if (runs.empty() || runs.back().EndOffset != frame.BeginOffset || runs.back().BodyCount != bodyCount)
+        {
+            SessionFrameRun run;
+            run.StartUsec = frame.TimestampUsec;
+            run.BeginOffset = frame.BeginOffset;
+            run.BodyCount = bodyCount;
+            runs.push_back(run);
+        }
+        runs.back().EndUsec = frame.TimestampUsec;
+        runs.back().EndOffset = frame.EndOffset;
+        runs.back().FrameCount++;
+    }
+
+    static void FinishFrame(SessionSegment& segment, const ScanFrame& frame)
+    {
+        if (segment.FrameCount == 0)
+        {
+            segment.StartUsec = frame.TimestampUsec;
+        }
+        if (segment.FrameCount % SparseIndexInterval == 0)
+        {
+            segment.SparseIndex.push_back({ frame.TimestampUsec, frame.BeginOffset });
+        }
+        segment.EndUsec = frame.TimestampUsec;
+        segment.FrameCount++;
+        segment.RowCount += frame.BodyIds.size();
+
+        AddToRun(segment.BodyCounts, frame, static_cast<uint32_t>(frame.BodyIds.size()));
+        for (uint32_t bodyId : frame.BodyIds)
+        {
+            AddToRun(segment.Bodies[bodyId], frame, 0);
+        }
+    }
+
+    void FinishSegment(SessionSegment& segment, const ScanFrame& frame)
+    {
+        segment.EndOffset = frame.EndOffset;
+        m_segments.push_back(std::move(segment));
+    }
+
+    // Clips a run to the time range with the sparse index and adds it if frames are left
+    void AddSpan(size_t segment, const SessionFrameRun& run, uint64_t startUsec, uint64_t endUsec, uint32_t bodyId,
+                 std::vector<SessionSpan>& spans) const
+    {
+        SessionSpan span;
+        span.Segment = segment;
+        span.StartUsec = std::max(run.StartUsec, startUsec);
+        span.EndUsec = std::min(run.EndUsec, endUsec);
+        span.BeginOffset = run.BeginOffset;
+        span.EndOffset = run.EndOffset;
+        span.BodyId = bodyId;
+        if (span.StartUsec > span.EndUsec)
+        {
+            return;
+        }
+
+        // Timestamps increase within a segment, the frames in range start after the last indexed frame before
+        // startUsec and end before the first indexed frame after endUsec
+        const std::vector<SessionIndexEntry>& index = m_segments[segment].SparseIndex;
+        const auto after = [](uint64_t timestampUsec, const SessionIndexEntry& entry) { return timestampUsec < entry.TimestampUsec; };
+        auto first = std::upper_bound(index.begin(), index.end(), span.StartUsec, after);
+        if (first != index.begin())
+        {
+            span.BeginOffset = std::max(span.BeginOffset, std::prev(first)->Offset);
+        }
+        auto last = std::upper_bound(index.begin(), index.end(), span.EndUsec, after);
+        if (last != index.end())
+        {
+            span.EndOffset = std::min(span.EndOffset, last->Offset);
+        }
+        spans.push_back(span);
+    }
+
+    // Index file: "K4SX", the version, the scanned size of the file and its fingerprint, then the segments
+    void SaveIndex() const
+    {
+        using namespace SessionStoreInternal;
+        std::ofstream file(m_fileName + ".index", std::ios::binary | std::ios::trunc);
+        file.write("K4SX", 4);
+        Write(file, IndexVersion);
+        Write(file, m_scannedSize);
+        Write(file, m_fingerprint);
+        Write(file, static_cast<uint64_t>(m_segments.size()));
+        for (const SessionSegment& segment : m_segments)
+        {
+            WriteVector(file, std::vector<char>(segment.Header.begin(), segment.Header.end()));
+            for (uint64_t value : { segment.StartUsec, segment.EndUsec, segment.BeginOffset, segment.EndOffset, segment.FrameCount, segment.RowCount })
+            {
+                Write(file, value);
+            }
+            WriteVector(file, segment.SparseIndex);
+            WriteVector(file, segment.BodyCounts);
+            Write(file, static_cast<uint64_t>(segment.Bodies.size()));
+            for (const auto& body : segment.Bodies)
+            {
+                Write(file, body.first);
+                WriteVector(file, body.second);
+            }
+        }
+        // The index is only a cache, the file is indexed again if it cannot be written
+    }
+
+    // Leaves the store empty if the index file is missing or damaged
+    void LoadIndex()
+    {
+        using namespace SessionStoreInternal;
+        std::ifstream file(m_fileName + ".index", std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            return;
+        }
+        const uint64_t maxBytes = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+
+        char magic[4] = {};
+        uint32_t version = 0;
+        uint64_t segmentCount = 0;
+        bool valid = file.read(magic, 4) && std::memcmp(magic, "K4SX", 4) == 0 && Read(file, version) && version == IndexVersion &&
+                     Read(file, m_scannedSize) && Read(file, m_fingerprint) && Read(file, segmentCount) && segmentCount <= maxBytes;
+        for (uint64_t index = 0; valid && index < segmentCount; index++)
+        {
+            SessionSegment segment;
+            std::vector<char> header;
+            uint64_t bodyCount = 0;
+            valid = ReadVector(file, header, maxBytes) && Read(file, segment.StartUsec) && Read(file, segment.EndUsec) &&
+                    Read(file, segment.BeginOffset) && Read(file, segment.EndOffset) && Read(file, segment.FrameCount) &&
+                    Read(file, segment.RowCount) && ReadVector(file, segment.SparseIndex, maxBytes) &&
+                    ReadVector(file, segment.BodyCounts, maxBytes) && Read(file, bodyCount) && bodyCount <= maxBytes;
+            for (uint64_t body = 0; valid && body < bodyCount; body++)
+            {
+                uint32_t bodyId = 0;
+                valid = Read(file, bodyId) && ReadVector(file, segment.Bodies[bodyId], maxBytes);
+            }
+            segment.Header.assign(header.begin(), header.end());
+            valid = valid && segment.Header.compare(0, 6, "BodyID") == 0;
+            m_segments.push_back(std::move(segment));
+        }
+
+        if (!valid)
+        {
+            m_segments.clear();
+            m_scannedSize = 0;
+            m_fingerprint = 0;
+        }
+    }
+
+    std::string m_fileName;
+    bool m_useIndexFile = true;
+    std::vector<SessionSegment> m_segments;
+    uint64_t m_scannedSize = 0;     // Bytes of the file that were indexed, up to the last complete line
+    uint64_t m_fingerprint = 0;
+};
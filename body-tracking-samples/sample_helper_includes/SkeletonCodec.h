@@ -0,0 +1,754 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <k4abttypes.h>
+#include <JointSet.h>
+
+// Compact coding of skeleton streams, as a wire format of one packet per frame (SkeletonEncoder, SkeletonDecoder)
+// and as a file format (SkeletonFileWriter, SkeletonFileReader).
+//
+// Positions are quantized to fixed point steps of QuantizationUm micrometers and predicted from the same joint of the
+// same body id in the previous frame. The residuals of a body are zigzag coded and bit-packed with the width of the
+// largest one, so a body that moves a few steps per frame takes a few bits per coordinate. Confidence levels are
+// packed into 2 bits per joint and coded as the change since the previous frame. Orientations are not kept, like in
+// the CSV file; decoded joints have the identity orientation.
+//
+// Every KeyframeInterval frames a keyframe is coded without prediction and carries the configuration, so decoding can
+// start at any keyframe: a receiver that joins a stream drops packets until the next one, and SkeletonFileReader::Seek
+// starts at the last keyframe before the requested time.
+//
+// Packet of a frame, every integer an LEB128 varint unless noted:
+//   flags (byte, bit 0: keyframe)
+//   keyframe:   quantization_um, joint_mask, timestamp_usec
+//   otherwise:  zigzag(timestamp delta - timestamp delta of the previous frame)
+//   body_count
+//   per body:   id, confidence levels (2 bits per coded joint, XOR with the previous frame if predicted),
+//               residual width (byte), 3 residuals per coded joint of that many bits each, LSB first
+//
+// A body is predicted if the packet is not a keyframe and the previous frame has a body with the same id.
+
+struct SkeletonCodecConfig
+{
+    uint32_t QuantizationUm = 1000;         // Step of the positions in micrometers, 1000 = 1 mm
+    uint32_t KeyframeInterval = 30;         // Frames from one keyframe to the next, 1 s at 30 fps
+    uint32_t JointMask = AllJointsMask;     // Coded joints; the others decode at the origin with confidence NONE
+};
+
+namespace SkeletonCodecInternal
+{
+    // Quantized positions stay within +-2^30, so their differences fit into 32 bits
+    constexpr float PositionLimit = 1073741823.f;
+
+    inline void WriteVarint(std::vector<uint8_t>& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    inline bool ReadVarint(const uint8_t* data, size_t size, size_t& position, uint64_t& value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 64 && position < size; shift += 7)
+        {
+            const uint8_t byte = data[position++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline bool ReadVarint(std::istream& in, uint64_t& value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            const int byte = in.get();
+            if (byte == std::char_traits<char>::eof())
+            {
+                return false;
+            }
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 64 bit access at any alignment. The SDK only runs on little endian hosts (x64, arm64), so the packed bits are
+    // little endian like the varints.
+    inline uint64_t Load64(const uint8_t* data)
+    {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    inline void Store64(uint8_t* data, uint64_t value)
+    {
+        std::memcpy(data, &value, sizeof(value));
+    }
+
+    inline uint64_t ZigZag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t UnZigZag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // Fixed point positions and confidence levels of one body as coded in a frame
+    struct BodyState
+    {
+        uint32_t Id = 0;
+        uint64_t Confidence = 0;
+        std::array<int32_t, 3 * K4ABT_JOINT_COUNT> Positions{};
+    };
+
+    // State that the encoder and the decoder both keep, so that they make the same predictions
+    struct StreamState
+    {
+        bool Synchronized = false;              // A keyframe was coded since the start or the last error
+        uint32_t QuantizationUm = 1000;
+        float StepMm = 1.f;
+        std::array<k4abt_joint_id_t, K4ABT_JOINT_COUNT> JointIds{};
+        size_t JointCount = 0;
+        uint64_t TimestampUsec = 0;
+        int64_t TimestampDeltaUsec = 0;
+        std::vector<BodyState> Previous;
+        std::vector<BodyState> Current;
+
+        void StartKeyframe(uint32_t quantizationUm, uint32_t jointMask, uint64_t timestampUsec)
+        {
+            Synchronized = true;
+            QuantizationUm = quantizationUm;
+            StepMm = static_cast<float>(quantizationUm) / 1000.f;
+            JointCount = 0;
+            for (uint32_t joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+            {
+                if (((jointMask >> joint) & 1u) != 0)
+                {
+                    JointIds[JointCount++] = static_cast<k4abt_joint_id_t>(joint);
+                }
+            }
+            TimestampUsec = timestampUsec;
+            TimestampDeltaUsec = 0;
+            Previous.clear();
+        }
+
+        const BodyState* FindPrevious(uint32_t id) const
+        {
+            for (const BodyState& body : Previous)
+            {
+                if (body.Id == id)
+                {
+                    return &body;
+                }
+            }
+            return nullptr;
+        }
+
+        void EndFrame(uint64_t timestampUsec)
+        {
+            TimestampDeltaUsec = static_cast<int64_t>(timestampUsec - TimestampUsec);
+            TimestampUsec = timestampUsec;
+            Previous.swap(Current);
+        }
+    };
+}
+
+class SkeletonEncoder
+{
+public:
+    explicit SkeletonEncoder(SkeletonCodecConfig config = SkeletonCodecConfig())
+        : m_config(config)
+    {
+        m_config.QuantizationUm = std::max<uint32_t>(m_config.QuantizationUm, 1);
+        m_config.KeyframeInterval = std::max<uint32_t>(m_config.KeyframeInterval, 1);
+        m_config.JointMask &= AllJointsMask;
+        m_scale = 1000.f / static_cast<float>(m_config.QuantizationUm);
+    }
+
+    const SkeletonCodecConfig& GetConfig() const { return m_config; }
+
+    // Appends the packet of one frame to packet and returns true if it is a keyframe
+    bool Encode(uint64_t timestampUsec, const std::vector<k4abt_body_t>& bodies, std::vector<uint8_t>& packet)
+    {
+        using namespace SkeletonCodecInternal;
+
+        const bool keyframe = !m_state.Synchronized || m_framesSinceKeyframe >= m_config.KeyframeInterval;
+        packet.push_back(keyframe ? 1 : 0);
+        if (keyframe)
+        {
+            m_state.StartKeyframe(m_config.QuantizationUm, m_config.JointMask, timestampUsec);
+            m_framesSinceKeyframe = 0;
+            WriteVarint(packet, m_config.QuantizationUm);
+            WriteVarint(packet, m_config.JointMask);
+            WriteVarint(packet, timestampUsec);
+        }
+        else
+        {
+            const int64_t delta = static_cast<int64_t>(timestampUsec - m_state.TimestampUsec);
+            WriteVarint(packet, ZigZag(delta - m_state.TimestampDeltaUsec));
+        }
+        m_framesSinceKeyframe++;
+
+        WriteVarint(packet, bodies.size());
+        m_state.Current.resize(bodies.size());
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            EncodeBody(bodies[i], m_state.Current[i], packet);
+        }
+        m_state.EndFrame(timestampUsec);
+        return keyframe;
+    }
+
+    // Makes the next frame a keyframe, for example when a receiver joins the stream
+    void ForceKeyframe()
+    {
+        m_state.Synchronized = false;
+    }
+
+private:
+    void EncodeBody(const k4abt_body_t& body, SkeletonCodecInternal::BodyState& current, std::vector<uint8_t>& packet)
+    {
+        using namespace SkeletonCodecInternal;
+
+        const BodyState* previous = m_state.FindPrevious(body.id);
+        const size_t valueCount = 3 * m_state.JointCount;
+        std::array<uint32_t, 3 * K4ABT_JOINT_COUNT> residuals;
+        uint32_t residualBits = 0;
+        uint64_t confidence = 0;
+        for (size_t j = 0; j < m_state.JointCount; j++)
+        {
+            const k4abt_joint_t& joint = body.skeleton.joints[m_state.JointIds[j]];
+            confidence |= static_cast<uint64_t>(joint.confidence_level & 3) << (2 * j);
+            for (size_t axis = 0; axis < 3; axis++)
+            {
+                const size_t index = 3 * j + axis;
+                const int32_t position = Quantize(joint.position.v[axis]);
+                const int32_t residual = previous != nullptr ? position - previous->Positions[index] : position;
+                residuals[index] = (static_cast<uint32_t>(residual) << 1) ^ static_cast<uint32_t>(residual >> 31);
+                residualBits |= residuals[index];
+                current.Positions[index] = position;
+            }
+        }
+        current.Id = body.id;
+        current.Confidence = confidence;
+
+        WriteVarint(packet, body.id);
+        WriteVarint(packet, previous != nullptr ? confidence ^ previous->Confidence : confidence);
+
+        uint8_t width = 0;
+        while (width < 32 && (residualBits >> width) != 0)
+        {
+            width++;
+        }
+        packet.push_back(width);
+
+        // The whole accumulator is stored after every value and the output advances by its complete bytes, which
+        // needs 8 bytes of slack at the end but no branches
+        const size_t start = packet.size();
+        const size_t byteCount = (valueCount * width + 7) / 8;
+        packet.resize(start + byteCount + 8);
+        uint8_t* out = packet.data() + start;
+        uint64_t accumulator = 0;
+        unsigned bits = 0;
+        for (size_t i = 0; i < valueCount; i++)
+        {
+            accumulator |= static_cast<uint64_t>(residuals[i]) << bits;
+            bits += width;
+            Store64(out, accumulator);
+            out += bits / 8;
+            accumulator >>= bits & ~7u;
+            bits &= 7;
+        }
+        Store64(out, accumulator);
+        packet.resize(start + byteCount);
+    }
+
+    int32_t Quantize(float positionMm) const
+    {
+        float scaled = positionMm * m_scale;
+        if (!(scaled >= -SkeletonCodecInternal::PositionLimit))   // Also NaN
+        {
+            scaled = -SkeletonCodecInternal::PositionLimit;
+        }
+        else if (scaled > SkeletonCodecInternal::PositionLimit)
+        {
+            scaled = SkeletonCodecInternal::PositionLimit;
+        }
+        return static_cast<int32_t>(scaled + (scaled >= 0.f ? 0.5f : -0.5f));
+    }
+
+    SkeletonCodecConfig m_config;
+    float m_scale = 1.f;
+    uint32_t m_framesSinceKeyframe = 0;
+    SkeletonCodecInternal::StreamState m_state;
+};
+
+class SkeletonDecoder
+{
+public:
+    // Decodes the packet of one frame into bodies. Returns false for a malformed packet and for the packets before the
+    // first keyframe, which cannot be decoded; bodies is then empty and decoding resumes at the next keyframe.
+    bool Decode(const uint8_t* data, size_t size, uint64_t& timestampUsec, std::vector<k4abt_body_t>& bodies)
+    {
+        using namespace SkeletonCodecInternal;
+
+        bodies.clear();
+        size_t position = 0;
+        if (size == 0)
+        {
+            return Fail();
+        }
+        const bool keyframe = (data[position++] & 1) != 0;
+        uint64_t timestamp = 0;
+        if (keyframe)
+        {
+            uint64_t quantizationUm = 0;
+            uint64_t jointMask = 0;
+            if (!ReadVarint(data, size, position, quantizationUm) || !ReadVarint(data, size, position, jointMask) ||
+                !ReadVarint(data, size, position, timestamp) || quantizationUm == 0 || quantizationUm > UINT32_MAX ||
+                (jointMask & ~static_cast<uint64_t>(AllJointsMask)) != 0)
+            {
+                return Fail();
+            }
+            m_state.StartKeyframe(static_cast<uint32_t>(quantizationUm), static_cast<uint32_t>(jointMask), timestamp);
+        }
+        else
+        {
+            uint64_t deltaChange = 0;
+            if (!m_state.Synchronized || !ReadVarint(data, size, position, deltaChange))
+            {
+                return Fail();
+            }
+            timestamp = m_state.TimestampUsec + static_cast<uint64_t>(m_state.TimestampDeltaUsec + UnZigZag(deltaChange));
+        }
+
+        // Every body takes at least 3 bytes
+        uint64_t bodyCount = 0;
+        if (!ReadVarint(data, size, position, bodyCount) || bodyCount > (size - position) / 3)
+        {
+            return Fail();
+        }
+        bodies.resize(static_cast<size_t>(bodyCount));
+        m_state.Current.resize(static_cast<size_t>(bodyCount));
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            if (!DecodeBody(data, size, position, bodies[i], m_state.Current[i]))
+            {
+                return Fail();
+            }
+        }
+        if (position != size)
+        {
+            return Fail();
+        }
+
+        m_state.EndFrame(timestamp);
+        timestampUsec = timestamp;
+        return true;
+    }
+
+    bool Decode(const std::vector<uint8_t>& packet, uint64_t& timestampUsec, std::vector<k4abt_body_t>& bodies)
+    {
+        return Decode(packet.data(), packet.size(), timestampUsec, bodies);
+    }
+
+    // False until the first keyframe and after a malformed packet
+    bool IsSynchronized() const { return m_state.Synchronized; }
+
+    // Drops the state, the next packet that can be decoded is a keyframe
+    void Reset()
+    {
+        m_state.Synchronized = false;
+    }
+
+private:
+    bool DecodeBody(const uint8_t* data, size_t size, size_t& position, k4abt_body_t& body,
+                    SkeletonCodecInternal::BodyState& current)
+    {
+        using namespace SkeletonCodecInternal;
+
+        uint64_t id = 0;
+        uint64_t confidence = 0;
+        if (!ReadVarint(data, size, position, id) || !ReadVarint(data, size, position, confidence) || position >= size)
+        {
+            return false;
+        }
+        const uint8_t width = data[position++];
+        const size_t valueCount = 3 * m_state.JointCount;
+        const size_t byteCount = (valueCount * width + 7) / 8;
+        if (width > 32 || byteCount > size - position)
+        {
+            return false;
+        }
+
+        const BodyState* previous = m_state.FindPrevious(static_cast<uint32_t>(id));
+        if (previous != nullptr)
+        {
+            confidence ^= previous->Confidence;
+        }
+        current.Id = static_cast<uint32_t>(id);
+        current.Confidence = confidence;
+        body.id = static_cast<uint32_t>(id);
+
+        if (m_state.JointCount < K4ABT_JOINT_COUNT)
+        {
+            for (k4abt_joint_t& joint : body.skeleton.joints)
+            {
+                joint.position = { 0.f, 0.f, 0.f };
+                joint.orientation = { 1.f, 0.f, 0.f, 0.f };
+                joint.confidence_level = K4ABT_JOINT_CONFIDENCE_NONE;
+            }
+        }
+
+        // Every value is read with one 64 bit load from a copy with 8 bytes of padding
+        std::copy(data + position, data + position + byteCount, m_residualBytes.begin());
+        std::fill(m_residualBytes.begin() + byteCount, m_residualBytes.begin() + byteCount + 8, static_cast<uint8_t>(0));
+        const uint64_t valueMask = (static_cast<uint64_t>(1) << width) - 1;
+        size_t bitPosition = 0;
+        for (size_t j = 0; j < m_state.JointCount; j++)
+        {
+            k4abt_joint_t& joint = body.skeleton.joints[m_state.JointIds[j]];
+            for (size_t axis = 0; axis < 3; axis++)
+            {
+                const uint64_t word = Load64(m_residualBytes.data() + bitPosition / 8);
+                const uint32_t zigzag = static_cast<uint32_t>((word >> (bitPosition & 7)) & valueMask);
+                bitPosition += width;
+
+                const size_t index = 3 * j + axis;
+                const uint32_t residual = (zigzag >> 1) ^ (0u - (zigzag & 1));
+                const uint32_t predicted = previous != nullptr ? static_cast<uint32_t>(previous->Positions[index]) : 0;
+                current.Positions[index] = static_cast<int32_t>(predicted + residual);
+                joint.position.v[axis] = static_cast<float>(current.Positions[index]) * m_state.StepMm;
+            }
+            joint.orientation = { 1.f, 0.f, 0.f, 0.f };
+            joint.confidence_level = static_cast<k4abt_joint_confidence_level_t>((confidence >> (2 * j)) & 3);
+        }
+        position += byteCount;
+        return true;
+    }
+
+    bool Fail()
+    {
+        m_state.Synchronized = false;
+        return false;
+    }
+
+    SkeletonCodecInternal::StreamState m_state;
+    std::array<uint8_t, 3 * K4ABT_JOINT_COUNT * 4 + 8> m_residualBytes{};
+};
+
+// File of one skeleton stream: "K4SK" and a version byte, then the size of every packet as a varint followed by the
+// packet. Close ends the packets with a size of 0 and appends the keyframe index: the keyframe count, then for every
+// keyframe its timestamp and the file offset of its size, both as varint deltas to the previous keyframe, and finally
+// the 8 byte little endian offset of the index and "K4SI". A file without index, for example of a process that was
+// killed, is indexed by the reader from the packet sizes.
+struct SkeletonKeyframe
+{
+    uint64_t TimestampUsec = 0;
+    uint64_t FileOffset = 0;
+};
+
+namespace SkeletonCodecInternal
+{
+    constexpr char FileMagic[4] = { 'K', '4', 'S', 'K' };
+    constexpr char IndexMagic[4] = { 'K', '4', 'S', 'I' };
+    constexpr uint8_t FileVersion = 1;
+    constexpr size_t FileHeaderSize = 5;
+    constexpr size_t IndexTrailerSize = 12;
+    constexpr uint64_t MaxPacketSize = 1 << 24;     // Larger sizes are taken as corrupt
+}
+
+class SkeletonFileWriter
+{
+public:
+    ~SkeletonFileWriter()
+    {
+        Close();
+    }
+
+    // Creates the file, replacing an existing one
+    bool Open(const std::string& fileName, SkeletonCodecConfig config = SkeletonCodecConfig())
+    {
+        using namespace SkeletonCodecInternal;
+
+        Close();
+        m_file.open(fileName, std::ios::binary | std::ios::trunc);
+        m_file.write(FileMagic, sizeof(FileMagic));
+        m_file.put(static_cast<char>(FileVersion));
+        m_encoder = SkeletonEncoder(config);
+        m_keyframes.clear();
+        m_offset = FileHeaderSize;
+        return m_file.good();
+    }
+
+    bool IsOpen() const { return m_file.is_open(); }
+
+    bool Write(uint64_t timestampUsec, const std::vector<k4abt_body_t>& bodies)
+    {
+        m_packet.clear();
+        if (m_encoder.Encode(timestampUsec, bodies, m_packet))
+        {
+            m_keyframes.push_back({ timestampUsec, m_offset });
+        }
+        m_size.clear();
+        SkeletonCodecInternal::WriteVarint(m_size, m_packet.size());
+        m_file.write(reinterpret_cast<const char*>(m_size.data()), static_cast<std::streamsize>(m_size.size()));
+        m_file.write(reinterpret_cast<const char*>(m_packet.data()), static_cast<std::streamsize>(m_packet.size()));
+        m_offset += m_size.size() + m_packet.size();
+        return m_file.good();
+    }
+
+    // Bytes of the file so far, without the index
+    uint64_t GetSize() const { return m_offset; }
+
+    // Writes the keyframe index and closes the file
+    bool Close()
+    {
+        using namespace SkeletonCodecInternal;
+
+        if (!m_file.is_open())
+        {
+            return true;
+        }
+        std::vector<uint8_t> index;
+        WriteVarint(index, 0);
+        WriteVarint(index, m_keyframes.size());
+        SkeletonKeyframe last;
+        for (const SkeletonKeyframe& keyframe : m_keyframes)
+        {
+            WriteVarint(index, keyframe.TimestampUsec - last.TimestampUsec);
+            WriteVarint(index, keyframe.FileOffset - last.FileOffset);
+            last = keyframe;
+        }
+        const uint64_t indexOffset = m_offset + 1;
+        for (int byte = 0; byte < 8; byte++)
+        {
+            index.push_back(static_cast<uint8_t>(indexOffset >> (8 * byte)));
+        }
+        index.insert(index.end(), std::begin(IndexMagic), std::end(IndexMagic));
+        m_file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()));
+
+        const bool success = m_file.good();
+        m_file.close();
+        return success;
+    }
+
+private:
+    std::ofstream m_file;
+    SkeletonEncoder m_encoder;
+    std::vector<SkeletonKeyframe> m_keyframes;
+    std::vector<uint8_t> m_packet;
+    std::vector<uint8_t> m_size;
+    uint64_t m_offset = 0;
+};
+
+class SkeletonFileReader
+{
+public:
+    bool Open(const std::string& fileName)
+    {
+        using namespace SkeletonCodecInternal;
+
+        m_file.close();
+        m_file.clear();
+        m_file.open(fileName, std::ios::binary);
+        char header[FileHeaderSize] = {};
+        if (!m_file.read(header, FileHeaderSize) || !std::equal(std::begin(FileMagic), std::end(FileMagic), header) ||
+            static_cast<uint8_t>(header[4]) != FileVersion)
+        {
+            m_file.close();
+            return false;
+        }
+
+        m_keyframes.clear();
+        if (!ReadIndex())
+        {
+            ScanIndex();
+        }
+        m_file.clear();
+        m_file.seekg(FileHeaderSize);
+        m_decoder.Reset();
+        m_hasPending = false;
+        return true;
+    }
+
+    // Reads the next frame, false at the end of the stream or at a corrupt packet
+    bool ReadFrame(uint64_t& timestampUsec, std::vector<k4abt_body_t>& bodies)
+    {
+        if (m_hasPending)
+        {
+            m_hasPending = false;
+            timestampUsec = m_pendingTimestampUsec;
+            bodies.swap(m_pendingBodies);
+            return true;
+        }
+
+        uint64_t size = 0;
+        if (!SkeletonCodecInternal::ReadVarint(m_file, size) || size == 0 || size > SkeletonCodecInternal::MaxPacketSize)
+        {
+            return false;
+        }
+        m_packet.resize(static_cast<size_t>(size));
+        if (!m_file.read(reinterpret_cast<char*>(m_packet.data()), static_cast<std::streamsize>(size)))
+        {
+            return false;
+        }
+        return m_decoder.Decode(m_packet, timestampUsec, bodies);
+    }
+
+    // Positions the reader so that the next ReadFrame returns the first frame at or after timestampUsec. Decoding
+    // starts at the last keyframe before it. Returns false if there is no such frame.
+    bool Seek(uint64_t timestampUsec)
+    {
+        m_hasPending = false;
+        if (m_keyframes.empty())
+        {
+            return false;
+        }
+        auto keyframe = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), timestampUsec,
+            [](uint64_t timestamp, const SkeletonKeyframe& entry) { return timestamp < entry.TimestampUsec; });
+        if (keyframe != m_keyframes.begin())
+        {
+            --keyframe;
+        }
+
+        m_file.clear();
+        m_file.seekg(static_cast<std::streamoff>(keyframe->FileOffset));
+        m_decoder.Reset();
+        while (ReadFrame(m_pendingTimestampUsec, m_pendingBodies))
+        {
+            if (m_pendingTimestampUsec >= timestampUsec)
+            {
+                m_hasPending = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Keyframes in file order, timestamps increase if the stream was recorded in one session
+    const std::vector<SkeletonKeyframe>& GetKeyframes() const { return m_keyframes; }
+
+private:
+    bool ReadIndex()
+    {
+        using namespace SkeletonCodecInternal;
+
+        m_file.clear();
+        m_file.seekg(0, std::ios::end);
+        const uint64_t fileSize = static_cast<uint64_t>(m_file.tellg());
+        if (fileSize < FileHeaderSize + IndexTrailerSize)
+        {
+            return false;
+        }
+
+        uint8_t trailer[IndexTrailerSize] = {};
+        m_file.seekg(static_cast<std::streamoff>(fileSize - IndexTrailerSize));
+        if (!m_file.read(reinterpret_cast<char*>(trailer), IndexTrailerSize) ||
+            !std::equal(std::begin(IndexMagic), std::end(IndexMagic), trailer + 8))
+        {
+            return false;
+        }
+        uint64_t indexOffset = 0;
+        for (int byte = 0; byte < 8; byte++)
+        {
+            indexOffset |= static_cast<uint64_t>(trailer[byte]) << (8 * byte);
+        }
+        if (indexOffset < FileHeaderSize || indexOffset > fileSize - IndexTrailerSize)
+        {
+            return false;
+        }
+
+        m_file.seekg(static_cast<std::streamoff>(indexOffset));
+        uint64_t count = 0;
+        if (!ReadVarint(m_file, count) || count > fileSize)
+        {
+            return false;
+        }
+        SkeletonKeyframe keyframe;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            uint64_t timestampDelta = 0;
+            uint64_t offsetDelta = 0;
+            if (!ReadVarint(m_file, timestampDelta) || !ReadVarint(m_file, offsetDelta))
+            {
+                m_keyframes.clear();
+                return false;
+            }
+            keyframe.TimestampUsec += timestampDelta;
+            keyframe.FileOffset += offsetDelta;
+            m_keyframes.push_back(keyframe);
+        }
+        return true;
+    }
+
+    // Reads the size and the start of every packet to find the keyframes
+    void ScanIndex()
+    {
+        using namespace SkeletonCodecInternal;
+
+        m_file.clear();
+        m_file.seekg(FileHeaderSize);
+        uint64_t offset = FileHeaderSize;
+        while (true)
+        {
+            uint64_t size = 0;
+            if (!ReadVarint(m_file, size) || size == 0 || size > MaxPacketSize)
+            {
+                return;
+            }
+            const uint64_t packetOffset = static_cast<uint64_t>(m_file.tellg());
+            const int flags = m_file.get();
+            uint64_t quantizationUm = 0;
+            uint64_t jointMask = 0;
+            uint64_t timestampUsec = 0;
+            if (flags == std::char_traits<char>::eof())
+            {
+                return;
+            }
+            if ((flags & 1) != 0 && ReadVarint(m_file, quantizationUm) && ReadVarint(m_file, jointMask) &&
+                ReadVarint(m_file, timestampUsec))
+            {
+                m_keyframes.push_back({ timestampUsec, offset });
+            }
+            offset = packetOffset + size;
+            m_file.seekg(static_cast<std::streamoff>(offset));
+            if (!m_file)
+            {
+                return;
+            }
+        }
+    }
+
+    std::ifstream m_file;
+    SkeletonDecoder m_decoder;
+    std::vector<SkeletonKeyframe> m_keyframes;
+    std::vector<uint8_t> m_packet;
+    bool m_hasPending = false;
+    uint64_t m_pendingTimestampUsec = 0;
+    std::vector<k4abt_body_t> m_pendingBodies;
+};
@@ -0,0 +1,343 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <k4abttypes.h>
+#include <JointSet.h>
+
+// Temporal smoothing of joint positions and orientations, per body and per joint.
+//
+// Apply it to the bodies of every frame right after k4abt_tracker_pop_result so that all consumers
+// see the same smoothed skeletons. The filter state of a body is kept in struct-of-arrays form with
+// one float array per quantity, so every position update is a plain loop over the joints. GCC vectorizes
+// these loops at -O3 (the Release configuration) and only when errno is not set by std::sqrt, which is why
+// the translation units that include this header are built with -fno-math-errno. Only the joints of the JointSet are filtered (the others are left as measured), so a smoother
+// for a subset such as JointProfiles::Legs does proportionally less work.
+
+enum class SmoothingFilter
+{
+    None,
+    OneEuro,    // Adaptive low pass: little lag on fast motion, strong smoothing at rest
+    Kalman      // Constant velocity Kalman filter, measurement noise scaled by joint confidence
+};
+
+struct SkeletonSmootherConfig
+{
+    SmoothingFilter Filter = SmoothingFilter::OneEuro;
+
+    // One-Euro filter (positions in millimeters)
+    float MinCutoffHz = 1.0f;            // Cutoff frequency at rest
+    float Beta = 0.005f;                 // Cutoff increase per mm/s of joint speed
+    float DerivativeCutoffHz = 1.0f;     // Cutoff of the speed estimate
+
+    // Kalman filter
+    float AccelerationNoise = 4.0e6f;    // Variance of the unmodeled acceleration, (mm/s^2)^2
+    float MeasurementNoise = 100.0f;     // Variance of a medium confidence measurement, mm^2
+
+    // Orientations are moved towards the measurement by this fraction with SLERP, 1 disables smoothing
+    float OrientationWeight = 0.5f;
+
+    // A body that was not seen for longer than this is restarted from its next measurement
+    uint64_t ResetAfterUsec = 500000;
+};
+
+template <typename Joints>
+class BasicSkeletonSmoother
+{
+public:
+    explicit BasicSkeletonSmoother(SkeletonSmootherConfig config = SkeletonSmootherConfig())
+        : m_config(config)
+    {
+    }
+
+    const SkeletonSmootherConfig& GetConfig() const { return m_config; }
+
+    // Smooth the skeletons of one frame in place. Bodies are matched to their filter state by id.
+    void Apply(std::vector<k4abt_body_t>& bodies, uint64_t timestampUsec)
+    {
+        if (m_config.Filter == SmoothingFilter::None)
+        {
+            return;
+        }
+
+        for (BodyState& state : m_states)
+        {
+            state.Seen = false;
+        }
+
+        for (k4abt_body_t& body : bodies)
+        {
+            BodyState& state = FindOrCreateState(body.id);
+            state.Seen = true;
+
+            state.Measurement.Gather(body.skeleton);
+
+            const bool restart = !state.Initialized ||
+                timestampUsec <= state.TimestampUsec ||
+                timestampUsec - state.TimestampUsec > m_config.ResetAfterUsec;
+            if (restart)
+            {
+                Initialize(state, body.skeleton);
+            }
+            else
+            {
+                const float dt = static_cast<float>(timestampUsec - state.TimestampUsec) * 1e-6f;
+                if (m_config.Filter == SmoothingFilter::OneEuro)
+                {
+                    UpdateOneEuro(state, dt);
+                }
+                else
+                {
+                    UpdateKalman(state, dt);
+                }
+                UpdateOrientations(state, body.skeleton);
+            }
+            state.TimestampUsec = timestampUsec;
+
+            state.Scatter(body.skeleton);
+        }
+
+        // Drop the bodies that left the scene, the slots are reused by new bodies
+        for (BodyState& state : m_states)
+        {
+            if (!state.Seen && timestampUsec > state.TimestampUsec + m_config.ResetAfterUsec)
+            {
+                state.Initialized = false;
+            }
+        }
+    }
+
+    void Reset()
+    {
+        m_states.clear();
+    }
+
+private:
+    static constexpr size_t JointCount = Joints::Count;
+    using JointArray = std::array<float, JointCount>;
+
+    struct JointPositions
+    {
+        alignas(32) JointArray X;
+        alignas(32) JointArray Y;
+        alignas(32) JointArray Z;
+        alignas(32) JointArray Confidence;
+
+        void Gather(const k4abt_skeleton_t& skeleton)
+        {
+            for (size_t j = 0; j < JointCount; j++)
+            {
+                const k4abt_joint_t& joint = skeleton.joints[Joints::Ids[j]];
+                X[j] = joint.position.xyz.x;
+                Y[j] = joint.position.xyz.y;
+                Z[j] = joint.position.xyz.z;
+                Confidence[j] = static_cast<float>(joint.confidence_level);
+            }
+        }
+    };
+
+    struct BodyState
+    {
+        uint32_t Id = K4ABT_INVALID_BODY_ID;
+        bool Initialized = false;
+        bool Seen = false;
+        uint64_t TimestampUsec = 0;
+
+        JointPositions Measurement;
+
+        // Filtered position and velocity (mm, mm/s)
+        alignas(32) JointArray X, Y, Z;
+        alignas(32) JointArray VX, VY, VZ;
+
+        // Kalman covariance [P00 P01; P01 P11], shared by the three axes since they use the same noise model
+        alignas(32) JointArray P00, P01, P11;
+
+        std::array<k4a_quaternion_t, JointCount> Orientation;
+
+        void Scatter(k4abt_skeleton_t& skeleton) const
+        {
+            for (size_t j = 0; j < JointCount; j++)
+            {
+                k4abt_joint_t& joint = skeleton.joints[Joints::Ids[j]];
+                joint.position.xyz.x = X[j];
+                joint.position.xyz.y = Y[j];
+                joint.position.xyz.z = Z[j];
+                joint.orientation = Orientation[j];
+            }
+        }
+    };
+
+    BodyState& FindOrCreateState(uint32_t id)
+    {
+        BodyState* freeSlot = nullptr;
+        for (BodyState& state : m_states)
+        {
+            if (state.Initialized && state.Id == id)
+            {
+                return state;
+            }
+            if (!state.Initialized && freeSlot == nullptr)
+            {
+                freeSlot = &state;
+            }
+        }
+        if (freeSlot == nullptr)
+        {
+            m_states.emplace_back();
+            freeSlot = &m_states.back();
+        }
+        freeSlot->Id = id;
+        freeSlot->Initialized = false;
+        return *freeSlot;
+    }
+
+    void Initialize(BodyState& state, const k4abt_skeleton_t& skeleton)
+    {
+        state.X = state.Measurement.X;
+        state.Y = state.Measurement.Y;
+        state.Z = state.Measurement.Z;
+        state.VX.fill(0.f);
+        state.VY.fill(0.f);
+        state.VZ.fill(0.f);
+        state.P00.fill(m_config.MeasurementNoise);
+        state.P01.fill(0.f);
+        state.P11.fill(m_config.AccelerationNoise);
+        for (size_t j = 0; j < JointCount; j++)
+        {
+            state.Orientation[j] = skeleton.joints[Joints::Ids[j]].orientation;
+        }
+        state.Initialized = true;
+    }
+
+    static constexpr float TwoPi = 6.28318531f;
+
+    // Weight of the new sample of an exponential low pass filter with the given cutoff frequency
+    static float SmoothingFactor(float dt, float cutoffHz)
+    {
+        return 1.f / (1.f + 1.f / (TwoPi * cutoffHz * dt));
+    }
+
+    void UpdateOneEuro(BodyState& state, float dt)
+    {
+        const JointPositions& m = state.Measurement;
+        const float derivativeAlpha = SmoothingFactor(dt, m_config.DerivativeCutoffHz);
+        const float inverseDt = 1.f / dt;
+
+        for (size_t j = 0; j < JointCount; j++)
+        {
+            // Low pass filtered speed of the joint
+            state.VX[j] += derivativeAlpha * ((m.X[j] - state.X[j]) * inverseDt - state.VX[j]);
+            state.VY[j] += derivativeAlpha * ((m.Y[j] - state.Y[j]) * inverseDt - state.VY[j]);
+            state.VZ[j] += derivativeAlpha * ((m.Z[j] - state.Z[j]) * inverseDt - state.VZ[j]);
+            const float speed = std::sqrt(state.VX[j] * state.VX[j] + state.VY[j] * state.VY[j] + state.VZ[j] * state.VZ[j]);
+
+            // Cutoff grows with the speed, which keeps the lag small during fast motion
+            const float alpha = SmoothingFactor(dt, m_config.MinCutoffHz + m_config.Beta * speed);
+
+            state.X[j] += alpha * (m.X[j] - state.X[j]);
+            state.Y[j] += alpha * (m.Y[j] - state.Y[j]);
+            state.Z[j] += alpha * (m.Z[j] - state.Z[j]);
+        }
+    }
+
+    void UpdateKalman(BodyState& state, float dt)
+    {
+        const JointPositions& m = state.Measurement;
+        const float q = m_config.AccelerationNoise;
+        const float q00 = q * dt * dt * dt * dt * 0.25f;
+        const float q01 = q * dt * dt * dt * 0.5f;
+        const float q11 = q * dt * dt;
+        const float mediumConfidence = static_cast<float>(K4ABT_JOINT_CONFIDENCE_MEDIUM);
+
+        for (size_t j = 0; j < JointCount; j++)
+        {
+            // Predict
+            const float px = state.X[j] + state.VX[j] * dt;
+            const float py = state.Y[j] + state.VY[j] * dt;
+            const float pz = state.Z[j] + state.VZ[j] * dt;
+            const float p00 = state.P00[j] + dt * (2.f * state.P01[j] + dt * state.P11[j]) + q00;
+            const float p01 = state.P01[j] + dt * state.P11[j] + q01;
+            const float p11 = state.P11[j] + q11;
+
+            // Trust low confidence (predicted or occluded) joints less
+            const float confidenceScale = m.Confidence[j] >= mediumConfidence ? 1.f : (m.Confidence[j] > 0.f ? 4.f : 16.f);
+            const float r = m_config.MeasurementNoise * confidenceScale;
+
+            // Update
+            const float inverseS = 1.f / (p00 + r);
+            const float k0 = p00 * inverseS;
+            const float k1 = p01 * inverseS;
+            const float ex = m.X[j] - px;
+            const float ey = m.Y[j] - py;
+            const float ez = m.Z[j] - pz;
+
+            state.X[j] = px + k0 * ex;
+            state.Y[j] = py + k0 * ey;
+            state.Z[j] = pz + k0 * ez;
+            state.VX[j] += k1 * ex;
+            state.VY[j] += k1 * ey;
+            state.VZ[j] += k1 * ez;
+
+            state.P00[j] = (1.f - k0) * p00;
+            state.P01[j] = (1.f - k0) * p01;
+            state.P11[j] = p11 - k1 * p01;
+        }
+    }
+
+    void UpdateOrientations(BodyState& state, const k4abt_skeleton_t& skeleton)
+    {
+        const float t = m_config.OrientationWeight;
+        for (size_t j = 0; j < JointCount; j++)
+        {
+            state.Orientation[j] = Slerp(state.Orientation[j], skeleton.joints[Joints::Ids[j]].orientation, t);
+        }
+    }
+
+    static k4a_quaternion_t Slerp(const k4a_quaternion_t& from, const k4a_quaternion_t& to, float t)
+    {
+        float dot = from.wxyz.w * to.wxyz.w + from.wxyz.x * to.wxyz.x + from.wxyz.y * to.wxyz.y + from.wxyz.z * to.wxyz.z;
+
+        // q and -q are the same rotation, take the short way
+        const float sign = dot < 0.f ? -1.f : 1.f;
+        dot *= sign;
+
+        float wFrom = 1.f - t;
+        float wTo = t * sign;
+        if (dot < 0.9995f)
+        {
+            const float theta = std::acos(dot);
+            const float inverseSinTheta = 1.f / std::sin(theta);
+            wFrom = std::sin((1.f - t) * theta) * inverseSinTheta;
+            wTo = std::sin(t * theta) * inverseSinTheta * sign;
+        }
+
+        k4a_quaternion_t result;
+        result.wxyz.w = wFrom * from.wxyz.w + wTo * to.wxyz.w;
+        result.wxyz.x = wFrom * from.wxyz.x + wTo * to.wxyz.x;
+        result.wxyz.y = wFrom * from.wxyz.y + wTo * to.wxyz.y;
+        result.wxyz.z = wFrom * from.wxyz.z + wTo * to.wxyz.z;
+
+        // Renormalize, needed after the linear fallback for nearly equal rotations
+        const float norm = std::sqrt(result.wxyz.w * result.wxyz.w + result.wxyz.x * result.wxyz.x +
+            result.wxyz.y * result.wxyz.y + result.wxyz.z * result.wxyz.z);
+        if (norm > 0.f)
+        {
+            const float inverseNorm = 1.f / norm;
+            result.wxyz.w *= inverseNorm;
+            result.wxyz.x *= inverseNorm;
+            result.wxyz.y *= inverseNorm;
+            result.wxyz.z *= inverseNorm;
+        }
+        return result;
+    }
+
+    SkeletonSmootherConfig m_config;
+    std::vector<BodyState> m_states;
+};
+
+using SkeletonSmoother = BasicSkeletonSmoother<JointProfiles::Full>;
@@ -0,0 +1,236 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+// Decides which captures of a device go to the body tracker when inference is slower than the camera, instead of
+// losing whichever captures arrive while the queue of the SDK happens to be full.
+//
+// The controller follows the captures in the tracker (enqueued, not popped yet), their residency from enqueue to
+// pop, and the service time of the tracker: the time it spent on one capture, from the later of its enqueue and the
+// previous pop until its pop. The policy decides what overload costs:
+//
+//     LowestLatency    At most one capture is in the tracker. While it is busy only the newest capture is held
+//                      and enqueued as soon as the tracker is free, so every result is as fresh as possible.
+//     HighestCoverage  Captures are admitted at an even fraction of the camera rate (1, 1/2, 1/4, 1/8) that the
+//                      service time can sustain, so results stay evenly spaced in time. The queue is kept short
+//                      so that the residency does not grow with the backlog.
+//
+// Every capture that is not enqueued is counted with its reason. For use by the capture thread only.
+enum class AdmissionPolicy
+{
+    LowestLatency,
+    HighestCoverage
+};
+
+enum class AdmissionDecision
+{
+    Enqueue,    // Enqueue the capture now
+    Hold,       // Keep the capture instead of the held one, enqueue it when CanEnqueueHeld()
+    Drop        // Release the capture, the drop is already counted
+};
+
+enum class DropReason
+{
+    TrackerBusy,    // The tracker had as many captures as allowed
+    Superseded,     // A held capture was replaced by a newer one
+    Decimated,      // Not part of the admitted fraction of the camera rate
+    QueueFull,      // Admitted, but the SDK queue timed out
+    Count
+};
+
+constexpr size_t DropReasonCount = static_cast<size_t>(DropReason::Count);
+
+inline constexpr std::array<const char*, DropReasonCount> g_dropReasonNames =
+{
+    "tracker_busy",
+    "superseded",
+    "decimated",
+    "queue_full",
+};
+
+struct AdmissionStatistics
+{
+    uint64_t Captures = 0;
+    uint64_t Enqueued = 0;
+    std::array<uint64_t, DropReasonCount> Dropped{};
+    size_t InFlight = 0;
+    int Decimation = 1;             // Every Decimation-th capture is admitted
+    double ResidencyMs = 0.0;       // Moving averages
+    double ServiceTimeMs = 0.0;
+    double CaptureIntervalMs = 0.0;
+    double PopIntervalMs = 0.0;
+};
+
+class TrackerAdmissionController
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int MaxDecimation = 8;
+
+    // maxInFlight bounds the captures in the tracker for HighestCoverage; LowestLatency always keeps one
+    explicit TrackerAdmissionController(AdmissionPolicy policy, size_t maxInFlight = 2)
+        : m_policy(policy)
+        , m_maxInFlight(policy == AdmissionPolicy::LowestLatency ? 1 : std::max<size_t>(maxInFlight, 1))
+    {
+    }
+
+    AdmissionPolicy GetPolicy() const { return m_policy; }
+
+    // Decision for a new capture from the device
+    AdmissionDecision OnCapture(Clock::time_point now)
+    {
+        m_statistics.Captures++;
+        if (m_lastCapture != Clock::time_point())
+        {
+            Average(m_statistics.CaptureIntervalMs, ToMs(now - m_lastCapture));
+        }
+        m_lastCapture = now;
+
+        if (m_policy == AdmissionPolicy::LowestLatency)
+        {
+            if (m_inFlight.size() < m_maxInFlight && !m_holding)
+            {
+                return AdmissionDecision::Enqueue;
+            }
+            if (m_holding)
+            {
+                Drop(DropReason::Superseded);
+            }
+            m_holding = true;
+            return AdmissionDecision::Hold;
+        }
+
+        if (m_captureIndex++ % static_cast<uint64_t>(m_statistics.Decimation) != 0)
+        {
+            Drop(DropReason::Decimated);
+            return AdmissionDecision::Drop;
+        }
+        if (m_inFlight.size() >= m_maxInFlight)
+        {
+            Drop(DropReason::TrackerBusy);
+            return AdmissionDecision::Drop;
+        }
+        return AdmissionDecision::Enqueue;
+    }
+
+    // True when the held capture should be enqueued now
+    bool CanEnqueueHeld() const
+    {
+        return m_holding && m_inFlight.size() < m_maxInFlight;
+    }
+
+    // Called when an enqueued or held capture was accepted by the tracker
+    void OnEnqueued(uint64_t deviceTimestampUsec, Clock::time_point now)
+    {
+        m_holding = false;
+        m_statistics.Enqueued++;
+        m_inFlight.emplace_back(deviceTimestampUsec, now);
+        m_statistics.InFlight = m_inFlight.size();
+    }
+
+    // Called when an enqueued or held capture timed out in the SDK queue
+    void OnQueueFull()
+    {
+        m_holding = false;
+        Drop(DropReason::QueueFull);
+    }
+
+    // Called for every popped body frame
+    void OnPopped(uint64_t deviceTimestampUsec, Clock::time_point now)
+    {
+        // The tracker returns results in enqueue order; skip the older captures it never returned. A timestamp that
+        // is not in flight leaves the later captures waiting for their own results.
+        while (!m_inFlight.empty() && m_inFlight.front().first < deviceTimestampUsec)
+        {
+            m_inFlight.pop_front();
+        }
+        if (!m_inFlight.empty() && m_inFlight.front().first == deviceTimestampUsec)
+        {
+            const Clock::time_point enqueued = m_inFlight.front().second;
+            m_inFlight.pop_front();
+            Average(m_statistics.ResidencyMs, ToMs(now - enqueued));
+            const Clock::time_point serviceStart = m_lastPop != Clock::time_point() ? std::max(enqueued, m_lastPop) : enqueued;
+            Average(m_statistics.ServiceTimeMs, ToMs(now - serviceStart));
+        }
+        if (m_lastPop != Clock::time_point())
+        {
+            Average(m_statistics.PopIntervalMs, ToMs(now - m_lastPop));
+        }
+        m_lastPop = now;
+        m_statistics.InFlight = m_inFlight.size();
+
+        if (m_policy == AdmissionPolicy::HighestCoverage)
+        {
+            UpdateDecimation();
+        }
+    }
+
+    const AdmissionStatistics& GetStatistics() const { return m_statistics; }
+
+    uint64_t GetDroppedCount() const
+    {
+        uint64_t dropped = 0;
+        for (uint64_t count : m_statistics.Dropped)
+        {
+            dropped += count;
+        }
+        return dropped;
+    }
+
+private:
+    // Smallest power of two decimation whose admitted interval the service time fits into, with some headroom.
+    // It only goes back to the next finer rate when the service time clearly fits, so it does not oscillate.
+    void UpdateDecimation()
+    {
+        const double captureIntervalMs = m_statistics.CaptureIntervalMs;
+        const double serviceTimeMs = m_statistics.ServiceTimeMs;
+        if (captureIntervalMs <= 0.0 || serviceTimeMs <= 0.0)
+        {
+            return;
+        }
+
+        int& decimation = m_statistics.Decimation;
+        if (serviceTimeMs > 0.95 * captureIntervalMs * decimation && decimation < MaxDecimation)
+        {
+            decimation *= 2;
+        }
+        else if (decimation > 1 && serviceTimeMs < 0.75 * captureIntervalMs * (decimation / 2))
+        {
+            decimation /= 2;
+        }
+    }
+
+    void Drop(DropReason reason)
+    {
+        m_statistics.Dropped[static_cast<size_t>(reason)]++;
+    }
+
+    static double ToMs(Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    // Exponential moving average over roughly the last 16 values
+    static void Average(double& average, double value)
+    {
+        average = average == 0.0 ? value : average + (value - average) / 16.0;
+    }
+
+    AdmissionPolicy m_policy;
+    size_t m_maxInFlight;
+    AdmissionStatistics m_statistics;
+    std::deque<std::pair<uint64_t, Clock::time_point>> m_inFlight;
+    bool m_holding = false;
+    uint64_t m_captureIndex = 0;
+    Clock::time_point m_lastCapture;
+    Clock::time_point m_lastPop;
+};
@@ -0,0 +1,671 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// Stand-in implementation of the subset of the Azure Kinect Sensor SDK (k4a.h) that the samples use
+
+#include <k4a/k4a.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "StandInObjects.h"
+#include "StandInScene.h"
+#include "StandInSettings.h"
+
+using namespace std::chrono;
+
+namespace
+{
+    // The device clock starts a little before the first capture, like on the real device
+    const uint64_t DeviceClockStartUsec = 200000;
+    const uint64_t ImuSamplePeriodUsec = 625;   // 1.6 kHz
+
+    uint32_t GetFramesPerSecond(k4a_fps_t fps)
+    {
+        switch (fps)
+        {
+        case K4A_FRAMES_PER_SECOND_5: return 5;
+        case K4A_FRAMES_PER_SECOND_15: return 15;
+        default: return 30;
+        }
+    }
+
+    // Wait until a deadline, at most timeoutInMs (K4A_WAIT_INFINITE: no limit). Returns false on timeout.
+    bool WaitUntil(steady_clock::time_point deadline, int32_t timeoutInMs)
+    {
+        if (timeoutInMs != K4A_WAIT_INFINITE && deadline > steady_clock::now() + milliseconds(timeoutInMs))
+        {
+            std::this_thread::sleep_for(milliseconds(timeoutInMs));
+            return false;
+        }
+        std::this_thread::sleep_until(deadline);
+        return true;
+    }
+
+    struct Device
+    {
+        uint32_t Index = 0;
+        StandIn::Settings Settings;
+
+        std::mutex CameraMutex;
+        bool CamerasRunning = false;
+        steady_clock::time_point CamerasStart;
+        uint64_t FramePeriodUsec = 0;
+        uint64_t NextFrameIndex = 0;
+        std::unique_ptr<StandIn::SkeletonSource> Source;
+        std::unique_ptr<StandIn::SceneRenderer> Renderer;
+        std::vector<k4abt_body_t> Bodies;
+
+        std::mutex ImuMutex;
+        bool ImuRunning = false;
+        steady_clock::time_point ImuStart;
+        uint64_t NextImuIndex = 0;
+    };
+
+    std::mutex g_devicesMutex;
+    std::vector<bool> g_openDevices;
+
+    Device* FromHandle(k4a_device_t handle) { return reinterpret_cast<Device*>(handle); }
+
+    struct Transformation
+    {
+        k4a_calibration_t Calibration;
+    };
+
+    Transformation* FromHandle(k4a_transformation_t handle) { return reinterpret_cast<Transformation*>(handle); }
+}
+
+/************************************************ Images and captures ************************************************/
+
+uint64_t StandIn::GetSystemTimestampNsec()
+{
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+StandIn::Image* StandIn::CreateImage(k4a_image_format_t format, int width, int height, int stride)
+{
+    Image* image = new Image();
+    image->Format = format;
+    image->Width = width;
+    image->Height = height;
+    image->Stride = stride;
+    image->Buffer.resize(static_cast<size_t>(stride) * height);
+    return image;
+}
+
+void StandIn::ReferenceImage(Image* image)
+{
+    image->References.fetch_add(1, std::memory_order_relaxed);
+}
+
+void StandIn::ReleaseImage(Image* image)
+{
+    if (image != nullptr && image->References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        delete image;
+    }
+}
+
+StandIn::Capture* StandIn::CreateCapture()
+{
+    return new Capture();
+}
+
+void StandIn::ReferenceCapture(Capture* capture)
+{
+    capture->References.fetch_add(1, std::memory_order_relaxed);
+}
+
+void StandIn::ReleaseCapture(Capture* capture)
+{
+    if (capture != nullptr && capture->References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        ReleaseImage(capture->Color);
+        ReleaseImage(capture->Depth);
+        ReleaseImage(capture->Ir);
+        ReleaseImage(capture->BodyIndexMap);
+        delete capture;
+    }
+}
+
+void StandIn::SetCaptureImage(Image*& slot, Image* image)
+{
+    if (image != nullptr)
+    {
+        ReferenceImage(image);
+    }
+    ReleaseImage(slot);
+    slot = image;
+}
+
+namespace
+{
+    // The getters return a new reference, released by the caller
+    k4a_image_t GetCaptureImage(StandIn::Image* image)
+    {
+        if (image == nullptr)
+        {
+            return nullptr;
+        }
+        StandIn::ReferenceImage(image);
+        return StandIn::ToHandle(image);
+    }
+}
+
+k4a_result_t k4a_capture_create(k4a_capture_t* capture_handle)
+{
+    *capture_handle = StandIn::ToHandle(StandIn::CreateCapture());
+    return K4A_RESULT_SUCCEEDED;
+}
+
+void k4a_capture_reference(k4a_capture_t capture_handle)
+{
+    StandIn::ReferenceCapture(StandIn::FromHandle(capture_handle));
+}
+
+void k4a_capture_release(k4a_capture_t capture_handle)
+{
+    StandIn::ReleaseCapture(StandIn::FromHandle(capture_handle));
+}
+
+k4a_image_t k4a_capture_get_color_image(k4a_capture_t capture_handle)
+{
+    return GetCaptureImage(StandIn::FromHandle(capture_handle)->Color);
+}
+
+k4a_image_t k4a_capture_get_depth_image(k4a_capture_t capture_handle)
+{
+    return GetCaptureImage(StandIn::FromHandle(capture_handle)->Depth);
+}
+
+k4a_image_t k4a_capture_get_ir_image(k4a_capture_t capture_handle)
+{
+    return GetCaptureImage(StandIn::FromHandle(capture_handle)->Ir);
+}
+
+void k4a_capture_set_color_image(k4a_capture_t capture_handle, k4a_image_t image_handle)
+{
+    StandIn::SetCaptureImage(StandIn::FromHandle(capture_handle)->Color, StandIn::FromHandle(image_handle));
+}
+
+void k4a_capture_set_depth_image(k4a_capture_t capture_handle, k4a_image_t image_handle)
+{
+    StandIn::SetCaptureImage(StandIn::FromHandle(capture_handle)->Depth, StandIn::FromHandle(image_handle));
+}
+
+void k4a_capture_set_ir_image(k4a_capture_t capture_handle, k4a_image_t image_handle)
+{
+    StandIn::SetCaptureImage(StandIn::FromHandle(capture_handle)->Ir, StandIn::FromHandle(image_handle));
+}
+
+k4a_result_t k4a_image_create(k4a_image_format_t format, int width_pixels, int height_pixels, int stride_bytes, k4a_image_t* image_handle)
+{
+    if (width_pixels <= 0 || height_pixels <= 0 || stride_bytes < 0)
+    {
+        return K4A_RESULT_FAILED;
+    }
+    if (stride_bytes == 0)
+    {
+        // Only the formats with a fixed pixel size can compute their stride
+        switch (format)
+        {
+        case K4A_IMAGE_FORMAT_DEPTH16:
+        case K4A_IMAGE_FORMAT_IR16:
+        case K4A_IMAGE_FORMAT_CUSTOM16: stride_bytes = width_pixels * 2; break;
+        case K4A_IMAGE_FORMAT_COLOR_BGRA32: stride_bytes = width_pixels * 4; break;
+        case K4A_IMAGE_FORMAT_CUSTOM8: stride_bytes = width_pixels; break;
+        default: return K4A_RESULT_FAILED;
+        }
+    }
+    *image_handle = StandIn::ToHandle(StandIn::CreateImage(format, width_pixels, height_pixels, stride_bytes));
+    return K4A_RESULT_SUCCEEDED;
+}
+
+uint8_t* k4a_image_get_buffer(k4a_image_t image_handle)
+{
+    return image_handle != nullptr ? StandIn::FromHandle(image_handle)->Buffer.data() : nullptr;
+}
+
+size_t k4a_image_get_size(k4a_image_t image_handle)
+{
+    return image_handle != nullptr ? StandIn::FromHandle(image_handle)->Buffer.size() : 0;
+}
+
+k4a_image_format_t k4a_image_get_format(k4a_image_t image_handle)
+{
+    return StandIn::FromHandle(image_handle)->Format;
+}
+
+int k4a_image_get_width_pixels(k4a_image_t image_handle)
+{
+    return image_handle != nullptr ? StandIn::FromHandle(image_handle)->Width : 0;
+}
+
+int k4a_image_get_height_pixels(k4a_image_t image_handle)
+{
+    return image_handle != nullptr ? StandIn::FromHandle(image_handle)->Height : 0;
+}
+
+int k4a_image_get_stride_bytes(k4a_image_t image_handle)
+{
+    return image_handle != nullptr ? StandIn::FromHandle(image_handle)->Stride : 0;
+}
+
+uint64_t k4a_image_get_device_timestamp_usec(k4a_image_t image_handle)
+{
+    return image_handle != nullptr ? StandIn::FromHandle(image_handle)->DeviceTimestampUsec : 0;
+}
+
+uint64_t k4a_image_get_system_timestamp_nsec(k4a_image_t image_handle)
+{
+    return image_handle != nullptr ? StandIn::FromHandle(image_handle)->SystemTimestampNsec : 0;
+}
+
+void k4a_image_set_device_timestamp_usec(k4a_image_t image_handle, uint64_t timestamp_usec)
+{
+    StandIn::FromHandle(image_handle)->DeviceTimestampUsec = timestamp_usec;
+}
+
+void k4a_image_set_system_timestamp_nsec(k4a_image_t image_handle, uint64_t timestamp_nsec)
+{
+    StandIn::FromHandle(image_handle)->SystemTimestampNsec = timestamp_nsec;
+}
+
+void k4a_image_reference(k4a_image_t image_handle)
+{
+    StandIn::ReferenceImage(StandIn::FromHandle(image_handle));
+}
+
+void k4a_image_release(k4a_image_t image_handle)
+{
+    StandIn::ReleaseImage(StandIn::FromHandle(image_handle));
+}
+
+/****************************************************** Device ******************************************************/
+
+uint32_t k4a_device_get_installed_count(void)
+{
+    return StandIn::GetSettings().DeviceCount;
+}
+
+k4a_result_t k4a_device_open(uint32_t index, k4a_device_t* device_handle)
+{
+    const StandIn::Settings settings = StandIn::GetSettings();
+    std::lock_guard<std::mutex> lock(g_devicesMutex);
+    g_openDevices.resize(settings.DeviceCount, false);
+    if (index >= settings.DeviceCount || g_openDevices[index])
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    Device* device = new Device();
+    device->Index = index;
+    device->Settings = settings;
+    g_openDevices[index] = true;
+    *device_handle = reinterpret_cast<k4a_device_t>(device);
+    return K4A_RESULT_SUCCEEDED;
+}
+
+void k4a_device_close(k4a_device_t device_handle)
+{
+    Device* device = FromHandle(device_handle);
+    if (device == nullptr)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_devicesMutex);
+        g_openDevices[device->Index] = false;
+    }
+    delete device;
+}
+
+k4a_buffer_result_t k4a_device_get_serialnum(k4a_device_t device_handle, char* serial_number, size_t* serial_number_size)
+{
+    char serial[32];
+    std::snprintf(serial, sizeof(serial), "%012u", FromHandle(device_handle)->Index);
+    const size_t size = std::strlen(serial) + 1;
+    if (serial_number == nullptr || *serial_number_size < size)
+    {
+        *serial_number_size = size;
+        return K4A_BUFFER_RESULT_TOO_SMALL;
+    }
+    std::memcpy(serial_number, serial, size);
+    *serial_number_size = size;
+    return K4A_BUFFER_RESULT_SUCCEEDED;
+}
+
+k4a_result_t k4a_device_get_sync_jack(k4a_device_t device_handle, bool* sync_in_jack_connected, bool* sync_out_jack_connected)
+{
+    // With sync cables device 0 is the first device of the daisy chain
+    const Device* device = FromHandle(device_handle);
+    const bool chained = device->Settings.SyncCables && device->Settings.DeviceCount > 1;
+    *sync_in_jack_connected = chained && device->Index > 0;
+    *sync_out_jack_connected = chained && device->Index + 1 < device->Settings.DeviceCount;
+    return K4A_RESULT_SUCCEEDED;
+}
+
+k4a_result_t k4a_device_get_calibration(k4a_device_t, const k4a_depth_mode_t depth_mode, const k4a_color_resolution_t color_resolution, k4a_calibration_t* calibration)
+{
+    *calibration = StandIn::CreateCalibration(depth_mode, color_resolution);
+    return K4A_RESULT_SUCCEEDED;
+}
+
+k4a_result_t k4a_device_start_cameras(k4a_device_t device_handle, const k4a_device_configuration_t* config)
+{
+    Device* device = FromHandle(device_handle);
+    std::lock_guard<std::mutex> lock(device->CameraMutex);
+    if (device->CamerasRunning || config->depth_mode == K4A_DEPTH_MODE_OFF)
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    // Same checks as the Sensor SDK: the master needs its sync out and its color camera, a subordinate its sync in
+    bool syncInConnected = false;
+    bool syncOutConnected = false;
+    k4a_device_get_sync_jack(device_handle, &syncInConnected, &syncOutConnected);
+    if ((config->wired_sync_mode == K4A_WIRED_SYNC_MODE_MASTER &&
+            (!syncOutConnected || config->color_resolution == K4A_COLOR_RESOLUTION_OFF)) ||
+        (config->wired_sync_mode == K4A_WIRED_SYNC_MODE_SUBORDINATE && !syncInConnected))
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    try
+    {
+        device->Source = std::make_unique<StandIn::SkeletonSource>(device->Settings);
+    }
+    catch (const std::runtime_error&)
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    const uint32_t fps = device->Settings.FramesPerSecond > 0 ? device->Settings.FramesPerSecond : GetFramesPerSecond(config->camera_fps);
+    device->FramePeriodUsec = 1000000 / fps;
+    device->Renderer = std::make_unique<StandIn::SceneRenderer>(
+        StandIn::CreateCalibration(config->depth_mode, config->color_resolution), config->color_format);
+    device->NextFrameIndex = 0;
+    device->CamerasStart = steady_clock::now();
+    device->CamerasRunning = true;
+    return K4A_RESULT_SUCCEEDED;
+}
+
+void k4a_device_stop_cameras(k4a_device_t device_handle)
+{
+    Device* device = FromHandle(device_handle);
+    std::lock_guard<std::mutex> lock(device->CameraMutex);
+    device->CamerasRunning = false;
+    device->Renderer.reset();
+    device->Source.reset();
+}
+
+k4a_wait_result_t k4a_device_get_capture(k4a_device_t device_handle, k4a_capture_t* capture_handle, int32_t timeout_in_ms)
+{
+    Device* device = FromHandle(device_handle);
+    std::lock_guard<std::mutex> lock(device->CameraMutex);
+    if (!device->CamerasRunning)
+    {
+        return K4A_WAIT_RESULT_FAILED;
+    }
+
+    // A consumer that falls behind gets the latest capture, older ones are dropped like on the device
+    const uint64_t elapsedUsec = static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now() - device->CamerasStart).count());
+    const uint64_t latestFrameIndex = elapsedUsec / device->FramePeriodUsec;
+    if (latestFrameIndex > device->NextFrameIndex + 1)
+    {
+        device->NextFrameIndex = latestFrameIndex;
+    }
+
+    const uint64_t frameIndex = device->NextFrameIndex;
+    if (!WaitUntil(device->CamerasStart + microseconds(frameIndex * device->FramePeriodUsec), timeout_in_ms))
+    {
+        return K4A_WAIT_RESULT_TIMEOUT;
+    }
+    device->NextFrameIndex++;
+
+    const uint64_t timestampUsec = DeviceClockStartUsec + frameIndex * device->FramePeriodUsec;
+    device->Source->GetBodies(frameIndex, timestampUsec, device->Bodies);
+    *capture_handle = StandIn::ToHandle(device->Renderer->CreateCapture(device->Bodies, timestampUsec));
+    return K4A_WAIT_RESULT_SUCCEEDED;
+}
+
+k4a_result_t k4a_device_start_imu(k4a_device_t device_handle)
+{
+    Device* device = FromHandle(device_handle);
+    std::lock_guard<std::mutex> lock(device->ImuMutex);
+    if (device->ImuRunning)
+    {
+        return K4A_RESULT_FAILED;
+    }
+    device->ImuStart = steady_clock::now();
+    device->NextImuIndex = 0;
+    device->ImuRunning = true;
+    return K4A_RESULT_SUCCEEDED;
+}
+
+void k4a_device_stop_imu(k4a_device_t device_handle)
+{
+    Device* device = FromHandle(device_handle);
+    std::lock_guard<std::mutex> lock(device->ImuMutex);
+    device->ImuRunning = false;
+}
+
+k4a_wait_result_t k4a_device_get_imu_sample(k4a_device_t device_handle, k4a_imu_sample_t* imu_sample, int32_t timeout_in_ms)
+{
+    Device* device = FromHandle(device_handle);
+    std::lock_guard<std::mutex> lock(device->ImuMutex);
+    if (!device->ImuRunning)
+    {
+        return K4A_WAIT_RESULT_FAILED;
+    }
+
+    const uint64_t sampleIndex = device->NextImuIndex;
+    if (!WaitUntil(device->ImuStart + microseconds(sampleIndex * ImuSamplePeriodUsec), timeout_in_ms))
+    {
+        return K4A_WAIT_RESULT_TIMEOUT;
+    }
+    device->NextImuIndex++;
+
+    // The device is level and at rest: the accelerometer measures 1 g upwards (-y), with a little vibration
+    const uint64_t timestampUsec = DeviceClockStartUsec + sampleIndex * ImuSamplePeriodUsec;
+    const float vibration = 0.02f * std::sin(static_cast<float>(sampleIndex) * 0.37f);
+    imu_sample->temperature = 30.f;
+    imu_sample->acc_sample = { vibration, -9.81f, -vibration };
+    imu_sample->acc_timestamp_usec = timestampUsec;
+    imu_sample->gyro_sample = { 0.f, 0.f, 0.f };
+    imu_sample->gyro_timestamp_usec = timestampUsec;
+    return K4A_WAIT_RESULT_SUCCEEDED;
+}
+
+/************************************************** Calibration ***************************************************/
+
+namespace
+{
+    const k4a_calibration_camera_t* GetCamera(const k4a_calibration_t* calibration, k4a_calibration_type_t camera)
+    {
+        switch (camera)
+        {
+        case K4A_CALIBRATION_TYPE_DEPTH: return &calibration->depth_camera_calibration;
+        case K4A_CALIBRATION_TYPE_COLOR: return &calibration->color_camera_calibration;
+        default: return nullptr;
+        }
+    }
+
+    bool IsValidType(k4a_calibration_type_t type)
+    {
+        return type > K4A_CALIBRATION_TYPE_UNKNOWN && type < K4A_CALIBRATION_TYPE_NUM;
+    }
+}
+
+k4a_result_t k4a_calibration_3d_to_3d(const k4a_calibration_t* calibration, const k4a_float3_t* source_point3d_mm,
+    const k4a_calibration_type_t source_camera, const k4a_calibration_type_t target_camera, k4a_float3_t* target_point3d_mm)
+{
+    if (!IsValidType(source_camera) || !IsValidType(target_camera))
+    {
+        return K4A_RESULT_FAILED;
+    }
+    const k4a_calibration_extrinsics_t& extrinsics = calibration->extrinsics[source_camera][target_camera];
+    const float* r = extrinsics.rotation;
+    const float* t = extrinsics.translation;
+    const k4a_float3_t p = *source_point3d_mm;
+    *target_point3d_mm = {
+        r[0] * p.xyz.x + r[1] * p.xyz.y + r[2] * p.xyz.z + t[0],
+        r[3] * p.xyz.x + r[4] * p.xyz.y + r[5] * p.xyz.z + t[1],
+        r[6] * p.xyz.x + r[7] * p.xyz.y + r[8] * p.xyz.z + t[2] };
+    return K4A_RESULT_SUCCEEDED;
+}
+
+k4a_result_t k4a_calibration_2d_to_3d(const k4a_calibration_t* calibration, const k4a_float2_t* source_point2d, const float source_depth_mm,
+    const k4a_calibration_type_t source_camera, const k4a_calibration_type_t target_camera, k4a_float3_t* target_point3d_mm, int* valid)
+{
+    const k4a_calibration_camera_t* camera = GetCamera(calibration, source_camera);
+    if (camera == nullptr || !IsValidType(target_camera))
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    const auto& intrinsics = camera->intrinsics.parameters.param;
+    const k4a_float3_t sourcePoint = {
+        (source_point2d->xy.x - intrinsics.cx) / intrinsics.fx * source_depth_mm,
+        (source_point2d->xy.y - intrinsics.cy) / intrinsics.fy * source_depth_mm,
+        source_depth_mm };
+    *valid = source_depth_mm > 0.f ? 1 : 0;
+    return k4a_calibration_3d_to_3d(calibration, &sourcePoint, source_camera, target_camera, target_point3d_mm);
+}
+
+k4a_result_t k4a_calibration_3d_to_2d(const k4a_calibration_t* calibration, const k4a_float3_t* source_point3d_mm,
+    const k4a_calibration_type_t source_camera, const k4a_calibration_type_t target_camera, k4a_float2_t* target_point2d, int* valid)
+{
+    const k4a_calibration_camera_t* camera = GetCamera(calibration, target_camera);
+    k4a_float3_t targetPoint;
+    if (camera == nullptr || k4a_calibration_3d_to_3d(calibration, source_point3d_mm, source_camera, target_camera, &targetPoint) != K4A_RESULT_SUCCEEDED)
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    const auto& intrinsics = camera->intrinsics.parameters.param;
+    if (targetPoint.xyz.z <= 0.f)
+    {
+        *target_point2d = { 0.f, 0.f };
+        *valid = 0;
+        return K4A_RESULT_SUCCEEDED;
+    }
+    *target_point2d = {
+        intrinsics.fx * targetPoint.xyz.x / targetPoint.xyz.z + intrinsics.cx,
+        intrinsics.fy * targetPoint.xyz.y / targetPoint.xyz.z + intrinsics.cy };
+    *valid = target_point2d->xy.x >= 0.f && target_point2d->xy.x < camera->resolution_width &&
+        target_point2d->xy.y >= 0.f && target_point2d->xy.y < camera->resolution_height ? 1 : 0;
+    return K4A_RESULT_SUCCEEDED;
+}
+
+/************************************************* Transformation *************************************************/
+
+k4a_transformation_t k4a_transformation_create(const k4a_calibration_t* calibration)
+{
+    return reinterpret_cast<k4a_transformation_t>(new Transformation{ *calibration });
+}
+
+void k4a_transformation_destroy(k4a_transformation_t transformation_handle)
+{
+    delete FromHandle(transformation_handle);
+}
+
+k4a_result_t k4a_transformation_depth_image_to_point_cloud(k4a_transformation_t transformation_handle, const k4a_image_t depth_image,
+    const k4a_calibration_type_t camera, k4a_image_t xyz_image)
+{
+    const k4a_calibration_camera_t* cameraCalibration = GetCamera(&FromHandle(transformation_handle)->Calibration, camera);
+    const StandIn::Image* depth = StandIn::FromHandle(depth_image);
+    StandIn::Image* xyz = StandIn::FromHandle(xyz_image);
+    if (cameraCalibration == nullptr || depth->Width != xyz->Width || depth->Height != xyz->Height ||
+        xyz->Buffer.size() < static_cast<size_t>(depth->Width) * depth->Height * 3 * sizeof(int16_t))
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    const auto& intrinsics = cameraCalibration->intrinsics.parameters.param;
+    int16_t* points = reinterpret_cast<int16_t*>(xyz->Buffer.data());
+    for (int v = 0; v < depth->Height; v++)
+    {
+        const uint16_t* depthRow = reinterpret_cast<const uint16_t*>(depth->Buffer.data() + v * depth->Stride);
+        const float rayY = (static_cast<float>(v) - intrinsics.cy) / intrinsics.fy;
+        for (int u = 0; u < depth->Width; u++)
+        {
+            const float z = depthRow[u];
+            const float rayX = (static_cast<float>(u) - intrinsics.cx) / intrinsics.fx;
+            int16_t* point = points + 3 * (v * depth->Width + u);
+            point[0] = static_cast<int16_t>(rayX * z);
+            point[1] = static_cast<int16_t>(rayY * z);
+            point[2] = static_cast<int16_t>(z);
+        }
+    }
+    return K4A_RESULT_SUCCEEDED;
+}
+
+k4a_result_t k4a_transformation_depth_image_to_color_camera_custom(k4a_transformation_t transformation_handle, const k4a_image_t depth_image,
+    const k4a_image_t custom_image, k4a_image_t transformed_depth_image, k4a_image_t transformed_custom_image,
+    k4a_transformation_interpolation_type_t, uint32_t invalid_custom_value)
+{
+    // The stand-in color camera shares the optical center of the depth camera, so every color pixel looks along
+    // the ray of one depth pixel and the transformation is a resampling (nearest neighbor).
+    const k4a_calibration_t& calibration = FromHandle(transformation_handle)->Calibration;
+    const auto& depthIntrinsics = calibration.depth_camera_calibration.intrinsics.parameters.param;
+    const auto& colorIntrinsics = calibration.color_camera_calibration.intrinsics.parameters.param;
+    const StandIn::Image* depth = StandIn::FromHandle(depth_image);
+    const StandIn::Image* custom = StandIn::FromHandle(custom_image);
+    StandIn::Image* transformedDepth = StandIn::FromHandle(transformed_depth_image);
+    StandIn::Image* transformedCustom = StandIn::FromHandle(transformed_custom_image);
+
+    const int width = calibration.color_camera_calibration.resolution_width;
+    const int height = calibration.color_camera_calibration.resolution_height;
+    const int customBytes = custom->Format == K4A_IMAGE_FORMAT_CUSTOM16 ? 2 : 1;
+    if (width == 0 || transformedDepth->Width != width || transformedDepth->Height != height ||
+        transformedCustom->Width != width || transformedCustom->Height != height ||
+        custom->Width != depth->Width || custom->Height != depth->Height)
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    std::vector<int> depthColumns(width);
+    for (int u = 0; u < width; u++)
+    {
+        depthColumns[u] = static_cast<int>(std::lround((u - colorIntrinsics.cx) / colorIntrinsics.fx * depthIntrinsics.fx + depthIntrinsics.cx));
+    }
+
+    for (int v = 0; v < height; v++)
+    {
+        const int depthRow = static_cast<int>(std::lround((v - colorIntrinsics.cy) / colorIntrinsics.fy * depthIntrinsics.fy + depthIntrinsics.cy));
+        uint16_t* depthOut = reinterpret_cast<uint16_t*>(transformedDepth->Buffer.data() + v * transformedDepth->Stride);
+        uint8_t* customOut = transformedCustom->Buffer.data() + v * transformedCustom->Stride;
+        for (int u = 0; u < width; u++)
+        {
+            const int depthColumn = depthColumns[u];
+            const bool inside = depthRow >= 0 && depthRow < depth->Height && depthColumn >= 0 && depthColumn < depth->Width;
+            uint16_t z = 0;
+            uint32_t value = invalid_custom_value;
+            if (inside)
+            {
+                z = reinterpret_cast<const uint16_t*>(depth->Buffer.data() + depthRow * depth->Stride)[depthColumn];
+                const uint8_t* customIn = custom->Buffer.data() + depthRow * custom->Stride + depthColumn * customBytes;
+                value = customBytes == 2 ? *reinterpret_cast<const uint16_t*>(customIn) : *customIn;
+            }
+            depthOut[u] = z;
+            if (customBytes == 2)
+            {
+                reinterpret_cast<uint16_t*>(customOut)[u] = static_cast<uint16_t>(z == 0 ? invalid_custom_value : value);
+            }
+            else
+            {
+                customOut[u] = static_cast<uint8_t>(z == 0 ? invalid_custom_value : value);
+            }
+        }
+    }
+    return K4A_RESULT_SUCCEEDED;
+}
@@ -0,0 +1,272 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// Stand-in implementation of the Azure Kinect Body Tracking SDK (k4abt.h). The tracker returns the bodies the
+// stand-in device rendered into each capture, a configurable latency after the capture was enqueued.
+
+#include <k4abt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+
+#include "StandInObjects.h"
+#include "StandInSettings.h"
+
+using namespace std::chrono;
+
+namespace
+{
+    struct BodyFrame
+    {
+        std::atomic<int> References{ 1 };
+        StandIn::Capture* Capture = nullptr;
+        StandIn::Image* BodyIndexMap = nullptr;
+        std::vector<k4abt_body_t> Bodies;
+        uint64_t DeviceTimestampUsec = 0;
+        uint64_t SystemTimestampNsec = 0;
+        steady_clock::time_point ReadyTime;
+    };
+
+    BodyFrame* FromHandle(k4abt_frame_t handle) { return reinterpret_cast<BodyFrame*>(handle); }
+    k4abt_frame_t ToHandle(BodyFrame* frame) { return reinterpret_cast<k4abt_frame_t>(frame); }
+
+    void ReleaseFrame(BodyFrame* frame)
+    {
+        if (frame != nullptr && frame->References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            StandIn::ReleaseCapture(frame->Capture);
+            StandIn::ReleaseImage(frame->BodyIndexMap);
+            delete frame;
+        }
+    }
+
+    // The tracker is a pipeline: the result of a capture is ready TrackerLatencyMs after it was enqueued, independent
+    // of the frame rate. At most TrackerQueueDepth captures are processed at the same time, enqueue waits for a free
+    // slot like the input queue of the real tracker. Ready results wait in flight until they are popped.
+    struct Tracker
+    {
+        StandIn::Settings Settings;
+        int DepthWidth = 0;
+        int DepthHeight = 0;
+
+        std::mutex Mutex;
+        std::condition_variable Changed;
+        std::deque<BodyFrame*> InFlight;
+        bool Shutdown = false;
+
+        BodyFrame* Process(StandIn::Capture* capture) const;
+
+        // Number of captures whose results are not ready yet. All captures have the same latency, so these are
+        // the last ones in flight.
+        size_t CountProcessing() const
+        {
+            const steady_clock::time_point now = steady_clock::now();
+            return static_cast<size_t>(std::count_if(InFlight.begin(), InFlight.end(), [now](const BodyFrame* frame) { return frame->ReadyTime > now; }));
+        }
+    };
+
+    Tracker* FromHandle(k4abt_tracker_t handle) { return reinterpret_cast<Tracker*>(handle); }
+
+    BodyFrame* Tracker::Process(StandIn::Capture* capture) const
+    {
+        BodyFrame* frame = new BodyFrame();
+        StandIn::ReferenceCapture(capture);
+        frame->Capture = capture;
+        frame->Bodies = capture->Bodies;
+        frame->DeviceTimestampUsec = capture->Depth->DeviceTimestampUsec;
+        frame->SystemTimestampNsec = capture->Depth->SystemTimestampNsec;
+        frame->ReadyTime = steady_clock::now() + milliseconds(Settings.TrackerLatencyMs);
+
+        if (capture->BodyIndexMap != nullptr)
+        {
+            StandIn::ReferenceImage(capture->BodyIndexMap);
+            frame->BodyIndexMap = capture->BodyIndexMap;
+        }
+        else
+        {
+            // A capture that was not produced by the stand-in device has no ground truth
+            frame->BodyIndexMap = StandIn::CreateImage(K4A_IMAGE_FORMAT_CUSTOM8, DepthWidth, DepthHeight, DepthWidth);
+            std::fill(frame->BodyIndexMap->Buffer.begin(), frame->BodyIndexMap->Buffer.end(), static_cast<uint8_t>(K4ABT_BODY_INDEX_MAP_BACKGROUND));
+            frame->Bodies.clear();
+        }
+        frame->BodyIndexMap->DeviceTimestampUsec = frame->DeviceTimestampUsec;
+        frame->BodyIndexMap->SystemTimestampNsec = frame->SystemTimestampNsec;
+        return frame;
+    }
+}
+
+k4a_result_t k4abt_tracker_create(const k4a_calibration_t* sensor_calibration, k4abt_tracker_configuration_t, k4abt_tracker_t* tracker_handle)
+{
+    if (sensor_calibration->depth_mode == K4A_DEPTH_MODE_OFF || sensor_calibration->depth_mode == K4A_DEPTH_MODE_PASSIVE_IR)
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    Tracker* tracker = new Tracker();
+    tracker->Settings = StandIn::GetSettings();
+    tracker->Settings.TrackerQueueDepth = std::max<uint32_t>(tracker->Settings.TrackerQueueDepth, 1);
+    tracker->DepthWidth = sensor_calibration->depth_camera_calibration.resolution_width;
+    tracker->DepthHeight = sensor_calibration->depth_camera_calibration.resolution_height;
+    *tracker_handle = reinterpret_cast<k4abt_tracker_t>(tracker);
+    return K4A_RESULT_SUCCEEDED;
+}
+
+void k4abt_tracker_shutdown(k4abt_tracker_t tracker_handle)
+{
+    Tracker* tracker = FromHandle(tracker_handle);
+    std::lock_guard<std::mutex> lock(tracker->Mutex);
+    tracker->Shutdown = true;
+    tracker->Changed.notify_all();
+}
+
+void k4abt_tracker_destroy(k4abt_tracker_t tracker_handle)
+{
+    Tracker* tracker = FromHandle(tracker_handle);
+    for (BodyFrame* frame : tracker->InFlight)
+    {
+        ReleaseFrame(frame);
+    }
+    delete tracker;
+}
+
+void k4abt_tracker_set_temporal_smoothing(k4abt_tracker_t, float)
+{
+    // The stand-in bodies are exact, there is nothing to smooth
+}
+
+k4a_wait_result_t k4abt_tracker_enqueue_capture(k4abt_tracker_t tracker_handle, k4a_capture_t sensor_capture_handle, int32_t timeout_in_ms)
+{
+    Tracker* tracker = FromHandle(tracker_handle);
+    StandIn::Capture* capture = StandIn::FromHandle(sensor_capture_handle);
+    if (capture == nullptr || capture->Depth == nullptr)
+    {
+        return K4A_WAIT_RESULT_FAILED;
+    }
+
+    std::unique_lock<std::mutex> lock(tracker->Mutex);
+    const auto deadline = steady_clock::now() + milliseconds(std::max(timeout_in_ms, 0));
+    while (!tracker->Shutdown)
+    {
+        const size_t processing = tracker->CountProcessing();
+        if (processing < tracker->Settings.TrackerQueueDepth)
+        {
+            break;
+        }
+        if (timeout_in_ms != K4A_WAIT_INFINITE && steady_clock::now() >= deadline)
+        {
+            return K4A_WAIT_RESULT_TIMEOUT;
+        }
+
+        // The oldest capture in processing is the next one to finish
+        const steady_clock::time_point readyTime = tracker->InFlight[tracker->InFlight.size() - processing]->ReadyTime;
+        tracker->Changed.wait_until(lock, timeout_in_ms == K4A_WAIT_INFINITE ? readyTime : std::min(readyTime, deadline));
+    }
+    if (tracker->Shutdown)
+    {
+        return K4A_WAIT_RESULT_FAILED;
+    }
+
+    tracker->InFlight.push_back(tracker->Process(capture));
+    tracker->Changed.notify_all();
+    return K4A_WAIT_RESULT_SUCCEEDED;
+}
+
+k4a_wait_result_t k4abt_tracker_pop_result(k4abt_tracker_t tracker_handle, k4abt_frame_t* body_frame_handle, int32_t timeout_in_ms)
+{
+    Tracker* tracker = FromHandle(tracker_handle);
+    std::unique_lock<std::mutex> lock(tracker->Mutex);
+    const auto deadline = steady_clock::now() + milliseconds(std::max(timeout_in_ms, 0));
+
+    // After shutdown the results in flight can still be popped, then pop fails
+    while (tracker->InFlight.empty() || steady_clock::now() < tracker->InFlight.front()->ReadyTime)
+    {
+        if (tracker->InFlight.empty() && tracker->Shutdown)
+        {
+            return K4A_WAIT_RESULT_FAILED;
+        }
+
+        const bool infinite = timeout_in_ms == K4A_WAIT_INFINITE;
+        if (!infinite && steady_clock::now() >= deadline)
+        {
+            return K4A_WAIT_RESULT_TIMEOUT;
+        }
+        if (tracker->InFlight.empty() && infinite)
+        {
+            tracker->Changed.wait(lock);
+        }
+        else if (tracker->InFlight.empty())
+        {
+            tracker->Changed.wait_until(lock, deadline);
+        }
+        else
+        {
+            const steady_clock::time_point readyTime = tracker->InFlight.front()->ReadyTime;
+            tracker->Changed.wait_until(lock, infinite ? readyTime : std::min(readyTime, deadline));
+        }
+    }
+
+    *body_frame_handle = ToHandle(tracker->InFlight.front());
+    tracker->InFlight.pop_front();
+    tracker->Changed.notify_all();
+    return K4A_WAIT_RESULT_SUCCEEDED;
+}
+
+void k4abt_frame_reference(k4abt_frame_t body_frame_handle)
+{
+    FromHandle(body_frame_handle)->References.fetch_add(1, std::memory_order_relaxed);
+}
+
+void k4abt_frame_release(k4abt_frame_t body_frame_handle)
+{
+    ReleaseFrame(FromHandle(body_frame_handle));
+}
+
+uint32_t k4abt_frame_get_num_bodies(k4abt_frame_t body_frame_handle)
+{
+    return static_cast<uint32_t>(FromHandle(body_frame_handle)->Bodies.size());
+}
+
+k4a_result_t k4abt_frame_get_body_skeleton(k4abt_frame_t body_frame_handle, uint32_t index, k4abt_skeleton_t* skeleton)
+{
+    const BodyFrame* frame = FromHandle(body_frame_handle);
+    if (index >= frame->Bodies.size())
+    {
+        return K4A_RESULT_FAILED;
+    }
+    *skeleton = frame->Bodies[index].skeleton;
+    return K4A_RESULT_SUCCEEDED;
+}
+
+uint32_t k4abt_frame_get_body_id(k4abt_frame_t body_frame_handle, uint32_t index)
+{
+    const BodyFrame* frame = FromHandle(body_frame_handle);
+    return index < frame->Bodies.size() ? frame->Bodies[index].id : K4ABT_INVALID_BODY_ID;
+}
+
+uint64_t k4abt_frame_get_device_timestamp_usec(k4abt_frame_t body_frame_handle)
+{
+    return FromHandle(body_frame_handle)->DeviceTimestampUsec;
+}
+
+uint64_t k4abt_frame_get_system_timestamp_nsec(k4abt_frame_t body_frame_handle)
+{
+    return FromHandle(body_frame_handle)->SystemTimestampNsec;
+}
+
+k4a_image_t k4abt_frame_get_body_index_map(k4abt_frame_t body_frame_handle)
+{
+    StandIn::Image* image = FromHandle(body_frame_handle)->BodyIndexMap;
+    StandIn::ReferenceImage(image);
+    return StandIn::ToHandle(image);
+}
+
+k4a_capture_t k4abt_frame_get_capture(k4abt_frame_t body_frame_handle)
+{
+    StandIn::Capture* capture = FromHandle(body_frame_handle)->Capture;
+    StandIn::ReferenceCapture(capture);
+    return StandIn::ToHandle(capture);
+}
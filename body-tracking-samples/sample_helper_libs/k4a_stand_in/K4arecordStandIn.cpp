@@ -0,0 +1,179 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// Stand-in implementation of the playback API of the Azure Kinect recording SDK (k4arecord/playback.h).
+// A skeleton file is replayed frame by frame; any other existing file plays Settings::PlaybackFrameCount frames
+// of the animation at 30 frames per second. Captures are returned as fast as they are requested.
+
+#include <k4arecord/playback.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "StandInObjects.h"
+#include "StandInScene.h"
+#include "StandInSettings.h"
+
+namespace
+{
+    const uint64_t FramePeriodUsec = 33333;
+    const uint64_t ImuSamplePeriodUsec = 625;
+
+    struct Playback
+    {
+        k4a_calibration_t Calibration;
+        std::unique_ptr<StandIn::SkeletonSource> Source;
+        std::unique_ptr<StandIn::SceneRenderer> Renderer;
+        std::vector<uint64_t> FrameTimestampsUsec;
+        size_t NextFrame = 0;
+        uint64_t NextImuSample = 0;
+        std::vector<k4abt_body_t> Bodies;
+
+        uint64_t GetStartUsec() const { return FrameTimestampsUsec.front(); }
+        uint64_t GetEndUsec() const { return FrameTimestampsUsec.back() + FramePeriodUsec; }
+    };
+
+    Playback* FromHandle(k4a_playback_t handle) { return reinterpret_cast<Playback*>(handle); }
+}
+
+k4a_result_t k4a_playback_open(const char* path, k4a_playback_t* playback_handle)
+{
+    if (!std::ifstream(path).good())
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    std::unique_ptr<Playback> playback = std::make_unique<Playback>();
+    StandIn::Settings settings = StandIn::GetSettings();
+    if (StandIn::IsSkeletonFile(path))
+    {
+        settings.SkeletonFile = path;
+    }
+    try
+    {
+        playback->Source = std::make_unique<StandIn::SkeletonSource>(settings);
+    }
+    catch (const std::runtime_error&)
+    {
+        return K4A_RESULT_FAILED;
+    }
+
+    if (playback->Source->GetFrameCount() > 0)
+    {
+        for (size_t frame = 0; frame < playback->Source->GetFrameCount(); frame++)
+        {
+            playback->FrameTimestampsUsec.push_back(playback->Source->GetTimestampUsec(frame));
+        }
+    }
+    else
+    {
+        for (uint32_t frame = 0; frame < std::max<uint32_t>(settings.PlaybackFrameCount, 1); frame++)
+        {
+            playback->FrameTimestampsUsec.push_back(frame * FramePeriodUsec);
+        }
+    }
+
+    playback->Calibration = StandIn::CreateCalibration(K4A_DEPTH_MODE_NFOV_UNBINNED, K4A_COLOR_RESOLUTION_OFF);
+    playback->Renderer = std::make_unique<StandIn::SceneRenderer>(playback->Calibration, K4A_IMAGE_FORMAT_COLOR_MJPG);
+    *playback_handle = reinterpret_cast<k4a_playback_t>(playback.release());
+    return K4A_RESULT_SUCCEEDED;
+}
+
+void k4a_playback_close(k4a_playback_t playback_handle)
+{
+    delete FromHandle(playback_handle);
+}
+
+k4a_result_t k4a_playback_get_calibration(k4a_playback_t playback_handle, k4a_calibration_t* calibration)
+{
+    *calibration = FromHandle(playback_handle)->Calibration;
+    return K4A_RESULT_SUCCEEDED;
+}
+
+k4a_result_t k4a_playback_get_record_configuration(k4a_playback_t playback_handle, k4a_record_configuration_t* config)
+{
+    const Playback* playback = FromHandle(playback_handle);
+    *config = k4a_record_configuration_t();
+    config->color_format = K4A_IMAGE_FORMAT_COLOR_MJPG;
+    config->color_resolution = K4A_COLOR_RESOLUTION_OFF;
+    config->depth_mode = playback->Calibration.depth_mode;
+    config->camera_fps = K4A_FRAMES_PER_SECOND_30;
+    config->color_track_enabled = false;
+    config->depth_track_enabled = true;
+    config->ir_track_enabled = false;
+    config->imu_track_enabled = true;
+    config->wired_sync_mode = K4A_WIRED_SYNC_MODE_STANDALONE;
+    config->start_timestamp_offset_usec = static_cast<uint32_t>(playback->GetStartUsec());
+    return K4A_RESULT_SUCCEEDED;
+}
+
+uint64_t k4a_playback_get_recording_length_usec(k4a_playback_t playback_handle)
+{
+    const Playback* playback = FromHandle(playback_handle);
+    return playback->GetEndUsec() - playback->GetStartUsec();
+}
+
+k4a_stream_result_t k4a_playback_get_next_capture(k4a_playback_t playback_handle, k4a_capture_t* capture_handle)
+{
+    Playback* playback = FromHandle(playback_handle);
+    if (playback->NextFrame >= playback->FrameTimestampsUsec.size())
+    {
+        return K4A_STREAM_RESULT_EOF;
+    }
+
+    const size_t frame = playback->NextFrame++;
+    const uint64_t timestampUsec = playback->FrameTimestampsUsec[frame];
+    playback->Source->GetBodies(frame, timestampUsec, playback->Bodies);
+    *capture_handle = StandIn::ToHandle(playback->Renderer->CreateCapture(playback->Bodies, timestampUsec));
+    return K4A_STREAM_RESULT_SUCCEEDED;
+}
+
+k4a_stream_result_t k4a_playback_get_next_imu_sample(k4a_playback_t playback_handle, k4a_imu_sample_t* imu_sample)
+{
+    Playback* playback = FromHandle(playback_handle);
+    const uint64_t timestampUsec = playback->GetStartUsec() + playback->NextImuSample * ImuSamplePeriodUsec;
+    if (timestampUsec >= playback->GetEndUsec())
+    {
+        return K4A_STREAM_RESULT_EOF;
+    }
+
+    const float vibration = 0.02f * std::sin(static_cast<float>(playback->NextImuSample) * 0.37f);
+    playback->NextImuSample++;
+    imu_sample->temperature = 30.f;
+    imu_sample->acc_sample = { vibration, -9.81f, -vibration };
+    imu_sample->acc_timestamp_usec = timestampUsec;
+    imu_sample->gyro_sample = { 0.f, 0.f, 0.f };
+    imu_sample->gyro_timestamp_usec = timestampUsec;
+    return K4A_STREAM_RESULT_SUCCEEDED;
+}
+
+k4a_result_t k4a_playback_seek_timestamp(k4a_playback_t playback_handle, int64_t offset_usec, k4a_playback_seek_origin_t origin)
+{
+    Playback* playback = FromHandle(playback_handle);
+    int64_t targetUsec = 0;
+    switch (origin)
+    {
+    case K4A_PLAYBACK_SEEK_BEGIN: targetUsec = static_cast<int64_t>(playback->GetStartUsec()) + offset_usec; break;
+    case K4A_PLAYBACK_SEEK_END: targetUsec = static_cast<int64_t>(playback->GetEndUsec()) + offset_usec; break;
+    case K4A_PLAYBACK_SEEK_DEVICE_TIME: targetUsec = offset_usec; break;
+    default: return K4A_RESULT_FAILED;
+    }
+
+    // The next capture is the first one at or after the target time
+    const uint64_t target = static_cast<uint64_t>(std::max<int64_t>(targetUsec, 0));
+    const auto& timestamps = playback->FrameTimestampsUsec;
+    playback->NextFrame = static_cast<size_t>(std::lower_bound(timestamps.begin(), timestamps.end(), target) - timestamps.begin());
+    const uint64_t imuOffset = target > playback->GetStartUsec() ? target - playback->GetStartUsec() : 0;
+    playback->NextImuSample = (imuOffset + ImuSamplePeriodUsec - 1) / ImuSamplePeriodUsec;
+    return K4A_RESULT_SUCCEEDED;
+}
+
+k4a_result_t k4a_playback_set_color_conversion(k4a_playback_t, k4a_image_format_t target_format)
+{
+    // The stand-in recordings have no color track
+    return target_format == K4A_IMAGE_FORMAT_COLOR_MJPG ? K4A_RESULT_SUCCEEDED : K4A_RESULT_FAILED;
+}
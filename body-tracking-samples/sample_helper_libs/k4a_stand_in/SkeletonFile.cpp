@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "SkeletonFile.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    const char SkeletonFileMagic[8] = { 'K', '4', 'A', 'B', 'T', 'S', 'K', '1' };
+
+    template <typename T>
+    bool ReadValue(std::ifstream& file, T& value)
+    {
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+
+    template <typename T>
+    void WriteValue(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    bool ReadHeader(std::ifstream& file)
+    {
+        char magic[sizeof(SkeletonFileMagic)];
+        uint32_t jointCount = 0;
+        return file.read(magic, sizeof(magic)) &&
+            std::memcmp(magic, SkeletonFileMagic, sizeof(magic)) == 0 &&
+            ReadValue(file, jointCount) &&
+            jointCount == K4ABT_JOINT_COUNT;
+    }
+}
+
+bool StandIn::IsSkeletonFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return file.is_open() && ReadHeader(file);
+}
+
+std::vector<StandIn::SkeletonFileFrame> StandIn::ReadSkeletonFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to open skeleton file: " + path);
+    }
+    if (!ReadHeader(file))
+    {
+        throw std::runtime_error("Not a skeleton file: " + path);
+    }
+
+    std::vector<SkeletonFileFrame> frames;
+    SkeletonFileFrame frame;
+    uint32_t bodyCount = 0;
+    while (ReadValue(file, frame.DeviceTimestampUsec))
+    {
+        if (!ReadValue(file, bodyCount))
+        {
+            throw std::runtime_error("Truncated skeleton file: " + path);
+        }
+        frame.Bodies.resize(bodyCount);
+        for (k4abt_body_t& body : frame.Bodies)
+        {
+            if (!ReadValue(file, body.id) || !ReadValue(file, body.skeleton))
+            {
+                throw std::runtime_error("Truncated skeleton file: " + path);
+            }
+        }
+        frames.push_back(frame);
+    }
+
+    if (frames.empty())
+    {
+        throw std::runtime_error("Skeleton file has no frames: " + path);
+    }
+    return frames;
+}
+
+StandIn::SkeletonFileWriter::SkeletonFileWriter(const std::string& path)
+    : m_file(path, std::ios::binary | std::ios::trunc)
+{
+    if (!m_file.is_open())
+    {
+        throw std::runtime_error("Failed to create skeleton file: " + path);
+    }
+    m_file.write(SkeletonFileMagic, sizeof(SkeletonFileMagic));
+    WriteValue(m_file, static_cast<uint32_t>(K4ABT_JOINT_COUNT));
+}
+
+void StandIn::SkeletonFileWriter::Write(uint64_t deviceTimestampUsec, const std::vector<k4abt_body_t>& bodies)
+{
+    WriteValue(m_file, deviceTimestampUsec);
+    WriteValue(m_file, static_cast<uint32_t>(bodies.size()));
+    for (const k4abt_body_t& body : bodies)
+    {
+        WriteValue(m_file, body.id);
+        WriteValue(m_file, body.skeleton);
+    }
+}
@@ -0,0 +1,46 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <k4abttypes.h>
+
+namespace StandIn
+{
+    // Binary skeleton recording replayed by the stand-in devices and playbacks:
+    //
+    //     header   "K4ABTSK1", uint32 joint count (K4ABT_JOINT_COUNT)
+    //     frame    uint64 device timestamp in microseconds, uint32 body count,
+    //              body count x { uint32 body id, k4abt_skeleton_t }
+    //
+    // Values are stored in the byte order and layout of the machine that wrote the file.
+    struct SkeletonFileFrame
+    {
+        uint64_t DeviceTimestampUsec = 0;
+        std::vector<k4abt_body_t> Bodies;
+    };
+
+    // Returns true if the file exists and starts with the skeleton file header
+    bool IsSkeletonFile(const std::string& path);
+
+    // Throws std::runtime_error if the file cannot be read or is not a skeleton file
+    std::vector<SkeletonFileFrame> ReadSkeletonFile(const std::string& path);
+
+    // Records the bodies of a tracker, e.g. of a real device, for replay by the stand-in
+    class SkeletonFileWriter
+    {
+    public:
+        // Throws std::runtime_error if the file cannot be created
+        explicit SkeletonFileWriter(const std::string& path);
+
+        void Write(uint64_t deviceTimestampUsec, const std::vector<k4abt_body_t>& bodies);
+
+    private:
+        std::ofstream m_file;
+    };
+}
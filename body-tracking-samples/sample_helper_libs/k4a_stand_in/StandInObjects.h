@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <k4a/k4atypes.h>
+#include <k4abttypes.h>
+
+// Objects behind the k4a handles of the stand-in. The SDK headers define the handle types as pointers to
+// opaque structs, so the stand-in objects are converted with reinterpret_cast at the API boundary.
+namespace StandIn
+{
+    struct Image
+    {
+        std::atomic<int> References{ 1 };
+        k4a_image_format_t Format = K4A_IMAGE_FORMAT_CUSTOM;
+        int Width = 0;
+        int Height = 0;
+        int Stride = 0;
+        std::vector<uint8_t> Buffer;
+        uint64_t DeviceTimestampUsec = 0;
+        uint64_t SystemTimestampNsec = 0;
+    };
+
+    Image* CreateImage(k4a_image_format_t format, int width, int height, int stride);
+    void ReferenceImage(Image* image);
+    void ReleaseImage(Image* image);
+
+    struct Capture
+    {
+        std::atomic<int> References{ 1 };
+        Image* Color = nullptr;
+        Image* Depth = nullptr;
+        Image* Ir = nullptr;
+        float TemperatureC = 30.f;
+
+        // Ground truth of the synthetic scene, returned by the stand-in tracker
+        std::vector<k4abt_body_t> Bodies;
+        Image* BodyIndexMap = nullptr;
+    };
+
+    Capture* CreateCapture();
+    void ReferenceCapture(Capture* capture);
+    void ReleaseCapture(Capture* capture);
+
+    // Replace the image held in a slot of a capture, taking a reference on the new one
+    void SetCaptureImage(Image*& slot, Image* image);
+
+    inline Image* FromHandle(k4a_image_t handle) { return reinterpret_cast<Image*>(handle); }
+    inline k4a_image_t ToHandle(Image* image) { return reinterpret_cast<k4a_image_t>(image); }
+    inline Capture* FromHandle(k4a_capture_t handle) { return reinterpret_cast<Capture*>(handle); }
+    inline k4a_capture_t ToHandle(Capture* capture) { return reinterpret_cast<k4a_capture_t>(capture); }
+
+    // Current time of the host, for the system timestamps of images and body frames
+    uint64_t GetSystemTimestampNsec();
+}
@@ -0,0 +1,390 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "StandInScene.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include <BodyTrackingHelpers.h>
+
+namespace
+{
+    const float Pi = 3.14159265f;
+
+    // Room of the scene, in depth camera space (millimeters, y down)
+    const float FloorHeightInMM = 920.f;     // Below the optical center
+    const float BackWallDistanceInMM = 4500.f;
+
+    struct CameraMode
+    {
+        int Width;
+        int Height;
+        float FocalLength;
+    };
+
+    CameraMode GetDepthCameraMode(k4a_depth_mode_t depthMode)
+    {
+        switch (depthMode)
+        {
+        case K4A_DEPTH_MODE_NFOV_2X2BINNED: return { 320, 288, 252.f };
+        case K4A_DEPTH_MODE_NFOV_UNBINNED:  return { 640, 576, 504.f };
+        case K4A_DEPTH_MODE_WFOV_2X2BINNED: return { 512, 512, 148.f };
+        case K4A_DEPTH_MODE_WFOV_UNBINNED:  return { 1024, 1024, 296.f };
+        case K4A_DEPTH_MODE_PASSIVE_IR:     return { 1024, 1024, 296.f };
+        default:                            return { 0, 0, 0.f };
+        }
+    }
+
+    CameraMode GetColorCameraMode(k4a_color_resolution_t colorResolution)
+    {
+        switch (colorResolution)
+        {
+        case K4A_COLOR_RESOLUTION_720P:  return { 1280, 720, 605.f };
+        case K4A_COLOR_RESOLUTION_1080P: return { 1920, 1080, 908.f };
+        case K4A_COLOR_RESOLUTION_1440P: return { 2560, 1440, 1210.f };
+        case K4A_COLOR_RESOLUTION_1536P: return { 2048, 1536, 975.f };
+        case K4A_COLOR_RESOLUTION_2160P: return { 3840, 2160, 1815.f };
+        case K4A_COLOR_RESOLUTION_3072P: return { 4096, 3072, 1950.f };
+        default:                         return { 0, 0, 0.f };
+        }
+    }
+
+    void SetIdentity(k4a_calibration_extrinsics_t& extrinsics)
+    {
+        std::memset(&extrinsics, 0, sizeof(extrinsics));
+        extrinsics.rotation[0] = extrinsics.rotation[4] = extrinsics.rotation[8] = 1.f;
+    }
+
+    void SetCamera(k4a_calibration_camera_t& camera, const CameraMode& mode)
+    {
+        std::memset(&camera, 0, sizeof(camera));
+        SetIdentity(camera.extrinsics);
+        camera.resolution_width = mode.Width;
+        camera.resolution_height = mode.Height;
+        camera.metric_radius = 1.7f;
+        camera.intrinsics.type = K4A_CALIBRATION_LENS_DISTORTION_MODEL_BROWN_CONRADY;
+        camera.intrinsics.parameter_count = 14;
+        camera.intrinsics.parameters.param.cx = mode.Width / 2.f;
+        camera.intrinsics.parameters.param.cy = mode.Height / 2.f;
+        camera.intrinsics.parameters.param.fx = mode.FocalLength;
+        camera.intrinsics.parameters.param.fy = mode.FocalLength;
+        camera.intrinsics.parameters.param.metric_radius = camera.metric_radius;
+    }
+
+    // Standing pose of the animated bodies relative to the pelvis, in millimeters, facing the camera
+    const std::array<k4a_float3_t, K4ABT_JOINT_COUNT> StandingPose =
+    { {
+        {    0.f,    0.f,   0.f },  // PELVIS
+        {    0.f, -200.f,  10.f },  // SPINE_NAVEL
+        {    0.f, -380.f,  20.f },  // SPINE_CHEST
+        {    0.f, -560.f,  20.f },  // NECK
+        {  -40.f, -520.f,  20.f },  // CLAVICLE_LEFT
+        { -180.f, -500.f,  20.f },  // SHOULDER_LEFT
+        { -220.f, -230.f,   0.f },  // ELBOW_LEFT
+        { -240.f,   20.f, -40.f },  // WRIST_LEFT
+        { -245.f,   90.f, -50.f },  // HAND_LEFT
+        { -250.f,  160.f, -60.f },  // HANDTIP_LEFT
+        { -210.f,   80.f, -80.f },  // THUMB_LEFT
+        {   40.f, -520.f,  20.f },  // CLAVICLE_RIGHT
+        {  180.f, -500.f,  20.f },  // SHOULDER_RIGHT
+        {  220.f, -230.f,   0.f },  // ELBOW_RIGHT
+        {  240.f,   20.f, -40.f },  // WRIST_RIGHT
+        {  245.f,   90.f, -50.f },  // HAND_RIGHT
+        {  250.f,  160.f, -60.f },  // HANDTIP_RIGHT
+        {  210.f,   80.f, -80.f },  // THUMB_RIGHT
+        { -100.f,   20.f,   0.f },  // HIP_LEFT
+        { -110.f,  420.f, -20.f },  // KNEE_LEFT
+        { -115.f,  820.f,  20.f },  // ANKLE_LEFT
+        { -120.f,  870.f,-100.f },  // FOOT_LEFT
+        {  100.f,   20.f,   0.f },  // HIP_RIGHT
+        {  110.f,  420.f, -20.f },  // KNEE_RIGHT
+        {  115.f,  820.f,  20.f },  // ANKLE_RIGHT
+        {  120.f,  870.f,-100.f },  // FOOT_RIGHT
+        {    0.f, -680.f,  10.f },  // HEAD
+        {    0.f, -660.f, -80.f },  // NOSE
+        {  -35.f, -700.f, -60.f },  // EYE_LEFT
+        {  -75.f, -690.f,   0.f },  // EAR_LEFT
+        {   35.f, -700.f, -60.f },  // EYE_RIGHT
+        {   75.f, -690.f,   0.f },  // EAR_RIGHT
+    } };
+
+    // Radius of the body part between a joint and its parent, in millimeters
+    float GetSegmentRadius(int joint)
+    {
+        switch (joint)
+        {
+        case K4ABT_JOINT_SPINE_NAVEL:
+        case K4ABT_JOINT_SPINE_CHEST:
+            return 130.f;
+        case K4ABT_JOINT_HEAD:
+            return 100.f;
+        case K4ABT_JOINT_KNEE_LEFT:
+        case K4ABT_JOINT_KNEE_RIGHT:
+            return 75.f;
+        case K4ABT_JOINT_ELBOW_LEFT:
+        case K4ABT_JOINT_ELBOW_RIGHT:
+        case K4ABT_JOINT_ANKLE_LEFT:
+        case K4ABT_JOINT_ANKLE_RIGHT:
+        case K4ABT_JOINT_NECK:
+            return 55.f;
+        default:
+            return 40.f;
+        }
+    }
+
+    using Matrix = std::array<float, 9>;
+
+    Matrix Multiply(const Matrix& a, const Matrix& b)
+    {
+        Matrix result{};
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                result[r * 3 + c] = a[r * 3] * b[c] + a[r * 3 + 1] * b[3 + c] + a[r * 3 + 2] * b[6 + c];
+            }
+        }
+        return result;
+    }
+
+    // Rotation about the x axis of the camera: swings a limb forward or backward
+    Matrix RotationX(float angle)
+    {
+        const float c = std::cos(angle);
+        const float s = std::sin(angle);
+        return { 1.f, 0.f, 0.f, 0.f, c, -s, 0.f, s, c };
+    }
+
+    k4a_float3_t Rotate(const Matrix& m, float x, float y, float z)
+    {
+        return { m[0] * x + m[1] * y + m[2] * z, m[3] * x + m[4] * y + m[5] * z, m[6] * x + m[7] * y + m[8] * z };
+    }
+
+    k4a_quaternion_t ToQuaternion(const Matrix& m)
+    {
+        const float w = std::sqrt(std::max(0.f, 1.f + m[0] + m[4] + m[8])) / 2.f;
+        const float scale = w > 1e-4f ? 1.f / (4.f * w) : 0.f;
+        return { w, (m[7] - m[5]) * scale, (m[2] - m[6]) * scale, (m[3] - m[1]) * scale };
+    }
+
+    // One person walking in place: arms and legs swing in opposite phase, the whole body sways sideways
+    void AnimateBody(uint32_t bodyIndex, uint32_t bodyCount, float timeInSeconds, k4abt_body_t& body)
+    {
+        const float phase = 0.7f * bodyIndex;
+        const float stride = 2.f * Pi * 0.8f * timeInSeconds + phase;
+        const float swing = std::sin(stride);
+
+        std::array<Matrix, K4ABT_JOINT_COUNT> rotations;
+        const k4a_float3_t pelvis = {
+            (static_cast<float>(bodyIndex) - (bodyCount - 1) / 2.f) * 700.f + 250.f * std::sin(2.f * Pi * 0.1f * timeInSeconds + phase),
+            -20.f * std::abs(std::cos(stride)),
+            2500.f + 400.f * (bodyIndex % 3) };
+
+        body.id = bodyIndex + 1;
+        for (int j = 0; j < static_cast<int>(K4ABT_JOINT_COUNT); j++)
+        {
+            Matrix local = RotationX(0.f);
+            switch (j)
+            {
+            case K4ABT_JOINT_SHOULDER_LEFT:  local = RotationX(0.5f * swing); break;
+            case K4ABT_JOINT_SHOULDER_RIGHT: local = RotationX(-0.5f * swing); break;
+            case K4ABT_JOINT_ELBOW_LEFT:     local = RotationX(-0.3f - 0.3f * std::max(0.f, swing)); break;
+            case K4ABT_JOINT_ELBOW_RIGHT:    local = RotationX(-0.3f - 0.3f * std::max(0.f, -swing)); break;
+            case K4ABT_JOINT_HIP_LEFT:       local = RotationX(-0.35f * swing); break;
+            case K4ABT_JOINT_HIP_RIGHT:      local = RotationX(0.35f * swing); break;
+            case K4ABT_JOINT_KNEE_LEFT:      local = RotationX(0.5f * std::max(0.f, swing)); break;
+            case K4ABT_JOINT_KNEE_RIGHT:     local = RotationX(0.5f * std::max(0.f, -swing)); break;
+            default: break;
+            }
+
+            // Joints are ordered so that every parent comes before its children
+            k4abt_joint_t& joint = body.skeleton.joints[j];
+            const k4abt_joint_id_t parent = g_jointParents[j];
+            if (parent == K4ABT_JOINT_COUNT)
+            {
+                rotations[j] = local;
+                joint.position = pelvis;
+            }
+            else
+            {
+                const k4a_float3_t offset = Rotate(rotations[parent],
+                    StandingPose[j].xyz.x - StandingPose[parent].xyz.x,
+                    StandingPose[j].xyz.y - StandingPose[parent].xyz.y,
+                    StandingPose[j].xyz.z - StandingPose[parent].xyz.z);
+                const k4a_float3_t& parentPosition = body.skeleton.joints[parent].position;
+                joint.position = { parentPosition.xyz.x + offset.xyz.x, parentPosition.xyz.y + offset.xyz.y, parentPosition.xyz.z + offset.xyz.z };
+                rotations[j] = Multiply(rotations[parent], local);
+            }
+            joint.orientation = ToQuaternion(rotations[j]);
+            joint.confidence_level = K4ABT_JOINT_CONFIDENCE_MEDIUM;
+        }
+    }
+}
+
+k4a_calibration_t StandIn::CreateCalibration(k4a_depth_mode_t depthMode, k4a_color_resolution_t colorResolution)
+{
+    k4a_calibration_t calibration;
+    std::memset(&calibration, 0, sizeof(calibration));
+    calibration.depth_mode = depthMode;
+    calibration.color_resolution = colorResolution;
+    SetCamera(calibration.depth_camera_calibration, GetDepthCameraMode(depthMode));
+    SetCamera(calibration.color_camera_calibration, GetColorCameraMode(colorResolution));
+    for (auto& row : calibration.extrinsics)
+    {
+        for (k4a_calibration_extrinsics_t& extrinsics : row)
+        {
+            SetIdentity(extrinsics);
+        }
+    }
+    return calibration;
+}
+
+StandIn::SkeletonSource::SkeletonSource(const Settings& settings)
+    : m_bodyCount(settings.BodyCount)
+{
+    if (!settings.SkeletonFile.empty())
+    {
+        m_frames = ReadSkeletonFile(settings.SkeletonFile);
+    }
+}
+
+void StandIn::SkeletonSource::GetBodies(uint64_t frameIndex, uint64_t timestampUsec, std::vector<k4abt_body_t>& bodies) const
+{
+    if (!m_frames.empty())
+    {
+        const std::vector<k4abt_body_t>& frameBodies = m_frames[frameIndex % m_frames.size()].Bodies;
+        bodies.assign(frameBodies.begin(), frameBodies.end());
+        return;
+    }
+
+    bodies.resize(m_bodyCount);
+    for (uint32_t b = 0; b < m_bodyCount; b++)
+    {
+        AnimateBody(b, m_bodyCount, static_cast<float>(timestampUsec) * 1e-6f, bodies[b]);
+    }
+}
+
+StandIn::SceneRenderer::SceneRenderer(const k4a_calibration_t& calibration, k4a_image_format_t colorFormat)
+    : m_calibration(calibration)
+    , m_colorEnabled(colorFormat == K4A_IMAGE_FORMAT_COLOR_BGRA32 && calibration.color_camera_calibration.resolution_width > 0)
+{
+    // The room does not change, rays through each pixel hit the floor or the back wall
+    const k4a_calibration_camera_t& camera = m_calibration.depth_camera_calibration;
+    const auto& intrinsics = camera.intrinsics.parameters.param;
+    m_background.resize(static_cast<size_t>(camera.resolution_width) * camera.resolution_height);
+    for (int v = 0; v < camera.resolution_height; v++)
+    {
+        const float rayY = (static_cast<float>(v) - intrinsics.cy) / intrinsics.fy;
+        const float z = rayY > 0.f ? std::min(FloorHeightInMM / rayY, BackWallDistanceInMM) : BackWallDistanceInMM;
+        std::fill(m_background.begin() + v * camera.resolution_width, m_background.begin() + (v + 1) * camera.resolution_width,
+            static_cast<uint16_t>(z));
+    }
+}
+
+StandIn::Capture* StandIn::SceneRenderer::CreateCapture(const std::vector<k4abt_body_t>& bodies, uint64_t deviceTimestampUsec)
+{
+    const k4a_calibration_camera_t& camera = m_calibration.depth_camera_calibration;
+    const int width = camera.resolution_width;
+    const int height = camera.resolution_height;
+    const uint64_t systemTimestampNsec = GetSystemTimestampNsec();
+
+    Capture* capture = StandIn::CreateCapture();
+    capture->Bodies = bodies;
+
+    Image* depth = CreateImage(K4A_IMAGE_FORMAT_DEPTH16, width, height, width * static_cast<int>(sizeof(uint16_t)));
+    Image* bodyIndexMap = CreateImage(K4A_IMAGE_FORMAT_CUSTOM8, width, height, width);
+    std::memcpy(depth->Buffer.data(), m_background.data(), m_background.size() * sizeof(uint16_t));
+    std::fill(bodyIndexMap->Buffer.begin(), bodyIndexMap->Buffer.end(), static_cast<uint8_t>(K4ABT_BODY_INDEX_MAP_BACKGROUND));
+    RenderBodies(bodies, reinterpret_cast<uint16_t*>(depth->Buffer.data()), bodyIndexMap->Buffer.data());
+
+    for (Image* image : { depth, bodyIndexMap })
+    {
+        image->DeviceTimestampUsec = deviceTimestampUsec;
+        image->SystemTimestampNsec = systemTimestampNsec;
+    }
+    capture->Depth = depth;
+    capture->BodyIndexMap = bodyIndexMap;
+
+    if (m_colorEnabled)
+    {
+        const k4a_calibration_camera_t& colorCamera = m_calibration.color_camera_calibration;
+        Image* color = CreateImage(K4A_IMAGE_FORMAT_COLOR_BGRA32, colorCamera.resolution_width, colorCamera.resolution_height,
+            colorCamera.resolution_width * 4);
+        std::fill(color->Buffer.begin(), color->Buffer.end(), static_cast<uint8_t>(0x80));
+        color->DeviceTimestampUsec = deviceTimestampUsec;
+        color->SystemTimestampNsec = systemTimestampNsec;
+        capture->Color = color;
+    }
+    return capture;
+}
+
+void StandIn::SceneRenderer::RenderBodies(const std::vector<k4abt_body_t>& bodies, uint16_t* depth, uint8_t* bodyIndex) const
+{
+    // Every body part is a chain of spheres along the bone to its parent joint
+    const size_t bodyCount = std::min<size_t>(bodies.size(), K4ABT_BODY_INDEX_MAP_BACKGROUND);
+    for (size_t b = 0; b < bodyCount; b++)
+    {
+        const k4abt_skeleton_t& skeleton = bodies[b].skeleton;
+        for (int j = 1; j < static_cast<int>(K4ABT_JOINT_COUNT); j++)
+        {
+            const k4a_float3_t& a = skeleton.joints[g_jointParents[j]].position;
+            const k4a_float3_t& c = skeleton.joints[j].position;
+            const float radius = GetSegmentRadius(j);
+            const float length = std::sqrt(
+                (c.xyz.x - a.xyz.x) * (c.xyz.x - a.xyz.x) + (c.xyz.y - a.xyz.y) * (c.xyz.y - a.xyz.y) + (c.xyz.z - a.xyz.z) * (c.xyz.z - a.xyz.z));
+            const int steps = std::max(1, static_cast<int>(std::ceil(length / (0.75f * radius))));
+            for (int s = 0; s <= steps; s++)
+            {
+                const float t = static_cast<float>(s) / steps;
+                const k4a_float3_t center = {
+                    a.xyz.x + (c.xyz.x - a.xyz.x) * t,
+                    a.xyz.y + (c.xyz.y - a.xyz.y) * t,
+                    a.xyz.z + (c.xyz.z - a.xyz.z) * t };
+                RenderSphere(center, radius, static_cast<uint8_t>(b), depth, bodyIndex);
+            }
+        }
+    }
+}
+
+void StandIn::SceneRenderer::RenderSphere(const k4a_float3_t& center, float radius, uint8_t index, uint16_t* depth, uint8_t* bodyIndex) const
+{
+    const k4a_calibration_camera_t& camera = m_calibration.depth_camera_calibration;
+    const auto& intrinsics = camera.intrinsics.parameters.param;
+    if (center.xyz.z < radius + 100.f)
+    {
+        return;
+    }
+
+    const float u0 = intrinsics.fx * center.xyz.x / center.xyz.z + intrinsics.cx;
+    const float v0 = intrinsics.fy * center.xyz.y / center.xyz.z + intrinsics.cy;
+    const float pixelRadius = radius * intrinsics.fx / center.xyz.z;
+    const int uMin = std::max(0, static_cast<int>(u0 - pixelRadius));
+    const int uMax = std::min(camera.resolution_width - 1, static_cast<int>(u0 + pixelRadius));
+    const int vMin = std::max(0, static_cast<int>(v0 - pixelRadius));
+    const int vMax = std::min(camera.resolution_height - 1, static_cast<int>(v0 + pixelRadius));
+
+    const float inverseRadiusSquared = 1.f / (pixelRadius * pixelRadius);
+    for (int v = vMin; v <= vMax; v++)
+    {
+        for (int u = uMin; u <= uMax; u++)
+        {
+            const float distanceSquared = ((u - u0) * (u - u0) + (v - v0) * (v - v0)) * inverseRadiusSquared;
+            if (distanceSquared > 1.f)
+            {
+                continue;
+            }
+
+            // Front surface of the sphere, closer surfaces win
+            const uint16_t z = static_cast<uint16_t>(center.xyz.z - radius * std::sqrt(1.f - distanceSquared));
+            const int pixel = v * camera.resolution_width + u;
+            if (z < depth[pixel])
+            {
+                depth[pixel] = z;
+                bodyIndex[pixel] = index;
+            }
+        }
+    }
+}
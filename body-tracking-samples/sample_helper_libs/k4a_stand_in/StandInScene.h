@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <k4a/k4atypes.h>
+#include <k4abttypes.h>
+
+#include "SkeletonFile.h"
+#include "StandInObjects.h"
+#include "StandInSettings.h"
+
+namespace StandIn
+{
+    // Calibration of an ideal device: pinhole cameras without lens distortion, the color camera and the IMU at
+    // the optical center of the depth camera. Resolutions and fields of view follow the modes of the real device.
+    k4a_calibration_t CreateCalibration(k4a_depth_mode_t depthMode, k4a_color_resolution_t colorResolution);
+
+    // Bodies of every frame: a procedural animation of Settings::BodyCount people walking in place side by side,
+    // or the frames of Settings::SkeletonFile.
+    class SkeletonSource
+    {
+    public:
+        // Throws std::runtime_error if the skeleton file cannot be read
+        explicit SkeletonSource(const Settings& settings);
+
+        // Frames of the skeleton file, 0 for the endless animation
+        size_t GetFrameCount() const { return m_frames.size(); }
+
+        // Device timestamp of a frame of the skeleton file
+        uint64_t GetTimestampUsec(size_t frameIndex) const { return m_frames[frameIndex].DeviceTimestampUsec; }
+
+        // Bodies at a frame of the skeleton file (looped) or at a time of the animation
+        void GetBodies(uint64_t frameIndex, uint64_t timestampUsec, std::vector<k4abt_body_t>& bodies) const;
+
+    private:
+        uint32_t m_bodyCount = 0;
+        std::vector<SkeletonFileFrame> m_frames;
+    };
+
+    // Renders the depth image and the body index map of a room (a floor and a back wall) with bodies in it
+    class SceneRenderer
+    {
+    public:
+        SceneRenderer(const k4a_calibration_t& calibration, k4a_image_format_t colorFormat);
+
+        // Capture with the depth image, a gray BGRA32 color image if configured, and the bodies as ground truth
+        Capture* CreateCapture(const std::vector<k4abt_body_t>& bodies, uint64_t deviceTimestampUsec);
+
+    private:
+        void RenderBodies(const std::vector<k4abt_body_t>& bodies, uint16_t* depth, uint8_t* bodyIndex) const;
+        void RenderSphere(const k4a_float3_t& center, float radius, uint8_t index, uint16_t* depth, uint8_t* bodyIndex) const;
+
+        k4a_calibration_t m_calibration;
+        bool m_colorEnabled = false;
+        std::vector<uint16_t> m_background;
+    };
+}
@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "StandInSettings.h"
+
+#include <cstdlib>
+#include <mutex>
+
+namespace
+{
+    uint32_t GetEnvironmentValue(const char* name, uint32_t defaultValue)
+    {
+        const char* value = std::getenv(name);
+        if (value == nullptr || *value == '\0')
+        {
+            return defaultValue;
+        }
+        return static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    }
+
+    StandIn::Settings LoadSettingsFromEnvironment()
+    {
+        StandIn::Settings settings;
+        settings.DeviceCount = GetEnvironmentValue("K4A_STAND_IN_DEVICES", settings.DeviceCount);
+        settings.FramesPerSecond = GetEnvironmentValue("K4A_STAND_IN_FPS", settings.FramesPerSecond);
+        settings.BodyCount = GetEnvironmentValue("K4A_STAND_IN_BODIES", settings.BodyCount);
+        settings.TrackerLatencyMs = GetEnvironmentValue("K4A_STAND_IN_TRACKER_LATENCY_MS", settings.TrackerLatencyMs);
+        settings.TrackerQueueDepth = GetEnvironmentValue("K4A_STAND_IN_TRACKER_QUEUE_DEPTH", settings.TrackerQueueDepth);
+        settings.PlaybackFrameCount = GetEnvironmentValue("K4A_STAND_IN_PLAYBACK_FRAMES", settings.PlaybackFrameCount);
+        settings.SyncCables = GetEnvironmentValue("K4A_STAND_IN_SYNC_CABLES", settings.SyncCables ? 1 : 0) != 0;
+        if (const char* skeletonFile = std::getenv("K4A_STAND_IN_SKELETON_FILE"))
+        {
+            settings.SkeletonFile = skeletonFile;
+        }
+        return settings;
+    }
+
+    std::mutex g_settingsMutex;
+
+    StandIn::Settings& GetStoredSettings()
+    {
+        static StandIn::Settings settings = LoadSettingsFromEnvironment();
+        return settings;
+    }
+}
+
+StandIn::Settings StandIn::GetSettings()
+{
+    std::lock_guard<std::mutex> lock(g_settingsMutex);
+    return GetStoredSettings();
+}
+
+void StandIn::SetSettings(const Settings& settings)
+{
+    std::lock_guard<std::mutex> lock(g_settingsMutex);
+    GetStoredSettings() = settings;
+}
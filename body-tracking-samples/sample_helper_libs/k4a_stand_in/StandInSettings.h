@@ -0,0 +1,40 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace StandIn
+{
+    // Behavior of the stand-in devices, trackers and playbacks.
+    //
+    // The defaults are read once from the environment, so the unmodified samples can be configured from a
+    // script. A load test that links the stand-in directly can call SetSettings before opening anything.
+    //
+    //     K4A_STAND_IN_DEVICES               Number of installed devices (1)
+    //     K4A_STAND_IN_FPS                   Camera frame rate, overrides the k4a_fps_t of the samples (0: not overridden)
+    //     K4A_STAND_IN_BODIES                Number of procedurally animated bodies (1)
+    //     K4A_STAND_IN_SKELETON_FILE         Skeleton file to replay instead of the animation (none)
+    //     K4A_STAND_IN_TRACKER_LATENCY_MS    Time from enqueue until the result of a capture can be popped (30)
+    //     K4A_STAND_IN_TRACKER_QUEUE_DEPTH   Captures the tracker processes at the same time before enqueue waits (3)
+    //     K4A_STAND_IN_PLAYBACK_FRAMES       Length of a played back recording of the animation (300)
+    //     K4A_STAND_IN_SYNC_CABLES           1: the devices are daisy chained with sync cables, device 0 first (0)
+    struct Settings
+    {
+        uint32_t DeviceCount = 1;
+        uint32_t FramesPerSecond = 0;
+        uint32_t BodyCount = 1;
+        std::string SkeletonFile;
+        uint32_t TrackerLatencyMs = 30;
+        uint32_t TrackerQueueDepth = 3;
+        uint32_t PlaybackFrameCount = 300;
+        bool SyncCables = false;
+    };
+
+    Settings GetSettings();
+
+    // Applies to devices, trackers and playbacks opened afterwards
+    void SetSettings(const Settings& settings);
+}
@@ -7,6 +7,7 @@
 #include <k4a/k4a.h>
 #include <k4abt.h>
 
+#include "LatencyRecorder.h"
 #include "Utilities.h"
 
 const float MillimeterToMeter = 0.001f;
@@ -85,7 +86,7 @@ void Window3dWrapper::Delete()
     }
 }
 
-void Window3dWrapper::UpdatePointClouds(k4a_image_t depthImage, std::vector<Color> pointCloudColors)
+void Window3dWrapper::UpdatePointClouds(k4a_image_t depthImage, const std::vector<Color>& pointCloudColors)
 {
     m_pointCloudUpdated = true;
     VERIFY(k4a_transformation_depth_image_to_point_cloud(m_transformationHandle,
@@ -93,10 +94,20 @@ void Window3dWrapper::UpdatePointClouds(k4a_image_t depthImage, std::vector<Colo
         K4A_CALIBRATION_TYPE_DEPTH,
         m_pointCloudImage), "Transform depth image to point clouds failed!");
 
-    int width = k4a_image_get_width_pixels(m_pointCloudImage);
-    int height = k4a_image_get_height_pixels(m_pointCloudImage);
+    ConvertPointCloud(m_pointCloudImage, pointCloudColors, m_pointClouds);
 
-    int16_t* pointCloudImageBuffer = (int16_t*)k4a_image_get_buffer(m_pointCloudImage);
+    UpdateDepthBuffer(depthImage);
+}
+
+void Window3dWrapper::ConvertPointCloud(
+    k4a_image_t pointCloudImage,
+    const std::vector<Color>& pointCloudColors,
+    std::vector<Visualization::PointCloudVertex>& vertices)
+{
+    int width = k4a_image_get_width_pixels(pointCloudImage);
+    int height = k4a_image_get_height_pixels(pointCloudImage);
+
+    int16_t* pointCloudImageBuffer = (int16_t*)k4a_image_get_buffer(pointCloudImage);
 
     for (int h = 0; h < height; h++)
     {
@@ -130,11 +141,9 @@ void Window3dWrapper::UpdatePointClouds(k4a_image_t depthImage, std::vector<Colo
             pointCloud.PixelLocation[0] = pixelLocation[0];
             pointCloud.PixelLocation[1] = pixelLocation[1];
 
-            m_pointClouds.push_back(pointCloud);
+            vertices.push_back(pointCloud);
         }
     }
-
-    UpdateDepthBuffer(depthImage);
 }
 
 void Window3dWrapper::CleanJointsAndBones()
@@ -210,6 +219,7 @@ void Window3dWrapper::Render()
 {
     if (m_pointCloudUpdated || m_pointClouds.size() != 0)
     {
+        LatencyScope latency(PipelineStage::PointCloudUpload);
         m_window3d.UpdatePointClouds(m_pointClouds.data(), (uint32_t)m_pointClouds.size(), m_depthBuffer.data(), m_depthWidth, m_depthHeight);
         m_pointClouds.clear();
         m_pointCloudUpdated = false;
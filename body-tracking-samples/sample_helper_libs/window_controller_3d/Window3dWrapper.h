@@ -37,7 +37,14 @@ public:
 
     void Delete();
 
-    void UpdatePointClouds(k4a_image_t depthImage, std::vector<Color> pointCloudColors = std::vector<Color>());
+    void UpdatePointClouds(k4a_image_t depthImage, const std::vector<Color>& pointCloudColors = std::vector<Color>());
+
+    // Append a vertex for every valid point of an int16 point cloud image (millimeters) to vertices, in meters.
+    // pointCloudColors is either empty or holds one body color per pixel that is blended into the point color.
+    static void ConvertPointCloud(
+        k4a_image_t pointCloudImage,
+        const std::vector<Color>& pointCloudColors,
+        std::vector<Visualization::PointCloudVertex>& vertices);
 
     void CleanJointsAndBones();
 
@@ -63,7 +70,7 @@ public:
 private:
     void InitializeCalibration(const k4a_calibration_t& sensorCalibration);
 
-    void BlendBodyColor(linmath::vec4 color, Color bodyColor);
+    static void BlendBodyColor(linmath::vec4 color, Color bodyColor);
 
     void UpdateDepthBuffer(k4a_image_t depthImage);
 
@@ -11,6 +11,7 @@
 
 #include "ViewControl.h"
 #include "Helpers.h"
+#include "LatencyRecorder.h"
 
 using namespace linmath;
 using namespace Visualization;
@@ -321,6 +322,7 @@ void WindowController3d::TriggerCameraPivotPointRendering()
 void WindowController3d::Render(std::vector<uint8_t>* renderedPixelsBgr, int* pixelsWidth, int* pixelsHeight)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
+    const LatencyClock::time_point submitStart = LatencyClock::now();
 
     glfwMakeContextCurrent(m_window);
 
@@ -366,7 +368,13 @@ void WindowController3d::Render(std::vector<uint8_t>* renderedPixelsBgr, int* pi
         *pixelsHeight = windowHeight;
     }
 
-    glfwSwapBuffers(m_window);
+    g_latencyRecorder.Record(PipelineStage::RenderSubmit, submitStart, LatencyClock::now());
+
+    {
+        // Waits for the GPU and, with vsync, for the display
+        LatencyScope latency(PipelineStage::Swap);
+        glfwSwapBuffers(m_window);
+    }
     glfwPollEvents();
 }
 
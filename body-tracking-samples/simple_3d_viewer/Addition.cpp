@@ -1,23 +1,20 @@
-#include <filesystem>
+#include <cmath>
 #include <fstream>
 #include <iostream>
-#include <mutex>
 #include <stdexcept>
 #include <sstream>
 #include <vector>
 #include <k4a/k4a.h>
 
 #include <BodyTrackingHelpers.h>
-#include <Eigen/Dense>
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 #include "Addition.h"
-#include "AngleCalculator.h"
 
-// Mutex for file access synchronization
-static std::mutex g_fileMutex;
-
-void SaveMultipleBodiesToCSV(const std::vector<k4abt_body_t>& bodies, std::ofstream& csvFile, uint64_t timestamp)
+template <typename Joints>
+void SaveMultipleBodiesToCSV(const std::vector<k4abt_body_t>& bodies, const FrameMetrics& metrics, std::ofstream& csvFile, uint64_t timestamp, uint64_t systemTimestampNsec)
 {
     try
     {
@@ -32,24 +29,25 @@ void SaveMultipleBodiesToCSV(const std::vector<k4abt_body_t>& bodies, std::ofstr
             throw std::runtime_error("Failed to open CSV file - file not open");
         }
 
-        // Lock the file for exclusive access
-        std::lock_guard<std::mutex> lock(g_fileMutex);
-
         // Write CSV Header if file is empty (same as in single body function)
         if (csvFile.tellp() == 0)
         {
             std::stringstream headerStream;
-            headerStream << "BodyID,Time";
+            headerStream << "BodyID,Time,DeviceTimeUsec,SystemTimeNsec";
             
-            for (int joint = 0; joint < static_cast<int>(K4ABT_JOINT_COUNT); joint++)
+            for (k4abt_joint_id_t joint : Joints::Ids)
             {
-                const std::string& jointName = g_jointNames.at(static_cast<k4abt_joint_id_t>(joint));
+                const std::string_view jointName = g_jointNames[joint];
                 headerStream << "," << jointName << "_X"
                              << "," << jointName << "_Y"
                              << "," << jointName << "_Z"
                              << "," << jointName << "_CONFIDENCE";
             }
-            headerStream << ",ANGLE" << std::endl;
+            for (const std::string& metricName : metrics.Names)
+            {
+                headerStream << "," << metricName;
+            }
+            headerStream << std::endl;
             csvFile << headerStream.str();
         }
 
@@ -57,51 +55,25 @@ void SaveMultipleBodiesToCSV(const std::vector<k4abt_body_t>& bodies, std::ofstr
         std::stringstream batchStream;
         
         // Process all bodies
-        for (const auto& body : bodies)
+        for (size_t bodyIndex = 0; bodyIndex < bodies.size(); bodyIndex++)
         {
-            // Calculate arm angle
-            Eigen::Vector3d jointPositionPelvis(
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_PELVIS)].position.xyz.x,
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_PELVIS)].position.xyz.y,
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_PELVIS)].position.xyz.z
-            );
-
-            Eigen::Vector3d jointPositionNeck(
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_NECK)].position.xyz.x,
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_NECK)].position.xyz.y,
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_NECK)].position.xyz.z
-            );
-
-            Eigen::Vector3d jointPositionNose(
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_NOSE)].position.xyz.x,
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_NOSE)].position.xyz.y,
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_NOSE)].position.xyz.z
-            );
-
-            Eigen::Vector3d jointPositionShoulder(
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_SHOULDER_RIGHT)].position.xyz.x,
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_SHOULDER_RIGHT)].position.xyz.y,
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_SHOULDER_RIGHT)].position.xyz.z
-            );
-
-            Eigen::Vector3d jointPositionElbow(
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_ELBOW_RIGHT)].position.xyz.x,
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_ELBOW_RIGHT)].position.xyz.y,
-                body.skeleton.joints[static_cast<int>(K4ABT_JOINT_ELBOW_RIGHT)].position.xyz.z
-            );
-			double angle = CalculateProjectedAngle(jointPositionPelvis, jointPositionNeck, jointPositionNose, jointPositionPelvis, jointPositionShoulder, jointPositionElbow);
-
-            batchStream << body.id << "," << timestamp;
+            const k4abt_body_t& body = bodies[bodyIndex];
+            batchStream << body.id << "," << timestamp << "," << metrics.DeviceTimestampUsec << "," << systemTimestampNsec;
             
-            for (int joint = 0; joint < static_cast<int>(K4ABT_JOINT_COUNT); joint++)
-            {
+            Joints::ForEach([&](k4abt_joint_id_t joint) {
                 const k4a_float3_t& position = body.skeleton.joints[joint].position;
                 batchStream << "," << position.xyz.x
                            << "," << position.xyz.y
                            << "," << position.xyz.z
                            << "," << body.skeleton.joints[joint].confidence_level;
+            });
+
+            // Metrics are precomputed once per frame by the metrics pipeline
+            for (size_t metric = 0; metric < metrics.Names.size(); metric++)
+            {
+                batchStream << "," << metrics.At(metric, bodyIndex);
             }
-            batchStream << "," << angle << std::endl;
+            batchStream << std::endl;
         }
         
         // Write all data at once
@@ -122,6 +94,83 @@ void SaveMultipleBodiesToCSV(const std::vector<k4abt_body_t>& bodies, std::ofstr
     }
 }
 
+template <typename Joints>
+void SaveMultipleBodiesToJSON(const std::vector<k4abt_body_t>& bodies, const FrameMetrics& metrics, std::ofstream& jsonFile, uint64_t timestamp, uint64_t systemTimestampNsec)
+{
+    try
+    {
+        if (!jsonFile.is_open())
+        {
+            throw std::runtime_error("Failed to open JSON file - file not open");
+        }
+
+        // One self-contained JSON object per line
+        std::stringstream frameStream;
+        frameStream << "{\"timestamp\":" << timestamp
+                    << ",\"device_timestamp_usec\":" << metrics.DeviceTimestampUsec
+                    << ",\"system_timestamp_nsec\":" << systemTimestampNsec;
+        if constexpr (!Joints::IsFull())
+        {
+            // Positions of a subset are listed in the order of these joint ids
+            for (size_t index = 0; index < Joints::Count; index++)
+            {
+                frameStream << (index == 0 ? ",\"joint_ids\":[" : ",") << static_cast<int>(Joints::Ids[index]);
+            }
+            frameStream << "]";
+        }
+        frameStream << ",\"bodies\":[";
+        for (size_t bodyIndex = 0; bodyIndex < bodies.size(); bodyIndex++)
+        {
+            const k4abt_body_t& body = bodies[bodyIndex];
+            frameStream << (bodyIndex == 0 ? "" : ",") << "{\"body_id\":" << body.id << ",\"joint_positions\":[";
+            const char* separator = "[";
+            Joints::ForEach([&](k4abt_joint_id_t joint) {
+                const k4a_float3_t& position = body.skeleton.joints[joint].position;
+                frameStream << separator << position.xyz.x << "," << position.xyz.y << "," << position.xyz.z << "]";
+                separator = ",[";
+            });
+            frameStream << "],\"metrics\":{";
+            for (size_t metric = 0; metric < metrics.Names.size(); metric++)
+            {
+                frameStream << (metric == 0 ? "\"" : ",\"") << metrics.Names[metric] << "\":";
+                const float value = metrics.At(metric, bodyIndex);
+                if (std::isfinite(value))
+                {
+                    frameStream << value;
+                }
+                else
+                {
+                    frameStream << "null";
+                }
+            }
+            frameStream << "}}";
+        }
+        frameStream << "]}" << std::endl;
+
+        jsonFile << frameStream.str();
+        jsonFile.flush();
+
+        if (!jsonFile.good())
+        {
+            throw std::runtime_error("Failed to write multiple bodies to JSON file - disk full or I/O error");
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error writing multiple bodies to JSON: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+// Instantiations for the joint profiles that can be selected at run time
+#define INSTANTIATE_BODY_WRITERS(Joints) \
+    template void SaveMultipleBodiesToCSV<Joints>(const std::vector<k4abt_body_t>&, const FrameMetrics&, std::ofstream&, uint64_t, uint64_t); \
+    template void SaveMultipleBodiesToJSON<Joints>(const std::vector<k4abt_body_t>&, const FrameMetrics&, std::ofstream&, uint64_t, uint64_t);
+
+INSTANTIATE_BODY_WRITERS(JointProfiles::Full)
+INSTANTIATE_BODY_WRITERS(JointProfiles::UpperBody)
+INSTANTIATE_BODY_WRITERS(JointProfiles::Legs)
+
 // Function to get the current timestamp in microseconds
 uint64_t GetTimestamp()
 {
@@ -145,65 +194,4 @@ uint64_t GetTimestamp()
     }
     return static_cast<uint64_t>(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
 #endif
-}
-
-void SaveColorImage(const k4a_image_t& colorImage, const std::string& folderPath, uint64_t timestamp, uint64_t frameCount)
-{
-	try
-	{
-		// Input validation
-		if (colorImage == nullptr)
-		{
-			throw std::runtime_error("Invalid color image");
-			}
-		
-		// If the folder does not exist, create it
-        try {
-            if (!std::filesystem::exists(folderPath))
-            {
-                if (!std::filesystem::create_directories(folderPath))
-                {
-                    throw std::runtime_error("Failed to create directory: " + folderPath);
-                }
-                std::cout << "Created directory: " << folderPath << std::endl;
-            }
-        }
-        catch (const std::filesystem::filesystem_error& e) {
-            throw std::runtime_error("Filesystem error: " + std::string(e.what()));
-        }
-		
-		// Generate filename
-		std::ostringstream ss;
-		ss << folderPath << "/color_" << timestamp << "_" << std::setw(6) << std::setfill('0') << frameCount << ".jpg";
-		std::string fileName = ss.str();
-		
-		// Get metadata of images
-		uint8_t* buffer = k4a_image_get_buffer(colorImage);
-		size_t bufferSize = k4a_image_get_size(colorImage);
-		
-		// Lock the file for exclusive access
-		std::lock_guard<std::mutex> lock(g_fileMutex);
-		
-        // Save as jpeg
-		std::ofstream outFile(fileName, std::ios::binary);
-		if (!outFile)
-		{
-			throw std::runtime_error("Failed to open color image file: " + fileName);
-		}
-		
-		// Write the color image data
-		outFile.write(reinterpret_cast<const char*>(buffer), bufferSize);
-		
-		// Close the file
-		outFile.close();
-		if (!outFile.good())
-		{
-			throw std::runtime_error("Failed to write color image data");
-		}
-	}
-	catch (const std::exception& e)
-	{
-		std::cerr << "Error saving color image: " << e.what() << std::endl;
-		throw;
-	}
 }
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include <stdexcept>
 #include <vector>
 #include <BodyTrackingHelpers.h>
+#include <JointSet.h>
+
+#include "MetricsPipeline.h"
 
 /**
  * @brief Function to save joint positions to a CSV file.
@@ -19,14 +22,38 @@ void SaveJointPositionsToCSV(const k4abt_body_t& body, std::ofstream& csvFile, u
  * @brief Function to save multiple bodies' joint positions to a CSV file in a batch.
  * 
  * This is more efficient than calling SaveJointPositionsToCSV multiple times
- * as it reduces file access operations and locking overhead.
+ * as it reduces file access operations. The stream must only be used by one thread,
+ * in the viewer that is the CSV sink of the result bus.
+ *
+ * Only the joints of the Joints set get columns. Instantiated for JointProfiles::Full,
+ * UpperBody and Legs.
  * 
  * @param bodies Vector of body data
+ * @param metrics Derived metrics of the bodies, one extra column per metric
  * @param csvFile CSV file stream to write to
  * @param timestamp Timestamp of the frame
+ * @param systemTimestampNsec Host time the depth image was received (k4a_image_get_system_timestamp_nsec), written
+ *        with the device timestamp of metrics so that rows can be correlated with the exposure
  * @throws std::runtime_error if file operations fail
  */
-void SaveMultipleBodiesToCSV(const std::vector<k4abt_body_t>& bodies, std::ofstream& csvFile, uint64_t timestamp);
+template <typename Joints = JointProfiles::Full>
+void SaveMultipleBodiesToCSV(const std::vector<k4abt_body_t>& bodies, const FrameMetrics& metrics, std::ofstream& csvFile, uint64_t timestamp, uint64_t systemTimestampNsec);
+
+/**
+ * @brief Function to save multiple bodies' joint positions and metrics as one JSON line per frame.
+ *
+ * "joint_positions" lists the joints of the Joints set. For a subset, the frame also has a
+ * "joint_ids" array with the joint id of every position. Instantiated like SaveMultipleBodiesToCSV.
+ *
+ * @param bodies Vector of body data
+ * @param metrics Derived metrics of the bodies, written as a "metrics" object per body (null if not available)
+ * @param jsonFile JSON Lines file stream to write to, only used by one thread
+ * @param timestamp Timestamp of the frame
+ * @param systemTimestampNsec Host time the depth image was received, like SaveMultipleBodiesToCSV
+ * @throws std::runtime_error if file operations fail
+ */
+template <typename Joints = JointProfiles::Full>
+void SaveMultipleBodiesToJSON(const std::vector<k4abt_body_t>& bodies, const FrameMetrics& metrics, std::ofstream& jsonFile, uint64_t timestamp, uint64_t systemTimestampNsec);
 
 /**
  * @brief Gets the current timestamp in microseconds.
@@ -37,14 +64,4 @@ void SaveMultipleBodiesToCSV(const std::vector<k4abt_body_t>& bodies, std::ofstr
  *
  * @return uint64_t The current timestamp in microseconds, or 0 on error.
  */
-uint64_t GetTimestamp();
-
-/**
- * @brief Function to save a color image to disk.
- *
- * @param colorImage Color image to save
- * @param folderPath Folder path to save the image
- * @param timestamp Timestamp of the frame
- * @param frameCount Frame count of the image
- */
-void SaveColorImage(const k4a_image_t& colorImage, const std::string& folderPath, uint64_t timestamp, uint64_t frameCount);
\ No newline at end of file
+uint64_t GetTimestamp();
\ No newline at end of file
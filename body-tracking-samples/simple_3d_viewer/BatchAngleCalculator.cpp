@@ -0,0 +1,219 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <limits>
+
+#include "BatchAngleCalculator.h"
+
+namespace
+{
+    // Segments shorter than this (in millimeters) are treated as degenerate
+    const float DegenerateLengthThreshold = 1e-6f;
+
+    const float RadianToDegree = static_cast<float>(180.0 / M_PI);
+    const float Pi = static_cast<float>(M_PI);
+
+    // Coefficients of the acos approximation from Abramowitz and Stegun 4.4.46 (|error| <= 2e-8 rad).
+    // acos(x) = sqrt(1 - x) * P(x) for 0 <= x <= 1. It only uses operations Eigen can vectorize.
+    const float AcosCoefficients[8] = {
+        1.5707963050f, -0.2145988016f, 0.0889789874f, -0.0501743046f,
+        0.0308918810f, -0.0170881256f, 0.0066700901f, -0.0012624911f };
+}
+
+void JointPositionsSoA::Assign(const std::vector<k4abt_body_t>& bodies)
+{
+    BodyCount = bodies.size();
+    const size_t size = static_cast<size_t>(K4ABT_JOINT_COUNT) * BodyCount;
+    X.resize(size);
+    Y.resize(size);
+    Z.resize(size);
+
+    for (size_t body = 0; body < BodyCount; body++)
+    {
+        const k4abt_joint_t* joints = bodies[body].skeleton.joints;
+        for (size_t joint = 0; joint < static_cast<size_t>(K4ABT_JOINT_COUNT); joint++)
+        {
+            const size_t index = joint * BodyCount + body;
+            X[index] = joints[joint].position.xyz.x;
+            Y[index] = joints[joint].position.xyz.y;
+            Z[index] = joints[joint].position.xyz.z;
+        }
+    }
+}
+
+BatchAngleCalculator::BatchAngleCalculator(std::vector<JointAngleDefinition> definitions)
+    : m_definitions(std::move(definitions))
+{
+}
+
+void BatchAngleCalculator::PrepareLanes(size_t bodyCount)
+{
+    const size_t laneCount = m_definitions.size() * bodyCount;
+    m_projectLane.resize(laneCount);
+    m_unsignedLane.resize(laneCount);
+    for (size_t angle = 0; angle < m_definitions.size(); angle++)
+    {
+        const JointAngleKind kind = m_definitions[angle].Kind;
+        m_projectLane.segment(angle * bodyCount, bodyCount).setConstant(kind == JointAngleKind::Projected ? 1.f : 0.f);
+        m_unsignedLane.segment(angle * bodyCount, bodyCount).setConstant(kind == JointAngleKind::Unsigned ? 1.f : 0.f);
+    }
+
+    m_v1x.resize(laneCount); m_v1y.resize(laneCount); m_v1z.resize(laneCount);
+    m_v2x.resize(laneCount); m_v2y.resize(laneCount); m_v2z.resize(laneCount);
+    m_nx.resize(laneCount); m_ny.resize(laneCount); m_nz.resize(laneCount);
+    m_sign.resize(laneCount); m_valid.resize(laneCount);
+    m_laneBodyCount = bodyCount;
+}
+
+void BatchAngleCalculator::Compute(const JointPositionsSoA& joints, JointAngleBatch& result)
+{
+    const size_t bodyCount = joints.BodyCount;
+    const size_t laneCount = m_definitions.size() * bodyCount;
+
+    result.BodyCount = bodyCount;
+    result.AngleCount = m_definitions.size();
+    result.Degrees.resize(laneCount);
+    result.ValidMask.resize(laneCount);
+    if (laneCount == 0)
+    {
+        return;
+    }
+
+    if (bodyCount != m_laneBodyCount || m_projectLane.size() != static_cast<Eigen::Index>(laneCount))
+    {
+        PrepareLanes(bodyCount);
+    }
+
+    const float* x = joints.X.data();
+    const float* y = joints.Y.data();
+    const float* z = joints.Z.data();
+
+    // Gather the two segments and the raw reference plane normal of every lane. With the joint-major
+    // layout the bodies of one joint are contiguous, so this is a handful of short linear copies.
+    for (size_t angle = 0; angle < m_definitions.size(); angle++)
+    {
+        const JointAngleDefinition& definition = m_definitions[angle];
+        const size_t first = definition.Joints[0] * bodyCount;
+        const size_t vertex = definition.Joints[1] * bodyCount;
+        const size_t last = definition.Joints[2] * bodyCount;
+        const bool hasPlane = definition.Kind != JointAngleKind::Unsigned;
+
+        // Same orientation as CalculateNormalVector: (p1 - p2) x (p3 - p2)
+        const size_t p1 = definition.Plane[0] * bodyCount;
+        const size_t p2 = definition.Plane[1] * bodyCount;
+        const size_t p3 = definition.Plane[2] * bodyCount;
+
+        for (size_t body = 0, lane = angle * bodyCount; body < bodyCount; body++, lane++)
+        {
+            m_v1x[lane] = x[first + body] - x[vertex + body];
+            m_v1y[lane] = y[first + body] - y[vertex + body];
+            m_v1z[lane] = z[first + body] - z[vertex + body];
+            m_v2x[lane] = x[last + body] - x[vertex + body];
+            m_v2y[lane] = y[last + body] - y[vertex + body];
+            m_v2z[lane] = z[last + body] - z[vertex + body];
+
+            if (hasPlane)
+            {
+                const float ax = x[p1 + body] - x[p2 + body];
+                const float ay = y[p1 + body] - y[p2 + body];
+                const float az = z[p1 + body] - z[p2 + body];
+                const float bx = x[p3 + body] - x[p2 + body];
+                const float by = y[p3 + body] - y[p2 + body];
+                const float bz = z[p3 + body] - z[p2 + body];
+                m_nx[lane] = ay * bz - az * by;
+                m_ny[lane] = az * bx - ax * bz;
+                m_nz[lane] = ax * by - ay * bx;
+            }
+            else
+            {
+                // A zero normal makes the projection a no-op
+                m_nx[lane] = 0.f;
+                m_ny[lane] = 0.f;
+                m_nz[lane] = 0.f;
+            }
+        }
+    }
+
+    // The rest is lane-wise arithmetic over all angles of all bodies. The output array doubles as
+    // scratch storage so that no temporaries are allocated.
+    Eigen::ArrayXf& degrees = result.Degrees;
+    Eigen::ArrayXf& scratch = degrees;
+
+    // Normalize the plane normal. Unsigned lanes carry a zero normal which makes the projection a no-op.
+    scratch = (m_nx.square() + m_ny.square() + m_nz.square()).sqrt();
+    m_valid = ((scratch > DegenerateLengthThreshold) || (m_unsignedLane > 0.5f)).cast<float>();
+    scratch = (scratch > DegenerateLengthThreshold).select(scratch.inverse(), 0.f);
+    m_nx *= scratch;
+    m_ny *= scratch;
+    m_nz *= scratch;
+
+    // Project both segments onto the plane: v' = v - (n . v) n. Projecting the points and then
+    // taking differences (as CalculateProjectedAngle does) gives the same vectors.
+    scratch = (m_nx * m_v1x + m_ny * m_v1y + m_nz * m_v1z) * m_projectLane;
+    m_v1x -= scratch * m_nx;
+    m_v1y -= scratch * m_ny;
+    m_v1z -= scratch * m_nz;
+    scratch = (m_nx * m_v2x + m_ny * m_v2y + m_nz * m_v2z) * m_projectLane;
+    m_v2x -= scratch * m_nx;
+    m_v2y -= scratch * m_ny;
+    m_v2z -= scratch * m_nz;
+
+    // Direction of the angle: (v1 x v2) . n
+    m_sign = (m_v1y * m_v2z - m_v1z * m_v2y) * m_nx + (m_v1z * m_v2x - m_v1x * m_v2z) * m_ny + (m_v1x * m_v2y - m_v1y * m_v2x) * m_nz;
+
+    // Segment lengths (the normal is no longer needed, reuse its lanes)
+    m_ny = (m_v1x.square() + m_v1y.square() + m_v1z.square()).sqrt();
+    m_nz = (m_v2x.square() + m_v2y.square() + m_v2z.square()).sqrt();
+    m_valid *= ((m_ny > DegenerateLengthThreshold) && (m_nz > DegenerateLengthThreshold)).cast<float>();
+
+    // Cosine of the angle, clamped for floating point precision issues
+    scratch = (m_valid > 0.5f).select((m_v1x * m_v2x + m_v1y * m_v2y + m_v1z * m_v2z) / (m_ny * m_nz), 1.f).max(-1.f).min(1.f);
+
+    // acos(|c|) by the polynomial approximation, then mirrored for negative cosines
+    const auto& c = AcosCoefficients;
+    m_ny = scratch.abs();
+    m_nz = (1.f - m_ny).sqrt() *
+        (((((((c[7] * m_ny + c[6]) * m_ny + c[5]) * m_ny + c[4]) * m_ny + c[3]) * m_ny + c[2]) * m_ny + c[1]) * m_ny + c[0]);
+    degrees = (scratch >= 0.f).select(m_nz, Pi - m_nz) * RadianToDegree;
+
+    // Same sign convention as CalculateAngle, unsigned lanes keep the positive angle
+    degrees = ((m_sign > 0.f) || (m_unsignedLane > 0.5f)).select(degrees, -degrees);
+    degrees = (m_valid > 0.5f).select(degrees, std::numeric_limits<float>::quiet_NaN());
+
+    for (size_t lane = 0; lane < laneCount; lane++)
+    {
+        result.ValidMask[lane] = m_valid[lane] > 0.5f ? 1 : 0;
+    }
+}
+
+const std::vector<JointAngleDefinition>& GetClinicalJointAngleDefinitions()
+{
+    // Sagittal plane spanned by pelvis, neck and nose, frontal plane spanned by pelvis and both shoulders
+    static const std::array<k4abt_joint_id_t, 3> Sagittal = { K4ABT_JOINT_PELVIS, K4ABT_JOINT_NECK, K4ABT_JOINT_NOSE };
+    static const std::array<k4abt_joint_id_t, 3> Frontal = { K4ABT_JOINT_SHOULDER_LEFT, K4ABT_JOINT_PELVIS, K4ABT_JOINT_SHOULDER_RIGHT };
+    static const std::array<k4abt_joint_id_t, 3> None = { K4ABT_JOINT_PELVIS, K4ABT_JOINT_PELVIS, K4ABT_JOINT_PELVIS };
+
+    static const std::vector<JointAngleDefinition> definitions =
+    {
+        { "ELBOW_FLEXION_LEFT",      JointAngleKind::Unsigned,  { K4ABT_JOINT_SHOULDER_LEFT,  K4ABT_JOINT_ELBOW_LEFT,     K4ABT_JOINT_WRIST_LEFT },     None },
+        { "ELBOW_FLEXION_RIGHT",     JointAngleKind::Unsigned,  { K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_ELBOW_RIGHT,    K4ABT_JOINT_WRIST_RIGHT },    None },
+        { "WRIST_FLEXION_LEFT",      JointAngleKind::Unsigned,  { K4ABT_JOINT_ELBOW_LEFT,     K4ABT_JOINT_WRIST_LEFT,     K4ABT_JOINT_HAND_LEFT },      None },
+        { "WRIST_FLEXION_RIGHT",     JointAngleKind::Unsigned,  { K4ABT_JOINT_ELBOW_RIGHT,    K4ABT_JOINT_WRIST_RIGHT,    K4ABT_JOINT_HAND_RIGHT },     None },
+        { "KNEE_FLEXION_LEFT",       JointAngleKind::Unsigned,  { K4ABT_JOINT_HIP_LEFT,       K4ABT_JOINT_KNEE_LEFT,      K4ABT_JOINT_ANKLE_LEFT },     None },
+        { "KNEE_FLEXION_RIGHT",      JointAngleKind::Unsigned,  { K4ABT_JOINT_HIP_RIGHT,      K4ABT_JOINT_KNEE_RIGHT,     K4ABT_JOINT_ANKLE_RIGHT },    None },
+        { "ANKLE_FLEXION_LEFT",      JointAngleKind::Unsigned,  { K4ABT_JOINT_KNEE_LEFT,      K4ABT_JOINT_ANKLE_LEFT,     K4ABT_JOINT_FOOT_LEFT },      None },
+        { "ANKLE_FLEXION_RIGHT",     JointAngleKind::Unsigned,  { K4ABT_JOINT_KNEE_RIGHT,     K4ABT_JOINT_ANKLE_RIGHT,    K4ABT_JOINT_FOOT_RIGHT },     None },
+        { "HIP_FLEXION_LEFT",        JointAngleKind::Projected, { K4ABT_JOINT_SPINE_CHEST,    K4ABT_JOINT_HIP_LEFT,       K4ABT_JOINT_KNEE_LEFT },      Sagittal },
+        { "HIP_FLEXION_RIGHT",       JointAngleKind::Projected, { K4ABT_JOINT_SPINE_CHEST,    K4ABT_JOINT_HIP_RIGHT,      K4ABT_JOINT_KNEE_RIGHT },     Sagittal },
+        { "HIP_ABDUCTION_LEFT",      JointAngleKind::Projected, { K4ABT_JOINT_SPINE_CHEST,    K4ABT_JOINT_HIP_LEFT,       K4ABT_JOINT_KNEE_LEFT },      Frontal },
+        { "HIP_ABDUCTION_RIGHT",     JointAngleKind::Projected, { K4ABT_JOINT_SPINE_CHEST,    K4ABT_JOINT_HIP_RIGHT,      K4ABT_JOINT_KNEE_RIGHT },     Frontal },
+        { "SHOULDER_FLEXION_LEFT",   JointAngleKind::Projected, { K4ABT_JOINT_PELVIS,         K4ABT_JOINT_SHOULDER_LEFT,  K4ABT_JOINT_ELBOW_LEFT },     Sagittal },
+        { "SHOULDER_FLEXION_RIGHT",  JointAngleKind::Projected, { K4ABT_JOINT_PELVIS,         K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_ELBOW_RIGHT },    Sagittal },
+        { "SHOULDER_ABDUCTION_LEFT", JointAngleKind::Projected, { K4ABT_JOINT_HIP_LEFT,       K4ABT_JOINT_SHOULDER_LEFT,  K4ABT_JOINT_ELBOW_LEFT },     Frontal },
+        { "SHOULDER_ABDUCTION_RIGHT",JointAngleKind::Projected, { K4ABT_JOINT_HIP_RIGHT,      K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_ELBOW_RIGHT },    Frontal },
+        { "TRUNK_FLEXION",           JointAngleKind::Projected, { K4ABT_JOINT_PELVIS,         K4ABT_JOINT_SPINE_NAVEL,    K4ABT_JOINT_NECK },           Sagittal },
+        { "TRUNK_LATERAL_FLEXION",   JointAngleKind::Projected, { K4ABT_JOINT_PELVIS,         K4ABT_JOINT_SPINE_NAVEL,    K4ABT_JOINT_NECK },           Frontal },
+        { "NECK_FLEXION",            JointAngleKind::Signed,    { K4ABT_JOINT_SPINE_CHEST,    K4ABT_JOINT_NECK,           K4ABT_JOINT_HEAD },           Sagittal },
+        { "NECK_LATERAL_FLEXION",    JointAngleKind::Projected, { K4ABT_JOINT_SPINE_CHEST,    K4ABT_JOINT_NECK,           K4ABT_JOINT_HEAD },           Frontal },
+    };
+    return definitions;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <Eigen/Dense>
+#include <k4abttypes.h>
+
+/**
+ * Kind of angle computed for a joint angle definition
+ */
+enum class JointAngleKind
+{
+    Unsigned,   // Angle between the two segments meeting at the vertex, in [0, 180] degrees
+    Signed,     // Angle in [-180, 180] degrees, sign taken from the reference plane normal
+    Projected   // Signed angle after projecting the three joints onto the reference plane
+};
+
+/**
+ * Definition of one joint angle: First - Vertex - Last, with an optional reference plane
+ */
+struct JointAngleDefinition
+{
+    const char* Name;
+    JointAngleKind Kind;
+    std::array<k4abt_joint_id_t, 3> Joints;   // First, vertex, last
+    std::array<k4abt_joint_id_t, 3> Plane;    // Joints spanning the reference plane (ignored for Unsigned)
+};
+
+/**
+ * Joint positions of a batch of bodies in struct-of-arrays layout.
+ * The position of joint j of body b is stored at index j * BodyCount + b.
+ */
+struct JointPositionsSoA
+{
+    size_t BodyCount = 0;
+    Eigen::ArrayXf X;
+    Eigen::ArrayXf Y;
+    Eigen::ArrayXf Z;
+
+    /**
+     * Fill the arrays from the skeletons of the given bodies
+     *
+     * @param bodies Bodies of the current frame
+     */
+    void Assign(const std::vector<k4abt_body_t>& bodies);
+};
+
+/**
+ * Result of a batch angle calculation.
+ * The angle a of body b is stored at index a * BodyCount + b.
+ */
+struct JointAngleBatch
+{
+    size_t BodyCount = 0;
+    size_t AngleCount = 0;
+    Eigen::ArrayXf Degrees;           // NaN where the input was degenerate
+    std::vector<uint8_t> ValidMask;   // 1 if the angle is valid, 0 if the input was degenerate
+
+    float At(size_t angle, size_t body) const { return Degrees[angle * BodyCount + body]; }
+    bool IsValid(size_t angle, size_t body) const { return ValidMask[angle * BodyCount + body] != 0; }
+};
+
+/**
+ * Computes a fixed set of joint angles for all bodies of a frame at once.
+ *
+ * All (angle, body) pairs are laid out as lanes of flat float arrays so that the
+ * arithmetic is vectorized by Eigen. Unlike CalculateAngle, degenerate input does
+ * not throw; it is reported through JointAngleBatch::ValidMask instead.
+ */
+class BatchAngleCalculator
+{
+public:
+    explicit BatchAngleCalculator(std::vector<JointAngleDefinition> definitions);
+
+    const std::vector<JointAngleDefinition>& GetDefinitions() const { return m_definitions; }
+
+    /**
+     * Compute all angles for all bodies
+     *
+     * @param joints Joint positions of the bodies in struct-of-arrays layout
+     * @param result Output angles and validity mask, resized as needed
+     */
+    void Compute(const JointPositionsSoA& joints, JointAngleBatch& result);
+
+private:
+    void PrepareLanes(size_t bodyCount);
+
+    std::vector<JointAngleDefinition> m_definitions;
+    size_t m_laneBodyCount = 0;
+
+    // Per-lane constants, rebuilt when the body count changes
+    Eigen::ArrayXf m_projectLane;
+    Eigen::ArrayXf m_unsignedLane;
+
+    // Scratch lanes reused between calls
+    Eigen::ArrayXf m_v1x, m_v1y, m_v1z;
+    Eigen::ArrayXf m_v2x, m_v2y, m_v2z;
+    Eigen::ArrayXf m_nx, m_ny, m_nz;
+    Eigen::ArrayXf m_sign, m_valid;
+};
+
+/**
+ * Set of about twenty clinical joint angles (elbow, knee, hip, ankle, shoulder, wrist and trunk)
+ */
+const std::vector<JointAngleDefinition>& GetClinicalJointAngleDefinitions();
@@ -0,0 +1,227 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <k4a/k4a.h>
+
+#include "ImageArchiveWriter.h"
+
+namespace
+{
+    constexpr size_t TarBlockSize = 512;
+
+    // POSIX ustar header, see https://pubs.opengroup.org/onlinepubs/9699919799/utilities/pax.html
+    struct TarHeader
+    {
+        char Name[100];
+        char Mode[8];
+        char Uid[8];
+        char Gid[8];
+        char Size[12];
+        char ModificationTime[12];
+        char Checksum[8];
+        char TypeFlag;
+        char LinkName[100];
+        char Magic[6];
+        char Version[2];
+        char UserName[32];
+        char GroupName[32];
+        char DeviceMajor[8];
+        char DeviceMinor[8];
+        char Prefix[155];
+        char Padding[12];
+    };
+    static_assert(sizeof(TarHeader) == TarBlockSize, "A tar header is one block");
+
+    void WriteOctal(char* field, size_t fieldSize, uint64_t value)
+    {
+        // Zero padded octal digits followed by a NUL
+        std::snprintf(field, fieldSize, "%0*" PRIo64, static_cast<int>(fieldSize - 1), value);
+    }
+
+    TarHeader MakeTarHeader(const char* name, size_t size)
+    {
+        TarHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::strncpy(header.Name, name, sizeof(header.Name) - 1);
+        WriteOctal(header.Mode, sizeof(header.Mode), 0644);
+        WriteOctal(header.Uid, sizeof(header.Uid), 0);
+        WriteOctal(header.Gid, sizeof(header.Gid), 0);
+        WriteOctal(header.Size, sizeof(header.Size), size);
+        WriteOctal(header.ModificationTime, sizeof(header.ModificationTime), static_cast<uint64_t>(std::time(nullptr)));
+        header.TypeFlag = '0';
+        std::memcpy(header.Magic, "ustar", 6);
+        std::memcpy(header.Version, "00", 2);
+
+        // The checksum is computed with the checksum field filled with spaces
+        std::memset(header.Checksum, ' ', sizeof(header.Checksum));
+        unsigned int checksum = 0;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&header);
+        for (size_t i = 0; i < sizeof(header); i++)
+        {
+            checksum += bytes[i];
+        }
+        std::snprintf(header.Checksum, sizeof(header.Checksum), "%06o", checksum);
+        header.Checksum[7] = ' ';
+        return header;
+    }
+}
+
+ImageArchiveWriter::ImageArchiveWriter(ViewerResultBus& bus, const std::string& folderPath, ImageArchiveFormat format, size_t queueCapacity)
+    : m_folderPath(folderPath)
+    , m_format(format)
+{
+    // The folder is checked once here instead of for every image
+    try
+    {
+        if (!std::filesystem::exists(folderPath))
+        {
+            if (!std::filesystem::create_directories(folderPath))
+            {
+                throw std::runtime_error("Failed to create directory: " + folderPath);
+            }
+            std::cout << "Created directory for images: " << folderPath << std::endl;
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e)
+    {
+        throw std::runtime_error("Filesystem error: " + std::string(e.what()));
+    }
+
+    if (m_format == ImageArchiveFormat::Tar)
+    {
+        const std::string tarFileName = folderPath + "/color_images.tar";
+        m_tarFile.open(tarFileName, std::ios::binary | std::ios::trunc);
+        if (!m_tarFile.is_open())
+        {
+            throw std::runtime_error("Failed to create image archive: " + tarFileName);
+        }
+
+        const std::string indexFileName = folderPath + "/color_images.csv";
+        m_indexFile.open(indexFileName, std::ios::trunc);
+        if (!m_indexFile.is_open())
+        {
+            throw std::runtime_error("Failed to create image archive index: " + indexFileName);
+        }
+        m_indexFile << "FrameCount,Timestamp,Offset,Size,Name" << std::endl;
+    }
+
+    m_subscription = &bus.Subscribe<ColorImageResult>(queueCapacity, BackpressurePolicy::DropNewest);
+    m_thread = std::thread(&ImageArchiveWriter::WriterThread, this);
+}
+
+ImageArchiveWriter::~ImageArchiveWriter()
+{
+    Close();
+}
+
+void ImageArchiveWriter::Close()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+    m_subscription->Close();
+    m_thread.join();
+
+    if (m_tarFile.is_open())
+    {
+        // End of archive: two zero blocks
+        const char zeros[2 * TarBlockSize] = {};
+        m_tarFile.write(zeros, sizeof(zeros));
+    }
+}
+
+ImageArchiveStatistics ImageArchiveWriter::GetStatistics() const
+{
+    ImageArchiveStatistics statistics;
+    statistics.Written = m_written.load(std::memory_order_relaxed);
+    statistics.Dropped = m_subscription->GetDroppedCount();
+    statistics.Failed = m_failed.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+void ImageArchiveWriter::WriterThread()
+{
+    ColorImageResult pending;
+    while (m_subscription->Pop(pending))
+    {
+        if (pending.Image.Get() == nullptr)
+        {
+            continue;
+        }
+
+        if (Write(pending))
+        {
+            m_written.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            m_failed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Give the image buffer back to the SDK before waiting for the next one
+        pending = ColorImageResult();
+    }
+}
+
+bool ImageArchiveWriter::Write(const ColorImageResult& pending)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "color_%" PRIu64 "_%06" PRIu64 ".jpg", pending.Timestamp, pending.FrameCount);
+
+    const uint8_t* buffer = k4a_image_get_buffer(pending.Image.Get());
+    const size_t bufferSize = k4a_image_get_size(pending.Image.Get());
+
+    if (m_format == ImageArchiveFormat::Tar)
+    {
+        return AppendToTar(name, buffer, bufferSize, pending.Timestamp, pending.FrameCount);
+    }
+    return WriteFile(name, buffer, bufferSize);
+}
+
+bool ImageArchiveWriter::WriteFile(const char* name, const uint8_t* data, size_t size)
+{
+    const std::string fileName = m_folderPath + "/" + name;
+    std::ofstream outFile(fileName, std::ios::binary);
+    if (!outFile)
+    {
+        std::cerr << "Failed to open color image file: " << fileName << std::endl;
+        return false;
+    }
+
+    outFile.write(reinterpret_cast<const char*>(data), size);
+    outFile.close();
+    if (!outFile.good())
+    {
+        std::cerr << "Failed to write color image data: " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ImageArchiveWriter::AppendToTar(const char* name, const uint8_t* data, size_t size, uint64_t timestamp, uint64_t frameCount)
+{
+    const TarHeader header = MakeTarHeader(name, size);
+    m_tarFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const uint64_t dataOffset = m_tarOffset + TarBlockSize;
+
+    // Entry data padded to a whole number of blocks
+    m_tarFile.write(reinterpret_cast<const char*>(data), size);
+    const size_t padding = (TarBlockSize - size % TarBlockSize) % TarBlockSize;
+    const char zeros[TarBlockSize] = {};
+    m_tarFile.write(zeros, padding);
+    m_tarFile.flush();
+    if (!m_tarFile.good())
+    {
+        std::cerr << "Failed to append color image to archive - disk full or I/O error" << std::endl;
+        return false;
+    }
+    m_tarOffset = dataOffset + size + padding;
+
+    m_indexFile << frameCount << "," << timestamp << "," << dataOffset << "," << size << "," << name << std::endl;
+    return true;
+}
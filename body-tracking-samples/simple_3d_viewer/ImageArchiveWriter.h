@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "ResultMessages.h"
+
+/**
+ * Storage of the archived color images
+ */
+enum class ImageArchiveFormat
+{
+    Files,   // One color_<timestamp>_<frame>.jpg file per image in the folder
+    Tar      // All images appended to color_images.tar in the folder, with a color_images.csv index
+};
+
+/**
+ * Counters of an image archive, updated by the writer thread
+ */
+struct ImageArchiveStatistics
+{
+    uint64_t Written = 0;   // Images stored
+    uint64_t Dropped = 0;   // Images dropped because the queue of the archive was full
+    uint64_t Failed = 0;    // Images that could not be written
+};
+
+/**
+ * Saves the color images published on the result bus on a background thread.
+ *
+ * The archive is a DropNewest subscriber: a published ColorImageResult only holds a reference on
+ * the k4a_image_t, so the capture loop never waits on file creation or disk I/O. When the writer
+ * falls behind and its queue is full, the new image is dropped and counted instead of blocking.
+ */
+class ImageArchiveWriter
+{
+public:
+    /**
+     * @brief Create the folder (and the archive), subscribe to the color images and start the writer thread.
+     *
+     * @param bus Result bus the color images are published on
+     * @param folderPath Folder of the images, created if it does not exist
+     * @param format Individual files or a single tar archive
+     * @param queueCapacity Maximum number of images waiting to be written
+     * @throws std::runtime_error if the folder or the archive cannot be created
+     */
+    ImageArchiveWriter(ViewerResultBus& bus, const std::string& folderPath, ImageArchiveFormat format, size_t queueCapacity = 16);
+
+    ~ImageArchiveWriter();
+
+    ImageArchiveWriter(const ImageArchiveWriter&) = delete;
+    ImageArchiveWriter& operator=(const ImageArchiveWriter&) = delete;
+
+    /**
+     * @brief Write the queued images and stop the writer thread. Later images are ignored.
+     */
+    void Close();
+
+    ImageArchiveStatistics GetStatistics() const;
+
+private:
+    void WriterThread();
+    bool Write(const ColorImageResult& pending);
+    bool WriteFile(const char* name, const uint8_t* data, size_t size);
+    bool AppendToTar(const char* name, const uint8_t* data, size_t size, uint64_t timestamp, uint64_t frameCount);
+
+    std::string m_folderPath;
+    ImageArchiveFormat m_format;
+
+    Subscription<ColorImageResult>* m_subscription = nullptr;
+    std::atomic<uint64_t> m_written{ 0 };
+    std::atomic<uint64_t> m_failed{ 0 };
+
+    // Tar archive and its index, only used by the writer thread
+    std::ofstream m_tarFile;
+    std::ofstream m_indexFile;
+    uint64_t m_tarOffset = 0;
+
+    std::thread m_thread;
+};
@@ -0,0 +1,272 @@
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include <BodyTrackingHelpers.h>
+
+#include "MetricsPipeline.h"
+
+namespace
+{
+    const float NaN = std::numeric_limits<float>::quiet_NaN();
+
+    // Segment masses as a fraction of the body mass and the position of the segment center of mass
+    // along proximal -> distal, after Winter, "Biomechanics and Motor Control of Human Movement".
+    struct BodySegment
+    {
+        k4abt_joint_id_t Proximal;
+        k4abt_joint_id_t Distal;
+        float MassFraction;
+        float CenterRatio;
+    };
+
+    const BodySegment g_bodySegments[] =
+    {
+        { K4ABT_JOINT_PELVIS,         K4ABT_JOINT_NECK,          0.497f,  0.50f  },
+        { K4ABT_JOINT_NECK,           K4ABT_JOINT_HEAD,          0.081f,  1.00f  },
+        { K4ABT_JOINT_SHOULDER_LEFT,  K4ABT_JOINT_ELBOW_LEFT,    0.028f,  0.436f },
+        { K4ABT_JOINT_ELBOW_LEFT,     K4ABT_JOINT_WRIST_LEFT,    0.016f,  0.430f },
+        { K4ABT_JOINT_WRIST_LEFT,     K4ABT_JOINT_HANDTIP_LEFT,  0.006f,  0.506f },
+        { K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_ELBOW_RIGHT,   0.028f,  0.436f },
+        { K4ABT_JOINT_ELBOW_RIGHT,    K4ABT_JOINT_WRIST_RIGHT,   0.016f,  0.430f },
+        { K4ABT_JOINT_WRIST_RIGHT,    K4ABT_JOINT_HANDTIP_RIGHT, 0.006f,  0.506f },
+        { K4ABT_JOINT_HIP_LEFT,       K4ABT_JOINT_KNEE_LEFT,     0.100f,  0.433f },
+        { K4ABT_JOINT_KNEE_LEFT,      K4ABT_JOINT_ANKLE_LEFT,    0.0465f, 0.433f },
+        { K4ABT_JOINT_ANKLE_LEFT,     K4ABT_JOINT_FOOT_LEFT,     0.0145f, 0.50f  },
+        { K4ABT_JOINT_HIP_RIGHT,      K4ABT_JOINT_KNEE_RIGHT,    0.100f,  0.433f },
+        { K4ABT_JOINT_KNEE_RIGHT,     K4ABT_JOINT_ANKLE_RIGHT,   0.0465f, 0.433f },
+        { K4ABT_JOINT_ANKLE_RIGHT,    K4ABT_JOINT_FOOT_RIGHT,    0.0145f, 0.50f  },
+    };
+
+    k4abt_joint_id_t ParseJointName(const std::string& name)
+    {
+        for (size_t joint = 0; joint < g_jointNames.size(); joint++)
+        {
+            if (g_jointNames[joint] == name)
+            {
+                return static_cast<k4abt_joint_id_t>(joint);
+            }
+        }
+        throw std::runtime_error("Unknown joint name: " + name);
+    }
+}
+
+MetricsConfig GetDefaultMetricsConfig()
+{
+    MetricsConfig config;
+    config.Angles.push_back({ "ANGLE", JointAngleKind::Projected,
+        { K4ABT_JOINT_PELVIS, K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_ELBOW_RIGHT },
+        { K4ABT_JOINT_PELVIS, K4ABT_JOINT_NECK, K4ABT_JOINT_NOSE } });
+    return config;
+}
+
+MetricsConfig LoadMetricsConfig(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to open metrics configuration: " + fileName);
+    }
+
+    MetricsConfig config;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream tokens(line);
+        std::string kind;
+        if (!(tokens >> kind))
+        {
+            continue;
+        }
+
+        std::string first, second;
+        if (kind == "angle" && tokens >> first)
+        {
+            bool found = false;
+            for (const JointAngleDefinition& definition : GetClinicalJointAngleDefinitions())
+            {
+                if (first == "all" || first == definition.Name)
+                {
+                    config.Angles.push_back(definition);
+                    found = true;
+                }
+            }
+            if (!found)
+            {
+                throw std::runtime_error("Unknown angle '" + first + "' in line " + std::to_string(lineNumber));
+            }
+        }
+        else if (kind == "segment" && tokens >> first >> second)
+        {
+            config.Segments.emplace_back(ParseJointName(first), ParseJointName(second));
+        }
+        else if (kind == "velocity" && tokens >> first)
+        {
+            config.VelocityJoints.push_back(ParseJointName(first));
+        }
+        else if (kind == "com")
+        {
+            config.CenterOfMass = true;
+        }
+        else
+        {
+            throw std::runtime_error("Invalid metric in line " + std::to_string(lineNumber) + ": " + line);
+        }
+    }
+    return config;
+}
+
+MetricsPipeline::MetricsPipeline(MetricsConfig config)
+    : m_config(std::move(config))
+    , m_angleCalculator(m_config.Angles)
+{
+    for (const JointAngleDefinition& definition : m_config.Angles)
+    {
+        m_frame.Names.push_back(definition.Name);
+    }
+    for (const auto& segment : m_config.Segments)
+    {
+        m_frame.Names.push_back(std::string(g_jointNames[segment.first]) + "_" + std::string(g_jointNames[segment.second]) + "_LENGTH");
+    }
+    for (k4abt_joint_id_t joint : m_config.VelocityJoints)
+    {
+        m_frame.Names.push_back(std::string(g_jointNames[joint]) + "_SPEED");
+    }
+    if (m_config.CenterOfMass)
+    {
+        m_frame.Names.insert(m_frame.Names.end(), { "COM_X", "COM_Y", "COM_Z" });
+    }
+}
+
+const FrameMetrics& MetricsPipeline::Compute(const std::vector<k4abt_body_t>& bodies, uint64_t deviceTimestampUsec)
+{
+    const size_t bodyCount = bodies.size();
+    m_frame.BodyCount = bodyCount;
+    m_frame.DeviceTimestampUsec = deviceTimestampUsec;
+    m_frame.Values.resize(m_frame.Names.size() * bodyCount);
+
+    m_positions.Assign(bodies);
+
+    size_t column = 0;
+    if (!m_config.Angles.empty())
+    {
+        m_angleCalculator.Compute(m_positions, m_angles);
+        m_frame.Values.head(m_angles.Degrees.size()) = m_angles.Degrees;
+        column += m_config.Angles.size();
+    }
+
+    ComputeSegmentLengths(column);
+    column += m_config.Segments.size();
+
+    if (!m_config.VelocityJoints.empty())
+    {
+        ComputeVelocities(column, bodies, deviceTimestampUsec);
+        column += m_config.VelocityJoints.size();
+    }
+
+    if (m_config.CenterOfMass)
+    {
+        ComputeCenterOfMass(column);
+    }
+
+    return m_frame;
+}
+
+void MetricsPipeline::ComputeSegmentLengths(size_t firstColumn)
+{
+    const Eigen::Index n = static_cast<Eigen::Index>(m_frame.BodyCount);
+    for (size_t i = 0; i < m_config.Segments.size(); i++)
+    {
+        const Eigen::Index a = m_config.Segments[i].first * n;
+        const Eigen::Index b = m_config.Segments[i].second * n;
+        m_frame.Values.segment((firstColumn + i) * n, n) =
+            ((m_positions.X.segment(a, n) - m_positions.X.segment(b, n)).square() +
+             (m_positions.Y.segment(a, n) - m_positions.Y.segment(b, n)).square() +
+             (m_positions.Z.segment(a, n) - m_positions.Z.segment(b, n)).square()).sqrt();
+    }
+}
+
+void MetricsPipeline::ComputeVelocities(size_t firstColumn, const std::vector<k4abt_body_t>& bodies, uint64_t deviceTimestampUsec)
+{
+    const size_t bodyCount = m_frame.BodyCount;
+    const size_t previousCount = m_previousIds.size();
+
+    // Match bodies to the previous frame by id
+    m_previousIndex.assign(bodyCount, -1);
+    for (size_t body = 0; body < bodyCount; body++)
+    {
+        for (size_t previous = 0; previous < previousCount; previous++)
+        {
+            if (m_previousIds[previous] == bodies[body].id)
+            {
+                m_previousIndex[body] = static_cast<int>(previous);
+                break;
+            }
+        }
+    }
+
+    const bool hasPrevious = deviceTimestampUsec > m_previousTimestampUsec && previousCount > 0;
+    const float inverseDeltaSeconds = hasPrevious ? 1e6f / static_cast<float>(deviceTimestampUsec - m_previousTimestampUsec) : 0.f;
+
+    for (size_t i = 0; i < m_config.VelocityJoints.size(); i++)
+    {
+        const size_t joint = m_config.VelocityJoints[i];
+        float* speed = m_frame.Values.data() + (firstColumn + i) * bodyCount;
+        for (size_t body = 0; body < bodyCount; body++)
+        {
+            const int previous = m_previousIndex[body];
+            if (!hasPrevious || previous < 0)
+            {
+                speed[body] = NaN;
+                continue;
+            }
+            const size_t current = joint * bodyCount + body;
+            const size_t before = joint * previousCount + static_cast<size_t>(previous);
+            const float dx = m_positions.X[current] - m_previousPositions.X[before];
+            const float dy = m_positions.Y[current] - m_previousPositions.Y[before];
+            const float dz = m_positions.Z[current] - m_previousPositions.Z[before];
+            speed[body] = std::sqrt(dx * dx + dy * dy + dz * dz) * inverseDeltaSeconds;
+        }
+    }
+
+    // Remember this frame for the next one
+    m_previousPositions.BodyCount = m_positions.BodyCount;
+    m_previousPositions.X = m_positions.X;
+    m_previousPositions.Y = m_positions.Y;
+    m_previousPositions.Z = m_positions.Z;
+    m_previousIds.resize(bodyCount);
+    for (size_t body = 0; body < bodyCount; body++)
+    {
+        m_previousIds[body] = bodies[body].id;
+    }
+    m_previousTimestampUsec = deviceTimestampUsec;
+}
+
+void MetricsPipeline::ComputeCenterOfMass(size_t firstColumn)
+{
+    const Eigen::Index n = static_cast<Eigen::Index>(m_frame.BodyCount);
+    auto comX = m_frame.Values.segment(firstColumn * n, n);
+    auto comY = m_frame.Values.segment((firstColumn + 1) * n, n);
+    auto comZ = m_frame.Values.segment((firstColumn + 2) * n, n);
+    comX.setZero();
+    comY.setZero();
+    comZ.setZero();
+
+    // Mass weighted sum of the segment centers; the mass fractions add up to one
+    for (const BodySegment& segment : g_bodySegments)
+    {
+        const Eigen::Index p = segment.Proximal * n;
+        const Eigen::Index d = segment.Distal * n;
+        const float w = segment.MassFraction;
+        const float r = segment.CenterRatio;
+        comX += w * ((1.f - r) * m_positions.X.segment(p, n) + r * m_positions.X.segment(d, n));
+        comY += w * ((1.f - r) * m_positions.Y.segment(p, n) + r * m_positions.Y.segment(d, n));
+        comZ += w * ((1.f - r) * m_positions.Z.segment(p, n) + r * m_positions.Z.segment(d, n));
+    }
+}
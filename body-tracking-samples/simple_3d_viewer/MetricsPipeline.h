@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <Eigen/Dense>
+#include <k4abttypes.h>
+
+#include "BatchAngleCalculator.h"
+
+/**
+ * Selection of the derived metrics computed for every body of every frame
+ */
+struct MetricsConfig
+{
+    std::vector<JointAngleDefinition> Angles;                                  // One column per angle, in degrees
+    std::vector<std::pair<k4abt_joint_id_t, k4abt_joint_id_t>> Segments;       // <A>_<B>_LENGTH columns, in millimeters
+    std::vector<k4abt_joint_id_t> VelocityJoints;                              // <JOINT>_SPEED columns, in millimeters per second
+    bool CenterOfMass = false;                                                 // COM_X, COM_Y, COM_Z columns, in millimeters
+};
+
+/**
+ * @brief Default metrics: the right shoulder flexion angle, exported as the ANGLE column as before.
+ */
+MetricsConfig GetDefaultMetricsConfig();
+
+/**
+ * @brief Load a metrics selection from a text file.
+ *
+ * One metric per line, '#' starts a comment:
+ *   angle SHOULDER_FLEXION_RIGHT     (any name of GetClinicalJointAngleDefinitions, or "all")
+ *   segment ELBOW_RIGHT WRIST_RIGHT
+ *   velocity PELVIS
+ *   com
+ *
+ * @param fileName Path of the configuration file
+ * @throws std::runtime_error if the file cannot be read or contains an unknown entry
+ */
+MetricsConfig LoadMetricsConfig(const std::string& fileName);
+
+/**
+ * Metrics of all bodies of one frame.
+ * The value of column c for body b is stored at index c * BodyCount + b.
+ */
+struct FrameMetrics
+{
+    size_t BodyCount = 0;
+    uint64_t DeviceTimestampUsec = 0;
+    std::vector<std::string> Names;   // Column names, fixed for the lifetime of the pipeline
+    Eigen::ArrayXf Values;            // NaN where a metric is not available (degenerate pose, first frame of a body)
+
+    float At(size_t column, size_t body) const { return Values[column * BodyCount + body]; }
+};
+
+/**
+ * Computes the configured metrics once per frame so that every sink (CSV, JSON, terminal)
+ * shares the same values instead of recomputing them.
+ *
+ * All metrics are evaluated column by column over all bodies of the frame, so the cost grows
+ * linearly with the number of metrics and the formatting cost stays in the sinks.
+ */
+class MetricsPipeline
+{
+public:
+    explicit MetricsPipeline(MetricsConfig config);
+
+    const std::vector<std::string>& GetColumnNames() const { return m_frame.Names; }
+
+    /**
+     * @brief Compute the metrics of a frame.
+     *
+     * @param bodies Bodies of the frame
+     * @param deviceTimestampUsec Device timestamp of the frame, used for velocities
+     * @return Metrics of the frame, valid until the next call
+     */
+    const FrameMetrics& Compute(const std::vector<k4abt_body_t>& bodies, uint64_t deviceTimestampUsec);
+
+private:
+    void ComputeSegmentLengths(size_t firstColumn);
+    void ComputeVelocities(size_t firstColumn, const std::vector<k4abt_body_t>& bodies, uint64_t deviceTimestampUsec);
+    void ComputeCenterOfMass(size_t firstColumn);
+
+    MetricsConfig m_config;
+    BatchAngleCalculator m_angleCalculator;
+    JointAngleBatch m_angles;
+    JointPositionsSoA m_positions;
+
+    // Previous frame, for velocities
+    JointPositionsSoA m_previousPositions;
+    std::vector<uint32_t> m_previousIds;
+    uint64_t m_previousTimestampUsec = 0;
+    std::vector<int> m_previousIndex;   // Index of each current body in the previous frame, -1 if new
+
+    FrameMetrics m_frame;
+};
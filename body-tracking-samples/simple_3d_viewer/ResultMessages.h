@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <k4a/k4a.h>
+#include <k4abttypes.h>
+#include <ResultBus.h>
+
+#include "MetricsPipeline.h"
+
+/**
+ * Reference on a k4a_image_t that is released when the message holding it is dropped or consumed.
+ * Copies take another reference, so the image buffer itself is never copied.
+ */
+class ImageReference
+{
+public:
+    ImageReference() = default;
+
+    explicit ImageReference(k4a_image_t image)
+        : m_image(image)
+    {
+        if (m_image != nullptr)
+        {
+            k4a_image_reference(m_image);
+        }
+    }
+
+    ImageReference(const ImageReference& other)
+        : ImageReference(other.m_image)
+    {
+    }
+
+    ImageReference(ImageReference&& other) noexcept
+        : m_image(std::exchange(other.m_image, nullptr))
+    {
+    }
+
+    ImageReference& operator=(ImageReference other) noexcept
+    {
+        std::swap(m_image, other.m_image);
+        return *this;
+    }
+
+    ~ImageReference()
+    {
+        if (m_image != nullptr)
+        {
+            k4a_image_release(m_image);
+        }
+    }
+
+    k4a_image_t Get() const { return m_image; }
+
+private:
+    k4a_image_t m_image = nullptr;
+};
+
+/**
+ * Bodies of one tracker result with their derived metrics
+ */
+struct BodyFrameResult
+{
+    uint64_t Timestamp = 0;            // System timestamp (0 for recordings)
+    uint64_t DeviceTimestampUsec = 0;   // Center of the depth exposure, device clock
+    uint64_t SystemTimestampNsec = 0;   // Depth image received by the host, host clock (0 for recordings)
+    std::vector<k4abt_body_t> Bodies;
+    FrameMetrics Metrics;
+};
+
+/**
+ * Color image of a capture that should be saved
+ */
+struct ColorImageResult
+{
+    ImageReference Image;
+    uint64_t Timestamp = 0;
+    uint64_t FrameCount = 0;
+};
+
+/**
+ * Status message for the console
+ */
+struct EventResult
+{
+    uint64_t Timestamp = 0;
+    std::string Text;
+};
+
+using ViewerResultBus = ResultBus<BodyFrameResult, ColorImageResult, EventResult>;
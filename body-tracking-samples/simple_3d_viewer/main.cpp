@@ -2,20 +2,34 @@
 // Licensed under the MIT License.
 
 #include <array>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 #include <k4arecord/playback.h>
 #include <k4a/k4a.h>
 #include <k4abt.h>
 
 #include <BodyTrackingHelpers.h>
+#include <DeviceClockCorrelator.h>
+#include <JointSet.h>
+#include <LatencyRecorder.h>
+#include <PlaybackSelection.h>
+#include <SkeletonCodec.h>
+#include <SkeletonSmoother.h>
+#include <TrackerAdmission.h>
 #include <Utilities.h>
 #include <Window3dWrapper.h>
 
 #include "Addition.h"
+#include "ImageArchiveWriter.h"
+#include "MetricsPipeline.h"
+#include "ResultMessages.h"
 
 void PrintUsage()
 {
@@ -38,7 +52,21 @@ void PrintUsage()
     printf("  - Additional options:\n");
     printf("      -csv filename.csv - Specify the output CSV file name (optional, default: joint_positions.csv)\n");
     printf("      -novis - Disable visualization, only write to CSV (optional)\n");
+    printf("      -json filename.jsonl - Also write joint positions and metrics as JSON lines (optional)\n");
+    printf("      -skel filename.k4sk - Also write the skeletons as a compressed skeleton stream, replacing the file (optional)\n");
+    printf("      -smooth ONEEURO|KALMAN - Smooth joint positions and orientations over time (optional)\n");
+    printf("      -metrics metrics.txt - Select the derived metrics written to CSV/JSON (optional, default: right shoulder ANGLE)\n");
+    printf("      -joints FULL|UPPER_BODY|LEGS - Joints written to CSV/JSON (optional, default: FULL)\n");
 	printf("      -img frequency of saving image - Save colorimages to specified folder (optional)\n");
+    printf("      -imgtar - Append the saved color images to color_images.tar with a CSV index instead of single files (optional)\n");
+    printf("      -trace trace.json - Write a Chrome trace of the pipeline stages on exit and on key t (optional)\n");
+    printf("      -tracewindow seconds - Time window of the trace (optional, default: 10)\n");
+    printf("      -admission LATENCY|COVERAGE - Captures given to a tracker slower than the camera (optional, default: COVERAGE)\n");
+    printf("          LATENCY - One capture in the tracker, only the newest one waits for it: the freshest results\n");
+    printf("          COVERAGE - An even fraction of the camera rate the tracker sustains: the most evenly spaced results\n");
+    printf("      -start seconds, -end seconds - Play only this time range of the recording (optional, OFFLINE)\n");
+    printf("      -stride N - Track only every Nth frame of the recording (optional, OFFLINE)\n");
+    printf("      -skipcolor - Release the color images of the recording as soon as they are read (optional, OFFLINE)\n");
     printf("e.g.   (k4abt_)simple_3d_viewer.exe WFOV_BINNED CPU\n");
     printf("e.g.   (k4abt_)simple_3d_viewer.exe CPU\n");
     printf("e.g.   (k4abt_)simple_3d_viewer.exe WFOV_BINNED\n");
@@ -60,6 +88,8 @@ void PrintAppUsage()
     printf(" h: help\n");
     printf(" b: body visualization mode\n");
     printf(" k: 3d window layout\n");
+    printf(" l: print pipeline stage latencies\n");
+    printf(" t: write the Chrome trace (with -trace)\n");
     printf("\n");
 }
 
@@ -67,7 +97,24 @@ void PrintAppUsage()
 bool s_isRunning = true;
 Visualization::Layout3d s_layoutMode = Visualization::Layout3d::OnlyMainView;
 bool s_visualizeJointFrame = false;
+std::string s_traceFileName;
+int s_traceWindowSeconds = 10;
 
+void WriteTrace()
+{
+    if (s_traceFileName.empty())
+    {
+        return;
+    }
+    if (g_latencyRecorder.WriteChromeTrace(s_traceFileName, std::chrono::seconds(s_traceWindowSeconds)))
+    {
+        std::cout << "Wrote the last " << s_traceWindowSeconds << " s of the pipeline trace to " << s_traceFileName << std::endl;
+    }
+    else
+    {
+        std::cerr << "Failed to write trace file: " << s_traceFileName << std::endl;
+    }
+}
 
 int64_t ProcessKey(void* /*context*/, int key)
 {
@@ -87,6 +134,12 @@ int64_t ProcessKey(void* /*context*/, int key)
     case GLFW_KEY_H:
         PrintAppUsage();
         break;
+    case GLFW_KEY_L:
+        g_latencyRecorder.PrintReport(stdout);
+        break;
+    case GLFW_KEY_T:
+        WriteTrace();
+        break;
     }
     return 1;
 }
@@ -109,9 +162,19 @@ struct InputSettings
 	bool Visualization = true;
 	bool SaveImage = false;
     int ImageFreq = 1;
+    ImageArchiveFormat ImageFormat = ImageArchiveFormat::Files;
     std::string FileName;
     std::string ModelPath;
 	std::string CSVFileName = "joint_positions.csv";
+    std::string JSONFileName;
+    std::string SkeletonFileName;
+    std::string MetricsFileName;
+    std::string TraceFileName;
+    int TraceWindowSeconds = 10;
+    AdmissionPolicy Admission = AdmissionPolicy::HighestCoverage;
+    PlaybackSelection Playback;
+    SmoothingFilter Smoothing = SmoothingFilter::None;
+    JointProfile ExportJoints = JointProfile::Full;
 	std::string ImageFolder = "color_images";
 	k4a_fps_t CameraFPS = K4A_FRAMES_PER_SECOND_30;
 	k4a_color_resolution_t ColorResolution = K4A_COLOR_RESOLUTION_OFF;
@@ -119,6 +182,7 @@ struct InputSettings
 
 bool ParseInputSettingsFromArg(int argc, char** argv, InputSettings& inputSettings)
 {
+    bool selectionValid = true;
     for (int i = 1; i < argc; i++)
     {
         std::string inputArg(argv[i]);
@@ -180,6 +244,64 @@ bool ParseInputSettingsFromArg(int argc, char** argv, InputSettings& inputSettin
 				return false;
 			}
 		}
+        else if (inputArg == std::string("-json"))
+        {
+            if (i < argc - 1)
+                inputSettings.JSONFileName = argv[++i];
+            else
+            {
+                printf("Error: JSON file name missing\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("-skel"))
+        {
+            if (i < argc - 1)
+                inputSettings.SkeletonFileName = argv[++i];
+            else
+            {
+                printf("Error: skeleton stream file name missing\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("-smooth"))
+        {
+            std::string filter = i < argc - 1 ? argv[++i] : "";
+            if (filter == "ONEEURO")
+                inputSettings.Smoothing = SmoothingFilter::OneEuro;
+            else if (filter == "KALMAN")
+                inputSettings.Smoothing = SmoothingFilter::Kalman;
+            else
+            {
+                printf("Error: smoothing filter must be ONEEURO or KALMAN\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("-metrics"))
+        {
+            if (i < argc - 1)
+                inputSettings.MetricsFileName = argv[++i];
+            else
+            {
+                printf("Error: metrics file name missing\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("-joints"))
+        {
+            std::string profile = i < argc - 1 ? argv[++i] : "";
+            if (profile == "FULL")
+                inputSettings.ExportJoints = JointProfile::Full;
+            else if (profile == "UPPER_BODY")
+                inputSettings.ExportJoints = JointProfile::UpperBody;
+            else if (profile == "LEGS")
+                inputSettings.ExportJoints = JointProfile::Legs;
+            else
+            {
+                printf("Error: joint profile must be FULL, UPPER_BODY or LEGS\n");
+                return false;
+            }
+        }
 		else if (inputArg == std::string("FPS_5"))
 		{
 			inputSettings.CameraFPS = K4A_FRAMES_PER_SECOND_5;
@@ -205,6 +327,49 @@ bool ParseInputSettingsFromArg(int argc, char** argv, InputSettings& inputSettin
 				inputSettings.ImageFreq = atoi(argv[++i]);
             }
         }
+        else if (inputArg == std::string("-imgtar"))
+        {
+            inputSettings.ImageFormat = ImageArchiveFormat::Tar;
+        }
+        else if (inputArg == std::string("-trace"))
+        {
+            if (i < argc - 1)
+                inputSettings.TraceFileName = argv[++i];
+            else
+            {
+                printf("Error: trace file name missing\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("-tracewindow"))
+        {
+            inputSettings.TraceWindowSeconds = i < argc - 1 ? atoi(argv[++i]) : 0;
+            if (inputSettings.TraceWindowSeconds <= 0)
+            {
+                printf("Error: trace window must be a positive number of seconds\n");
+                return false;
+            }
+        }
+        else if (inputArg == std::string("-admission"))
+        {
+            std::string policy = i < argc - 1 ? argv[++i] : "";
+            if (policy == "LATENCY")
+                inputSettings.Admission = AdmissionPolicy::LowestLatency;
+            else if (policy == "COVERAGE")
+                inputSettings.Admission = AdmissionPolicy::HighestCoverage;
+            else
+            {
+                printf("Error: admission policy must be LATENCY or COVERAGE\n");
+                return false;
+            }
+        }
+        else if (ParsePlaybackSelectionArg(argc, argv, i, inputSettings.Playback, selectionValid))
+        {
+            if (!selectionValid)
+            {
+                return false;
+            }
+        }
         else
         {
             printf("Error: command not understood: %s\n", inputArg.c_str());
@@ -214,7 +379,34 @@ bool ParseInputSettingsFromArg(int argc, char** argv, InputSettings& inputSettin
     return true;
 }
 
-void PrintJointPositions(const std::vector<k4abt_body_t>& bodies) {
+// Per-frame processing shared by all outputs, and the bus the results are published on.
+// The outputs (CSV, JSON, skeleton stream, console, image archive) are sinks on their own threads.
+struct FrameOutputs
+{
+    SkeletonSmoother Smoother;
+    MetricsPipeline Metrics;
+    ViewerResultBus Bus;
+
+    FrameOutputs(SkeletonSmootherConfig smootherConfig, MetricsConfig metricsConfig)
+        : Smoother(smootherConfig), Metrics(std::move(metricsConfig)) {}
+};
+
+// Get all bodies of a body frame, smoothed over time if enabled
+std::vector<k4abt_body_t> GetBodies(k4abt_frame_t bodyFrame, FrameOutputs& outputs) {
+    LatencyScope latency(PipelineStage::BodyExtraction);
+    uint32_t numBodies = k4abt_frame_get_num_bodies(bodyFrame);
+    std::vector<k4abt_body_t> bodies(numBodies);
+    for (uint32_t i = 0; i < numBodies; i++)
+    {
+        VERIFY(k4abt_frame_get_body_skeleton(bodyFrame, i, &bodies[i].skeleton), "Get skeleton from body frame failed!");
+        bodies[i].id = k4abt_frame_get_body_id(bodyFrame, i);
+    }
+
+    outputs.Smoother.Apply(bodies, k4abt_frame_get_device_timestamp_usec(bodyFrame));
+    return bodies;
+}
+
+void PrintJointPositions(const std::vector<k4abt_body_t>& bodies, const FrameMetrics& metrics) {
     const k4abt_joint_id_t jointsOnTerminal[] =
     {
         K4ABT_JOINT_PELVIS,
@@ -226,60 +418,137 @@ void PrintJointPositions(const std::vector<k4abt_body_t>& bodies) {
         K4ABT_JOINT_FOOT_RIGHT
     };
 
-    for (const auto& body : bodies) {
+    for (size_t bodyIndex = 0; bodyIndex < bodies.size(); bodyIndex++) {
+        const k4abt_body_t& body = bodies[bodyIndex];
         std::cout << "=====Body ID: " << body.id << "=====" << std::endl;
         for (const auto& joint : jointsOnTerminal) {
             const k4a_float3_t position = body.skeleton.joints[joint].position;
-            std::cout << g_jointNames.at(joint) << ": X=" << position.xyz.x
+            std::cout << g_jointNames[joint] << ": X=" << position.xyz.x
                       << ", Y=" << position.xyz.y
                       << ", Z=" << position.xyz.z << std::endl;
         }
+        for (size_t metric = 0; metric < metrics.Names.size(); metric++) {
+            std::cout << metrics.Names[metric] << ": " << metrics.At(metric, bodyIndex) << std::endl;
+        }
         std::cout << std::endl;
     }
 }
 
-void VisualizeResult(k4abt_frame_t bodyFrame, Window3dWrapper& window3d, int depthWidth, int depthHeight, std::ofstream& csvFile, uint64_t timestamp) {
+// Compute the metrics of a frame once and hand them to every sink
+void ExportFrame(const std::vector<k4abt_body_t>& bodies, uint64_t deviceTimestampUsec, uint64_t systemTimestampNsec, uint64_t timestamp, FrameOutputs& outputs) {
+    BodyFrameResult frame;
+    frame.Timestamp = timestamp;
+    frame.DeviceTimestampUsec = deviceTimestampUsec;
+    frame.SystemTimestampNsec = systemTimestampNsec;
+    frame.Bodies = bodies;
+    {
+        LatencyScope latency(PipelineStage::Metrics);
+        frame.Metrics = outputs.Metrics.Compute(bodies, deviceTimestampUsec);
+    }
+    outputs.Bus.Publish(frame);
+}
+
+// Start the sinks of the body frames and events. Every sink has its own queue, a slow disk only delays its own file.
+std::vector<std::thread> StartSinks(ViewerResultBus& bus, std::ofstream& csvFile, std::ofstream& jsonFile, SkeletonFileWriter& skeletonFile, JointProfile exportJoints) {
+    std::vector<std::thread> sinks;
+
+    // The writers are specialized for the exported joints, pick them once
+    const auto saveCSV = DispatchJointProfile(exportJoints, [](auto joints) {
+        return &SaveMultipleBodiesToCSV<decltype(joints)>;
+    });
+    const auto saveJSON = DispatchJointProfile(exportJoints, [](auto joints) {
+        return &SaveMultipleBodiesToJSON<decltype(joints)>;
+    });
+
+    // Files must not lose frames, the capture loop waits if they fall far behind
+    Subscription<BodyFrameResult>& csv = bus.Subscribe<BodyFrameResult>(64, BackpressurePolicy::Block);
+    sinks.push_back(StartSink(csv, [&csvFile, saveCSV](const BodyFrameResult& frame) {
+        LatencyScope latency(PipelineStage::CsvWrite);
+        try {
+            saveCSV(frame.Bodies, frame.Metrics, csvFile, frame.Timestamp, frame.SystemTimestampNsec);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Failed to write CSV data: " << e.what() << std::endl;
+        }
+    }));
+
+    if (jsonFile.is_open()) {
+        Subscription<BodyFrameResult>& json = bus.Subscribe<BodyFrameResult>(64, BackpressurePolicy::Block);
+        sinks.push_back(StartSink(json, [&jsonFile, saveJSON](const BodyFrameResult& frame) {
+            if (frame.Bodies.empty()) {
+                return;
+            }
+            LatencyScope latency(PipelineStage::JsonWrite);
+            try {
+                saveJSON(frame.Bodies, frame.Metrics, jsonFile, frame.Timestamp, frame.SystemTimestampNsec);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Failed to write JSON data: " << e.what() << std::endl;
+            }
+        }));
+    }
+
+    // Every frame is coded, also those without bodies, so the stream keeps the timeline of the session
+    if (skeletonFile.IsOpen()) {
+        Subscription<BodyFrameResult>& skeletons = bus.Subscribe<BodyFrameResult>(64, BackpressurePolicy::Block);
+        sinks.push_back(StartSink(skeletons, [&skeletonFile](const BodyFrameResult& frame) {
+            LatencyScope latency(PipelineStage::SkeletonWrite);
+            if (!skeletonFile.Write(frame.DeviceTimestampUsec, frame.Bodies)) {
+                std::cerr << "Failed to write skeleton stream data" << std::endl;
+            }
+        }));
+    }
+
+    // The terminal only needs the latest frames
+    Subscription<BodyFrameResult>& console = bus.Subscribe<BodyFrameResult>(8, BackpressurePolicy::DropOldest);
+    sinks.push_back(StartSink(console, [](const BodyFrameResult& frame) {
+        PrintJointPositions(frame.Bodies, frame.Metrics);
+    }));
+
+    Subscription<EventResult>& events = bus.Subscribe<EventResult>(32, BackpressurePolicy::DropOldest);
+    sinks.push_back(StartSink(events, [](const EventResult& event) {
+        std::cerr << event.Text << std::endl;
+    }));
+
+    return sinks;
+}
+
+void VisualizeResult(k4abt_frame_t bodyFrame, Window3dWrapper& window3d, int depthWidth, int depthHeight, FrameOutputs& outputs, uint64_t timestamp) {
 
     // Obtain original capture that generates the body tracking result
     k4a_capture_t originalCapture = k4abt_frame_get_capture(bodyFrame);
     k4a_image_t depthImage = k4a_capture_get_depth_image(originalCapture);
 
-    std::vector<Color> pointCloudColors(depthWidth * depthHeight, { 1.f, 1.f, 1.f, 1.f });
-
-    // Read body index map and assign colors
-    k4a_image_t bodyIndexMap = k4abt_frame_get_body_index_map(bodyFrame);
-    const uint8_t* bodyIndexMapBuffer = k4a_image_get_buffer(bodyIndexMap);
-    for (int i = 0; i < depthWidth * depthHeight; i++)
     {
-        uint8_t bodyIndex = bodyIndexMapBuffer[i];
-        if (bodyIndex != K4ABT_BODY_INDEX_MAP_BACKGROUND)
+        LatencyScope latency(PipelineStage::PointCloudBuild);
+        std::vector<Color> pointCloudColors(depthWidth * depthHeight, { 1.f, 1.f, 1.f, 1.f });
+
+        // Read body index map and assign colors
+        k4a_image_t bodyIndexMap = k4abt_frame_get_body_index_map(bodyFrame);
+        const uint8_t* bodyIndexMapBuffer = k4a_image_get_buffer(bodyIndexMap);
+        for (int i = 0; i < depthWidth * depthHeight; i++)
         {
-            uint32_t bodyId = k4abt_frame_get_body_id(bodyFrame, bodyIndex);
-            pointCloudColors[i] = g_bodyColors[bodyId % g_bodyColors.size()];
+            uint8_t bodyIndex = bodyIndexMapBuffer[i];
+            if (bodyIndex != K4ABT_BODY_INDEX_MAP_BACKGROUND)
+            {
+                uint32_t bodyId = k4abt_frame_get_body_id(bodyFrame, bodyIndex);
+                pointCloudColors[i] = g_bodyColors[bodyId % g_bodyColors.size()];
+            }
         }
-    }
-    k4a_image_release(bodyIndexMap);
+        k4a_image_release(bodyIndexMap);
 
-    // Visualize point cloud
-    window3d.UpdatePointClouds(depthImage, pointCloudColors);
+        // Visualize point cloud
+        window3d.UpdatePointClouds(depthImage, pointCloudColors);
+    }
 
     // Visualize the skeleton data
     window3d.CleanJointsAndBones();
-    uint32_t numBodies = k4abt_frame_get_num_bodies(bodyFrame);
 
     // For multiple bodies
-    std::vector<k4abt_body_t> bodies;
-    bodies.reserve(numBodies);
+    std::vector<k4abt_body_t> bodies = GetBodies(bodyFrame, outputs);
 
-    for (uint32_t i = 0; i < numBodies; i++)
+    for (const k4abt_body_t& body : bodies)
     {
-        k4abt_body_t body;
-        VERIFY(k4abt_frame_get_body_skeleton(bodyFrame, i, &body.skeleton), "Get skeleton from body frame failed!");
-        body.id = k4abt_frame_get_body_id(bodyFrame, i);
-
-        // Add body to the vector
-        bodies.push_back(body);
-
         // Assign the correct color based on the body id
         Color color = g_bodyColors[body.id % g_bodyColors.size()];
         color.a = 0.4f;
@@ -320,25 +589,15 @@ void VisualizeResult(k4abt_frame_t bodyFrame, Window3dWrapper& window3d, int dep
         }
     }
 
-    // Print joint positions to terminal
-    PrintJointPositions(bodies);
-
-	// Save the joint positions to a CSV file
-    if (!bodies.empty()) {
-        try {
-            SaveMultipleBodiesToCSV(bodies, csvFile, timestamp);
-        }
-        catch (const std::exception& e) {
-            std::cerr << "Failed to write CSV data: " << e.what() << std::endl;
-        }
-    }
+    // Print and save the joint positions and metrics
+    ExportFrame(bodies, k4abt_frame_get_device_timestamp_usec(bodyFrame), k4abt_frame_get_system_timestamp_nsec(bodyFrame), timestamp, outputs);
 
     k4a_capture_release(originalCapture);
     k4a_image_release(depthImage);
 
 }
 
-void PlayFile(InputSettings inputSettings, std::ofstream& csvFile)
+void PlayFile(InputSettings inputSettings, FrameOutputs& outputs)
 {
     // Initialize the 3d window controller
     Window3dWrapper window3d;
@@ -361,6 +620,23 @@ void PlayFile(InputSettings inputSettings, std::ofstream& csvFile)
         return;
     }
 
+    // Only the selected part of the recording is read and tracked, the captures before it are skipped by seeking
+    const PlaybackSelection& selection = inputSettings.Playback;
+    k4a_record_configuration_t recordConfig;
+    if (k4a_playback_get_record_configuration(playbackHandle, &recordConfig) != K4A_RESULT_SUCCEEDED)
+    {
+        printf("Failed to get record configuration\n");
+        return;
+    }
+    const uint64_t framePeriodUsec = GetFramePeriodUsec(recordConfig.camera_fps);
+    if (selection.StartUsec > 0 &&
+        k4a_playback_seek_timestamp(playbackHandle, static_cast<int64_t>(selection.StartUsec), K4A_PLAYBACK_SEEK_BEGIN) != K4A_RESULT_SUCCEEDED)
+    {
+        printf("Failed to seek to %.3f s\n", selection.StartUsec / 1000000.0);
+        return;
+    }
+    uint64_t skippedCaptures = 0;
+
     k4a_capture_t capture = nullptr;
     k4a_stream_result_t playbackResult = K4A_STREAM_RESULT_SUCCEEDED;
 
@@ -380,9 +656,17 @@ void PlayFile(InputSettings inputSettings, std::ofstream& csvFile)
         window3d.SetKeyCallback(ProcessKey);
     }
 
+    // Start times of the captures in the tracker, by device timestamp
+    LatencyStartTimes trackerResidency;
+
     while (playbackResult == K4A_STREAM_RESULT_SUCCEEDED && s_isRunning)
     {
+        const LatencyClock::time_point acquireStart = LatencyClock::now();
         playbackResult = k4a_playback_get_next_capture(playbackHandle, &capture);
+        if (playbackResult == K4A_STREAM_RESULT_SUCCEEDED)
+        {
+            g_latencyRecorder.Record(PipelineStage::CaptureAcquire, acquireStart, LatencyClock::now());
+        }
         if (playbackResult == K4A_STREAM_RESULT_EOF)
         {
             // End of file reached
@@ -399,11 +683,38 @@ void PlayFile(InputSettings inputSettings, std::ofstream& csvFile)
                 k4a_capture_release(capture);
                 continue;
             }
+            const uint64_t depthTimestampUsec = k4a_image_get_device_timestamp_usec(depthImage);
             // Release the Depth image
             k4a_image_release(depthImage);
 
+            const uint64_t timeUsec = depthTimestampUsec > recordConfig.start_timestamp_offset_usec ?
+                depthTimestampUsec - recordConfig.start_timestamp_offset_usec : 0;
+            if (timeUsec >= selection.EndUsec)
+            {
+                k4a_capture_release(capture);
+                break;
+            }
+            if (!selection.IsSelected(timeUsec, framePeriodUsec))
+            {
+                skippedCaptures++;
+                k4a_capture_release(capture);
+                continue;
+            }
+            if (selection.SkipColor)
+            {
+                k4a_capture_set_color_image(capture, nullptr);
+            }
+
             //enque capture and pop results - synchronous
-            k4a_wait_result_t queueCaptureResult = k4abt_tracker_enqueue_capture(tracker, capture, K4A_WAIT_INFINITE);
+            k4a_wait_result_t queueCaptureResult;
+            {
+                LatencyScope latency(PipelineStage::TrackerEnqueueWait);
+                queueCaptureResult = k4abt_tracker_enqueue_capture(tracker, capture, K4A_WAIT_INFINITE);
+            }
+            if (queueCaptureResult == K4A_WAIT_RESULT_SUCCEEDED)
+            {
+                trackerResidency.Start(depthTimestampUsec);
+            }
 
             // Release the sensor capture once it is no longer needed.
             k4a_capture_release(capture);
@@ -418,37 +729,20 @@ void PlayFile(InputSettings inputSettings, std::ofstream& csvFile)
             k4a_wait_result_t popFrameResult = k4abt_tracker_pop_result(tracker, &bodyFrame, K4A_WAIT_INFINITE);
             if (popFrameResult == K4A_WAIT_RESULT_SUCCEEDED)
             {
+                trackerResidency.Stop(PipelineStage::TrackerResidency, k4abt_frame_get_device_timestamp_usec(bodyFrame));
+
                 /************* Successfully get a body tracking result, process the result here ***************/
                 if (inputSettings.Visualization)
                 {
-                    VisualizeResult(bodyFrame, window3d, depthWidth, depthHeight, csvFile, 0);
+                    VisualizeResult(bodyFrame, window3d, depthWidth, depthHeight, outputs, 0);
                 }
                 else
                 {
                     // Extract bodies and save to CSV without visualization
-                    uint32_t numBodies = k4abt_frame_get_num_bodies(bodyFrame);
-                    std::vector<k4abt_body_t> bodies;
-                    bodies.reserve(numBodies);
-
-                    for (uint32_t i = 0; i < numBodies; i++)
-                    {
-                        k4abt_body_t body;
-                        VERIFY(k4abt_frame_get_body_skeleton(bodyFrame, i, &body.skeleton), "Get skeleton from body frame failed!");
-                        body.id = k4abt_frame_get_body_id(bodyFrame, i);
-                        bodies.push_back(body);
-                    }
+                    std::vector<k4abt_body_t> bodies = GetBodies(bodyFrame, outputs);
 
-                    // Print joint positions to terminal
-                    PrintJointPositions(bodies);
-
-                    if (!bodies.empty()) {
-                        try {
-                            SaveMultipleBodiesToCSV(bodies, csvFile, 0);
-                        }
-                        catch (const std::exception& e) {
-                            std::cerr << "Failed to write CSV data: " << e.what() << std::endl;
-                        }
-                    }
+                    // Print and save the joint positions and metrics
+                    ExportFrame(bodies, k4abt_frame_get_device_timestamp_usec(bodyFrame), k4abt_frame_get_system_timestamp_nsec(bodyFrame), 0, outputs);
                 }
                 //Release the bodyFrame
                 k4abt_frame_release(bodyFrame);
@@ -476,11 +770,15 @@ void PlayFile(InputSettings inputSettings, std::ofstream& csvFile)
         window3d.Delete();
     }
     
+    if (selection.IsRestricted())
+    {
+        printf("Skipped %llu captures outside of the selection\n", static_cast<unsigned long long>(skippedCaptures));
+    }
     printf("Finished body tracking processing!\n");
     k4a_playback_close(playbackHandle);
 }
 
-void PlayFromDevice(InputSettings inputSettings, std::ofstream& csvFile) 
+void PlayFromDevice(InputSettings inputSettings, FrameOutputs& outputs) 
 {
     k4a_device_t device = nullptr;
     VERIFY(k4a_device_open(0, &device), "Open K4A Device failed!");
@@ -525,48 +823,79 @@ void PlayFromDevice(InputSettings inputSettings, std::ofstream& csvFile)
 
     uint64_t frameCount = 0;
 
-    // Create image directory before starting the capture loop
+    // Color images are written on a background thread, the capture loop only queues them
+    std::unique_ptr<ImageArchiveWriter> imageArchive;
     if (inputSettings.SaveImage)
     {
         try {
-            if (!std::filesystem::exists(inputSettings.ImageFolder))
-            {
-                if (!std::filesystem::create_directories(inputSettings.ImageFolder))
-                {
-                    std::cerr << "Failed to create directory: " << inputSettings.ImageFolder << std::endl;
-                }
-                else
-                {
-                    std::cout << "Created directory for images: " << inputSettings.ImageFolder << std::endl;
-                }
-            }
+            imageArchive = std::make_unique<ImageArchiveWriter>(outputs.Bus, inputSettings.ImageFolder, inputSettings.ImageFormat);
         }
-        catch (const std::filesystem::filesystem_error& e) {
-            std::cerr << "Filesystem error: " << e.what() << std::endl;
+        catch (const std::exception& e) {
+            std::cerr << "Failed to create image archive: " << e.what() << std::endl;
         }
     }
 
+    // Start times of the captures in the tracker, by device timestamp
+    LatencyStartTimes trackerResidency;
+
+    // Exposure times of the captures on the host clock, for the glass-to-result latencies
+    DeviceClockCorrelator deviceClock;
+
+    // Decides which captures go to the tracker when it is slower than the camera
+    TrackerAdmissionController admission(inputSettings.Admission);
+    k4a_capture_t heldCapture = nullptr;
+    uint64_t heldTimestampUsec = 0;
+    int admittedDecimation = 1;
+
+    // timeout_in_ms is set to 0. Return immediately no matter whether the capture is successfully added to the
+    // queue or not, a full queue is counted as a dropped capture.
+    auto enqueueCapture = [&](k4a_capture_t capture, uint64_t depthTimestampUsec) {
+        k4a_wait_result_t queueCaptureResult;
+        {
+            LatencyScope latency(PipelineStage::TrackerEnqueueWait);
+            queueCaptureResult = k4abt_tracker_enqueue_capture(tracker, capture, 0);
+        }
+        if (queueCaptureResult == K4A_WAIT_RESULT_SUCCEEDED)
+        {
+            trackerResidency.Start(depthTimestampUsec);
+            admission.OnEnqueued(depthTimestampUsec, LatencyClock::now());
+        }
+        else if (queueCaptureResult == K4A_WAIT_RESULT_TIMEOUT)
+        {
+            admission.OnQueueFull();
+        }
+        return queueCaptureResult;
+    };
+
     while (s_isRunning)
     {
         k4a_capture_t sensorCapture = nullptr;
+        const LatencyClock::time_point acquireStart = LatencyClock::now();
         k4a_wait_result_t getCaptureResult = k4a_device_get_capture(device, &sensorCapture, 0); // timeout_in_ms is set to 0
 
         if (getCaptureResult == K4A_WAIT_RESULT_SUCCEEDED)
         {
+            g_latencyRecorder.Record(PipelineStage::CaptureAcquire, acquireStart, LatencyClock::now());
+
 			// Save image following the frequency
-			if (inputSettings.SaveImage && frameCount % inputSettings.ImageFreq == 0)
+			if (imageArchive && frameCount % inputSettings.ImageFreq == 0)
 			{
 				k4a_image_t colorImage = k4a_capture_get_color_image(sensorCapture);
 				if (colorImage != nullptr)
 				{
                     // Get timestamp of system
                     uint64_t colorTimestamp = GetTimestamp();
-                    try {
-					    SaveColorImage(colorImage, inputSettings.ImageFolder, colorTimestamp, frameCount);
-                        std::cout << "Saved image at frame: " << frameCount << std::endl;
-                    }
-                    catch (const std::exception& e) {
-                        std::cerr << "Failed to save image: " << e.what() << std::endl;
+
+                    // Zero copy: the message only holds a reference on the SDK image buffer
+                    if (outputs.Bus.Publish(ColorImageResult{ ImageReference(colorImage), colorTimestamp, frameCount }) > 0)
+                    {
+                        // Report the first drop and then every 30th, the writer cannot keep up with the disk
+                        uint64_t dropped = imageArchive->GetStatistics().Dropped;
+                        if (dropped % 30 == 1)
+                        {
+                            outputs.Bus.Publish(EventResult{ colorTimestamp,
+                                "Image archive queue full, dropped " + std::to_string(dropped) + " images so far" });
+                        }
                     }
 					k4a_image_release(colorImage);
 				}
@@ -574,9 +903,40 @@ void PlayFromDevice(InputSettings inputSettings, std::ofstream& csvFile)
                     std::cerr << "No color image available to save" << std::endl;
                 }
 			}
-            // timeout_in_ms is set to 0. Return immediately no matter whether the sensorCapture is successfully added
-            // to the queue or not.
-            k4a_wait_result_t queueCaptureResult = k4abt_tracker_enqueue_capture(tracker, sensorCapture, 0);
+            uint64_t depthTimestampUsec = 0;
+            if (k4a_image_t depthImage = k4a_capture_get_depth_image(sensorCapture))
+            {
+                depthTimestampUsec = k4a_image_get_device_timestamp_usec(depthImage);
+                const uint64_t receivedNsec = k4a_image_get_system_timestamp_nsec(depthImage);
+                k4a_image_release(depthImage);
+
+                deviceClock.AddSample(depthTimestampUsec, receivedNsec);
+                if (deviceClock.IsValid())
+                {
+                    g_latencyRecorder.Record(PipelineStage::GlassToReceive,
+                        FromHostNsec(deviceClock.ToHostNsec(depthTimestampUsec)), FromHostNsec(receivedNsec));
+                }
+            }
+
+            k4a_wait_result_t queueCaptureResult = K4A_WAIT_RESULT_SUCCEEDED;
+            switch (admission.OnCapture(LatencyClock::now()))
+            {
+            case AdmissionDecision::Enqueue:
+                queueCaptureResult = enqueueCapture(sensorCapture, depthTimestampUsec);
+                break;
+            case AdmissionDecision::Hold:
+                // Keep only the newest capture until the tracker is free
+                if (heldCapture != nullptr)
+                {
+                    k4a_capture_release(heldCapture);
+                }
+                k4a_capture_reference(sensorCapture);
+                heldCapture = sensorCapture;
+                heldTimestampUsec = depthTimestampUsec;
+                break;
+            case AdmissionDecision::Drop:
+                break;
+            }
 
             // Release the sensor capture once it is no longer needed.
             k4a_capture_release(sensorCapture);
@@ -595,59 +955,103 @@ void PlayFromDevice(InputSettings inputSettings, std::ofstream& csvFile)
 
         // Pop Result from Body Tracker
         k4abt_frame_t bodyFrame = nullptr;
+        uint64_t shownExposureNsec = 0;
         k4a_wait_result_t popFrameResult = k4abt_tracker_pop_result(tracker, &bodyFrame, 0); // timeout_in_ms is set to 0
         if (popFrameResult == K4A_WAIT_RESULT_SUCCEEDED)
         {
+            trackerResidency.Stop(PipelineStage::TrackerResidency, k4abt_frame_get_device_timestamp_usec(bodyFrame));
+            admission.OnPopped(k4abt_frame_get_device_timestamp_usec(bodyFrame), LatencyClock::now());
+            if (admission.GetStatistics().Decimation != admittedDecimation)
+            {
+                admittedDecimation = admission.GetStatistics().Decimation;
+                outputs.Bus.Publish(EventResult{ GetTimestamp(), admittedDecimation == 1 ?
+                    std::string("Tracker keeps up, admitting every capture") :
+                    "Tracker overloaded, admitting 1 of every " + std::to_string(admittedDecimation) + " captures" });
+            }
+            if (deviceClock.IsValid())
+            {
+                shownExposureNsec = deviceClock.ToHostNsec(k4abt_frame_get_device_timestamp_usec(bodyFrame));
+                g_latencyRecorder.Record(PipelineStage::GlassToPop, FromHostNsec(shownExposureNsec), LatencyClock::now());
+            }
+
 			// Get timestamp of system
             uint64_t bodyTimestamp = GetTimestamp();
             
             // Process the body frame based on visualization setting
             if (inputSettings.Visualization)
             {
-                VisualizeResult(bodyFrame, window3d, depthWidth, depthHeight, csvFile, bodyTimestamp);
+                VisualizeResult(bodyFrame, window3d, depthWidth, depthHeight, outputs, bodyTimestamp);
             }
             else
             {
                 // Extract bodies and save to CSV without visualization
-                uint32_t numBodies = k4abt_frame_get_num_bodies(bodyFrame);
-                std::vector<k4abt_body_t> bodies;
-                bodies.reserve(numBodies);
+                std::vector<k4abt_body_t> bodies = GetBodies(bodyFrame, outputs);
 
-                for (uint32_t i = 0; i < numBodies; i++)
-                {
-                    k4abt_body_t body;
-                    VERIFY(k4abt_frame_get_body_skeleton(bodyFrame, i, &body.skeleton), "Get skeleton from body frame failed!");
-                    body.id = k4abt_frame_get_body_id(bodyFrame, i);
-                    bodies.push_back(body);
-                }
-
-                // Print joint positions to terminal
-                PrintJointPositions(bodies);
-
-                if (!bodies.empty()) {
-                    try {
-                        SaveMultipleBodiesToCSV(bodies, csvFile, bodyTimestamp);
-                    }
-                    catch (const std::exception& e) {
-                        std::cerr << "Failed to write CSV data: " << e.what() << std::endl;
-                    }
-                }
+                // Print and save the joint positions and metrics
+                ExportFrame(bodies, k4abt_frame_get_device_timestamp_usec(bodyFrame), k4abt_frame_get_system_timestamp_nsec(bodyFrame), bodyTimestamp, outputs);
             }
             
             //Release the bodyFrame
             k4abt_frame_release(bodyFrame);
         }
+
+        // The tracker is free again, give it the newest capture that waited for it
+        if (heldCapture != nullptr && admission.CanEnqueueHeld())
+        {
+            k4a_wait_result_t queueCaptureResult = enqueueCapture(heldCapture, heldTimestampUsec);
+            k4a_capture_release(heldCapture);
+            heldCapture = nullptr;
+            if (queueCaptureResult == K4A_WAIT_RESULT_FAILED)
+            {
+                std::cout << "Error! Add capture to tracker process queue failed!" << std::endl;
+                break;
+            }
+        }
        
         if (inputSettings.Visualization)
         {
             window3d.SetLayout3d(s_layoutMode);
             window3d.SetJointFrameVisualization(s_visualizeJointFrame);
             window3d.Render();
+
+            // The swap shows the body frame popped in this iteration
+            if (shownExposureNsec != 0)
+            {
+                g_latencyRecorder.Record(PipelineStage::GlassToSwap, FromHostNsec(shownExposureNsec), LatencyClock::now());
+            }
         }
 		frameCount++;
     }
 
     std::cout << "Finished body tracking processing!" << std::endl;
+    if (heldCapture != nullptr)
+    {
+        k4a_capture_release(heldCapture);
+    }
+
+    const AdmissionStatistics& admissionStatistics = admission.GetStatistics();
+    std::cout << "Tracker admission: " << admissionStatistics.Captures << " captures, " << admissionStatistics.Enqueued
+              << " enqueued, " << admission.GetDroppedCount() << " dropped";
+    for (size_t reason = 0; reason < DropReasonCount; reason++)
+    {
+        std::cout << (reason == 0 ? " (" : ", ") << g_dropReasonNames[reason] << " " << admissionStatistics.Dropped[reason];
+    }
+    std::cout << ")" << std::endl;
+    printf("Tracker residency %.1f ms, service time %.1f ms, capture interval %.1f ms, pop interval %.1f ms\n",
+        admissionStatistics.ResidencyMs, admissionStatistics.ServiceTimeMs, admissionStatistics.CaptureIntervalMs, admissionStatistics.PopIntervalMs);
+    if (deviceClock.IsValid())
+    {
+        printf("Device clock: host - device offset %.0f us, drift %.1f ppm\n", deviceClock.GetOffsetUsec(), deviceClock.GetDriftPpm());
+    }
+
+    if (imageArchive)
+    {
+        // Wait for the queued images before reporting
+        imageArchive->Close();
+        ImageArchiveStatistics statistics = imageArchive->GetStatistics();
+        std::cout << "Saved " << statistics.Written << " color images, dropped " << statistics.Dropped
+                  << ", failed " << statistics.Failed << std::endl;
+    }
 
     if (inputSettings.Visualization)
     {
@@ -672,6 +1076,24 @@ int main(int argc, char** argv)
         return -1;
     }
 
+    // Select the derived metrics shared by all outputs
+    MetricsConfig metricsConfig = GetDefaultMetricsConfig();
+    if (!inputSettings.MetricsFileName.empty())
+    {
+        try
+        {
+            metricsConfig = LoadMetricsConfig(inputSettings.MetricsFileName);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return -1;
+        }
+    }
+    SkeletonSmootherConfig smootherConfig;
+    smootherConfig.Filter = inputSettings.Smoothing;
+    FrameOutputs outputs(smootherConfig, std::move(metricsConfig));
+
     // Open the CSV file
     std::ofstream csvFile(inputSettings.CSVFileName, std::ios::app);
     if (!csvFile.is_open())
@@ -680,16 +1102,69 @@ int main(int argc, char** argv)
         return -1;
     }
 
+    // Open the JSON file
+    std::ofstream jsonFile;
+    if (!inputSettings.JSONFileName.empty())
+    {
+        jsonFile.open(inputSettings.JSONFileName, std::ios::app);
+        if (!jsonFile.is_open())
+        {
+            std::cerr << "Failed to open JSON file: " << inputSettings.JSONFileName << std::endl;
+            return -1;
+        }
+    }
+
+    // Open the skeleton stream, coding only the exported joints
+    SkeletonFileWriter skeletonFile;
+    if (!inputSettings.SkeletonFileName.empty())
+    {
+        SkeletonCodecConfig skeletonConfig;
+        skeletonConfig.JointMask = DispatchJointProfile(inputSettings.ExportJoints, [](auto joints) {
+            return decltype(joints)::Bits;
+        });
+        if (!skeletonFile.Open(inputSettings.SkeletonFileName, skeletonConfig))
+        {
+            std::cerr << "Failed to open skeleton stream file: " << inputSettings.SkeletonFileName << std::endl;
+            return -1;
+        }
+    }
+
+    // Spans are only kept for threads that start recording after tracing is enabled
+    s_traceFileName = inputSettings.TraceFileName;
+    s_traceWindowSeconds = inputSettings.TraceWindowSeconds;
+    if (!s_traceFileName.empty())
+    {
+        g_latencyRecorder.EnableTrace();
+    }
+    g_latencyRecorder.SetThreadName("capture loop");
+
+    std::vector<std::thread> sinks = StartSinks(outputs.Bus, csvFile, jsonFile, skeletonFile, inputSettings.ExportJoints);
+
     // Either play the offline file or play from the device
     if (inputSettings.Offline == true)
     {
-        PlayFile(inputSettings, csvFile);
+        PlayFile(inputSettings, outputs);
     }
     else
     {
-        PlayFromDevice(inputSettings, csvFile);
+        PlayFromDevice(inputSettings, outputs);
+    }
+
+    // Let the sinks write what is still queued
+    outputs.Bus.Close();
+    for (std::thread& sink : sinks)
+    {
+        sink.join();
     }
 	csvFile.close();
+	jsonFile.close();
+    if (!skeletonFile.Close())
+    {
+        std::cerr << "Failed to write the index of the skeleton stream: " << inputSettings.SkeletonFileName << std::endl;
+    }
+
+    g_latencyRecorder.PrintReport(stdout);
+    WriteTrace();
 
     return 0;
 }